@@ -0,0 +1,725 @@
+/* This file is part of GEGL editor -- a gtk frontend for GEGL
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gegl.h>
+#include <gegl-plugin.h>
+
+#include "gegl-disk-cache.h"
+
+#define ENTRY_SUFFIX ".gegl"
+
+struct _GeglDiskCache
+{
+  gchar   *path;
+  guint64  max_size;
+};
+
+typedef struct
+{
+  gchar   *path;
+  guint64  size;
+  gint64   mtime;
+} CacheEntry;
+
+
+GeglDiskCache *
+gegl_disk_cache_new (const gchar *path,
+                     guint64      max_size)
+{
+  GeglDiskCache *cache;
+
+  g_return_val_if_fail (path != NULL, NULL);
+
+  if (g_mkdir_with_parents (path, 0755) != 0)
+    {
+      g_warning ("unable to create cache directory %s", path);
+      return NULL;
+    }
+
+  cache           = g_new0 (GeglDiskCache, 1);
+  cache->path     = g_strdup (path);
+  cache->max_size = max_size;
+
+  return cache;
+}
+
+void
+gegl_disk_cache_free (GeglDiskCache *cache)
+{
+  if (! cache)
+    return;
+
+  g_free (cache->path);
+  g_free (cache);
+}
+
+static gchar *
+entry_path (GeglDiskCache *cache,
+            const gchar   *key)
+{
+  gchar *name = g_strconcat (key, ENTRY_SUFFIX, NULL);
+  gchar *path = g_build_filename (cache->path, name, NULL);
+
+  g_free (name);
+
+  return path;
+}
+
+static void
+hash_file (GChecksum   *checksum,
+           const gchar *file_path)
+{
+  GStatBuf  st;
+  gint64    mtime_nsec = 0;
+  gchar    *str;
+
+  if (g_stat (file_path, &st) != 0)
+    return;
+
+  /* a file rewritten within the same second has to miss too */
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+  mtime_nsec = st.st_mtim.tv_nsec;
+#endif
+
+  str = g_strdup_printf ("%s:%" G_GUINT64_FORMAT ":%" G_GINT64_FORMAT
+                         ".%09" G_GINT64_FORMAT ";",
+                         file_path,
+                         (guint64) st.st_size,
+                         (gint64) st.st_mtime,
+                         mtime_nsec);
+  g_checksum_update (checksum, (const guchar *) str, -1);
+  g_free (str);
+}
+
+/* returns the local file read through the path or URI property @pspec of
+ * @node, if any, in @file_path.  Returns FALSE if it's a URI which isn't a
+ * local file, whose changes can't be told.
+ */
+static gboolean
+get_file (GeglNode    *node,
+          GParamSpec  *pspec,
+          gchar      **file_path)
+{
+  gchar    *uri       = NULL;
+  gboolean  cacheable = TRUE;
+
+  *file_path = NULL;
+
+  if (GEGL_IS_PARAM_SPEC_FILE_PATH (pspec))
+    {
+      gegl_node_get (node, pspec->name, file_path, NULL);
+
+      return TRUE;
+    }
+
+  gegl_node_get (node, pspec->name, &uri, NULL);
+
+  if (uri && *uri)
+    {
+      gchar *scheme = g_uri_parse_scheme (uri);
+
+      *file_path = g_filename_from_uri (uri, NULL, NULL);
+
+      /* loaders accept plain paths as URIs too */
+      if (! *file_path && ! scheme)
+        *file_path = g_strdup (uri);
+      else if (! *file_path)
+        cacheable = FALSE;
+
+      g_free (scheme);
+    }
+
+  g_free (uri);
+
+  return cacheable;
+}
+
+/* adds the operation and the property values of @node, and the size and
+ * modification time of the files it reads, to @checksum.  Returns FALSE
+ * if any of them can't be told apart by value, like buffers, or remote
+ * URIs.
+ */
+static gboolean
+hash_node (GeglNode  *node,
+           GChecksum *checksum)
+{
+  const gchar  *op_name   = gegl_node_get_operation (node);
+  GParamSpec  **properties;
+  guint         n_properties;
+  GString      *str;
+  gboolean      cacheable = TRUE;
+  gint          i;
+
+  if (! op_name)
+    return FALSE;
+
+  str = g_string_new (NULL);
+
+  g_string_append_printf (str, "%s opi=%s;",
+                          op_name, gegl_operation_get_op_version (op_name));
+
+  properties = gegl_operation_list_properties (op_name, &n_properties);
+
+  for (i = 0; cacheable && i < n_properties; i++)
+    {
+      GParamSpec *pspec = properties[i];
+      GValue      value = G_VALUE_INIT;
+      GValue      str_value = G_VALUE_INIT;
+      GType       type  = G_PARAM_SPEC_VALUE_TYPE (pspec);
+      gchar       buf[G_ASCII_DTOSTR_BUF_SIZE];
+
+      g_value_init (&value, type);
+      gegl_node_get_property (node, pspec->name, &value);
+
+      g_string_append_printf (str, " %s=", pspec->name);
+
+      if (type == G_TYPE_DOUBLE)
+        {
+          g_string_append (str, g_ascii_dtostr (buf, sizeof (buf),
+                                                g_value_get_double (&value)));
+        }
+      else if (type == G_TYPE_FLOAT)
+        {
+          g_string_append (str, g_ascii_dtostr (buf, sizeof (buf),
+                                                g_value_get_float (&value)));
+        }
+      else if (type == GEGL_TYPE_COLOR)
+        {
+          GeglColor *color = g_value_get_object (&value);
+          gdouble    rgba[4] = { 0.0, };
+          gint       j;
+
+          if (color)
+            gegl_color_get_rgba (color, &rgba[0], &rgba[1], &rgba[2], &rgba[3]);
+
+          for (j = 0; j < 4; j++)
+            {
+              g_string_append (str, g_ascii_dtostr (buf, sizeof (buf),
+                                                    rgba[j]));
+              g_string_append_c (str, ',');
+            }
+        }
+      else if (type == GEGL_TYPE_PATH)
+        {
+          GeglPath *path = g_value_get_object (&value);
+
+          if (path)
+            {
+              gchar *path_str = gegl_path_to_string (path);
+
+              g_string_append (str, path_str);
+              g_free (path_str);
+            }
+        }
+      else if (GEGL_IS_PARAM_SPEC_FORMAT (pspec))
+        {
+          const Babl *format = g_value_get_pointer (&value);
+
+          if (format)
+            g_string_append (str, babl_get_name (format));
+        }
+      else if (G_TYPE_IS_OBJECT (type) || G_TYPE_IS_BOXED (type) ||
+               type == G_TYPE_POINTER)
+        {
+          /* buffers, and other references, are only cacheable when
+           * they're unset
+           */
+          if (g_value_peek_pointer (&value))
+            cacheable = FALSE;
+        }
+      else if (g_value_type_transformable (type, G_TYPE_STRING))
+        {
+          const gchar *value_str;
+
+          g_value_init (&str_value, G_TYPE_STRING);
+          g_value_transform (&value, &str_value);
+
+          value_str = g_value_get_string (&str_value);
+
+          /* strings are length-prefixed, so that they can't be mistaken
+           * for the following properties
+           */
+          if (value_str)
+            g_string_append_printf (str, "%" G_GSIZE_FORMAT ":%s",
+                                    strlen (value_str), value_str);
+
+          g_value_unset (&str_value);
+        }
+      else
+        {
+          cacheable = FALSE;
+        }
+
+      g_string_append_c (str, ';');
+
+      if (cacheable &&
+          (GEGL_IS_PARAM_SPEC_FILE_PATH (pspec) ||
+           GEGL_IS_PARAM_SPEC_URI (pspec)))
+        {
+          gchar *file_path;
+
+          cacheable = get_file (node, pspec, &file_path);
+
+          if (file_path)
+            hash_file (checksum, file_path);
+
+          g_free (file_path);
+        }
+
+      g_value_unset (&value);
+    }
+
+  g_free (properties);
+
+  g_checksum_update (checksum, (const guchar *) str->str, str->len);
+  g_string_free (str, TRUE);
+
+  return cacheable;
+}
+
+/* returns the key of the content of @node's output, made of the key of
+ * its own operation and those of its producers, or NULL if it can't be
+ * cached.  Unlike a serialization of the sub-graph, the key doesn't depend
+ * on the nodes downstream, nor on the other consumers of shared nodes, so
+ * that graphs sharing a sub-graph share its key.  The keys are stored in
+ * @keys, which owns them.
+ */
+static const gchar *
+node_key (GeglNode   *node,
+          GHashTable *keys)
+{
+  GChecksum  *checksum;
+  gchar     **pads;
+  gchar      *key       = NULL;
+  gboolean    cacheable;
+  gint        i;
+
+  if (g_hash_table_lookup_extended (keys, node, NULL, (gpointer *) &key))
+    return key;
+
+  checksum = g_checksum_new (G_CHECKSUM_SHA256);
+
+  cacheable = hash_node (node, checksum);
+
+  pads = gegl_node_list_input_pads (node);
+
+  for (i = 0; cacheable && pads && pads[i]; i++)
+    {
+      gchar       *output_pad = NULL;
+      GeglNode    *producer;
+      const gchar *producer_key = "-";
+      gchar       *str;
+
+      producer = gegl_node_get_producer (node, pads[i], &output_pad);
+
+      if (producer)
+        {
+          producer_key = node_key (producer, keys);
+
+          if (! producer_key)
+            cacheable = FALSE;
+        }
+
+      str = g_strdup_printf (" %s=%s.%s;", pads[i], producer_key,
+                             output_pad ? output_pad : "");
+      g_checksum_update (checksum, (const guchar *) str, -1);
+      g_free (str);
+      g_free (output_pad);
+    }
+
+  g_strfreev (pads);
+
+  if (cacheable)
+    key = g_strdup (g_checksum_get_string (checksum));
+
+  g_checksum_free (checksum);
+
+  g_hash_table_insert (keys, node, key);
+
+  return key;
+}
+
+/* returns the key of the entry holding @node's output, or NULL if it
+ * can't be cached
+ */
+static gchar *
+compute_key (GeglNode   *node,
+             GHashTable *keys)
+{
+  GeglRectangle  extent   = gegl_node_get_bounding_box (node);
+  const gchar   *node_str = node_key (node, keys);
+  gchar         *str;
+  gchar         *key;
+
+  if (! node_str                                   ||
+      gegl_rectangle_is_infinite_plane (&extent)   ||
+      gegl_rectangle_is_empty (&extent))
+    {
+      return NULL;
+    }
+
+  str = g_strdup_printf ("gegl-%d.%d.%d %s roi=%d,%d,%dx%d",
+                         GEGL_MAJOR_VERSION, GEGL_MINOR_VERSION,
+                         GEGL_MICRO_VERSION, node_str,
+                         extent.x, extent.y, extent.width, extent.height);
+  key = g_compute_checksum_for_string (G_CHECKSUM_SHA256, str, -1);
+  g_free (str);
+
+  return key;
+}
+
+/* lists the nodes upstream of @node which have several consumers, like a
+ * common prefix of several chains, producers first.
+ */
+static void
+find_shared_nodes (GeglNode   *node,
+                   GHashTable *visited,
+                   GPtrArray  *shared)
+{
+  gchar **pads;
+  gint    i;
+
+  if (g_hash_table_contains (visited, node))
+    return;
+
+  g_hash_table_add (visited, node);
+
+  pads = gegl_node_list_input_pads (node);
+
+  for (i = 0; pads && pads[i]; i++)
+    {
+      GeglNode *producer = gegl_node_get_producer (node, pads[i], NULL);
+
+      if (producer)
+        find_shared_nodes (producer, visited, shared);
+    }
+
+  g_strfreev (pads);
+
+  if (gegl_node_get_consumers (node, "output", NULL, NULL) > 1)
+    g_ptr_array_add (shared, node);
+}
+
+static gint
+entry_compare (gconstpointer a,
+               gconstpointer b)
+{
+  const CacheEntry *entry_a = a;
+  const CacheEntry *entry_b = b;
+
+  return (entry_a->mtime > entry_b->mtime) - (entry_a->mtime < entry_b->mtime);
+}
+
+/* removes the least recently used entries until the cache fits in its
+ * size limit.
+ */
+static void
+gegl_disk_cache_trim (GeglDiskCache *cache)
+{
+  GArray      *entries;
+  GDir        *dir;
+  const gchar *name;
+  guint64      total = 0;
+  gint         i;
+
+  if (! cache->max_size)
+    return;
+
+  dir = g_dir_open (cache->path, 0, NULL);
+
+  if (! dir)
+    return;
+
+  entries = g_array_new (FALSE, FALSE, sizeof (CacheEntry));
+
+  while ((name = g_dir_read_name (dir)))
+    {
+      CacheEntry entry;
+      GStatBuf   st;
+
+      if (! g_str_has_suffix (name, ENTRY_SUFFIX))
+        continue;
+
+      entry.path = g_build_filename (cache->path, name, NULL);
+
+      if (g_stat (entry.path, &st) != 0)
+        {
+          g_free (entry.path);
+          continue;
+        }
+
+      entry.size  = st.st_size;
+      entry.mtime = st.st_mtime;
+      total      += entry.size;
+
+      g_array_append_val (entries, entry);
+    }
+
+  g_dir_close (dir);
+
+  g_array_sort (entries, entry_compare);
+
+  for (i = 0; i < entries->len; i++)
+    {
+      CacheEntry *entry = &g_array_index (entries, CacheEntry, i);
+
+      if (total > cache->max_size && g_unlink (entry->path) == 0)
+        total -= entry->size;
+
+      g_free (entry->path);
+    }
+
+  g_array_free (entries, TRUE);
+}
+
+static GeglBuffer *
+gegl_disk_cache_lookup (GeglDiskCache *cache,
+                        const gchar   *key)
+{
+  gchar      *path   = entry_path (cache, key);
+  GeglBuffer *buffer = NULL;
+
+  if (g_file_test (path, G_FILE_TEST_IS_REGULAR))
+    {
+      /* the tiles are read from the file as they're used */
+      buffer = gegl_buffer_open (path);
+
+      /* mark the entry as recently used */
+      if (buffer)
+        g_utime (path, NULL);
+    }
+
+  g_free (path);
+
+  return buffer;
+}
+
+/* renders @node into a new entry for @key, and returns the entry.  The
+ * result is written to the entry's file as it's rendered, rather than
+ * kept in memory.
+ */
+static GeglBuffer *
+gegl_disk_cache_store (GeglDiskCache *cache,
+                       const gchar   *key,
+                       GeglNode      *node)
+{
+  GeglRectangle  extent    = gegl_node_get_bounding_box (node);
+  GeglOperation *operation = gegl_node_get_gegl_operation (node);
+  const Babl    *format    = NULL;
+  gchar         *path      = entry_path (cache, key);
+  gchar         *tmp_path;
+  GeglBuffer    *buffer    = NULL;
+
+  if (operation)
+    format = gegl_operation_get_format (operation, "output");
+  if (! format)
+    format = babl_format ("RGBA float");
+
+  /* write to a temporary file first, so that concurrent gegl processes
+   * sharing the directory never see partial entries.
+   */
+  tmp_path = g_strdup_printf ("%s.%08x.tmp", path, g_random_int ());
+
+  buffer = g_object_new (GEGL_TYPE_BUFFER,
+                         "x",      extent.x,
+                         "y",      extent.y,
+                         "width",  extent.width,
+                         "height", extent.height,
+                         "format", format,
+                         "path",   tmp_path,
+                         NULL);
+
+  gegl_node_blit_buffer (node, buffer, &extent, 0, GEGL_ABYSS_NONE);
+
+  gegl_buffer_flush (buffer);
+  g_object_unref (buffer);
+
+  if (g_rename (tmp_path, path) == 0)
+    {
+      buffer = gegl_buffer_open (path);
+    }
+  else
+    {
+      buffer = gegl_buffer_load (tmp_path);
+      g_unlink (tmp_path);
+    }
+
+  g_free (tmp_path);
+  g_free (path);
+
+  gegl_disk_cache_trim (cache);
+
+  return buffer;
+}
+
+/* connects a buffer source in place of @node's output */
+static GeglNode *
+replace_with_buffer (GeglNode   *node,
+                     GeglBuffer *buffer)
+{
+  GeglNode     *source;
+  GeglNode    **consumers = NULL;
+  const gchar **pads      = NULL;
+  gint          n;
+  gint          i;
+
+  source = gegl_node_new_child (gegl_node_get_parent (node),
+                                "operation", "gegl:buffer-source",
+                                "buffer",    buffer,
+                                NULL);
+
+  n = gegl_node_get_consumers (node, "output", &consumers, &pads);
+
+  for (i = 0; i < n; i++)
+    gegl_node_connect_to (source, "output", consumers[i], pads[i]);
+
+  g_free (consumers);
+  g_free (pads);
+
+  return source;
+}
+
+/* replaces @node by its cached result, which is rendered and stored first
+ * if there's none.  Returns the buffer source replacing @node, or NULL if
+ * it can't be cached.
+ */
+static GeglNode *
+cache_node (GeglDiskCache *cache,
+            GeglNode      *node,
+            const gchar   *key)
+{
+  GeglNode   *source;
+  GeglBuffer *buffer;
+
+  buffer = gegl_disk_cache_lookup (cache, key);
+
+  if (! buffer)
+    buffer = gegl_disk_cache_store (cache, key, node);
+
+  if (! buffer)
+    return NULL;
+
+  source = replace_with_buffer (node, buffer);
+  g_object_unref (buffer);
+
+  return source;
+}
+
+GeglNode *
+gegl_disk_cache_process (GeglDiskCache *cache,
+                         GeglNode      *node)
+{
+  GPtrArray  *chain;
+  GPtrArray  *keys;
+  GPtrArray  *shared;
+  GHashTable *node_keys;
+  GHashTable *visited;
+  GeglNode   *iter;
+  GeglNode   *result = node;
+  GeglBuffer *buffer = NULL;
+  gint        hit;
+  gint        i;
+
+  g_return_val_if_fail (cache != NULL, node);
+  g_return_val_if_fail (GEGL_IS_NODE (node), node);
+
+  chain     = g_ptr_array_new ();
+  keys      = g_ptr_array_new_with_free_func (g_free);
+  node_keys = g_hash_table_new_full (NULL, NULL, NULL, g_free);
+
+  /* all keys are computed up front, before buffer sources are spliced in */
+  for (iter = node; iter; iter = gegl_node_get_producer (iter, "input", NULL))
+    {
+      g_ptr_array_add (chain, iter);
+      g_ptr_array_add (keys, compute_key (iter, node_keys));
+    }
+
+  /* an earlier run may have ended at any node of the chain, or stored it
+   * as a node shared between several chains.
+   */
+  for (hit = 0; hit < chain->len; hit++)
+    {
+      if (! keys->pdata[hit])
+        continue;
+
+      buffer = gegl_disk_cache_lookup (cache, keys->pdata[hit]);
+
+      if (buffer)
+        break;
+    }
+
+  if (buffer)
+    {
+      GeglNode *source = replace_with_buffer (chain->pdata[hit], buffer);
+
+      g_object_unref (buffer);
+
+      if (hit == 0)
+        result = source;
+    }
+
+  if (result == node)
+    {
+      /* the nodes shared between chains, still upstream of @node, are
+       * stored too, so that other chains sharing them can start from their
+       * result.  Producers are stored first, and the nodes downstream are
+       * rendered from them.
+       */
+      shared  = g_ptr_array_new ();
+      visited = g_hash_table_new (NULL, NULL);
+
+      find_shared_nodes (node, visited, shared);
+
+      for (i = 0; i < shared->len; i++)
+        {
+          gchar *key;
+
+          if (shared->pdata[i] == node)
+            continue;
+
+          key = compute_key (shared->pdata[i], node_keys);
+
+          if (key)
+            cache_node (cache, shared->pdata[i], key);
+
+          g_free (key);
+        }
+
+      g_hash_table_destroy (visited);
+      g_ptr_array_free (shared, TRUE);
+
+      /* and the final result; the rest of the chain is rendered as usual */
+      if (keys->pdata[0])
+        {
+          GeglNode *source = cache_node (cache, node, keys->pdata[0]);
+
+          if (source)
+            result = source;
+        }
+    }
+
+  g_hash_table_destroy (node_keys);
+  g_ptr_array_free (keys, TRUE);
+  g_ptr_array_free (chain, TRUE);
+
+  return result;
+}
@@ -0,0 +1,53 @@
+/* This file is part of GEGL editor -- a gtk frontend for GEGL
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _GEGL_DISK_CACHE__H
+#define _GEGL_DISK_CACHE__H
+
+#include <gegl.h>
+
+/* A content-addressed, size-bounded cache of rendered node outputs, stored
+ * as .gegl buffers in a directory shared between gegl invocations.
+ *
+ * Entries are keyed by a hash of the operations and properties of the
+ * sub-graph producing them, the size and modification time of every file
+ * it reads, through a path or a local URI, and the rendered rectangle.
+ * The key of a node doesn't depend on the nodes downstream, so that graphs
+ * sharing a sub-graph share its entry.  Entries are always full size
+ * renders; scaled output is made from them.  Sub-graphs reading remote
+ * URIs, or buffers, aren't cached.  The least recently used entries are
+ * removed when the directory grows beyond its size limit.
+ */
+typedef struct _GeglDiskCache GeglDiskCache;
+
+GeglDiskCache *gegl_disk_cache_new     (const gchar   *path,
+                                        guint64        max_size);
+void           gegl_disk_cache_free    (GeglDiskCache *cache);
+
+/* Prepares the "input" chain ending at @node for rendering through the
+ * cache: the most downstream node with a cached result is replaced by a
+ * buffer source.  Unless that's @node itself, the nodes upstream of @node
+ * with several consumers, which other chains share, and @node are then
+ * rendered, and their results stored in the cache, written directly to
+ * disk.
+ *
+ * Returns the node to render from instead of @node, owned by @node's
+ * parent graph.
+ */
+GeglNode      *gegl_disk_cache_process (GeglDiskCache *cache,
+                                        GeglNode      *node);
+
+#endif
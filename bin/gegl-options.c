@@ -37,6 +37,8 @@ static GeglOptions *opts_new (void)
   o->file     = NULL;
   o->rest     = NULL;
   o->scale    = 1.0;
+  o->cache_dir  = NULL;
+  o->cache_size = 1024;
   return o;
 }
 
@@ -70,6 +72,12 @@ _("usage: %s [options] <file | -- [op [op] ..]>\n"
 "\n"
 "     -X              output the XML that was read in\n"
 "\n"
+"     --cache-dir dir reuse results of sub-graphs rendered by earlier runs,\n"
+"                     stored in the given directory.\n"
+"\n"
+"     --cache-size MiB  maximum size of the --cache-dir directory,\n"
+"                     least recently used results are removed first.\n"
+"\n"
 "     -v, --verbose   print diagnostics while running\n"
 "\n"
 "All parameters following -- are considered ops to be chained together\n"
@@ -444,6 +452,14 @@ parse_args (int    argc,
             get_float (o->scale);
         }
 
+        else if (match ("--cache-dir")) {
+            get_string (o->cache_dir);
+        }
+
+        else if (match ("--cache-size")) {
+            get_int (o->cache_size);
+        }
+
         else if (match ("-X")) {
             o->mode = GEGL_RUN_MODE_XML;
         }
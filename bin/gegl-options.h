@@ -52,6 +52,9 @@ struct _GeglOptions
   gdouble      scale;
 
   gboolean     serialize;
+
+  const gchar *cache_dir;
+  gint         cache_size; /* in MiB */
 };
 
 GeglOptions *gegl_options_parse (gint    argc,
@@ -30,6 +30,7 @@
 #endif
 
 #include "gegl-options.h"
+#include "gegl-disk-cache.h"
 #ifdef HAVE_SPIRO
 #include "gegl-path-spiro.h"
 #endif
@@ -341,13 +342,28 @@ main (gint    argc,
         }
       else
         {
-          GeglNode *output = gegl_node_new_child (gegl,
-                                                  "operation", "gegl:save",
-                                                  "path", o->output,
-                                                  NULL);
+          GeglNode      *output = gegl_node_new_child (gegl,
+                                                       "operation", "gegl:save",
+                                                       "path", o->output,
+                                                       NULL);
+          GeglNode      *source = gegl;
+          GeglDiskCache *disk_cache = NULL;
+
+          if (o->cache_dir)
+            disk_cache = gegl_disk_cache_new (o->cache_dir,
+                                              (guint64) o->cache_size << 20);
+
+          if (disk_cache)
+            {
+              GeglNode *proxy    = gegl_node_get_output_proxy (gegl, "output");
+              GeglNode *producer = gegl_node_get_producer (proxy, "input", NULL);
+
+              if (producer)
+                source = gegl_disk_cache_process (disk_cache, producer);
+            }
 
           if (o->scale != 1.0){
-            GeglRectangle bounds = gegl_node_get_bounding_box (gegl);
+            GeglRectangle bounds = gegl_node_get_bounding_box (source);
             GeglBuffer *tempb;
             GeglNode *n0;
 
@@ -359,7 +375,7 @@ main (gint    argc,
             bounds.height *= o->scale;
             temp = gegl_malloc (bounds.width * bounds.height * 4);
             tempb = gegl_buffer_new (&bounds, babl_format("R'G'B'A u8"));
-            gegl_node_blit (gegl, o->scale, &bounds, babl_format("R'G'B'A u8"), temp, GEGL_AUTO_ROWSTRIDE,
+            gegl_node_blit (source, o->scale, &bounds, babl_format("R'G'B'A u8"), temp, GEGL_AUTO_ROWSTRIDE,
                             GEGL_BLIT_DEFAULT);
 
             gegl_buffer_set (tempb, &bounds, 0.0, babl_format ("R'G'B'A u8"),
@@ -375,10 +391,11 @@ main (gint    argc,
           }
           else
           {
-            gegl_node_connect_from (output, "input", gegl, "output");
+            gegl_node_connect_from (output, "input", source, "output");
             gegl_node_process (output);
           }
 
+          gegl_disk_cache_free (disk_cache);
           g_object_unref (output);
         }
         break;
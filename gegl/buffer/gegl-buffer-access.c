@@ -40,6 +40,8 @@
 #include "gegl-rectangle.h"
 #include "gegl-buffer-iterator-private.h"
 #include "gegl-buffer-formats.h"
+#include "gegl-parallel.h"
+#include "gegl-parallel-private.h"
 
 static void gegl_buffer_iterate_read_fringed (GeglBuffer          *buffer,
                                               const GeglRectangle *roi,
@@ -59,6 +61,13 @@ static void gegl_buffer_iterate_read_dispatch (GeglBuffer          *buffer,
                                                gint                 level,
                                                GeglAbyssPolicy      repeat_mode);
 
+static void fill_abyss_color (guchar       *buf,
+                              gint          width,
+                              gint          height,
+                              gint          buf_stride,
+                              const guchar *pixel,
+                              gint          pixel_size);
+
 static void inline
 gegl_buffer_get_pixel (GeglBuffer     *buffer,
                        gint            x,
@@ -129,7 +138,7 @@ gegl_buffer_get_pixel (GeglBuffer     *buffer,
           tile->x == indice_x &&
           tile->y == indice_y))
       {
-        g_rec_mutex_lock (&buffer->tile_storage->mutex);
+        gegl_tile_storage_lock (buffer->tile_storage);
 
         if (tile)
           gegl_tile_unref (tile);
@@ -138,7 +147,7 @@ gegl_buffer_get_pixel (GeglBuffer     *buffer,
                                           indice_x, indice_y,
                                           0);
 
-        g_rec_mutex_unlock (&buffer->tile_storage->mutex);
+        gegl_tile_storage_unlock (buffer->tile_storage);
       }
 
     if (tile)
@@ -214,7 +223,7 @@ __gegl_buffer_set_pixel (GeglBuffer     *buffer,
           tile->x == indice_x &&
           tile->y == indice_y))
       {
-        g_rec_mutex_lock (&buffer->tile_storage->mutex);
+        gegl_tile_storage_lock (buffer->tile_storage);
 
         if (tile)
           gegl_tile_unref (tile);
@@ -223,7 +232,7 @@ __gegl_buffer_set_pixel (GeglBuffer     *buffer,
                                           indice_x, indice_y,
                                           0);
 
-        g_rec_mutex_unlock (&buffer->tile_storage->mutex);
+        gegl_tile_storage_unlock (buffer->tile_storage);
       }
 
     if (tile)
@@ -459,13 +468,13 @@ gegl_buffer_iterate_write (GeglBuffer          *buffer,
                        MIN (MIN (height - bufy, tile_height - offsety),
                             abyss_y_total - bufy) == tile_height;
 
-          g_rec_mutex_lock (&buffer->tile_storage->mutex);
+          gegl_tile_storage_lock (buffer->tile_storage);
 
           tile = gegl_tile_handler_get_tile ((GeglTileHandler *) buffer,
                                              index_x, index_y, level,
                                              ! whole_tile);
 
-          g_rec_mutex_unlock (&buffer->tile_storage->mutex);
+          gegl_tile_storage_unlock (buffer->tile_storage);
 
           if (!tile)
             {
@@ -992,12 +1001,12 @@ gegl_buffer_iterate_read_simple (GeglBuffer          *buffer,
           else
             pixels = tile_width - offsetx;
 
-          g_rec_mutex_lock (&buffer->tile_storage->mutex);
+          gegl_tile_storage_lock (buffer->tile_storage);
           tile = gegl_tile_source_get_tile ((GeglTileSource *) (buffer),
                                           gegl_tile_indice (tiledx, tile_width),
                                           gegl_tile_indice (tiledy, tile_height),
                                           level);
-          g_rec_mutex_unlock (&buffer->tile_storage->mutex);
+          gegl_tile_storage_unlock (buffer->tile_storage);
 
           if (!tile)
             {
@@ -1013,7 +1022,17 @@ gegl_buffer_iterate_read_simple (GeglBuffer          *buffer,
 
           y = bufy;
 
-          if (fish)
+          if (fish && tile->is_uniform_tile)
+            {
+              /* only the first pixel of a uniform tile needs converting */
+              guchar pixel[128];
+              gint   rows = MIN (height - bufy, tile_height - offsety);
+
+              babl_process (fish, tile_base, pixel, 1);
+
+              fill_abyss_color (bp, pixels, rows, buf_stride, pixel, bpx_size);
+            }
+          else if (fish)
             {
               int rows = MIN(height - bufy, tile_height - offsety);
               if (rows == 1)
@@ -1259,6 +1278,73 @@ gegl_buffer_iterate_read_simple (GeglBuffer          *buffer,
 
 }
 
+/* abyss fill
+ *
+ * The parts of a read that fall outside of the abyss are assembled in the
+ * destination buffer itself: the in-abyss part is read first, and the
+ * fringes are then filled by broadcasting single pixels along the rows,
+ * and by copying whole rows, rather than pixel by pixel.
+ */
+
+#define FILL_PIXELS(size)                                                 \
+  G_STMT_START                                                            \
+    {                                                                     \
+      guchar p[size];                                                     \
+      gint   i;                                                           \
+                                                                          \
+      memcpy (p, pixel, size);                                            \
+                                                                          \
+      for (i = 0; i < n; i++)                                             \
+        memcpy (dst + i * (size), p, size);                               \
+    }                                                                     \
+  G_STMT_END
+
+/* fills @n pixels of @dst with @pixel.  the common pixel sizes are
+ * broadcast using fixed-size stores, which the compiler turns into single
+ * (vector) moves, since the spans are often too short for
+ * gegl_memset_pattern() to pay off.
+ */
+static inline void
+fill_pixels (guchar       *dst,
+             const guchar *pixel,
+             gint          bpp,
+             gint          n)
+{
+  switch (bpp)
+    {
+    case 1:  memset (dst, *pixel, n); break;
+    case 2:  FILL_PIXELS (2);         break;
+    case 3:  FILL_PIXELS (3);         break;
+    case 4:  FILL_PIXELS (4);         break;
+    case 6:  FILL_PIXELS (6);         break;
+    case 8:  FILL_PIXELS (8);         break;
+    case 12: FILL_PIXELS (12);        break;
+    case 16: FILL_PIXELS (16);        break;
+
+    default:
+      gegl_memset_pattern (dst, pixel, bpp, n);
+      break;
+    }
+}
+
+#undef FILL_PIXELS
+
+/* copies the first row of the @height rows of @buf to the rest of them */
+static void
+fill_rows (guchar *buf,
+           gint    byte_width,
+           gint    height,
+           gint    buf_stride)
+{
+  guchar *row = buf + buf_stride;
+
+  while (--height > 0)
+    {
+      memcpy (row, buf, byte_width);
+      row += buf_stride;
+    }
+}
+
 static void
 fill_abyss_none (guchar *buf, gint width, gint height, gint buf_stride, gint pixel_size)
 {
@@ -1279,19 +1365,16 @@ fill_abyss_none (guchar *buf, gint width, gint height, gint buf_stride, gint pix
 }
 
 static void
-fill_abyss_color (guchar *buf, gint width, gint height, gint buf_stride, guchar *pixel, gint pixel_size)
+fill_abyss_color (guchar *buf, gint width, gint height, gint buf_stride, const guchar *pixel, gint pixel_size)
 {
   if (buf_stride == width * pixel_size)
     {
-      gegl_memset_pattern (buf, pixel, pixel_size, width * height);
+      fill_pixels (buf, pixel, pixel_size, width * height);
     }
-  else
+  else if (height > 0)
     {
-      while (height--)
-        {
-          gegl_memset_pattern (buf, pixel, pixel_size, width);
-          buf += buf_stride;
-        }
+      fill_pixels (buf, pixel, pixel_size, width);
+      fill_rows (buf, width * pixel_size, height, buf_stride);
     }
 }
 
@@ -1482,100 +1565,56 @@ gegl_buffer_iterate_read_abyss_clamp (GeglBuffer          *buffer,
   right_cols = (roi->x + roi->width) - (read_output_rect.x + read_output_rect.width);
   bottom_rows = (roi->y + roi->height) - (read_output_rect.y + read_output_rect.height);
 
-  if (top_rows)
+  /* Left and right of the rows that were read, the first and last pixels of
+   * each row broadcast
+   */
+  if (left_cols || right_cols)
     {
-      guchar *fill_buf = buf;
-      /* Top left pixel */
-      if (left_cols)
-        {
-          guchar *src_pixel = read_buf;
-          fill_abyss_color (fill_buf, left_cols, top_rows, buf_stride, src_pixel, bpp);
-          fill_buf += left_cols * bpp;
-        }
+      guchar *row = buf + top_rows * buf_stride;
+      gint    i;
 
-      /* Top rows */
-      {
-        guchar *src_pixel = read_buf;
-        guchar *row_fill_buf = fill_buf;
-        gint byte_width = read_output_rect.width * bpp;
-        gint i;
-        for (i = 0; i < top_rows; ++i)
-          {
-            memcpy (row_fill_buf, src_pixel, byte_width);
-            row_fill_buf += buf_stride;
-          }
-      }
-
-      fill_buf += (read_input_rect.width) * bpp;
-      /* Top right pixel */
-      if (right_cols)
+      for (i = 0; i < read_output_rect.height; ++i)
         {
-          guchar *src_pixel = read_buf + (read_input_rect.width - 1) * bpp;
-          fill_abyss_color (fill_buf, right_cols, top_rows, buf_stride, src_pixel, bpp);
-        }
-    }
+          if (left_cols)
+            fill_pixels (row, read_buf, bpp, left_cols);
 
-  /* Left */
-  if (left_cols)
-    {
-      guchar *row_fill_buf = buf + (top_rows * buf_stride);
-      guchar *src_pixel = read_buf;
-      gint i;
+          if (right_cols)
+            fill_pixels (read_buf + read_output_rect.width * bpp,
+                         read_buf + (read_output_rect.width - 1) * bpp,
+                         bpp, right_cols);
 
-      for (i = 0; i < read_output_rect.height; ++i)
-        {
-          gegl_memset_pattern (row_fill_buf, src_pixel, bpp, left_cols);
-          row_fill_buf += buf_stride;
-          src_pixel += buf_stride;
+          row      += buf_stride;
+          read_buf += buf_stride;
         }
     }
 
-  /* Right */
-  if (right_cols)
+  /* Above and below, the first and last of these rows copied whole, which
+   * takes care of the corners as well
+   */
+  if (top_rows)
     {
-      guchar *row_fill_buf = buf + (read_input_rect.width + left_cols) * bpp
-                                 + top_rows * buf_stride;
-      guchar *src_pixel = read_buf + (read_input_rect.width - 1) * bpp;
-      gint i;
+      const guchar *src_row = buf + top_rows * buf_stride;
+      guchar       *row     = buf;
+      gint          i;
 
-      for (i = 0; i < read_output_rect.height; ++i)
+      for (i = 0; i < top_rows; ++i)
         {
-          gegl_memset_pattern (row_fill_buf, src_pixel, bpp, right_cols);
-          row_fill_buf += buf_stride;
-          src_pixel += buf_stride;
+          memcpy (row, src_row, roi->width * bpp);
+          row += buf_stride;
         }
     }
 
   if (bottom_rows)
     {
-      guchar *fill_buf = buf + (read_input_rect.height + top_rows) * buf_stride;
-      /* Bottom left */
-      if (left_cols)
-        {
-          guchar *src_pixel = read_buf + (read_input_rect.height - 1) * buf_stride;
-          fill_abyss_color (fill_buf, left_cols, bottom_rows, buf_stride, src_pixel, bpp);
-          fill_buf += left_cols * bpp;
-        }
-
-      /* Bottom rows */
-      {
-        guchar *src_pixel = read_buf + (read_input_rect.height - 1) * buf_stride;
-        guchar *row_fill_buf = fill_buf;
-        gint byte_width = read_output_rect.width * bpp;
-        gint i;
-        for (i = 0; i < bottom_rows; ++i)
-          {
-            memcpy (row_fill_buf, src_pixel, byte_width);
-            row_fill_buf += buf_stride;
-          }
-      }
+      const guchar *src_row = buf + (top_rows + read_output_rect.height - 1) *
+                                    buf_stride;
+      guchar       *row     = (guchar *) src_row + buf_stride;
+      gint          i;
 
-      fill_buf += read_input_rect.width * bpp;
-      /* Bottom right */
-      if (right_cols)
+      for (i = 0; i < bottom_rows; ++i)
         {
-          guchar *src_pixel = read_buf + (read_input_rect.width - 1) * bpp + (read_input_rect.height - 1) * buf_stride;
-          fill_abyss_color (fill_buf, right_cols, bottom_rows, buf_stride, src_pixel, bpp);
+          memcpy (row, src_row, roi->width * bpp);
+          row += buf_stride;
         }
     }
 }
@@ -1590,12 +1629,24 @@ gegl_buffer_iterate_read_abyss_loop (GeglBuffer          *buffer,
                                      gint                 level)
 {
   GeglRectangle current_roi;
+  GeglRectangle period_roi;
   gint          bpp = babl_format_get_bytes_per_pixel (format);
+  guchar       *period_buf = buf;
   gint          origin_x;
+  gint          loop_chunk_ix;
+  gint          loop_chunk_iy;
+
+  /* Only a single period of the roi, at most the size of the abyss, is
+   * read; the rest of it repeats what was read, and is copied from it below.
+   */
+  period_roi.x      = roi->x;
+  period_roi.y      = roi->y;
+  period_roi.width  = MIN (roi->width,  abyss->width);
+  period_roi.height = MIN (roi->height, abyss->height);
 
   /* Loop abyss works like iterating over a grid of tiles the size of the abyss */
-  gint loop_chunk_ix = gegl_tile_indice (roi->x - abyss->x, abyss->width);
-  gint loop_chunk_iy = gegl_tile_indice (roi->y - abyss->y, abyss->height);
+  loop_chunk_ix = gegl_tile_indice (period_roi.x - abyss->x, abyss->width);
+  loop_chunk_iy = gegl_tile_indice (period_roi.y - abyss->y, abyss->height);
 
   current_roi.x = loop_chunk_ix * abyss->width  + abyss->x;
   current_roi.y = loop_chunk_iy * abyss->height + abyss->y;
@@ -1605,15 +1656,15 @@ gegl_buffer_iterate_read_abyss_loop (GeglBuffer          *buffer,
 
   origin_x = current_roi.x;
 
-  while (current_roi.y < roi->y + roi->height)
+  while (current_roi.y < period_roi.y + period_roi.height)
     {
-      guchar *inner_buf  = buf;
+      guchar *inner_buf  = period_buf;
       gint    row_height = 0;
 
-      while (current_roi.x < roi->x + roi->width)
+      while (current_roi.x < period_roi.x + period_roi.width)
         {
           GeglRectangle simple_roi;
-          gegl_rectangle_intersect (&simple_roi, &current_roi, roi);
+          gegl_rectangle_intersect (&simple_roi, &current_roi, &period_roi);
 
           gegl_buffer_iterate_read_simple (buffer,
                                            GEGL_RECTANGLE (abyss->x + (simple_roi.x - current_roi.x),
@@ -1631,11 +1682,55 @@ gegl_buffer_iterate_read_abyss_loop (GeglBuffer          *buffer,
           current_roi.x += abyss->width;
         }
 
-      buf += buf_stride * row_height;
+      period_buf += buf_stride * row_height;
 
       current_roi.x  = origin_x;
       current_roi.y += abyss->height;
     }
+
+  /* Right of the period, each row repeats its first period_roi.width
+   * pixels, copied in blocks of a growing number of periods
+   */
+  if (roi->width > period_roi.width)
+    {
+      const gint  period = period_roi.width * bpp;
+      guchar     *row    = buf;
+      gint        y;
+
+      for (y = 0; y < period_roi.height; y++)
+        {
+          gint    block     = period;
+          gint    remaining = (roi->width - period_roi.width) * bpp;
+          guchar *dst       = row + period;
+
+          while (remaining)
+            {
+              gint size = MIN (block, remaining);
+
+              memcpy (dst, row, size);
+              dst       += size;
+              remaining -= size;
+
+              if (block <= 2048)
+                block *= 2;
+            }
+
+          row += buf_stride;
+        }
+    }
+
+  /* Below the period, each row is a copy of the row a period above it */
+  if (roi->height > period_roi.height)
+    {
+      guchar *row = buf + period_roi.height * buf_stride;
+      gint    y;
+
+      for (y = period_roi.height; y < roi->height; y++)
+        {
+          memcpy (row, row - period_roi.height * buf_stride, roi->width * bpp);
+          row += buf_stride;
+        }
+    }
 }
 
 static gpointer
@@ -1915,6 +2010,188 @@ gegl_buffer_iterate_read_dispatch (GeglBuffer          *buffer,
     }
 }
 
+/* parallel access
+ *
+ * Large gegl_buffer_get() and gegl_buffer_set() calls, at full scale, are
+ * split into bands of whole tile rows, which are read or written on the
+ * gegl_parallel threads.  The bands cover disjoint rows of the linear
+ * buffer, and disjoint tiles, so the result doesn't depend on how the
+ * rectangle is split.
+ */
+
+/* the number of pixels a thread needs to be given for it to pay off */
+#define GEGL_BUFFER_PARALLEL_PIXELS_PER_THREAD (256 * 256)
+
+typedef struct
+{
+  GeglBuffer          *buffer;
+  const GeglRectangle *rect;
+  const Babl          *format;
+  guchar              *buf;
+  gint                 rowstride;
+  GeglAbyssPolicy      repeat_mode;
+  gint                 first_tile_row;
+  gint                 n_tile_rows;
+} GeglBufferParallelData;
+
+static gboolean
+gegl_buffer_use_parallel (GeglBuffer          *buffer,
+                          const GeglRectangle *rect)
+{
+  /* gegl_buffer_linear_open() keeps the tile storage locked until the
+   * buffer is closed, which would block the other threads, and exclusive
+   * buffers aren't locked at all.
+   */
+  return (gint64) rect->width * rect->height >=
+         2 * GEGL_BUFFER_PARALLEL_PIXELS_PER_THREAD                &&
+         rect->height > buffer->tile_storage->tile_height          &&
+         ! buffer->tile_storage->exclusive                         &&
+         ! g_object_get_data (G_OBJECT (buffer), "linear-tile")    &&
+         ! g_object_get_data (G_OBJECT (buffer), "linear-buffers");
+}
+
+/* calls @func for each of the bands of whole tile rows of data->rect the
+ * threads are given.
+ */
+static void
+gegl_buffer_parallel_distribute (GeglBufferParallelData     *data,
+                                 GeglParallelDistributeFunc  func)
+{
+  const GeglRectangle *rect        = data->rect;
+  gint                 tile_height = data->buffer->tile_storage->tile_height;
+  gint                 shift_y     = data->buffer->shift_y;
+  gint                 n_threads;
+
+  data->first_tile_row = gegl_tile_indice (rect->y + shift_y, tile_height);
+  data->n_tile_rows    = gegl_tile_indice (rect->y + rect->height - 1 + shift_y,
+                                           tile_height) -
+                         data->first_tile_row + 1;
+
+  n_threads = gegl_parallel_distribute_get_optimal_n_threads (
+    data->n_tile_rows,
+    (gdouble) GEGL_BUFFER_PARALLEL_PIXELS_PER_THREAD /
+    ((gdouble) rect->width * tile_height));
+
+  gegl_parallel_distribute (MIN (n_threads, data->n_tile_rows), func, data);
+}
+
+/* the rows of the band of thread @i out of @n */
+static gboolean
+gegl_buffer_parallel_get_band (GeglBufferParallelData *data,
+                               gint                    i,
+                               gint                    n,
+                               GeglRectangle          *band,
+                               gsize                  *offset)
+{
+  const GeglRectangle *rect        = data->rect;
+  gint                 tile_height = data->buffer->tile_storage->tile_height;
+  gint                 shift_y     = data->buffer->shift_y;
+  gint                 row1, row2;
+  gint                 y1, y2;
+
+  row1 = data->first_tile_row + (gint64) i       * data->n_tile_rows / n;
+  row2 = data->first_tile_row + (gint64) (i + 1) * data->n_tile_rows / n;
+
+  y1 = MAX (row1 * tile_height - shift_y, rect->y);
+  y2 = MIN (row2 * tile_height - shift_y, rect->y + rect->height);
+
+  if (y1 >= y2)
+    return FALSE;
+
+  *band = *GEGL_RECTANGLE (rect->x, y1, rect->width, y2 - y1);
+  *offset = (gsize) (y1 - rect->y) * data->rowstride;
+
+  return TRUE;
+}
+
+static void
+gegl_buffer_get_parallel_func (gint                    i,
+                               gint                    n,
+                               GeglBufferParallelData *data)
+{
+  GeglRectangle band;
+  gsize         offset;
+
+  if (gegl_buffer_parallel_get_band (data, i, n, &band, &offset))
+    {
+      gegl_buffer_iterate_read_dispatch (data->buffer, &band,
+                                         data->buf + offset, data->rowstride,
+                                         data->format, 0, data->repeat_mode);
+    }
+}
+
+static void
+gegl_buffer_set_parallel_func (gint                    i,
+                               gint                    n,
+                               GeglBufferParallelData *data)
+{
+  GeglRectangle band;
+  gsize         offset;
+
+  if (gegl_buffer_parallel_get_band (data, i, n, &band, &offset))
+    {
+      gegl_buffer_iterate_write (data->buffer, &band,
+                                 data->buf + offset, data->rowstride,
+                                 data->format, 0);
+    }
+}
+
+static void
+gegl_buffer_get_parallel (GeglBuffer          *buffer,
+                          const GeglRectangle *rect,
+                          const Babl          *format,
+                          gpointer             dest_buf,
+                          gint                 rowstride,
+                          GeglAbyssPolicy      repeat_mode)
+{
+  GeglBufferParallelData data;
+
+  if (gegl_buffer_ext_flush)
+    gegl_buffer_ext_flush (buffer, rect);
+
+  if (rowstride == GEGL_AUTO_ROWSTRIDE)
+    rowstride = rect->width * babl_format_get_bytes_per_pixel (format);
+
+  data.buffer      = buffer;
+  data.rect        = rect;
+  data.format      = format;
+  data.buf         = dest_buf;
+  data.rowstride   = rowstride;
+  data.repeat_mode = repeat_mode;
+
+  gegl_buffer_parallel_distribute (
+    &data, (GeglParallelDistributeFunc) gegl_buffer_get_parallel_func);
+}
+
+static void
+gegl_buffer_set_parallel (GeglBuffer          *buffer,
+                          const GeglRectangle *rect,
+                          const Babl          *format,
+                          const void          *src,
+                          gint                 rowstride)
+{
+  GeglBufferParallelData data;
+
+  if (gegl_buffer_ext_flush)
+    gegl_buffer_ext_flush (buffer, rect);
+
+  if (rowstride == GEGL_AUTO_ROWSTRIDE)
+    rowstride = rect->width * babl_format_get_bytes_per_pixel (format);
+
+  data.buffer      = buffer;
+  data.rect        = rect;
+  data.format      = format;
+  data.buf         = (guchar *) src;
+  data.rowstride   = rowstride;
+  data.repeat_mode = GEGL_ABYSS_NONE;
+
+  gegl_buffer_parallel_distribute (
+    &data, (GeglParallelDistributeFunc) gegl_buffer_set_parallel_func);
+
+  if (gegl_buffer_is_shared (buffer))
+    gegl_buffer_flush (buffer);
+}
+
 void
 gegl_buffer_set_unlocked (GeglBuffer          *buffer,
                           const GeglRectangle *rect,
@@ -1982,6 +2259,17 @@ gegl_buffer_set (GeglBuffer          *buffer,
         }
     }
 
+  if (level == 0 &&
+      gegl_buffer_use_parallel (buffer, rect ? rect : &buffer->extent))
+    {
+      gegl_buffer_lock (buffer);
+      gegl_buffer_set_parallel (buffer, rect ? rect : &buffer->extent,
+                                format, src, rowstride);
+      gegl_buffer_unlock (buffer);
+      gegl_buffer_emit_changed_signal (buffer, rect);
+      return;
+    }
+
     _gegl_buffer_set_with_flags (buffer, rect, level, format, src, rowstride,
                                  GEGL_BUFFER_SET_FLAG_LOCK|
                                  GEGL_BUFFER_SET_FLAG_NOTIFY);
@@ -2348,10 +2636,202 @@ gegl_buffer_get (GeglBuffer          *buffer,
 {
   g_return_if_fail (GEGL_IS_BUFFER (buffer));
   gegl_buffer_lock (buffer);
-  _gegl_buffer_get_unlocked (buffer, scale, rect, format, dest_buf, rowstride, repeat_mode);
+
+  if (GEGL_FLOAT_EQUAL (scale, 1.0) && dest_buf &&
+      gegl_buffer_use_parallel (buffer, rect ? rect : &buffer->extent))
+    {
+      gegl_buffer_get_parallel (buffer, rect ? rect : &buffer->extent,
+                                format ? format : buffer->soft_format,
+                                dest_buf, rowstride, repeat_mode & 0x7);
+    }
+  else
+    {
+      _gegl_buffer_get_unlocked (buffer, scale, rect, format, dest_buf,
+                                 rowstride, repeat_mode);
+    }
+
   gegl_buffer_unlock (buffer);
 }
 
+
+/*
+ * transposed access
+ */
+
+/* the side of the square blocks of pixels transposed at a time, small
+ * enough for a block of the source and of the destination to stay in the
+ * cache.
+ */
+#define TRANSPOSE_BLOCK_SIZE  16
+
+/* the number of buffer rows read or written at a time */
+#define TRANSPOSE_BAND_HEIGHT 64
+
+#define TRANSPOSE_PIXELS(size)                                            \
+  for (x = x0; x < x1; x++)                                               \
+    {                                                                     \
+      guchar       *d = dst + (gsize) x  * dst_stride + y0 * (size);      \
+      const guchar *s = src + (gsize) y0 * src_stride + x  * (size);      \
+                                                                          \
+      for (y = y0; y < y1; y++, d += (size), s += src_stride)             \
+        memcpy (d, s, (size));                                            \
+    }
+
+/* stores the @height rows of @width pixels at @src as @width rows of
+ * @height pixels at @dst, a block at a time.  the pixel sizes the buffers
+ * commonly use are copied using fixed-size copies, which the compiler turns
+ * into single loads and stores.
+ */
+static void
+transpose_pixels (guchar       *dst,
+                  gint          dst_stride,
+                  const guchar *src,
+                  gint          src_stride,
+                  gint          width,
+                  gint          height,
+                  gint          bpp)
+{
+  gint x0, y0;
+
+  for (y0 = 0; y0 < height; y0 += TRANSPOSE_BLOCK_SIZE)
+    {
+      gint y1 = MIN (y0 + TRANSPOSE_BLOCK_SIZE, height);
+
+      for (x0 = 0; x0 < width; x0 += TRANSPOSE_BLOCK_SIZE)
+        {
+          gint x1 = MIN (x0 + TRANSPOSE_BLOCK_SIZE, width);
+          gint x, y;
+
+          switch (bpp)
+            {
+            case 1:  TRANSPOSE_PIXELS (1);   break;
+            case 2:  TRANSPOSE_PIXELS (2);   break;
+            case 3:  TRANSPOSE_PIXELS (3);   break;
+            case 4:  TRANSPOSE_PIXELS (4);   break;
+            case 8:  TRANSPOSE_PIXELS (8);   break;
+            case 12: TRANSPOSE_PIXELS (12);  break;
+            case 16: TRANSPOSE_PIXELS (16);  break;
+            default: TRANSPOSE_PIXELS (bpp); break;
+            }
+        }
+    }
+}
+
+#undef TRANSPOSE_PIXELS
+
+void
+gegl_buffer_get_transposed (GeglBuffer          *buffer,
+                            const GeglRectangle *rect,
+                            gdouble              scale,
+                            const Babl          *format,
+                            gpointer             dest,
+                            gint                 rowstride,
+                            GeglAbyssPolicy      repeat_mode)
+{
+  GeglRectangle  band_rect;
+  guchar        *band;
+  gint           band_height;
+  gint           bpp;
+
+  g_return_if_fail (GEGL_IS_BUFFER (buffer));
+
+  if (! rect)
+    rect = &buffer->extent;
+
+  if (gegl_rectangle_is_empty (rect))
+    return;
+
+  g_return_if_fail (dest != NULL);
+
+  if (! format)
+    format = buffer->soft_format;
+
+  bpp = babl_format_get_bytes_per_pixel (format);
+
+  if (rowstride == GEGL_AUTO_ROWSTRIDE)
+    rowstride = rect->height * bpp;
+
+  band_height = MIN (rect->height, TRANSPOSE_BAND_HEIGHT);
+  band        = gegl_scratch_alloc ((gsize) bpp * rect->width * band_height);
+
+  band_rect = *rect;
+
+  for (band_rect.y = rect->y;
+       band_rect.y < rect->y + rect->height;
+       band_rect.y += band_height)
+    {
+      band_rect.height = MIN (band_height,
+                              rect->y + rect->height - band_rect.y);
+
+      gegl_buffer_get (buffer, &band_rect, scale, format, band,
+                       GEGL_AUTO_ROWSTRIDE, repeat_mode);
+
+      transpose_pixels ((guchar *) dest + (band_rect.y - rect->y) * bpp,
+                        rowstride,
+                        band, bpp * rect->width,
+                        rect->width, band_rect.height,
+                        bpp);
+    }
+
+  gegl_scratch_free (band);
+}
+
+void
+gegl_buffer_set_transposed (GeglBuffer          *buffer,
+                            const GeglRectangle *rect,
+                            gint                 level,
+                            const Babl          *format,
+                            gconstpointer        src,
+                            gint                 rowstride)
+{
+  GeglRectangle  band_rect;
+  guchar        *band;
+  gint           band_height;
+  gint           bpp;
+
+  g_return_if_fail (GEGL_IS_BUFFER (buffer));
+
+  if (! rect)
+    rect = &buffer->extent;
+
+  if (gegl_rectangle_is_empty (rect))
+    return;
+
+  g_return_if_fail (src != NULL);
+
+  if (! format)
+    format = buffer->soft_format;
+
+  bpp = babl_format_get_bytes_per_pixel (format);
+
+  if (rowstride == GEGL_AUTO_ROWSTRIDE)
+    rowstride = rect->height * bpp;
+
+  band_height = MIN (rect->height, TRANSPOSE_BAND_HEIGHT);
+  band        = gegl_scratch_alloc ((gsize) bpp * rect->width * band_height);
+
+  band_rect = *rect;
+
+  for (band_rect.y = rect->y;
+       band_rect.y < rect->y + rect->height;
+       band_rect.y += band_height)
+    {
+      band_rect.height = MIN (band_height,
+                              rect->y + rect->height - band_rect.y);
+
+      transpose_pixels (band, bpp * rect->width,
+                        (const guchar *) src + (band_rect.y - rect->y) * bpp,
+                        rowstride,
+                        band_rect.height, rect->width,
+                        bpp);
+
+      gegl_buffer_set (buffer, &band_rect, level, format, band,
+                       GEGL_AUTO_ROWSTRIDE);
+    }
+
+  gegl_scratch_free (band);
+}
+
 static void
 gegl_buffer_copy2 (GeglBuffer          *src,
                    const GeglRectangle *src_rect,
@@ -2977,25 +3457,8 @@ gegl_buffer_set_color_from_pixel_tile (GeglBuffer            *dst,
     }
   else
     {
-      gint tile_size = dst->tile_storage->tile_size;
-
-      if (gegl_memeq_zero (data->pixel, data->bpp))
-        {
-          tile = gegl_tile_handler_empty_new_tile (tile_size);
-        }
-      else
-        {
-          tile = gegl_tile_new (tile_size);
-
-          gegl_tile_lock (tile);
-
-          gegl_memset_pattern (gegl_tile_get_data (tile),
-                               data->pixel,
-                               data->bpp,
-                               tile_size / data->bpp);
-
-          gegl_tile_unlock (tile);
-        }
+      tile = gegl_tile_handler_empty_new_uniform_tile (
+        dst->tile_storage->tile_size, data->pixel, data->bpp);
     }
 
   gegl_tile_handler_cache_insert (dst->tile_storage->cache, tile,
@@ -3072,6 +3535,87 @@ gegl_buffer_set_color_from_pixel (GeglBuffer          *dst,
     gegl_tile_unref (data.tile);
 }
 
+/* Stores the color of @rect of @buffer in @pixel, in @format, if @rect
+ * only spans uniform tiles of the same color, and returns TRUE; returns
+ * FALSE otherwise.
+ */
+gboolean
+gegl_buffer_get_uniform_pixel (GeglBuffer          *buffer,
+                               const GeglRectangle *rect,
+                               const Babl          *format,
+                               gpointer             pixel)
+{
+  gint     tile_width  = buffer->tile_storage->tile_width;
+  gint     tile_height = buffer->tile_storage->tile_height;
+  gint     bpp         = babl_format_get_bytes_per_pixel (buffer->soft_format);
+  guchar   color[128];
+  gboolean uniform     = TRUE;
+  gboolean first       = TRUE;
+  gint     x0, y0, x1, y1;
+  gint     x, y;
+
+  if (rect->width <= 0 || rect->height <= 0             ||
+      bpp > sizeof (color)                              ||
+      ! gegl_rectangle_contains (&buffer->abyss, rect))
+    {
+      return FALSE;
+    }
+
+  x0 = gegl_tile_indice (buffer->shift_x + rect->x, tile_width);
+  y0 = gegl_tile_indice (buffer->shift_y + rect->y, tile_height);
+  x1 = gegl_tile_indice (buffer->shift_x + rect->x + rect->width  - 1,
+                         tile_width);
+  y1 = gegl_tile_indice (buffer->shift_y + rect->y + rect->height - 1,
+                         tile_height);
+
+  g_rec_mutex_lock (&buffer->tile_storage->mutex);
+
+  for (y = y0; y <= y1 && uniform; y++)
+    {
+      for (x = x0; x <= x1 && uniform; x++)
+        {
+          GeglTile *tile;
+
+          tile = gegl_tile_source_get_tile ((GeglTileSource *) buffer,
+                                            x, y, 0);
+
+          if (! tile)
+            {
+              uniform = FALSE;
+              break;
+            }
+
+          if (! tile->is_uniform_tile)
+            {
+              uniform = FALSE;
+            }
+          else if (first)
+            {
+              memcpy (color, gegl_tile_get_data (tile), bpp);
+              first = FALSE;
+            }
+          else
+            {
+              uniform = ! memcmp (color, gegl_tile_get_data (tile), bpp);
+            }
+
+          gegl_tile_unref (tile);
+        }
+    }
+
+  g_rec_mutex_unlock (&buffer->tile_storage->mutex);
+
+  if (! uniform)
+    return FALSE;
+
+  if (format == buffer->soft_format)
+    memcpy (pixel, color, bpp);
+  else
+    babl_process (babl_fish (buffer->soft_format, format), color, pixel, 1);
+
+  return TRUE;
+}
+
 GeglBuffer *
 gegl_buffer_dup (GeglBuffer *buffer)
 {
@@ -131,3 +131,29 @@ gegl_rectangle_alignment_get_type (void)
 
   return etype;
 }
+
+GType
+gegl_buffer_access_hint_get_type (void)
+{
+  static GType etype = 0;
+
+  if (etype == 0)
+    {
+      static GEnumValue values[] = {
+        { GEGL_BUFFER_ACCESS_HINT_DEFAULT, N_("Default"), "default" },
+        { GEGL_BUFFER_ACCESS_HINT_POINT,   N_("Point"),   "point"   },
+        { GEGL_BUFFER_ACCESS_HINT_AREA,    N_("Area"),    "area"    },
+        { 0, NULL, NULL }
+      };
+      gint i;
+
+      for (i = 0; i < G_N_ELEMENTS (values); i++)
+        if (values[i].value_name)
+          values[i].value_name =
+            dgettext (GETTEXT_PACKAGE, values[i].value_name);
+
+      etype = g_enum_register_static ("GeglBufferAccessHint", values);
+    }
+
+  return etype;
+}
@@ -97,6 +97,19 @@ GType gegl_rectangle_alignment_get_type (void) G_GNUC_CONST;
 
 #define GEGL_TYPE_RECTANGLE_ALIGNMENT (gegl_rectangle_alignment_get_type ())
 
+typedef enum {
+  /* the configured tile size */
+  GEGL_BUFFER_ACCESS_HINT_DEFAULT,
+  /* each pixel is accessed once, independently of its neighbours */
+  GEGL_BUFFER_ACCESS_HINT_POINT,
+  /* each pixel is accessed along with a neighbourhood of pixels */
+  GEGL_BUFFER_ACCESS_HINT_AREA
+} GeglBufferAccessHint;
+
+GType gegl_buffer_access_hint_get_type (void) G_GNUC_CONST;
+
+#define GEGL_TYPE_BUFFER_ACCESS_HINT (gegl_buffer_access_hint_get_type ())
+
 G_END_DECLS
 
 #endif /* __GEGL_ENUMS_H__ */
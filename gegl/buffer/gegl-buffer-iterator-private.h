@@ -24,4 +24,6 @@ G_STATIC_ASSERT (GEGL_BUFFER_READWRITE == 0x3);
 #define GEGL_ITERATOR_INCOMPATIBLE (1 << 2)
 #define GEGL_ITERATOR_NO_NOTIFY    (1 << 3)
 
+void gegl_buffer_iterator_cleanup (void);
+
 #endif
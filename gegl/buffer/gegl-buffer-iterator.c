@@ -28,10 +28,15 @@
 #include "gegl-buffer.h"
 #include "gegl-buffer-types.h"
 #include "gegl-rectangle.h"
+#include "gegl-types.h"
+#include "gegl-parallel.h"
 #include "gegl-buffer-iterator.h"
 #include "gegl-buffer-iterator-private.h"
 #include "gegl-buffer-private.h"
 #include "gegl-tile-storage.h"
+#include "gegl-tile-conversion.h"
+#include "gegl-tile-backend-file.h"
+#include "gegl-tile-backend-swap.h"
 
 typedef enum {
   GeglIteratorState_Start,
@@ -47,6 +52,7 @@ typedef enum {
   GeglIteratorTileMode_DirectTile,
   GeglIteratorTileMode_LinearTile,
   GeglIteratorTileMode_GetBuffer,
+  GeglIteratorTileMode_ConvertedTile,
   GeglIteratorTileMode_Empty,
 } GeglIteratorTileMode;
 
@@ -63,8 +69,12 @@ typedef struct _SubIterState {
   GeglRectangle        real_roi;
   gint                 level;
   gboolean             can_discard_data;
+  gboolean             convert_tiles;
+  gboolean             prefetch;
   /* Direct data members */
   GeglTile            *current_tile;
+  /* Converted tile data members */
+  GeglTileConversion  *conversion;
   /* Indirect data members */
   gpointer             real_data;
   /* Linear data members */
@@ -79,6 +89,7 @@ struct _GeglBufferIteratorPriv
   GeglRectangle     origin_tile;
   gint              remaining_rows;
   gint              max_slots;
+  gboolean          prefetch;
   SubIterState      sub_iter[];
   /* gint           access_order[]; */ /* allocated, but accessed through
                                         * get_access_order().
@@ -112,6 +123,7 @@ _gegl_buffer_iterator_empty_new (gint max_slots)
 
   iter->priv->num_buffers = 0;
   iter->priv->state       = GeglIteratorState_Start;
+  iter->priv->prefetch    = FALSE;
 
   return iter;
 }
@@ -124,6 +136,26 @@ gegl_buffer_iterator_empty_new (gint max_slots)
 }
 
 
+/* only tiles read from disk are worth prefetching; tiles of other
+ * backends are as fast to read directly as to look up in the cache.
+ * mipmap tiles are rendered, rather than read, so they're skipped too,
+ * and exclusive storages may not be accessed by the prefetch threads.
+ */
+static gboolean
+can_prefetch (GeglBuffer *buf,
+              gint        level)
+{
+  GeglTileBackend *backend;
+
+  if (level != 0 || buf->tile_storage->exclusive)
+    return FALSE;
+
+  backend = gegl_buffer_backend (buf);
+
+  return GEGL_IS_TILE_BACKEND_SWAP (backend) ||
+         GEGL_IS_TILE_BACKEND_FILE (backend);
+}
+
 static inline int
 _gegl_buffer_iterator_add (GeglBufferIterator  *iter,
                           GeglBuffer          *buf,
@@ -166,7 +198,13 @@ _gegl_buffer_iterator_add (GeglBufferIterator  *iter,
       sub->level            = level;
       sub->can_discard_data = (access_mode & GEGL_ACCESS_READWRITE) ==
                               GEGL_ACCESS_WRITE;
+      sub->convert_tiles    = FALSE;
+      sub->conversion       = NULL;
       sub->alias            = -1;
+      sub->prefetch         = (access_mode & GEGL_ACCESS_READ) &&
+                              can_prefetch (buf, level);
+
+      priv->prefetch |= sub->prefetch;
 
       if (index > 0)
         {
@@ -233,6 +271,15 @@ release_tile (GeglBufferIterator *iter,
       sub->current_tile = NULL;
       iter->items[index].data = NULL;
 
+      sub->current_tile_mode = GeglIteratorTileMode_Empty;
+    }
+  else if (sub->current_tile_mode == GeglIteratorTileMode_ConvertedTile)
+    {
+      gegl_tile_conversion_unref (sub->conversion);
+
+      sub->conversion = NULL;
+      iter->items[index].data = NULL;
+
       sub->current_tile_mode = GeglIteratorTileMode_Empty;
     }
   else if (sub->current_tile_mode == GeglIteratorTileMode_GetBuffer)
@@ -376,7 +423,7 @@ get_tile (GeglBufferIterator *iter,
       sub->real_roi.width  = tile_width;
       sub->real_roi.height = tile_height;
 
-      g_rec_mutex_lock (&buf->tile_storage->mutex);
+      gegl_tile_storage_lock (buf->tile_storage);
 
       sub->current_tile = gegl_tile_handler_get_tile (
         (GeglTileHandler *) buf,
@@ -384,7 +431,7 @@ get_tile (GeglBufferIterator *iter,
         ! (sub->can_discard_data &&
            gegl_rectangle_contains (&sub->full_rect, &sub->real_roi)));
 
-      g_rec_mutex_unlock (&buf->tile_storage->mutex);
+      gegl_tile_storage_unlock (buf->tile_storage);
 
       if (sub->access_mode & GEGL_ACCESS_WRITE)
         gegl_tile_lock (sub->current_tile);
@@ -396,7 +443,23 @@ get_tile (GeglBufferIterator *iter,
 
   sub->row_stride = buf->tile_width * sub->format_bpp;
 
-  iter->items[index].data = gegl_tile_get_data (sub->current_tile);
+  if (sub->convert_tiles)
+    {
+      sub->conversion = gegl_tile_conversion_get (sub->current_tile,
+                                                  buf->soft_format,
+                                                  sub->format);
+
+      gegl_tile_read_unlock (sub->current_tile);
+      gegl_tile_unref (sub->current_tile);
+      sub->current_tile = NULL;
+
+      iter->items[index].data = gegl_tile_conversion_get_data (sub->conversion);
+      sub->current_tile_mode  = GeglIteratorTileMode_ConvertedTile;
+    }
+  else
+    {
+      iter->items[index].data = gegl_tile_get_data (sub->current_tile);
+    }
 }
 
 static inline double
@@ -435,13 +498,29 @@ needs_indirect_read (GeglBufferIterator *iter,
   GeglBufferIteratorPriv *priv = iter->priv;
   SubIterState           *sub  = &priv->sub_iter[index];
 
-  if (sub->access_mode & GEGL_ITERATOR_INCOMPATIBLE)
-    return TRUE;
-
   /* Needs abyss generation */
   if (!gegl_rectangle_contains (&sub->buffer->abyss, &iter->items[index].roi))
     return TRUE;
 
+  if (sub->access_mode & GEGL_ITERATOR_INCOMPATIBLE)
+    {
+      const GeglRectangle *roi = &iter->items[index].roi;
+
+      /* Incompatible tiles, or format conversion not using converted tiles */
+      if (! sub->convert_tiles)
+        return TRUE;
+
+      /* Tiles are converted whole, so only use their conversions for
+       * chunks covering at least half of the tile, and convert smaller
+       * chunks alone.
+       */
+      if (2 * roi->width * roi->height <
+          sub->buffer->tile_width * sub->buffer->tile_height)
+        {
+          return TRUE;
+        }
+    }
+
   return FALSE;
 }
 
@@ -512,6 +591,7 @@ prepare_iteration (GeglBufferIterator *iter)
       GeglBuffer   *buf   = sub->buffer;
       gint          current_offset_x;
       gint          current_offset_y;
+      gboolean      compatible_tiles;
       gint          j;
 
       gegl_buffer_lock (sub->buffer);
@@ -562,14 +642,25 @@ prepare_iteration (GeglBufferIterator *iter)
             }
         }
 
+      compatible_tiles =
+        (priv->origin_tile.width  == buf->tile_width) &&
+        (priv->origin_tile.height == buf->tile_height) &&
+        (abs(origin_offset_x - current_offset_x) % priv->origin_tile.width == 0) &&
+        (abs(origin_offset_y - current_offset_y) % priv->origin_tile.height == 0);
+
       /* Format converison needed */
       if (gegl_buffer_get_format (sub->buffer) != sub->format)
-        sub->access_mode |= GEGL_ITERATOR_INCOMPATIBLE;
+        {
+          sub->access_mode |= GEGL_ITERATOR_INCOMPATIBLE;
+
+          /* Read-only access to compatible tiles uses their cached
+           * conversions, shared with other readers in the same format.
+           */
+          if (compatible_tiles && ! (sub->access_mode & GEGL_ACCESS_WRITE))
+            sub->convert_tiles = TRUE;
+        }
       /* Incompatiable tiles */
-      else if ((priv->origin_tile.width  != buf->tile_width) ||
-               (priv->origin_tile.height != buf->tile_height) ||
-               (abs(origin_offset_x - current_offset_x) % priv->origin_tile.width != 0) ||
-               (abs(origin_offset_y - current_offset_y) % priv->origin_tile.height != 0))
+      else if (! compatible_tiles)
         {
           /* Check if the buffer is a linear buffer */
           if ((buf->extent.x      == -buf->shift_x) &&
@@ -577,7 +668,7 @@ prepare_iteration (GeglBufferIterator *iter)
               (buf->extent.width  == buf->tile_width) &&
               (buf->extent.height == buf->tile_height))
             {
-              g_rec_mutex_lock (&buf->tile_storage->mutex);
+              gegl_tile_storage_lock (buf->tile_storage);
 
               sub->linear_tile = gegl_tile_handler_get_tile (
                 (GeglTileHandler *) buf,
@@ -585,7 +676,7 @@ prepare_iteration (GeglBufferIterator *iter)
                 ! (sub->can_discard_data &&
                    gegl_rectangle_contains (&sub->full_rect, &buf->extent)));
 
-              g_rec_mutex_unlock (&buf->tile_storage->mutex);
+              gegl_tile_storage_unlock (buf->tile_storage);
 
               if (sub->access_mode & GEGL_ACCESS_WRITE)
                 gegl_tile_lock (sub->linear_tile);
@@ -598,6 +689,193 @@ prepare_iteration (GeglBufferIterator *iter)
     }
 }
 
+/* Prefetching
+ *
+ * Once the tiles of a chunk are loaded, the tiles of the next chunk which
+ * aren't in the cache are requested from storage by the prefetch threads,
+ * so that reading them from the swap, or from a file, overlaps with
+ * processing the current chunk.  By the time the iterator gets to them,
+ * they're normally in the cache.  Buffers of other backends, and mipmap
+ * levels, aren't prefetched; see can_prefetch().
+ */
+
+/* the number of threads reading prefetched tiles */
+#define GEGL_BUFFER_ITERATOR_PREFETCH_THREADS 2
+
+typedef struct
+{
+  GeglTileStorage *tile_storage;
+  gint             x;
+  gint             y;
+  gint             z;
+} PrefetchRequest;
+
+static GThreadPool *prefetch_pool;
+static GMutex       prefetch_mutex;
+
+static void
+prefetch_func (PrefetchRequest *request,
+               gpointer         user_data)
+{
+  GeglTileStorage *tile_storage = request->tile_storage;
+  GeglTile        *tile;
+
+  g_rec_mutex_lock (&tile_storage->mutex);
+
+  tile = gegl_tile_source_get_tile (GEGL_TILE_SOURCE (tile_storage),
+                                    request->x, request->y, request->z);
+
+  g_rec_mutex_unlock (&tile_storage->mutex);
+
+  /* the tile stays in the cache */
+  if (tile)
+    gegl_tile_unref (tile);
+
+  g_object_unref (tile_storage);
+
+  g_slice_free (PrefetchRequest, request);
+}
+
+static GThreadPool *
+get_prefetch_pool (void)
+{
+  GThreadPool *pool = g_atomic_pointer_get (&prefetch_pool);
+
+  if (! pool)
+    {
+      g_mutex_lock (&prefetch_mutex);
+
+      pool = prefetch_pool;
+
+      if (! pool)
+        {
+          pool = g_thread_pool_new ((GFunc) prefetch_func, NULL,
+                                    GEGL_BUFFER_ITERATOR_PREFETCH_THREADS,
+                                    FALSE, NULL);
+
+          g_atomic_pointer_set (&prefetch_pool, pool);
+        }
+
+      g_mutex_unlock (&prefetch_mutex);
+    }
+
+  return pool;
+}
+
+void
+gegl_buffer_iterator_cleanup (void)
+{
+  g_mutex_lock (&prefetch_mutex);
+
+  if (prefetch_pool)
+    {
+      /* finish the pending requests, which hold their tile storage */
+      g_thread_pool_free (prefetch_pool, FALSE, TRUE);
+
+      prefetch_pool = NULL;
+    }
+
+  g_mutex_unlock (&prefetch_mutex);
+}
+
+/* requests the tiles of the chunk at (x, y), in the lead buffer's
+ * coordinates, which the sub-iterators would read directly.
+ */
+static void
+prefetch_tiles (GeglBufferIterator *iter,
+                gint                x,
+                gint                y)
+{
+  GeglBufferIteratorPriv *priv     = iter->priv;
+  SubIterState           *lead_sub = &priv->sub_iter[0];
+  gint                    index;
+
+  for (index = 0; index < priv->num_buffers; index++)
+    {
+      SubIterState    *sub = &priv->sub_iter[index];
+      GeglBuffer      *buf = sub->buffer;
+      GeglTileStorage *tile_storage = buf->tile_storage;
+      PrefetchRequest *request;
+      gint             sub_x;
+      gint             sub_y;
+      gint             tile_x;
+      gint             tile_y;
+      gboolean         cached;
+
+      if (! sub->prefetch                              ||
+          sub->alias >= 0                              ||
+          sub->linear_tile                             ||
+          ((sub->access_mode & GEGL_ITERATOR_INCOMPATIBLE) &&
+           ! sub->convert_tiles))
+        {
+          continue;
+        }
+
+      sub_x = x + sub->full_rect.x - lead_sub->full_rect.x;
+      sub_y = y + sub->full_rect.y - lead_sub->full_rect.y;
+
+      if (sub_x <  buf->abyss.x                    ||
+          sub_y <  buf->abyss.y                    ||
+          sub_x >= buf->abyss.x + buf->abyss.width ||
+          sub_y >= buf->abyss.y + buf->abyss.height)
+        {
+          continue;
+        }
+
+      tile_x = gegl_tile_indice (sub_x + buf->shift_x, buf->tile_width);
+      tile_y = gegl_tile_indice (sub_y + buf->shift_y, buf->tile_height);
+
+      /* don't wait for a prefetch thread holding the storage */
+      if (! g_rec_mutex_trylock (&tile_storage->mutex))
+        continue;
+
+      cached = gegl_tile_source_is_cached (GEGL_TILE_SOURCE (tile_storage),
+                                           tile_x, tile_y, 0);
+
+      g_rec_mutex_unlock (&tile_storage->mutex);
+
+      if (cached)
+        continue;
+
+      request               = g_slice_new (PrefetchRequest);
+      request->tile_storage = g_object_ref (tile_storage);
+      request->x            = tile_x;
+      request->y            = tile_y;
+      request->z            = 0;
+
+      g_thread_pool_push (get_prefetch_pool (), request, NULL);
+    }
+}
+
+/* prefetches the tiles of the chunk following the current one, as
+ * increment_rects() would move to it.
+ */
+static inline void
+prefetch_next_tiles (GeglBufferIterator *iter)
+{
+  GeglBufferIteratorPriv *priv = iter->priv;
+  SubIterState           *sub  = &priv->sub_iter[0];
+  int                     x;
+  int                     y;
+
+  if (! priv->prefetch)
+    return;
+
+  x = iter->items[0].roi.x + iter->items[0].roi.width;
+  y = iter->items[0].roi.y;
+
+  if (x >= sub->full_rect.x + sub->full_rect.width)
+    {
+      x  = sub->full_rect.x;
+      y += iter->items[0].roi.height;
+
+      if (y >= sub->full_rect.y + sub->full_rect.height)
+        return;
+    }
+
+  prefetch_tiles (iter, x, y);
+}
+
 static inline void
 load_rects (GeglBufferIterator *iter)
 {
@@ -635,6 +913,8 @@ load_rects (GeglBufferIterator *iter)
         }
     }
 
+  prefetch_next_tiles (iter);
+
   if (next_state == GeglIteratorState_InRows)
     {
       gint index;
@@ -787,6 +1067,14 @@ gegl_buffer_iterator_next (GeglBufferIterator *iter)
       GeglBuffer   *primary = sub0->buffer;
       gint          index;
 
+      /* don't start iterating if the render we're part of was cancelled */
+      if (gegl_parallel_is_cancelled ())
+        {
+          priv->state = GeglIteratorState_Invalid;
+          _gegl_buffer_iterator_stop (iter);
+          return FALSE;
+        }
+
       if (primary->tile_width == primary->extent.width
           && primary->tile_height == primary->extent.height
           && sub0->full_rect.width == primary->tile_width
@@ -855,7 +1143,7 @@ gegl_buffer_iterator_next (GeglBufferIterator *iter)
             release_tile (iter, index);
         }
 
-      if (increment_rects (iter) == FALSE)
+      if (increment_rects (iter) == FALSE || gegl_parallel_is_cancelled ())
         {
           _gegl_buffer_iterator_stop (iter);
           return FALSE;
@@ -72,6 +72,13 @@ struct _GeglBuffer
   GeglTileBackend  *backend;
 
   gboolean          initialized;
+
+  GeglBufferAccessHint access_hint; /* used to choose the tile size of
+                                       new buffers */
+
+  gboolean          exclusive; /* the new storage is only accessed by a
+                                  single thread, see
+                                  gegl_buffer_new_exclusive() */
 };
 
 struct _GeglBufferClass
@@ -171,6 +178,15 @@ struct _GeglTile
   guint            keep_identity:1;  /* maintain data pointer identity, rather
                                       * than data content only
                                       */
+  gint             is_uniform_tile;  /* whether the tile data is a single
+                                      * pixel repeated across the tile
+                                      * (allowing for false negatives, but
+                                      * not false positives), see
+                                      * gegl_tile_handler_empty_new_uniform_tile().
+                                      * cleared by every writer, outside of the
+                                      * clone-state lock, so it can't share a
+                                      * word with the bit-fields above.
+                                      */
 
   gint             clone_state; /* tile clone/unclone state & spinlock */
   gint            *n_clones;    /* an array of two atomic counters, shared
@@ -192,6 +208,11 @@ struct _GeglTile
    */
   GeglTileCallback unlock_notify;
   gpointer         unlock_notify_data;
+
+  /* the cached conversions of the tile data to other formats, see
+   * gegl-tile-conversion.c
+   */
+  gpointer         conversions;
 };
 
 gboolean gegl_tile_needs_store    (GeglTile *tile);
@@ -211,6 +232,11 @@ gboolean gegl_buffer_scan_compatible (GeglBuffer *bufferA,
                                       gint        xB,
                                       gint        yB);
 
+gboolean gegl_buffer_get_uniform_pixel (GeglBuffer          *buffer,
+                                        const GeglRectangle *rect,
+                                        const Babl          *format,
+                                        gpointer             pixel);
+
 
 extern void (*gegl_tile_handler_cache_ext_flush) (void *tile_handler_cache, const GeglRectangle *rect);
 extern void (*gegl_buffer_ext_flush) (GeglBuffer *buffer, const GeglRectangle *rect);
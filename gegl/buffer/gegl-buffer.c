@@ -54,6 +54,14 @@
 #endif
 
 
+/* the pixel size for which the configured tile size is used as is by
+ * hinted buffers, and the range of their tile dimensions
+ */
+#define GEGL_BUFFER_HINT_REFERENCE_BPP 4
+#define GEGL_BUFFER_HINT_MIN_TILE_SIZE 32
+#define GEGL_BUFFER_HINT_MAX_TILE_SIZE 512
+
+
 G_DEFINE_TYPE (GeglBuffer, gegl_buffer, GEGL_TYPE_TILE_HANDLER)
 
 static GObjectClass * parent_class = NULL;
@@ -78,7 +86,9 @@ enum
   PROP_PIXELS,
   PROP_PATH,
   PROP_BACKEND,
-  PROP_INITIALIZED
+  PROP_INITIALIZED,
+  PROP_ACCESS_HINT,
+  PROP_EXCLUSIVE
 };
 
 enum
@@ -170,6 +180,16 @@ gegl_buffer_get_property (GObject    *gobject,
         g_value_set_boolean (value, buffer->initialized);
         break;
 
+      case PROP_ACCESS_HINT:
+        g_value_set_enum (value, buffer->access_hint);
+        break;
+
+      case PROP_EXCLUSIVE:
+        g_value_set_boolean (value, buffer->tile_storage ?
+                                    buffer->tile_storage->exclusive :
+                                    buffer->exclusive);
+        break;
+
       default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID (gobject, property_id, pspec);
         break;
@@ -273,6 +293,14 @@ gegl_buffer_set_property (GObject      *gobject,
         buffer->initialized = g_value_get_boolean (value);
         break;
 
+      case PROP_ACCESS_HINT:
+        buffer->access_hint = g_value_get_enum (value);
+        break;
+
+      case PROP_EXCLUSIVE:
+        buffer->exclusive = g_value_get_boolean (value);
+        break;
+
       default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID (gobject, property_id, pspec);
         break;
@@ -468,6 +496,53 @@ gegl_buffer_storage_changed (GeglTileStorage     *storage,
   gegl_buffer_emit_changed_signal (GEGL_BUFFER (userdata), rect);
 }
 
+/* the tile size of a new buffer of @format, accessed according to @hint.
+ * tiles of buffers accessed a pixel at a time hold about as many bytes as
+ * the configured tile size does for 4-byte pixels, rather than growing
+ * with the pixel size, while tiles of buffers accessed a neighbourhood at a
+ * time are four times as large, so that fewer of the neighbourhoods cross
+ * into other tiles.
+ */
+static void
+gegl_buffer_get_hinted_tile_size (const Babl           *format,
+                                  GeglBufferAccessHint  hint,
+                                  gint                 *tile_width,
+                                  gint                 *tile_height)
+{
+  GeglBufferConfig *config = gegl_buffer_config ();
+  gint64            n_pixels;
+  gint              n_bits;
+
+  if (hint == GEGL_BUFFER_ACCESS_HINT_DEFAULT)
+    {
+      *tile_width  = config->tile_width;
+      *tile_height = config->tile_height;
+
+      return;
+    }
+
+  n_pixels = (gint64) config->tile_width * config->tile_height *
+             GEGL_BUFFER_HINT_REFERENCE_BPP /
+             babl_format_get_bytes_per_pixel (format);
+
+  if (hint == GEGL_BUFFER_ACCESS_HINT_AREA)
+    n_pixels *= 4;
+
+  n_pixels = CLAMP (n_pixels,
+                    GEGL_BUFFER_HINT_MIN_TILE_SIZE *
+                    GEGL_BUFFER_HINT_MIN_TILE_SIZE,
+                    GEGL_BUFFER_HINT_MAX_TILE_SIZE *
+                    GEGL_BUFFER_HINT_MAX_TILE_SIZE);
+
+  /* round down to a power of two, split as evenly as possible between the
+   * dimensions, favoring wider tiles.
+   */
+  n_bits = g_bit_storage (n_pixels) - 1;
+
+  *tile_width  = 1 << ((n_bits + 1) / 2);
+  *tile_height = 1 << (n_bits / 2);
+}
+
 static GObject *
 gegl_buffer_constructor (GType                  type,
                          guint                  n_params,
@@ -533,6 +608,22 @@ gegl_buffer_constructor (GType                  type,
               buffer->format = babl_format ("RGBA float");
             }
 
+          /* an explicit tile size takes precedence over the access hint */
+          if (buffer->tile_width <= 0 || buffer->tile_height <= 0)
+            {
+              gint tile_width;
+              gint tile_height;
+
+              gegl_buffer_get_hinted_tile_size (buffer->format,
+                                                buffer->access_hint,
+                                                &tile_width, &tile_height);
+
+              if (buffer->tile_width <= 0)
+                buffer->tile_width = tile_width;
+              if (buffer->tile_height <= 0)
+                buffer->tile_height = tile_height;
+            }
+
           /* make a new backend & storage */
 
           if (buffer->path)
@@ -584,6 +675,17 @@ gegl_buffer_constructor (GType                  type,
 
       source = GEGL_TILE_SOURCE (gegl_tile_storage_new (backend,
                                                         buffer->initialized));
+
+      if (buffer->exclusive)
+        {
+          GeglRectangle extent = buffer->extent;
+
+          extent.x += buffer->shift_x;
+          extent.y += buffer->shift_y;
+
+          gegl_tile_storage_make_exclusive (GEGL_TILE_STORAGE (source),
+                                            &extent);
+        }
       gegl_tile_handler_set_source ((GeglTileHandler*)(buffer), source);
       g_object_unref (source);
     }
@@ -871,15 +973,15 @@ gegl_buffer_class_init (GeglBufferClass *class)
                                                         G_PARAM_STATIC_STRINGS));
 
   g_object_class_install_property (gobject_class, PROP_TILE_HEIGHT,
-                                   g_param_spec_int ("tile-height", "tile-height", "height of a tile",
-                                                     -1, G_MAXINT, gegl_buffer_config()->tile_height,
+                                   g_param_spec_int ("tile-height", "tile-height", "height of a tile, or -1 to choose it according to the access hint",
+                                                     -1, G_MAXINT, -1,
                                                      G_PARAM_READWRITE |
                                                      G_PARAM_CONSTRUCT_ONLY |
                                                      G_PARAM_STATIC_STRINGS));
 
   g_object_class_install_property (gobject_class, PROP_TILE_WIDTH,
-                                   g_param_spec_int ("tile-width", "tile-width", "width of a tile",
-                                                     -1, G_MAXINT, gegl_buffer_config()->tile_width,
+                                   g_param_spec_int ("tile-width", "tile-width", "width of a tile, or -1 to choose it according to the access hint",
+                                                     -1, G_MAXINT, -1,
                                                      G_PARAM_READWRITE |
                                                      G_PARAM_CONSTRUCT_ONLY |
                                                      G_PARAM_STATIC_STRINGS));
@@ -900,6 +1002,23 @@ gegl_buffer_class_init (GeglBufferClass *class)
                                                          G_PARAM_CONSTRUCT_ONLY |
                                                          G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (gobject_class, PROP_ACCESS_HINT,
+                                   g_param_spec_enum ("access-hint", "Access hint",
+                                                      "How the buffer is going to be accessed, used to choose its tile size",
+                                                      GEGL_TYPE_BUFFER_ACCESS_HINT,
+                                                      GEGL_BUFFER_ACCESS_HINT_DEFAULT,
+                                                      G_PARAM_READWRITE |
+                                                      G_PARAM_CONSTRUCT_ONLY |
+                                                      G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_EXCLUSIVE,
+                                   g_param_spec_boolean ("exclusive", "Exclusive",
+                                                         "Whether the buffer is only accessed by a single thread at a time",
+                                                         FALSE,
+                                                         G_PARAM_READWRITE |
+                                                         G_PARAM_CONSTRUCT_ONLY |
+                                                         G_PARAM_STATIC_STRINGS));
+
   gegl_buffer_signals[CHANGED] =
     g_signal_new ("changed",
                   G_TYPE_FROM_CLASS (gobject_class),
@@ -1024,6 +1143,51 @@ gegl_buffer_new (const GeglRectangle *extent,
                        NULL);
 }
 
+GeglBuffer *
+gegl_buffer_new_for_access (const GeglRectangle  *extent,
+                            const Babl           *format,
+                            GeglBufferAccessHint  hint)
+{
+  GeglRectangle empty={0,0,0,0};
+
+  if (extent == NULL)
+    extent = &empty;
+
+  if (format == NULL)
+    format = gegl_babl_rgba_linear_float ();
+
+  return g_object_new (GEGL_TYPE_BUFFER,
+                       "x", extent->x,
+                       "y", extent->y,
+                       "width", extent->width,
+                       "height", extent->height,
+                       "format", format,
+                       "access-hint", hint,
+                       NULL);
+}
+
+GeglBuffer *
+gegl_buffer_new_exclusive (const GeglRectangle *extent,
+                           const Babl          *format)
+{
+  GeglRectangle empty={0,0,0,0};
+
+  if (extent == NULL)
+    extent = &empty;
+
+  if (format == NULL)
+    format = gegl_babl_rgba_linear_float ();
+
+  return g_object_new (GEGL_TYPE_BUFFER,
+                       "x", extent->x,
+                       "y", extent->y,
+                       "width", extent->width,
+                       "height", extent->height,
+                       "format", format,
+                       "exclusive", TRUE,
+                       NULL);
+}
+
 GeglBuffer *
 gegl_buffer_new_for_backend (const GeglRectangle *extent,
                              GeglTileBackend     *backend)
@@ -1212,6 +1376,8 @@ void
 gegl_buffer_emit_changed_signal (GeglBuffer          *buffer,
                                  const GeglRectangle *rect)
 {
+  gegl_tile_storage_bump_revision (buffer->tile_storage);
+
   if (buffer->changed_signal_connections)
     {
       GeglRectangle copy;
@@ -1275,6 +1441,14 @@ gegl_buffer_thaw_changed (GeglBuffer *buffer)
     }
 }
 
+guint
+gegl_buffer_get_revision (GeglBuffer *buffer)
+{
+  g_return_val_if_fail (GEGL_IS_BUFFER (buffer), 0);
+
+  return g_atomic_int_get (&buffer->tile_storage->revision);
+}
+
 GeglTile *
 gegl_buffer_get_tile (GeglBuffer *buffer,
                       gint        x,
@@ -1289,12 +1463,12 @@ gegl_buffer_get_tile (GeglBuffer *buffer,
   GeglTileStorage *tile_storage = buffer->tile_storage;
   g_assert (tile_storage);
 
-  g_rec_mutex_lock (&tile_storage->mutex);
+  gegl_tile_storage_lock (tile_storage);
 
   tile = gegl_tile_source_command (source, GEGL_TILE_GET,
                                    x, y, z, NULL);
 
-  g_rec_mutex_unlock (&tile_storage->mutex);
+  gegl_tile_storage_unlock (tile_storage);
   }
 
   return tile;
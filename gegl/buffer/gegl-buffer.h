@@ -68,6 +68,42 @@ struct _GeglRectangle
 GeglBuffer *    gegl_buffer_new               (const GeglRectangle *extent,
                                                const Babl          *format);
 
+/**
+ * gegl_buffer_new_for_access: (skip)
+ * @extent: the geometry of the buffer (origin, width and height) a
+ * GeglRectangle.
+ * @format: the Babl pixel format to be used, create one with babl_format("RGBA
+ * u8") and similar.
+ * @hint: how the buffer is going to be accessed.
+ *
+ * Like gegl_buffer_new(), but with a tile size chosen according to the pixel
+ * size of @format and to @hint, rather than the configured tile size: tiles
+ * of buffers processed a pixel at a time hold about the same number of bytes
+ * regardless of the pixel size, while buffers processed a neighbourhood at
+ * a time get larger tiles.
+ */
+GeglBuffer *    gegl_buffer_new_for_access    (const GeglRectangle  *extent,
+                                               const Babl           *format,
+                                               GeglBufferAccessHint  hint);
+
+/**
+ * gegl_buffer_new_exclusive: (skip)
+ * @extent: the geometry of the buffer (origin, width and height) a
+ * GeglRectangle.
+ * @format: the Babl pixel format to be used, create one with babl_format("RGBA
+ * u8") and similar.
+ *
+ * Like gegl_buffer_new(), but for a buffer which is only ever accessed by a
+ * single thread at a time, such as an operation's temporary buffer.  The
+ * buffer, and the sub-buffers sharing its storage, skip the locking of the
+ * storage, and the tiles within @extent are looked up directly, rather than
+ * through a hash table.  Its tiles are never evicted from the cache, nor
+ * are they prefetched, and large gegl_buffer_get() and gegl_buffer_set()
+ * calls aren't distributed across threads.
+ */
+GeglBuffer *    gegl_buffer_new_exclusive     (const GeglRectangle *extent,
+                                               const Babl          *format);
+
 /**
  * gegl_buffer_new_for_backend:
  * @extent: the geometry of the buffer (origin, width and height) a
@@ -298,6 +334,58 @@ void            gegl_buffer_set               (GeglBuffer          *buffer,
                                                const void          *src,
                                                gint                 rowstride);
 
+/**
+ * gegl_buffer_get_transposed: (skip)
+ * @buffer: the buffer to retrieve data from.
+ * @rect: the coordinates we want to retrieve data from, if NULL equal to the
+ * extent of the buffer. The coordinates and dimensions are after scale has
+ * been applied.
+ * @scale: sampling scale, 1.0 = pixel for pixel 2.0 = magnify, 0.5 scale down.
+ * @format: the BablFormat to store in the linear buffer @dest.
+ * @dest: the memory destination for a linear buffer of @rect->width rows of
+ * @rect->height pixels each.
+ * @rowstride: rowstride in bytes, or GEGL_AUTO_ROWSTRIDE to compute the
+ * rowstride based on the height and bytes per pixel for the specified format.
+ * @repeat_mode: how requests outside the buffer extent are handled, as for
+ * gegl_buffer_get().
+ *
+ * Like gegl_buffer_get(), but stores the pixels transposed, such that each
+ * column of @rect is stored as a row of @dest.  This lets vertical passes of
+ * separable filters process a block of columns as contiguous rows, using the
+ * same code as their horizontal passes, while reading the buffer a band of
+ * whole rows at a time.
+ */
+void            gegl_buffer_get_transposed    (GeglBuffer          *buffer,
+                                               const GeglRectangle *rect,
+                                               gdouble              scale,
+                                               const Babl          *format,
+                                               gpointer             dest,
+                                               gint                 rowstride,
+                                               GeglAbyssPolicy      repeat_mode);
+
+/**
+ * gegl_buffer_set_transposed: (skip)
+ * @buffer: the buffer to modify.
+ * @rect: the coordinates we want to change the data of, if NULL equal to the
+ * extent of the buffer.
+ * @mipmap_level: the scale level being set, 0 = 1:1 = default = base mipmap level,
+ * 1 = 1:2, 2=1:4, 3=1:8 ..
+ * @format: the babl_format the linear buffer @src.
+ * @src: linear buffer of @rect->width rows of @rect->height pixels each.
+ * @rowstride: rowstride in bytes, or GEGL_AUTO_ROWSTRIDE to compute the
+ * rowstride based on the height and bytes per pixel for the specified format.
+ *
+ * Like gegl_buffer_set(), but with the pixels of @src transposed, such that
+ * each row of @src is stored as a column of @rect; the counterpart of
+ * gegl_buffer_get_transposed().
+ */
+void            gegl_buffer_set_transposed    (GeglBuffer          *buffer,
+                                               const GeglRectangle *rect,
+                                               gint                 mipmap_level,
+                                               const Babl          *format,
+                                               gconstpointer        src,
+                                               gint                 rowstride);
+
 
 
 /**
@@ -752,6 +840,21 @@ void gegl_buffer_freeze_changed (GeglBuffer *buffer);
  */
 void gegl_buffer_thaw_changed (GeglBuffer *buffer);
 
+/**
+ * gegl_buffer_get_revision:
+ * @buffer: a GeglBuffer
+ *
+ * Returns a number identifying the current content of @buffer, which
+ * changes whenever @buffer, or another buffer sharing its storage, such as
+ * a sub-buffer, is written to; regardless of whether the "changed" signal
+ * is blocked, or has any handlers.  As long as the revision of @buffer
+ * stays the same, so does its content, which allows caching values derived
+ * from it.
+ *
+ * Returns: the revision of @buffer's content.
+ */
+guint gegl_buffer_get_revision (GeglBuffer *buffer);
+
 
 /**
  * gegl_buffer_flush_ext:
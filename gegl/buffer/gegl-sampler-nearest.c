@@ -164,7 +164,7 @@ gegl_sampler_get_pixel (GeglSampler    *sampler,
           tile->x == indice_x &&
           tile->y == indice_y))
       {
-        g_rec_mutex_lock (&buffer->tile_storage->mutex);
+        gegl_tile_storage_lock (buffer->tile_storage);
 
         if (tile)
           {
@@ -180,7 +180,7 @@ gegl_sampler_get_pixel (GeglSampler    *sampler,
 
         gegl_tile_read_lock (tile);
 
-        g_rec_mutex_unlock (&buffer->tile_storage->mutex);
+        gegl_tile_storage_unlock (buffer->tile_storage);
       }
 
     if (tile)
@@ -20,7 +20,11 @@
 #define __GEGL_SCRATCH_PRIVATE_H__
 
 
-guint64   gegl_scratch_get_total (void);
+guint64   gegl_scratch_get_total     (void);
+
+void      gegl_scratch_set_counter   (volatile guintptr *counter);
+volatile guintptr *
+          gegl_scratch_get_counter   (void);
 
 
 #endif /* __GEGL_SCRATCH_PRIVATE_H__ */
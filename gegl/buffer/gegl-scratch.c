@@ -22,35 +22,57 @@
 
 #include <glib-object.h>
 
+#include "gegl-instrument.h"
 #include "gegl-memory-private.h"
 #include "gegl-scratch.h"
 #include "gegl-scratch-private.h"
 
 
-#define GEGL_SCRATCH_MAX_BLOCK_SIZE    (1 << 20)
-#define GEGL_SCRATCH_BLOCK_DATA_OFFSET GEGL_ALIGN (sizeof (GeglScratchBlock))
+#define GEGL_SCRATCH_MAX_BLOCK_SIZE_LOG2 20
+#define GEGL_SCRATCH_MAX_BLOCK_SIZE      (1 << GEGL_SCRATCH_MAX_BLOCK_SIZE_LOG2)
+#define GEGL_SCRATCH_MIN_BLOCK_SIZE_LOG2 6
+#define GEGL_SCRATCH_MIN_BLOCK_SIZE      (1 << GEGL_SCRATCH_MIN_BLOCK_SIZE_LOG2)
+#define GEGL_SCRATCH_N_CLASSES           (1 + 4 * (GEGL_SCRATCH_MAX_BLOCK_SIZE_LOG2 - \
+                                               GEGL_SCRATCH_MIN_BLOCK_SIZE_LOG2))
+#define GEGL_SCRATCH_NO_CLASS            G_MAXUINT8
+#define GEGL_SCRATCH_TRIM_INTERVAL       256
+#define GEGL_SCRATCH_BLOCK_DATA_OFFSET   GEGL_ALIGN (sizeof (GeglScratchBlock))
 
 
 G_STATIC_ASSERT (GEGL_ALIGNMENT <= G_MAXUINT8);
+G_STATIC_ASSERT (GEGL_SCRATCH_N_CLASSES < GEGL_SCRATCH_NO_CLASS);
 
 
 /*  private types  */
 
-typedef struct _GeglScratchBlock   GeglScratchBlock;
-typedef struct _GeglScratchContext GeglScratchContext;
+typedef struct _GeglScratchBlock    GeglScratchBlock;
+typedef struct _GeglScratchFreeList GeglScratchFreeList;
+typedef struct _GeglScratchContext  GeglScratchContext;
 
 struct _GeglScratchBlock
 {
   GeglScratchContext *context;
+  GeglScratchBlock   *next;
+  GeglScratchBlock   *prev;
   gsize               size;
+  gint                scope;
+  guint8              klass;
   guint8              offset;
 };
 
+struct _GeglScratchFreeList
+{
+  GeglScratchBlock *head;
+  gint              n_blocks;
+  gint              min_n_blocks; /* since the last trim */
+};
+
 struct _GeglScratchContext
 {
-  GeglScratchBlock **blocks;
-  gint               n_blocks;
-  gint               n_available_blocks;
+  GeglScratchFreeList  free_lists[GEGL_SCRATCH_N_CLASSES];
+  GeglScratchBlock    *scope_blocks; /* most recent first */
+  gint                 scope;
+  gint                 n_allocs;     /* since the last trim */
 };
 
 
@@ -58,21 +80,27 @@ struct _GeglScratchContext
 
 static GeglScratchContext      * gegl_scratch_context_new     (void);
 static void                      gegl_scratch_context_free    (GeglScratchContext *context);
+static inline GeglScratchContext * gegl_scratch_context_get   (void);
+static void                      gegl_scratch_context_trim    (GeglScratchContext *context);
 
 static GeglScratchBlock        * gegl_scratch_block_new       (GeglScratchContext *context,
-                                                               gsize               size);
+                                                               gsize               size,
+                                                               gint                klass);
 static void                      gegl_scratch_block_free      (GeglScratchBlock   *block);
 
 static inline gpointer           gegl_scratch_block_to_data   (GeglScratchBlock   *block);
 static inline GeglScratchBlock * gegl_scratch_block_from_data (gpointer            data);
 
+static inline gint               gegl_scratch_size_to_class   (gsize               size);
+static inline gsize              gegl_scratch_class_to_size   (gint                klass);
+
 
 /*  local variables  */
 
 static GPrivate                 gegl_scratch_context = G_PRIVATE_INIT (
   (GDestroyNotify) gegl_scratch_context_free);
-static const GeglScratchContext void_context;
 static volatile guintptr        gegl_scratch_total;
+static GPrivate                 gegl_scratch_counter;
 
 
 /*  private functions  */
@@ -88,17 +116,81 @@ gegl_scratch_context_free (GeglScratchContext *context)
 {
   gint i;
 
-  for (i = 0; i < context->n_available_blocks; i++)
-    gegl_scratch_block_free (context->blocks[i]);
+  for (i = 0; i < GEGL_SCRATCH_N_CLASSES; i++)
+    {
+      GeglScratchBlock *block = context->free_lists[i].head;
+
+      while (block)
+        {
+          GeglScratchBlock *next = block->next;
+
+          gegl_scratch_block_free (block);
+
+          block = next;
+        }
+    }
+
+  /* blocks left over in unterminated scopes */
+  while (context->scope_blocks)
+    {
+      GeglScratchBlock *next = context->scope_blocks->next;
+
+      gegl_scratch_block_free (context->scope_blocks);
 
-  g_free (context->blocks);
+      context->scope_blocks = next;
+    }
 
   g_slice_free (GeglScratchContext, context);
 }
 
+static inline GeglScratchContext *
+gegl_scratch_context_get (void)
+{
+  GeglScratchContext *context = g_private_get (&gegl_scratch_context);
+
+  if (G_UNLIKELY (! context))
+    {
+      context = gegl_scratch_context_new ();
+
+      g_private_set (&gegl_scratch_context, context);
+    }
+
+  return context;
+}
+
+/* frees the blocks which remained unused ever since the last trim, which
+ * happens every GEGL_SCRATCH_TRIM_INTERVAL allocations, keeping the cache
+ * at the high-water mark of the recent usage of each size class.
+ */
+static void
+gegl_scratch_context_trim (GeglScratchContext *context)
+{
+  gint i;
+
+  for (i = 0; i < GEGL_SCRATCH_N_CLASSES; i++)
+    {
+      GeglScratchFreeList *list = &context->free_lists[i];
+
+      for (; list->min_n_blocks > 0; list->min_n_blocks--)
+        {
+          GeglScratchBlock *block = list->head;
+
+          list->head = block->next;
+          list->n_blocks--;
+
+          gegl_scratch_block_free (block);
+        }
+
+      list->min_n_blocks = list->n_blocks;
+    }
+
+  context->n_allocs = 0;
+}
+
 GeglScratchBlock *
 gegl_scratch_block_new (GeglScratchContext *context,
-                        gsize               size)
+                        gsize               size,
+                        gint                klass)
 {
   GeglScratchBlock *block;
   gint              offset;
@@ -115,6 +207,7 @@ gegl_scratch_block_new (GeglScratchContext *context,
 
   block->context = context;
   block->size    = size;
+  block->klass   = klass;
   block->offset  = offset;
 
   return block;
@@ -141,44 +234,99 @@ gegl_scratch_block_from_data (gpointer data)
                                GEGL_SCRATCH_BLOCK_DATA_OFFSET);
 }
 
+/* the size classes are GEGL_SCRATCH_MIN_BLOCK_SIZE, followed by four
+ * classes per power of two, at 1.25, 1.5, 1.75 and 2 times the previous
+ * power of two, wasting at most 20% of each block.
+ */
+static inline gint
+gegl_scratch_size_to_class (gsize size)
+{
+  gsize m;
+  gint  l;
+
+  if (size <= GEGL_SCRATCH_MIN_BLOCK_SIZE)
+    return 0;
+
+  m = size - 1;
+  l = g_bit_storage (m) - 1;
+
+  return 1 + 4 * (l - GEGL_SCRATCH_MIN_BLOCK_SIZE_LOG2) + ((m >> (l - 2)) & 3);
+}
+
+static inline gsize
+gegl_scratch_class_to_size (gint klass)
+{
+  gint l;
+  gint k;
+
+  if (klass == 0)
+    return GEGL_SCRATCH_MIN_BLOCK_SIZE;
+
+  l = GEGL_SCRATCH_MIN_BLOCK_SIZE_LOG2 + (klass - 1) / 4;
+  k = (klass - 1) % 4 + 1;
+
+  return ((gsize) 1 << l) / 4 * (4 + k);
+}
+
 
 /*  public functions  */
 
 gpointer
 gegl_scratch_alloc (gsize size)
 {
-  GeglScratchContext *context;
+  GeglScratchContext *context = gegl_scratch_context_get ();
   GeglScratchBlock   *block;
 
   if (G_UNLIKELY (size > GEGL_SCRATCH_MAX_BLOCK_SIZE))
     {
-      block = gegl_scratch_block_new ((GeglScratchContext *) &void_context,
-                                      size);
-
-      return gegl_scratch_block_to_data (block);
+      block = gegl_scratch_block_new (context, size, GEGL_SCRATCH_NO_CLASS);
+    }
+  else
+    {
+      gint                 klass = gegl_scratch_size_to_class (size);
+      GeglScratchFreeList *list  = &context->free_lists[klass];
+
+      block = list->head;
+
+      if (G_LIKELY (block))
+        {
+          list->head = block->next;
+          list->n_blocks--;
+
+          list->min_n_blocks = MIN (list->min_n_blocks, list->n_blocks);
+        }
+      else
+        {
+          block = gegl_scratch_block_new (context,
+                                          gegl_scratch_class_to_size (klass),
+                                          klass);
+        }
+
+      if (G_UNLIKELY (++context->n_allocs == GEGL_SCRATCH_TRIM_INTERVAL))
+        gegl_scratch_context_trim (context);
     }
 
-  context = g_private_get (&gegl_scratch_context);
+  block->scope = context->scope;
 
-  if (G_UNLIKELY (! context))
+  if (G_UNLIKELY (block->scope))
     {
-      context = gegl_scratch_context_new ();
+      block->prev = NULL;
+      block->next = context->scope_blocks;
 
-      g_private_set (&gegl_scratch_context, context);
+      if (context->scope_blocks)
+        context->scope_blocks->prev = block;
+
+      context->scope_blocks = block;
     }
 
-  if (G_LIKELY (context->n_available_blocks))
+  if (G_UNLIKELY (gegl_instrument_enabled))
     {
-      block = context->blocks[--context->n_available_blocks];
-
-      if (G_LIKELY (size <= block->size))
-        return gegl_scratch_block_to_data (block);
+      volatile guintptr *counter = g_private_get (&gegl_scratch_counter);
 
-      gegl_scratch_block_free (block);
+      if (counter)
+        g_atomic_pointer_add (counter, size);
     }
 
-  block = gegl_scratch_block_new (context, size);
-
   return gegl_scratch_block_to_data (block);
 }
 
@@ -197,27 +345,72 @@ gegl_scratch_alloc0 (gsize size)
 void
 gegl_scratch_free (gpointer ptr)
 {
-  GeglScratchContext *context;
-  GeglScratchBlock   *block;
+  GeglScratchContext  *context;
+  GeglScratchBlock    *block;
+  GeglScratchFreeList *list;
 
   context = g_private_get (&gegl_scratch_context);
   block   = gegl_scratch_block_from_data (ptr);
 
   if (G_UNLIKELY (block->context != context))
     {
+      /* only memory allocated outside of a scope may be freed by a
+       * different thread
+       */
+      g_warn_if_fail (block->scope == 0);
+
       gegl_scratch_block_free (block);
 
       return;
     }
 
-  if (G_UNLIKELY (context->n_available_blocks == context->n_blocks))
+  if (G_UNLIKELY (block->scope))
+    {
+      if (block->prev)
+        block->prev->next = block->next;
+      else
+        context->scope_blocks = block->next;
+
+      if (block->next)
+        block->next->prev = block->prev;
+    }
+
+  if (G_UNLIKELY (block->klass == GEGL_SCRATCH_NO_CLASS))
     {
-      context->n_blocks = MAX (2 * context->n_blocks, 1);
-      context->blocks   = g_renew (GeglScratchBlock *, context->blocks,
-                                   context->n_blocks);
+      gegl_scratch_block_free (block);
+
+      return;
     }
 
-  context->blocks[context->n_available_blocks++] = block;
+  list = &context->free_lists[block->klass];
+
+  block->next = list->head;
+  list->head  = block;
+  list->n_blocks++;
+}
+
+void
+gegl_scratch_begin (void)
+{
+  GeglScratchContext *context = gegl_scratch_context_get ();
+
+  context->scope++;
+}
+
+void
+gegl_scratch_end (void)
+{
+  GeglScratchContext *context = g_private_get (&gegl_scratch_context);
+
+  g_return_if_fail (context && context->scope > 0);
+
+  while (context->scope_blocks &&
+         context->scope_blocks->scope == context->scope)
+    {
+      gegl_scratch_free (gegl_scratch_block_to_data (context->scope_blocks));
+    }
+
+  context->scope--;
 }
 
 
@@ -228,3 +421,20 @@ gegl_scratch_get_total (void)
 {
   return gegl_scratch_total;
 }
+
+/* sets the counter the scratch memory allocated by the calling thread is
+ * added to, while instrumentation is enabled.  the counter is shared with
+ * the worker threads of gegl_parallel_distribute(), and is added to
+ * atomically.
+ */
+void
+gegl_scratch_set_counter (volatile guintptr *counter)
+{
+  g_private_set (&gegl_scratch_counter, (gpointer) counter);
+}
+
+volatile guintptr *
+gegl_scratch_get_counter (void)
+{
+  return g_private_get (&gegl_scratch_counter);
+}
@@ -51,6 +51,26 @@ gpointer   gegl_scratch_alloc0 (gsize    size) G_GNUC_MALLOC;
  */
 void       gegl_scratch_free   (gpointer ptr);
 
+/**
+ * gegl_scratch_begin: (skip)
+ *
+ * Begins a scratch-memory scope, which lasts until the matching
+ * gegl_scratch_end() call.  Scopes may be nested.
+ *
+ * Scratch memory allocated by the calling thread within the scope, and not
+ * freed explicitly, is freed by gegl_scratch_end().  Such memory may only
+ * be freed explicitly by the same thread.
+ */
+void       gegl_scratch_begin  (void);
+
+/**
+ * gegl_scratch_end: (skip)
+ *
+ * Ends the innermost scratch-memory scope of the calling thread, begun by
+ * gegl_scratch_begin(), freeing the scratch memory allocated within it.
+ */
+void       gegl_scratch_end    (void);
+
 
 #define _GEGL_SCRATCH_MUL(x, y) \
   (G_LIKELY ((y) <= G_MAXSIZE / (x)) ? (x) * (y) : G_MAXSIZE)
@@ -26,6 +26,10 @@
 #include <malloc.h>
 #endif
 
+#ifdef HAVE_MADVISE
+#include <sys/mman.h>
+#endif
+
 #include <glib-object.h>
 
 #include "gegl-buffer-config.h"
@@ -44,8 +48,16 @@
 #define GEGL_TILE_BLOCK_SIZE_RATIO    0.01
 #define GEGL_TILE_BLOCK_MAX_BUFFERS   1024
 #define GEGL_TILE_BLOCKS_PER_TRIM     10
+#define GEGL_TILE_MAX_N_EMPTY_BLOCKS  1
 #define GEGL_TILE_SENTINEL_BLOCK      ((GeglTileBlock *) ~(guintptr) 0)
 
+#define GEGL_TILE_PAGE_SIZE           4096
+#define GEGL_TILE_HUGE_PAGE_SIZE      (2 << 20)
+
+#if defined (HAVE_MADVISE) && defined (MADV_HUGEPAGE) && defined (MAP_ANONYMOUS)
+#define GEGL_TILE_ALLOC_HUGE_PAGES    1
+#endif
+
 
 /*  private types  */
 
@@ -64,6 +76,8 @@ struct _GeglTileBlock
 {
   GeglTileBlock * volatile *block_ptr;
   guintptr                  size;
+  gsize                     buffer_size;
+  gboolean                  huge_pages;
 
   GeglTileBuffer           *head;
   gint                      n_allocated;
@@ -77,11 +91,22 @@ struct _GeglTileBlock
 
 static gint                    gegl_tile_log2i            (guint                      n);
 
+static gsize                   gegl_tile_block_get_size   (gsize                      buffer_size);
 static GeglTileBlock         * gegl_tile_block_new        (GeglTileBlock * volatile  *block_ptr,
                                                            gsize                      size);
 static void                    gegl_tile_block_free       (GeglTileBlock             *block,
                                                            GeglTileBlock            **head_block);
+static GeglTileBlock         * gegl_tile_block_alloc_mem  (gsize                      size);
 static void                    gegl_tile_block_free_mem   (GeglTileBlock             *block);
+static void                    gegl_tile_block_prefault   (GeglTileBlock             *block);
+
+#ifdef GEGL_TILE_ALLOC_HUGE_PAGES
+static gpointer                gegl_tile_huge_pages_alloc (gsize                      size);
+static gboolean                gegl_tile_alloc_huge_pages_enabled (void);
+#endif
+
+static GeglTileBlock         * gegl_tile_empty_block_pop  (gsize                      buffer_size);
+static gboolean                gegl_tile_empty_block_push (GeglTileBlock             *block);
 
 static inline gpointer         gegl_tile_buffer_to_data   (GeglTileBuffer            *buffer);
 static inline GeglTileBuffer * gegl_tile_buffer_from_data (gpointer                   data);
@@ -94,11 +119,17 @@ static gpointer                gegl_tile_alloc_fallback   (gsize
 static const gint     gegl_tile_divisors[] = {1, 3, 5};
 static GeglTileBlock *gegl_tile_blocks[G_N_ELEMENTS (gegl_tile_divisors)]
                                       [GEGL_TILE_MAX_SIZE_LOG2];
-static GeglTileBlock *gegl_tile_empty_block;
+static GMutex         gegl_tile_empty_blocks_mutex;
+static GeglTileBlock *gegl_tile_empty_blocks; /* linked through next */
+static gint           gegl_tile_n_empty_blocks;
+static gint           gegl_tile_max_n_empty_blocks = GEGL_TILE_MAX_N_EMPTY_BLOCKS;
 static gint           gegl_tile_n_blocks;
 static gint           gegl_tile_max_n_blocks;
+static gint           gegl_tile_n_huge_page_blocks;
 
 static guintptr       gegl_tile_alloc_total;
+static guintptr       gegl_tile_alloc_used;
+static guintptr       gegl_tile_alloc_n_fallbacks;
 
 
 /*  private functions  */
@@ -136,6 +167,28 @@ gegl_tile_log2i (guint n)
 
 #endif /* HAVE___BUILTIN_CLZ */
 
+/* returns the size of a new block for buffers of @buffer_size bytes, or 0 if
+ * such a block would hold a single buffer.
+ */
+static gsize
+gegl_tile_block_get_size (gsize buffer_size)
+{
+  gsize block_size;
+  gsize n_buffers;
+
+  block_size  = floor (gegl_buffer_config ()->tile_cache_size *
+                       GEGL_TILE_BLOCK_SIZE_RATIO);
+  block_size -= block_size % buffer_size;
+
+  n_buffers = block_size / buffer_size;
+  n_buffers = MIN (n_buffers, GEGL_TILE_BLOCK_MAX_BUFFERS);
+
+  if (n_buffers <= 1)
+    return 0;
+
+  return GEGL_TILE_BLOCK_BUFFER_OFFSET + n_buffers * buffer_size;
+}
+
 static GeglTileBlock *
 gegl_tile_block_new (GeglTileBlock * volatile *block_ptr,
                      gsize                     size)
@@ -148,57 +201,35 @@ gegl_tile_block_new (GeglTileBlock * volatile *block_ptr,
 
   buffer_size = GEGL_TILE_BUFFER_DATA_OFFSET + GEGL_ALIGN (size);
 
-  do
-    {
-      block = gegl_tile_empty_block;
-    }
-  while (block &&
-         ! g_atomic_pointer_compare_and_exchange (&gegl_tile_empty_block,
-                                                  block, NULL));
-
-  if (block && block->size - GEGL_TILE_BLOCK_BUFFER_OFFSET < buffer_size)
-    {
-      gegl_tile_block_free_mem (block);
-
-      block = NULL;
-    }
+  block = gegl_tile_empty_block_pop (buffer_size);
 
   if (block)
     {
       block_size = block->size;
 
       n_buffers = (block_size - GEGL_TILE_BLOCK_BUFFER_OFFSET) / buffer_size;
+      n_buffers = MIN (n_buffers, GEGL_TILE_BLOCK_MAX_BUFFERS);
 
       if (block->block_ptr == block_ptr)
         init_block = FALSE;
     }
   else
     {
-      gint n_blocks;
+      block_size = gegl_tile_block_get_size (buffer_size);
 
-      block_size  = floor (gegl_buffer_config ()->tile_cache_size *
-                           GEGL_TILE_BLOCK_SIZE_RATIO);
-      block_size -= block_size % buffer_size;
-
-      n_buffers = block_size / buffer_size;
-      n_buffers = MIN (n_buffers, GEGL_TILE_BLOCK_MAX_BUFFERS);
-
-      if (n_buffers <= 1)
+      if (! block_size)
         return NULL;
 
-      block_size = GEGL_TILE_BLOCK_BUFFER_OFFSET + n_buffers * buffer_size;
-
-      block = gegl_try_malloc (block_size);
+      block = gegl_tile_block_alloc_mem (block_size);
 
       if (! block)
         return NULL;
 
-      n_blocks = g_atomic_int_add (&gegl_tile_n_blocks, +1) + 1;
-
-      if (n_blocks % GEGL_TILE_BLOCKS_PER_TRIM == 0)
-        gegl_tile_max_n_blocks = MAX (gegl_tile_max_n_blocks, n_blocks);
+      /* the block may have been rounded up to whole huge pages */
+      block_size = block->size;
 
-      g_atomic_pointer_add (&gegl_tile_alloc_total, +block_size);
+      n_buffers = (block_size - GEGL_TILE_BLOCK_BUFFER_OFFSET) / buffer_size;
+      n_buffers = MIN (n_buffers, GEGL_TILE_BLOCK_MAX_BUFFERS);
     }
 
   if (init_block)
@@ -209,6 +240,7 @@ gegl_tile_block_new (GeglTileBlock * volatile *block_ptr,
 
       block->block_ptr   = block_ptr;
       block->size        = block_size;
+      block->buffer_size = buffer_size;
 
       block->head        = (GeglTileBuffer *) ((guint8 *) block +
                                                GEGL_TILE_BLOCK_BUFFER_OFFSET);
@@ -249,19 +281,55 @@ gegl_tile_block_free (GeglTileBlock  *block,
   if (block->next)
     block->next->prev = block->prev;
 
-  if (! gegl_tile_empty_block)
+  if (! gegl_tile_empty_block_push (block))
+    gegl_tile_block_free_mem (block);
+}
+
+static GeglTileBlock *
+gegl_tile_block_alloc_mem (gsize size)
+{
+  GeglTileBlock *block      = NULL;
+  gboolean       huge_pages = FALSE;
+  gint           n_blocks;
+
+#ifdef GEGL_TILE_ALLOC_HUGE_PAGES
+  if (size >= GEGL_TILE_HUGE_PAGE_SIZE && gegl_tile_alloc_huge_pages_enabled ())
     {
-      block->prev = NULL;
-      block->next = NULL;
+      gsize huge_size;
 
-      if (g_atomic_pointer_compare_and_exchange (&gegl_tile_empty_block,
-                                                 NULL, block))
+      huge_size = (size + (GEGL_TILE_HUGE_PAGE_SIZE - 1)) /
+                  GEGL_TILE_HUGE_PAGE_SIZE                *
+                  GEGL_TILE_HUGE_PAGE_SIZE;
+
+      block = gegl_tile_huge_pages_alloc (huge_size);
+
+      if (block)
         {
-          return;
+          size       = huge_size;
+          huge_pages = TRUE;
+
+          g_atomic_int_inc (&gegl_tile_n_huge_page_blocks);
         }
     }
+#endif
+
+  if (! block)
+    block = gegl_try_malloc (size);
+
+  if (! block)
+    return NULL;
+
+  block->size       = size;
+  block->huge_pages = huge_pages;
 
-  gegl_tile_block_free_mem (block);
+  n_blocks = g_atomic_int_add (&gegl_tile_n_blocks, +1) + 1;
+
+  if (n_blocks % GEGL_TILE_BLOCKS_PER_TRIM == 0)
+    gegl_tile_max_n_blocks = MAX (gegl_tile_max_n_blocks, n_blocks);
+
+  g_atomic_pointer_add (&gegl_tile_alloc_total, +size);
+
+  return block;
 }
 
 static void
@@ -270,7 +338,18 @@ gegl_tile_block_free_mem (GeglTileBlock *block)
   guintptr block_size = block->size;
   gint     n_blocks;
 
-  gegl_free (block);
+#ifdef GEGL_TILE_ALLOC_HUGE_PAGES
+  if (block->huge_pages)
+    {
+      munmap (block, block_size);
+
+      g_atomic_int_add (&gegl_tile_n_huge_page_blocks, -1);
+    }
+  else
+#endif
+    {
+      gegl_free (block);
+    }
 
   n_blocks = g_atomic_int_add (&gegl_tile_n_blocks, -1) - 1;
 
@@ -288,6 +367,154 @@ gegl_tile_block_free_mem (GeglTileBlock *block)
 #endif
 }
 
+/* touches all the pages of @block, so that using the block later on doesn't
+ * incur page faults.  the first page, holding the block header, has already
+ * been written to.
+ */
+static void
+gegl_tile_block_prefault (GeglTileBlock *block)
+{
+  volatile guint8 *mem = (volatile guint8 *) block;
+  gsize            i;
+
+  for (i = GEGL_TILE_PAGE_SIZE; i < block->size; i += GEGL_TILE_PAGE_SIZE)
+    mem[i] = 0;
+}
+
+#ifdef GEGL_TILE_ALLOC_HUGE_PAGES
+
+/* maps @size bytes, a multiple of the huge-page size, aligned to a huge
+ * page, and asks the kernel to back them with transparent huge pages.
+ * returns NULL if either fails.
+ */
+static gpointer
+gegl_tile_huge_pages_alloc (gsize size)
+{
+  guint8 *mem;
+  guint8 *aligned;
+  gsize   head;
+
+  /* over-allocate, so that the mapping can be trimmed to a huge-page
+   * boundary
+   */
+  mem = mmap (NULL, size + GEGL_TILE_HUGE_PAGE_SIZE,
+              PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+  if (mem == MAP_FAILED)
+    return NULL;
+
+  aligned = (guint8 *) (((guintptr) mem + (GEGL_TILE_HUGE_PAGE_SIZE - 1)) &
+                        ~(guintptr) (GEGL_TILE_HUGE_PAGE_SIZE - 1));
+  head    = aligned - mem;
+
+  if (head)
+    munmap (mem, head);
+
+  munmap (aligned + size, GEGL_TILE_HUGE_PAGE_SIZE - head);
+
+  if (madvise (aligned, size, MADV_HUGEPAGE))
+    {
+      munmap (aligned, size);
+
+      return NULL;
+    }
+
+  return aligned;
+}
+
+#endif /* GEGL_TILE_ALLOC_HUGE_PAGES */
+
+/* returns the smallest unused block large enough for a buffer of
+ * @buffer_size bytes, if one is available.
+ */
+static GeglTileBlock *
+gegl_tile_empty_block_pop (gsize buffer_size)
+{
+  GeglTileBlock  *block     = NULL;
+  GeglTileBlock **block_ptr = NULL;
+  GeglTileBlock **iter;
+
+  if (! gegl_tile_empty_blocks)
+    return NULL;
+
+  g_mutex_lock (&gegl_tile_empty_blocks_mutex);
+
+  for (iter = &gegl_tile_empty_blocks; *iter; iter = &(*iter)->next)
+    {
+      if ((*iter)->size - GEGL_TILE_BLOCK_BUFFER_OFFSET >= buffer_size &&
+          (! block_ptr || (*iter)->size < (*block_ptr)->size))
+        {
+          block_ptr = iter;
+        }
+    }
+
+  if (block_ptr)
+    block = *block_ptr;
+
+  if (block)
+    {
+      *block_ptr = block->next;
+
+      block->next = NULL;
+
+      gegl_tile_n_empty_blocks--;
+
+      /* the warmup blocks don't return to the pool once used, so that the
+       * pool shrinks back to its usual size.
+       */
+      if (gegl_tile_max_n_empty_blocks > GEGL_TILE_MAX_N_EMPTY_BLOCKS)
+        gegl_tile_max_n_empty_blocks--;
+    }
+  else if (gegl_tile_n_empty_blocks == gegl_tile_max_n_empty_blocks)
+    {
+      /* none of the blocks is large enough, and there is no room for
+       * others; free the most recent one
+       */
+      GeglTileBlock *too_small = gegl_tile_empty_blocks;
+
+      gegl_tile_empty_blocks = too_small->next;
+
+      gegl_tile_n_empty_blocks--;
+
+      g_mutex_unlock (&gegl_tile_empty_blocks_mutex);
+
+      gegl_tile_block_free_mem (too_small);
+
+      return NULL;
+    }
+
+  g_mutex_unlock (&gegl_tile_empty_blocks_mutex);
+
+  return block;
+}
+
+/* keeps @block around for reuse, if there is room for it, and returns TRUE;
+ * returns FALSE otherwise.
+ */
+static gboolean
+gegl_tile_empty_block_push (GeglTileBlock *block)
+{
+  gboolean success = FALSE;
+
+  g_mutex_lock (&gegl_tile_empty_blocks_mutex);
+
+  if (gegl_tile_n_empty_blocks < gegl_tile_max_n_empty_blocks)
+    {
+      block->prev = NULL;
+      block->next = gegl_tile_empty_blocks;
+
+      gegl_tile_empty_blocks = block;
+
+      gegl_tile_n_empty_blocks++;
+
+      success = TRUE;
+    }
+
+  g_mutex_unlock (&gegl_tile_empty_blocks_mutex);
+
+  return success;
+}
+
 static inline gpointer
 gegl_tile_buffer_to_data (GeglTileBuffer *buffer)
 {
@@ -307,6 +534,8 @@ gegl_tile_alloc_fallback (gsize size)
 
   buffer->block = NULL;
 
+  g_atomic_pointer_add (&gegl_tile_alloc_n_fallbacks, +1);
+
   return gegl_tile_buffer_to_data (buffer);
 }
 
@@ -326,12 +555,103 @@ gegl_tile_alloc_enabled (void)
   return enabled;
 }
 
+#ifdef GEGL_TILE_ALLOC_HUGE_PAGES
+
+static gboolean
+gegl_tile_alloc_huge_pages_enabled (void)
+{
+  static gint enabled = -1;
+
+  if (enabled < 0)
+    {
+      if (g_getenv ("GEGL_TILE_ALLOC_HUGE_PAGES"))
+        enabled = atoi (g_getenv ("GEGL_TILE_ALLOC_HUGE_PAGES")) ? TRUE : FALSE;
+      else
+        enabled = FALSE;
+    }
+
+  return enabled;
+}
+
+#endif /* GEGL_TILE_ALLOC_HUGE_PAGES */
+
+/* the fraction of the tile cache to allocate, and pre-fault, upfront */
+static gdouble
+gegl_tile_alloc_warmup (void)
+{
+  if (g_getenv ("GEGL_TILE_ALLOC_WARMUP"))
+    return CLAMP (g_ascii_strtod (g_getenv ("GEGL_TILE_ALLOC_WARMUP"), NULL),
+                  0.0, 1.0);
+
+  return 0.0;
+}
+
 
 /*  public functions  */
 
 void
 gegl_tile_alloc_init (void)
 {
+  /* the bytes per pixel of the tiles to warm up for: those of 8-bit and of
+   * floating-point RGBA, which most buffers use
+   */
+  static const gint  bpps[] = {4, 16};
+  GeglBufferConfig  *config = gegl_buffer_config ();
+  gdouble            warmup = gegl_tile_alloc_warmup ();
+  gsize              warmup_size;
+  gint               n_blocks = 0;
+  gint               i;
+
+  if (warmup <= 0.0 || ! gegl_tile_alloc_enabled ())
+    return;
+
+  /* allocate enough blocks to cover the requested fraction of the tile
+   * cache, split between the tile sizes, and keep them around, empty.  the
+   * blocks are sized, and capped, like the blocks of their tile size, so
+   * that all of their pre-faulted memory gets used.
+   */
+  warmup_size = floor (config->tile_cache_size * warmup /
+                       G_N_ELEMENTS (bpps));
+
+  gegl_tile_max_n_empty_blocks = G_MAXINT;
+
+  for (i = 0; i < G_N_ELEMENTS (bpps); i++)
+    {
+      gsize size;
+      gsize buffer_size;
+      gsize block_size;
+      gsize total;
+
+      size        = (gsize) config->tile_width * config->tile_height * bpps[i];
+      buffer_size = GEGL_TILE_BUFFER_DATA_OFFSET + GEGL_ALIGN (size);
+
+      if (size > GEGL_TILE_MAX_SIZE)
+        continue;
+
+      block_size = gegl_tile_block_get_size (buffer_size);
+
+      if (! block_size)
+        continue;
+
+      for (total = 0; total + block_size <= warmup_size; total += block_size)
+        {
+          GeglTileBlock *block = gegl_tile_block_alloc_mem (block_size);
+
+          if (! block)
+            break;
+
+          block->block_ptr = NULL;
+
+          gegl_tile_block_prefault (block);
+
+          gegl_tile_empty_block_push (block);
+
+          n_blocks++;
+        }
+    }
+
+  /* only keep room for the blocks we actually got */
+  gegl_tile_max_n_empty_blocks = MAX (n_blocks, GEGL_TILE_MAX_N_EMPTY_BLOCKS);
 }
 
 void
@@ -339,16 +659,24 @@ gegl_tile_alloc_cleanup (void)
 {
   GeglTileBlock *block;
 
-  do
+  g_mutex_lock (&gegl_tile_empty_blocks_mutex);
+
+  block = gegl_tile_empty_blocks;
+
+  gegl_tile_empty_blocks       = NULL;
+  gegl_tile_n_empty_blocks     = 0;
+  gegl_tile_max_n_empty_blocks = GEGL_TILE_MAX_N_EMPTY_BLOCKS;
+
+  g_mutex_unlock (&gegl_tile_empty_blocks_mutex);
+
+  while (block)
     {
-      block = gegl_tile_empty_block;
-    }
-  while (block &&
-         ! g_atomic_pointer_compare_and_exchange (&gegl_tile_empty_block,
-                                                  block, NULL));
+      GeglTileBlock *next = block->next;
 
-  if (block)
-    gegl_tile_block_free_mem (block);
+      gegl_tile_block_free_mem (block);
+
+      block = next;
+    }
 }
 
 gpointer
@@ -413,6 +741,8 @@ gegl_tile_alloc (gsize size)
   block->head = *next_buffer;
   block->n_allocated++;
 
+  g_atomic_pointer_add (&gegl_tile_alloc_used, +block->buffer_size);
+
   if (! block->head)
     {
       if (block->next)
@@ -471,6 +801,8 @@ gegl_tile_free (gpointer ptr)
 
   block->n_allocated--;
 
+  g_atomic_pointer_add (&gegl_tile_alloc_used, -block->buffer_size);
+
   next_buffer = gegl_tile_buffer_to_data (buffer);
 
   *next_buffer = block->head;
@@ -502,3 +834,39 @@ gegl_tile_alloc_get_total (void)
 {
   return gegl_tile_alloc_total;
 }
+
+gint
+gegl_tile_alloc_get_n_blocks (void)
+{
+  return gegl_tile_n_blocks;
+}
+
+gint
+gegl_tile_alloc_get_n_huge_page_blocks (void)
+{
+  return gegl_tile_n_huge_page_blocks;
+}
+
+gdouble
+gegl_tile_alloc_get_fragmentation (void)
+{
+  guintptr total = gegl_tile_alloc_total;
+  guintptr used  = gegl_tile_alloc_used;
+
+  if (! total)
+    return 0.0;
+
+  return 1.0 - (gdouble) MIN (used, total) / total;
+}
+
+guint64
+gegl_tile_alloc_get_n_fallbacks (void)
+{
+  return gegl_tile_alloc_n_fallbacks;
+}
+
+void
+gegl_tile_alloc_reset_stats (void)
+{
+  gegl_tile_alloc_n_fallbacks = 0;
+}
@@ -31,7 +31,13 @@ gpointer   gegl_tile_alloc           (gsize    size) G_GNUC_MALLOC;
 gpointer   gegl_tile_alloc0          (gsize    size) G_GNUC_MALLOC;
 void       gegl_tile_free            (gpointer ptr);
 
-guint64    gegl_tile_alloc_get_total (void);
+guint64    gegl_tile_alloc_get_total              (void);
+gint       gegl_tile_alloc_get_n_blocks           (void);
+gint       gegl_tile_alloc_get_n_huge_page_blocks (void);
+gdouble    gegl_tile_alloc_get_fragmentation      (void);
+guint64    gegl_tile_alloc_get_n_fallbacks        (void);
+
+void       gegl_tile_alloc_reset_stats            (void);
 
 
 #endif /* __GEGL_TILE_ALLOC_H__ */
@@ -90,6 +90,9 @@ typedef struct
   const GeglCompression *compression;
   GList                 *link;
   gint64                 offset;
+  guint8                *pixel;  /* the pixel of a uniform tile, which is
+                                  * kept in memory instead of being written
+                                  */
 } SwapBlock;
 
 typedef struct
@@ -758,6 +761,16 @@ gegl_tile_backend_swap_entry_read (GeglTileBackendSwap *self,
 
       gegl_tile_mark_as_stored (tile);
 
+      return tile;
+    }
+  else if (entry->block->pixel)
+    {
+      tile = gegl_tile_handler_empty_new_uniform_tile (tile_size,
+                                                       entry->block->pixel,
+                                                       bpp);
+
+      gegl_tile_mark_as_stored (tile);
+
       return tile;
     }
 
@@ -965,6 +978,19 @@ gegl_tile_backend_swap_block_create (void)
   block->ref_count = 1;
   block->link      = NULL;
   block->offset    = -1;
+  block->pixel     = NULL;
+
+  return block;
+}
+
+static SwapBlock *
+gegl_tile_backend_swap_uniform_block_create (gconstpointer pixel,
+                                             gint          bpp)
+{
+  SwapBlock *block = gegl_tile_backend_swap_block_create ();
+
+  block->pixel = g_malloc (bpp);
+  memcpy (block->pixel, pixel, bpp);
 
   return block;
 }
@@ -974,6 +1000,8 @@ gegl_tile_backend_swap_block_free (SwapBlock *block)
 {
   g_return_if_fail (block->ref_count == 0);
 
+  g_free (block->pixel);
+
   g_slice_free (SwapBlock, block);
 }
 
@@ -1144,7 +1172,17 @@ gegl_tile_backend_swap_set_tile (GeglTileSource *self,
   tile_size = gegl_tile_backend_get_tile_size (GEGL_TILE_BACKEND (swap));
 
   if (tile->is_zero_tile)
-    src_block = gegl_tile_backend_swap_empty_block ();
+    {
+      src_block = gegl_tile_backend_swap_empty_block ();
+    }
+  else if (tile->is_uniform_tile)
+    {
+      const Babl *format = gegl_tile_backend_get_format (GEGL_TILE_BACKEND (swap));
+
+      src_block = gegl_tile_backend_swap_uniform_block_create (
+        gegl_tile_get_data (tile),
+        babl_format_get_bytes_per_pixel (format));
+    }
 
   if (entry)
     {
@@ -1178,6 +1216,8 @@ gegl_tile_backend_swap_set_tile (GeglTileSource *self,
 
   if (! src_block)
     gegl_tile_backend_swap_entry_write (swap, entry, tile);
+  else if (src_block->pixel)
+    gegl_tile_backend_swap_block_unref (src_block, tile_size, TRUE);
 
   gegl_tile_mark_as_stored (tile);
 
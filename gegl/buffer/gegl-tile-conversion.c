@@ -0,0 +1,246 @@
+/* This file is part of GEGL
+ *
+ * GEGL is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * GEGL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* Converted copies of tile data, for read-only iteration in a format other
+ * than the buffer's, such that consumers reading the same tiles in the same
+ * format convert them once.
+ *
+ * The conversions of a tile are kept in a list attached to it, keyed by
+ * their source and destination formats, and by the tile revision they were
+ * converted from; a conversion of an older revision is stale, and is
+ * replaced upon the next request.  All the cached conversions are kept in
+ * a global LRU queue, bounded by a fraction of the tile cache size, and
+ * their size counts towards the tile cache total.
+ */
+
+#include "config.h"
+
+#include <glib-object.h>
+
+#include "gegl-buffer.h"
+#include "gegl-buffer-config.h"
+#include "gegl-buffer-private.h"
+#include "gegl-memory.h"
+#include "gegl-tile.h"
+#include "gegl-tile-conversion.h"
+#include "gegl-tile-handler-cache.h"
+
+
+/* the part of the tile cache size the conversions may use */
+#define GEGL_TILE_CONVERSION_CACHE_RATIO 0.125
+
+
+struct _GeglTileConversion
+{
+  GeglTileConversion *next;       /* the next conversion of the same tile */
+  GList               link;       /* in the LRU queue */
+  GeglTile           *tile;       /* NULL when not cached */
+
+  const Babl         *src_format;
+  const Babl         *format;
+  guint               rev;
+
+  gint                ref_count;
+  gsize               size;
+  gpointer            data;
+};
+
+
+static GMutex  mutex;
+static GQueue  queue = G_QUEUE_INIT;
+static gsize   total = 0;
+
+
+static void
+gegl_tile_conversion_free (GeglTileConversion *conversion)
+{
+  gegl_free (conversion->data);
+
+  g_slice_free (GeglTileConversion, conversion);
+}
+
+/* removes @conversion from the cache, returning its size.  has to be
+ * called with the mutex locked, and doesn't access the tile afterwards.
+ */
+static gsize
+gegl_tile_conversion_remove (GeglTileConversion *conversion)
+{
+  GeglTileConversion **prev;
+  gsize                size = conversion->size;
+
+  for (prev = (GeglTileConversion **) &conversion->tile->conversions;
+       *prev != conversion;
+       prev = &(*prev)->next);
+
+  conversion->tile = NULL;
+
+  g_queue_unlink (&queue, &conversion->link);
+  total -= size;
+
+  /* the tile is destroyed without taking the mutex once it has no
+   * conversions, so this has to be its last access.
+   */
+  g_atomic_pointer_set (prev, conversion->next);
+
+  if (g_atomic_int_dec_and_test (&conversion->ref_count))
+    gegl_tile_conversion_free (conversion);
+
+  return size;
+}
+
+GeglTileConversion *
+gegl_tile_conversion_get (GeglTile   *tile,
+                          const Babl *src_format,
+                          const Babl *format)
+{
+  GeglTileConversion *conversion;
+  GeglTileConversion *stale;
+  gint                n_pixels;
+  gsize               max_total;
+  gssize              diff = 0;
+  guint               rev;
+
+  /* the revision has to be read before the data, so that a change made
+   * during the conversion makes it stale.
+   */
+  rev = g_atomic_int_get (&tile->rev);
+
+  g_mutex_lock (&mutex);
+
+  for (conversion = tile->conversions;
+       conversion;
+       conversion = conversion->next)
+    {
+      if (conversion->src_format == src_format &&
+          conversion->format     == format     &&
+          conversion->rev        == rev)
+        {
+          g_queue_unlink (&queue, &conversion->link);
+          g_queue_push_head_link (&queue, &conversion->link);
+
+          g_atomic_int_inc (&conversion->ref_count);
+
+          g_mutex_unlock (&mutex);
+
+          return conversion;
+        }
+    }
+
+  g_mutex_unlock (&mutex);
+
+  n_pixels = tile->size / babl_format_get_bytes_per_pixel (src_format);
+
+  conversion             = g_slice_new0 (GeglTileConversion);
+  conversion->link.data  = conversion;
+  conversion->src_format = src_format;
+  conversion->format     = format;
+  conversion->rev        = rev;
+  conversion->ref_count  = 1;
+  conversion->size       = (gsize) n_pixels *
+                           babl_format_get_bytes_per_pixel (format);
+  conversion->data       = gegl_malloc (conversion->size);
+
+  if (tile->is_uniform_tile)
+    {
+      /* only the first pixel of a uniform tile needs converting */
+      guchar pixel[128];
+
+      babl_process (babl_fish (src_format, format),
+                    gegl_tile_get_data (tile), pixel, 1);
+
+      gegl_memset_pattern (conversion->data, pixel,
+                           babl_format_get_bytes_per_pixel (format), n_pixels);
+    }
+  else
+    {
+      babl_process (babl_fish (src_format, format),
+                    gegl_tile_get_data (tile), conversion->data, n_pixels);
+    }
+
+  max_total = gegl_buffer_config ()->tile_cache_size *
+              GEGL_TILE_CONVERSION_CACHE_RATIO;
+
+  if (conversion->size > max_total)
+    return conversion;
+
+  g_mutex_lock (&mutex);
+
+  /* replace the previous conversion, which is either stale, or was added
+   * by another thread in the meantime.
+   */
+  for (stale = tile->conversions; stale; stale = stale->next)
+    {
+      if (stale->src_format == src_format &&
+          stale->format     == format)
+        {
+          diff -= gegl_tile_conversion_remove (stale);
+
+          break;
+        }
+    }
+
+  while (total + conversion->size > max_total)
+    {
+      GList *last = g_queue_peek_tail_link (&queue);
+
+      diff -= gegl_tile_conversion_remove (last->data);
+    }
+
+  conversion->tile = tile;
+  conversion->next = tile->conversions;
+  tile->conversions = conversion;
+
+  g_queue_push_head_link (&queue, &conversion->link);
+  total += conversion->size;
+  diff  += conversion->size;
+
+  /* the cache holds a reference too */
+  g_atomic_int_inc (&conversion->ref_count);
+
+  g_mutex_unlock (&mutex);
+
+  gegl_tile_handler_cache_add_external (diff);
+
+  return conversion;
+}
+
+void
+gegl_tile_conversion_unref (GeglTileConversion *conversion)
+{
+  if (g_atomic_int_dec_and_test (&conversion->ref_count))
+    gegl_tile_conversion_free (conversion);
+}
+
+gpointer
+gegl_tile_conversion_get_data (GeglTileConversion *conversion)
+{
+  return conversion->data;
+}
+
+void
+gegl_tile_conversion_clear_tile (GeglTile *tile)
+{
+  gssize diff = 0;
+
+  g_mutex_lock (&mutex);
+
+  while (tile->conversions)
+    diff -= gegl_tile_conversion_remove (tile->conversions);
+
+  g_mutex_unlock (&mutex);
+
+  gegl_tile_handler_cache_add_external (diff);
+}
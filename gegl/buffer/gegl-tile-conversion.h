@@ -0,0 +1,38 @@
+/* This file is part of GEGL
+ *
+ * GEGL is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * GEGL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GEGL_TILE_CONVERSION_H__
+#define __GEGL_TILE_CONVERSION_H__
+
+
+typedef struct _GeglTileConversion GeglTileConversion;
+
+/* returns the data of @tile, whose pixels are in @src_format, converted to
+ * @format, converting it only if it isn't cached yet.  the tile has to be
+ * locked for reading.  the result has to be released using
+ * gegl_tile_conversion_unref(), and stays valid until then.
+ */
+GeglTileConversion * gegl_tile_conversion_get        (GeglTile           *tile,
+                                                      const Babl         *src_format,
+                                                      const Babl         *format);
+void                 gegl_tile_conversion_unref      (GeglTileConversion *conversion);
+gpointer             gegl_tile_conversion_get_data   (GeglTileConversion *conversion);
+
+/* drops the cached conversions of @tile, when it's destroyed */
+void                 gegl_tile_conversion_clear_tile (GeglTile           *tile);
+
+
+#endif /* __GEGL_TILE_CONVERSION_H__ */
@@ -18,6 +18,8 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #include <glib.h>
 #include <glib-object.h>
 
@@ -37,6 +39,7 @@
 #define GEGL_CACHE_TRIM_RATIO_MIN  0.01
 #define GEGL_CACHE_TRIM_RATIO_MAX  0.50
 #define GEGL_CACHE_TRIM_RATIO_RATE 2.0
+#define GEGL_CACHE_MAX_INDEX_SIZE  65536 /* tiles */
 
 typedef struct CacheItem
 {
@@ -148,6 +151,13 @@ gegl_tile_handler_cache_reinit (GeglTileHandlerCache *cache)
 
   g_hash_table_remove_all (cache->items);
 
+  if (cache->index)
+    {
+      memset (cache->index, 0,
+              sizeof (gpointer) *
+              cache->index_rect.width * cache->index_rect.height);
+    }
+
   while ((link = g_queue_pop_head_link (&cache->queue)))
     {
       item = LINK_GET_ITEM (link);
@@ -175,6 +185,7 @@ gegl_tile_handler_cache_dispose (GObject *object)
   gegl_tile_handler_cache_reinit (cache);
 
   g_hash_table_destroy (cache->items);
+  g_clear_pointer (&cache->index, g_free);
   G_OBJECT_CLASS (gegl_tile_handler_cache_parent_class)->dispose (object);
 }
 
@@ -446,13 +457,41 @@ gegl_tile_handler_cache_wash (GeglTileHandlerCache *cache)
   return FALSE;
 }
 
+/* returns the slot of the direct index holding the item at (x, y, z), or
+ * NULL if the item is kept in the hash table instead.
+ */
+static inline CacheItem **
+cache_index_slot (GeglTileHandlerCache *cache,
+                  gint                  x,
+                  gint                  y,
+                  gint                  z)
+{
+  if (cache->index && z == 0)
+    {
+      guint i = x - cache->index_rect.x;
+      guint j = y - cache->index_rect.y;
+
+      if (i < (guint) cache->index_rect.width &&
+          j < (guint) cache->index_rect.height)
+        {
+          return (CacheItem **) &cache->index[j * cache->index_rect.width + i];
+        }
+    }
+
+  return NULL;
+}
+
 static inline CacheItem *
 cache_lookup (GeglTileHandlerCache *cache,
               gint                  x,
               gint                  y,
               gint                  z)
 {
-  CacheItem key;
+  CacheItem **slot = cache_index_slot (cache, x, y, z);
+  CacheItem   key;
+
+  if (slot)
+    return *slot;
 
   key.x = x;
   key.y = y;
@@ -461,6 +500,30 @@ cache_lookup (GeglTileHandlerCache *cache,
   return g_hash_table_lookup (cache->items, &key);
 }
 
+static inline void
+cache_add (GeglTileHandlerCache *cache,
+           CacheItem            *item)
+{
+  CacheItem **slot = cache_index_slot (cache, item->x, item->y, item->z);
+
+  if (slot)
+    *slot = item;
+  else
+    g_hash_table_add (cache->items, item);
+}
+
+static inline void
+cache_remove (GeglTileHandlerCache *cache,
+              CacheItem            *item)
+{
+  CacheItem **slot = cache_index_slot (cache, item->x, item->y, item->z);
+
+  if (slot)
+    *slot = NULL;
+  else
+    g_hash_table_remove (cache->items, item);
+}
+
 /* returns the requested Tile if it is in the cache, NULL otherwize.
  */
 GeglTile *
@@ -512,12 +575,20 @@ gegl_tile_handler_cache_has_tile (GeglTileHandlerCache *cache,
 static gboolean
 gegl_tile_handler_cache_trim (GeglTileHandlerCache *cache)
 {
-  GList          *link;
-  gint64          time;
-  static gint64   last_time;
-  static gdouble  ratio  = GEGL_CACHE_TRIM_RATIO_MIN;
-  guint64         target_size;
-  static guint    counter;
+  GeglTileHandlerCache *exclusive_cache = NULL;
+  GList                *link;
+  gint64                time;
+  static gint64         last_time;
+  static gdouble        ratio  = GEGL_CACHE_TRIM_RATIO_MIN;
+  guint64               target_size;
+  static guint          counter;
+
+  /* exclusive caches aren't in the global cache queue, so that other
+   * threads never trim them; the thread using one trims its tiles first,
+   * when inserting into it.
+   */
+  if (cache && cache->exclusive)
+    exclusive_cache = cache;
 
   cache = NULL;
   link  = NULL;
@@ -549,6 +620,13 @@ gegl_tile_handler_cache_trim (GeglTileHandlerCache *cache)
 
   g_mutex_unlock (&mutex);
 
+  if (exclusive_cache &&
+      g_rec_mutex_trylock (&exclusive_cache->tile_storage->mutex))
+    {
+      cache = exclusive_cache;
+      link  = g_queue_peek_tail_link (&cache->queue);
+    }
+
   while ((guintptr) g_atomic_pointer_get (&cache_total) > target_size)
     {
       CacheItem *last_writable;
@@ -565,6 +643,12 @@ gegl_tile_handler_cache_trim (GeglTileHandlerCache *cache)
           if (cache)
             g_rec_mutex_unlock (&cache->tile_storage->mutex);
 
+          /* the exclusive cache isn't in the global cache queue; continue
+           * with the oldest cache in the queue
+           */
+          if (cache && cache->exclusive)
+            cache = NULL;
+
           g_mutex_lock (&mutex);
 
           do
@@ -629,7 +713,7 @@ gegl_tile_handler_cache_trim (GeglTileHandlerCache *cache)
         }
 
       /* the cache is being disconnected */
-      if (! cache->link.data)
+      if (! cache->link.data && ! cache->exclusive)
         link = NULL;
 
       if (! link)
@@ -637,7 +721,7 @@ gegl_tile_handler_cache_trim (GeglTileHandlerCache *cache)
 
       prev_link = g_list_previous (link);
       g_queue_unlink (&cache->queue, link);
-      g_hash_table_remove (cache->items, last_writable);
+      cache_remove (cache, last_writable);
       if (g_queue_is_empty (&cache->queue))
         cache->time = cache->stamp = 0;
       if (g_atomic_int_dec_and_test (gegl_tile_n_cached_clones (tile)))
@@ -684,7 +768,7 @@ gegl_tile_handler_cache_invalidate (GeglTileHandlerCache *cache,
       g_atomic_pointer_add (&cache_total_uncloned, -item->tile->size);
 
       g_queue_unlink (&cache->queue, &item->link);
-      g_hash_table_remove (cache->items, item);
+      cache_remove (cache, item);
 
       if (g_queue_is_empty (&cache->queue))
         cache->time = cache->stamp = 0;
@@ -814,7 +898,7 @@ gegl_tile_handler_cache_remove_item (GeglTileHandlerCache *cache,
   g_atomic_pointer_add (&cache_total_uncloned, -item->tile->size);
 
   g_queue_unlink (&cache->queue, &item->link);
-  g_hash_table_remove (cache->items, item);
+  cache_remove (cache, item);
 
   if (g_queue_is_empty (&cache->queue))
     cache->time = cache->stamp = 0;
@@ -902,7 +986,7 @@ gegl_tile_handler_cache_insert (GeglTileHandlerCache *cache,
   else
     total = (guintptr) g_atomic_pointer_get (&cache_total);
   g_atomic_pointer_add (&cache_total_uncloned, tile->size);
-  g_hash_table_add (cache->items, item);
+  cache_add (cache, item);
   g_queue_push_head_link (&cache->queue, &item->link);
 
   if (total > gegl_buffer_config ()->tile_cache_size)
@@ -931,6 +1015,26 @@ gegl_tile_handler_cache_tile_uncloned (GeglTileHandlerCache *cache,
   cache_total_max = MAX (cache_total_max, total);
 }
 
+/* accounts for @size bytes of tile data held outside of the caches, such as
+ * the converted tiles of gegl-tile-conversion.c, as part of the cache total.
+ * @size is negative when the data is released.
+ */
+void
+gegl_tile_handler_cache_add_external (gssize size)
+{
+  guintptr total;
+
+  if (! size)
+    return;
+
+  total = (guintptr) g_atomic_pointer_add (&cache_total, size) + size;
+
+  if (size > 0 && total > gegl_buffer_config ()->tile_cache_size)
+    gegl_tile_handler_cache_trim (NULL);
+
+  cache_total_max = MAX (cache_total_max, total);
+}
+
 GeglTileHandler *
 gegl_tile_handler_cache_new (void)
 {
@@ -951,6 +1055,34 @@ gegl_tile_handler_cache_connect (GeglTileHandlerCache *cache)
     }
 }
 
+/* makes @cache private to the single thread using its storage.  the cache
+ * leaves the global cache queue, so that its tiles are never trimmed, or
+ * washed, by other threads; they still count toward the cache total, and
+ * are trimmed by the thread using the cache, when it inserts tiles past the
+ * cache size.  its level-0 tiles within @tile_rect, in
+ * tile coordinates, are looked up through a direct index, rather than the
+ * hash table.
+ */
+void
+gegl_tile_handler_cache_make_exclusive (GeglTileHandlerCache *cache,
+                                        const GeglRectangle  *tile_rect)
+{
+  g_return_if_fail (g_queue_is_empty (&cache->queue));
+
+  gegl_tile_handler_cache_disconnect (cache);
+
+  cache->exclusive = TRUE;
+
+  if (tile_rect && tile_rect->width > 0 && tile_rect->height > 0 &&
+      (gint64) tile_rect->width * tile_rect->height <=
+      GEGL_CACHE_MAX_INDEX_SIZE)
+    {
+      cache->index_rect = *tile_rect;
+      cache->index      = g_new0 (gpointer,
+                                  tile_rect->width * tile_rect->height);
+    }
+}
+
 void
 gegl_tile_handler_cache_disconnect (GeglTileHandlerCache *cache)
 {
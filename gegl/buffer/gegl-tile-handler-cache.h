@@ -45,6 +45,9 @@ struct _GeglTileHandlerCache
   GQueue           queue;
   guintptr         time;
   guintptr         stamp;
+  gboolean         exclusive;
+  gpointer        *index;      /* the level-0 items of exclusive caches */
+  GeglRectangle    index_rect; /* the tiles covered by index */
 };
 
 struct _GeglTileHandlerCacheClass
@@ -58,6 +61,8 @@ GeglTileHandler * gegl_tile_handler_cache_new                (void);
 
 void              gegl_tile_handler_cache_connect            (GeglTileHandlerCache *cache);
 void              gegl_tile_handler_cache_disconnect         (GeglTileHandlerCache *cache);
+void              gegl_tile_handler_cache_make_exclusive     (GeglTileHandlerCache *cache,
+                                                              const GeglRectangle  *tile_rect);
 
 void              gegl_tile_handler_cache_insert             (GeglTileHandlerCache *cache,
                                                               GeglTile             *tile,
@@ -74,6 +79,7 @@ GeglTile        * gegl_tile_handler_cache_get_tile           (GeglTileHandlerCac
                                                               gint                  z);
 void              gegl_tile_handler_cache_tile_uncloned      (GeglTileHandlerCache *cache,
                                                               GeglTile             *tile);
+void              gegl_tile_handler_cache_add_external       (gssize                size);
 
 gsize             gegl_tile_handler_cache_get_total              (void);
 gsize             gegl_tile_handler_cache_get_total_max          (void);
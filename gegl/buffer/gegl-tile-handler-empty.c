@@ -22,8 +22,21 @@
 
 #include "gegl-buffer.h"
 #include "gegl-buffer-private.h"
+#include "gegl-memory.h"
 #include "gegl-tile-handler-empty.h"
 
+/* the number of distinct uniform tiles kept around for sharing */
+#define UNIFORM_POOL_SIZE 8
+
+typedef struct
+{
+  GeglTile *tile;
+  gint      bpp;
+} UniformTile;
+
+static GMutex      uniform_mutex;
+static UniformTile uniform_pool[UNIFORM_POOL_SIZE]; /* most recent first */
+
 G_DEFINE_TYPE (GeglTileHandlerEmpty, gegl_tile_handler_empty,
                GEGL_TYPE_TILE_HANDLER)
 
@@ -135,7 +148,8 @@ gegl_tile_handler_empty_new_tile (gint tile_size)
       tile = gegl_tile_new (tile_size);
 
       memset (gegl_tile_get_data (tile), 0x00, tile_size);
-      tile->is_zero_tile = TRUE;
+      tile->is_zero_tile    = TRUE;
+      tile->is_uniform_tile = TRUE;
     }
   else
     {
@@ -149,8 +163,9 @@ gegl_tile_handler_empty_new_tile (gint tile_size)
           allocated_tile->data           = allocated_buffer;
           allocated_tile->destroy_notify = NULL;
           allocated_tile->size           = common_empty_size;
-          allocated_tile->is_zero_tile   = TRUE;
-          allocated_tile->is_global_tile = TRUE;
+          allocated_tile->is_zero_tile    = TRUE;
+          allocated_tile->is_global_tile  = TRUE;
+          allocated_tile->is_uniform_tile = TRUE;
 
           /* avoid counting duplicates of the empty tile towards the total
            * cache size, both since this is unnecessary, and since they may
@@ -169,3 +184,75 @@ gegl_tile_handler_empty_new_tile (gint tile_size)
 
   return tile;
 }
+
+/* Returns a tile filled with @pixel, @bpp bytes in size, marked as uniform.
+ * Like the empty tiles, the tile shares its data with the other tiles of
+ * the same color, which are taken from a small pool of the most recently
+ * used colors, so that solid fills don't take any memory per tile, and
+ * readers can use the first pixel in place of the whole tile.  The tile is
+ * uncloned, and stops being uniform, once written to.
+ */
+GeglTile *
+gegl_tile_handler_empty_new_uniform_tile (gint          tile_size,
+                                          gconstpointer pixel,
+                                          gint          bpp)
+{
+  UniformTile  uniform;
+  GeglTile    *tile;
+  gint         i;
+
+  if (gegl_memeq_zero (pixel, bpp))
+    return gegl_tile_handler_empty_new_tile (tile_size);
+
+  g_mutex_lock (&uniform_mutex);
+
+  for (i = 0; i < UNIFORM_POOL_SIZE && uniform_pool[i].tile; i++)
+    {
+      if (uniform_pool[i].bpp        == bpp       &&
+          uniform_pool[i].tile->size == tile_size &&
+          ! memcmp (gegl_tile_get_data (uniform_pool[i].tile), pixel, bpp))
+        {
+          break;
+        }
+    }
+
+  if (i < UNIFORM_POOL_SIZE && uniform_pool[i].tile)
+    {
+      uniform = uniform_pool[i];
+    }
+  else
+    {
+      if (i == UNIFORM_POOL_SIZE)
+        gegl_tile_unref (uniform_pool[--i].tile);
+
+      uniform.tile = gegl_tile_new (tile_size);
+      uniform.bpp  = bpp;
+
+      gegl_memset_pattern (gegl_tile_get_data (uniform.tile),
+                           pixel, bpp, tile_size / bpp);
+
+      uniform.tile->is_uniform_tile = TRUE;
+    }
+
+  memmove (&uniform_pool[1], &uniform_pool[0], i * sizeof (UniformTile));
+  uniform_pool[0] = uniform;
+
+  tile = gegl_tile_dup (uniform.tile);
+
+  g_mutex_unlock (&uniform_mutex);
+
+  return tile;
+}
+
+void
+gegl_tile_handler_empty_cleanup (void)
+{
+  gint i;
+
+  g_mutex_lock (&uniform_mutex);
+
+  for (i = 0; i < UNIFORM_POOL_SIZE; i++)
+    g_clear_pointer (&uniform_pool[i].tile, gegl_tile_unref);
+
+  g_mutex_unlock (&uniform_mutex);
+}
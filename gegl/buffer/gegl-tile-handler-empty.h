@@ -62,6 +62,13 @@ GeglTileHandler * gegl_tile_handler_empty_new      (GeglTileBackend *backend,
 
 GeglTile        * gegl_tile_handler_empty_new_tile (gint             tile_size);
 
+GeglTile        * gegl_tile_handler_empty_new_uniform_tile
+                                                   (gint             tile_size,
+                                                    gconstpointer    pixel,
+                                                    gint             bpp);
+
+void              gegl_tile_handler_empty_cleanup  (void);
+
 G_END_DECLS
 
 #endif
@@ -27,6 +27,7 @@
 #include "gegl-buffer-types.h"
 #include "gegl-tile-handler.h"
 #include "gegl-tile-handler-cache.h"
+#include "gegl-tile-handler-empty.h"
 #include "gegl-tile-handler-private.h"
 #include "gegl-tile-handler-zoom.h"
 #include "gegl-tile-storage.h"
@@ -232,6 +233,46 @@ get_tile (GeglTileSource *gegl_tile_source,
     bpp    = babl_format_get_bytes_per_pixel (format);
     stride = tile_width * bpp;
 
+    /* if all the lower-level tiles are uniform, and of the same color, so
+     * is their downscaled tile, which can then share their pixel instead of
+     * being rendered.
+     */
+    if (! tile)
+      {
+        gboolean uniform = TRUE;
+
+        for (i = 0; i < 2 && uniform; i++)
+          for (j = 0; j < 2 && uniform; j++)
+            {
+              uniform = source_tile[i][j]                  &&
+                        source_tile[i][j]->is_uniform_tile &&
+                        ! memcmp (gegl_tile_get_data (source_tile[i][j]),
+                                  gegl_tile_get_data (source_tile[0][0]),
+                                  bpp);
+            }
+
+        if (uniform)
+          {
+            GeglTile *uniform_tile;
+
+            uniform_tile = gegl_tile_handler_empty_new_uniform_tile (
+              tile_storage->tile_size,
+              gegl_tile_get_data (source_tile[0][0]),
+              bpp);
+
+            tile = gegl_tile_handler_dup_tile (GEGL_TILE_HANDLER (zoom),
+                                               uniform_tile, x, y, z);
+
+            gegl_tile_unref (uniform_tile);
+
+            for (i = 0; i < 2; i++)
+              for (j = 0; j < 2; j++)
+                gegl_tile_unref (source_tile[i][j]);
+
+            return tile;
+          }
+      }
+
     if (! tile)
       tile = gegl_tile_handler_create_tile (GEGL_TILE_HANDLER (zoom), x, y, z);
 
@@ -27,6 +27,7 @@
 #include "gegl-tile-handler-empty.h"
 #include "gegl-tile-handler-zoom.h"
 #include "gegl-tile-handler-private.h"
+#include "gegl-buffer-private.h"
 
 
 G_DEFINE_TYPE (GeglTileStorage, gegl_tile_storage, GEGL_TYPE_TILE_HANDLER_CHAIN)
@@ -41,6 +42,11 @@ enum
 
 guint gegl_tile_storage_signals[LAST_SIGNAL] = { 0 };
 
+/* revisions are drawn from a single counter, so that a storage never gets
+ * a revision another one had before it, even at the same address.
+ */
+static gint gegl_tile_storage_last_revision = 0;
+
 GeglTileStorage *
 gegl_tile_storage_new (GeglTileBackend *backend,
                        gboolean         initialized)
@@ -214,4 +220,42 @@ gegl_tile_storage_init (GeglTileStorage *tile_storage)
 {
   tile_storage->seen_zoom = 0;
   g_rec_mutex_init (&tile_storage->mutex);
+
+  gegl_tile_storage_bump_revision (tile_storage);
+}
+
+void
+gegl_tile_storage_bump_revision (GeglTileStorage *tile_storage)
+{
+  g_atomic_int_set (&tile_storage->revision,
+                    g_atomic_int_add (&gegl_tile_storage_last_revision, 1) + 1);
+}
+
+/* makes the storage exclusive to the single thread using it.  the storage
+ * lock is skipped, and the level-0 tiles of @extent, in the storage's
+ * coordinates, are cached in a direct index.  must be called before the
+ * storage is used.
+ */
+void
+gegl_tile_storage_make_exclusive (GeglTileStorage     *tile_storage,
+                                  const GeglRectangle *extent)
+{
+  GeglRectangle tile_rect = {0, 0, 0, 0};
+
+  if (extent->width > 0 && extent->height > 0)
+    {
+      gint x1 = gegl_tile_indice (extent->x + extent->width - 1,
+                                  tile_storage->tile_width);
+      gint y1 = gegl_tile_indice (extent->y + extent->height - 1,
+                                  tile_storage->tile_height);
+
+      tile_rect.x      = gegl_tile_indice (extent->x, tile_storage->tile_width);
+      tile_rect.y      = gegl_tile_indice (extent->y, tile_storage->tile_height);
+      tile_rect.width  = x1 - tile_rect.x + 1;
+      tile_rect.height = y1 - tile_rect.y + 1;
+    }
+
+  gegl_tile_handler_cache_make_exclusive (tile_storage->cache, &tile_rect);
+
+  tile_storage->exclusive = TRUE;
 }
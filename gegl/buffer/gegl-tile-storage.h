@@ -54,6 +54,12 @@ struct _GeglTileStorage
 
   GeglTile      *hot_tile; /* cached tile for speeding up gegl_buffer_get_pixel
                               and gegl_buffer_set_pixel (1x1 sized gets/sets)*/
+
+  gint           revision; /* identifies the current content, see
+                              gegl_buffer_get_revision() */
+
+  gboolean       exclusive; /* only ever accessed by a single thread at a
+                               time, see gegl_buffer_new_exclusive() */
 };
 
 struct _GeglTileStorageClass
@@ -76,4 +82,26 @@ GeglTile * gegl_tile_storage_try_steal_hot_tile (GeglTileStorage *tile_storage,
 void       gegl_tile_storage_take_hot_tile      (GeglTileStorage *tile_storage,
                                                  GeglTile        *tile);
 
+void       gegl_tile_storage_bump_revision      (GeglTileStorage *tile_storage);
+
+void       gegl_tile_storage_make_exclusive     (GeglTileStorage     *tile_storage,
+                                                 const GeglRectangle *extent);
+
+/* the storage mutex guards against concurrent access, which exclusive
+ * storages rule out.
+ */
+static inline void
+gegl_tile_storage_lock (GeglTileStorage *tile_storage)
+{
+  if (! tile_storage->exclusive)
+    g_rec_mutex_lock (&tile_storage->mutex);
+}
+
+static inline void
+gegl_tile_storage_unlock (GeglTileStorage *tile_storage)
+{
+  if (! tile_storage->exclusive)
+    g_rec_mutex_unlock (&tile_storage->mutex);
+}
+
 #endif
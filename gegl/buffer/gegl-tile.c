@@ -29,6 +29,7 @@
 #include "gegl-buffer.h"
 #include "gegl-tile.h"
 #include "gegl-tile-alloc.h"
+#include "gegl-tile-conversion.h"
 #include "gegl-buffer-private.h"
 #include "gegl-tile-storage.h"
 
@@ -57,6 +58,9 @@ void gegl_tile_unref (GeglTile *tile)
   if (!g_atomic_int_dec_and_test (&tile->ref_count))
     return;
 
+  if (g_atomic_pointer_get (&tile->conversions))
+    gegl_tile_conversion_clear_tile (tile);
+
   /* In the case of a file store for example, we must make sure that
    * the in-memory tile is written to disk before we free the memory,
    * otherwise this data will be lost.
@@ -136,6 +140,7 @@ gegl_tile_dup (GeglTile *src)
       tile->size                = src->size;
       tile->is_zero_tile        = src->is_zero_tile;
       tile->is_global_tile      = src->is_global_tile;
+      tile->is_uniform_tile     = src->is_uniform_tile;
       tile->clone_state         = CLONE_STATE_CLONED;
       tile->n_clones            = src->n_clones;
 
@@ -299,6 +304,10 @@ gegl_tile_lock (GeglTile *tile)
   unsigned int count = 0;
   g_atomic_int_inc (&tile->lock_count);
 
+  /* the tile is about to be written to */
+  if (g_atomic_int_get (&tile->is_uniform_tile))
+    g_atomic_int_set (&tile->is_uniform_tile, FALSE);
+
   while (TRUE)
     {
       switch (g_atomic_int_get (&tile->clone_state))
@@ -67,7 +67,8 @@ enum
   PROP_USE_OPENCL,
   PROP_QUEUE_SIZE,
   PROP_APPLICATION_LICENSE,
-  PROP_MIPMAP_RENDERING
+  PROP_MIPMAP_RENDERING,
+  PROP_TILE_SIZE_AUTO
 };
 
 gint _gegl_threads = 1;
@@ -130,6 +131,10 @@ gegl_config_get_property (GObject    *gobject,
         g_value_set_boolean (value, config->mipmap_rendering);
         break;
 
+      case PROP_TILE_SIZE_AUTO:
+        g_value_set_boolean (value, config->tile_size_auto);
+        break;
+
       default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID (gobject, property_id, pspec);
         break;
@@ -178,6 +183,9 @@ gegl_config_set_property (GObject      *gobject,
       case PROP_MIPMAP_RENDERING:
         config->mipmap_rendering = g_value_get_boolean (value);
         break;
+      case PROP_TILE_SIZE_AUTO:
+        config->tile_size_auto = g_value_get_boolean (value);
+        break;
       case PROP_QUEUE_SIZE:
         config->queue_size = g_value_get_int (value);
         break;
@@ -231,6 +239,15 @@ gegl_config_class_init (GeglConfigClass *klass)
                                                      G_PARAM_READWRITE |
                                                      G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (gobject_class, PROP_TILE_SIZE_AUTO,
+                                   g_param_spec_boolean ("tile-size-auto",
+                                                         "Automatic tile size",
+                                                         "Choose the tile size of operation output buffers according to their pixel format and to the operation type.",
+                                                         FALSE,
+                                                         G_PARAM_READWRITE |
+                                                         G_PARAM_STATIC_STRINGS |
+                                                         G_PARAM_CONSTRUCT));
+
   {
     uint64_t default_tile_cache_size = 1024l * 1024 * 1024;
     uint64_t mem_total = default_tile_cache_size;
@@ -46,6 +46,7 @@ struct _GeglConfig
   gint     queue_size;
   gboolean mipmap_rendering;
   gchar   *application_license;
+  gboolean tile_size_auto;
 };
 
 struct _GeglConfigClass
@@ -39,6 +39,8 @@ gegl_dither_method_get_type (void)
         { GEGL_DITHER_ARITHMETIC_ADD_COVARIANT,   N_("Arithmetic add covariant"),  "add-covariant"  },
         { GEGL_DITHER_ARITHMETIC_XOR,   N_("Arithmetic xor"),   "xor"  },
         { GEGL_DITHER_ARITHMETIC_XOR_COVARIANT,   N_("Arithmetic xor covariant"),  "xor-covariant"  },
+        { GEGL_DITHER_JARVIS_JUDICE_NINKE, N_("Jarvis-Judice-Ninke"), "jarvis-judice-ninke" },
+        { GEGL_DITHER_STUCKI,           N_("Stucki"),           "stucki"           },
 
         { 0, NULL, NULL }
       };
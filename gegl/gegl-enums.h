@@ -46,6 +46,8 @@ typedef enum {
   GEGL_DITHER_ARITHMETIC_ADD_COVARIANT,
   GEGL_DITHER_ARITHMETIC_XOR,
   GEGL_DITHER_ARITHMETIC_XOR_COVARIANT,
+  GEGL_DITHER_JARVIS_JUDICE_NINKE,
+  GEGL_DITHER_STUCKI,
 } GeglDitherMethod;
 
 GType gegl_dither_method_get_type (void) G_GNUC_CONST;
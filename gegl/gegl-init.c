@@ -78,9 +78,11 @@ guint gegl_debug_flags = 0;
 #include "buffer/gegl-tile-alloc.h"
 #include "buffer/gegl-tile-backend-ram.h"
 #include "buffer/gegl-tile-backend-file.h"
+#include "buffer/gegl-tile-handler-empty.h"
 #include "gegl-config.h"
 #include "gegl-stats.h"
 #include "graph/gegl-node-private.h"
+#include "process/gegl-processor-private.h"
 #include "gegl-random-private.h"
 #include "gegl-parallel-private.h"
 
@@ -224,7 +226,7 @@ static const GOptionEntry cmd_entries[]=
     {
      "gegl-tile-size", 0, 0,
      G_OPTION_ARG_STRING, &cmd_gegl_tile_size,
-     N_("Default size of tiles in GeglBuffers"), "<widthxheight>"
+     N_("Default size of tiles in GeglBuffers"), "<widthxheight|auto>"
     },
     {
      "gegl-chunk-size", 0, 0,
@@ -265,6 +267,36 @@ gegl_get_option_group (void)
   return group;
 }
 
+/* parses a tile size of the form "<width>x<height>", "<size>", or "auto",
+ * which chooses the tile size of the output buffers of operations
+ * according to their format and to the type of the operation.
+ */
+static void
+gegl_config_parse_tile_size (GeglConfig  *config,
+                             const gchar *str)
+{
+  gint width;
+  gint height;
+
+  if (! g_ascii_strcasecmp (str, "auto"))
+    {
+      g_object_set (config,
+                    "tile-size-auto", TRUE,
+                    NULL);
+
+      return;
+    }
+
+  width = height = atoi(str);
+  str = strchr (str, 'x');
+  if (str)
+    height = atoi(str+1);
+  g_object_set (config,
+                "tile-width",  width,
+                "tile-height", height,
+                NULL);
+}
+
 static void 
 gegl_config_parse_env (GeglConfig *config)
 {
@@ -306,19 +338,7 @@ gegl_config_parse_env (GeglConfig *config)
     config->chunk_size = atoi(g_getenv("GEGL_CHUNK_SIZE"));
 
   if (g_getenv ("GEGL_TILE_SIZE"))
-    {
-      const gchar *str = g_getenv ("GEGL_TILE_SIZE");
-      gint         width;
-      gint         height;
-      width = height = atoi(str);
-      str = strchr (str, 'x');
-      if (str)
-        height = atoi(str+1);
-      g_object_set (config,
-                    "tile-width",  width,
-                    "tile-height", height,
-                    NULL);
-    }
+    gegl_config_parse_tile_size (config, g_getenv ("GEGL_TILE_SIZE"));
 
   if (g_getenv ("GEGL_THREADS"))
     {
@@ -402,6 +422,9 @@ gegl_exit (void)
 
   GEGL_INSTRUMENT_START()
 
+  gegl_processor_cleanup ();
+  gegl_buffer_iterator_cleanup ();
+  gegl_tile_handler_empty_cleanup ();
   gegl_tile_backend_swap_cleanup ();
   gegl_tile_cache_destroy ();
   gegl_operation_gtype_cleanup ();
@@ -573,19 +596,7 @@ gegl_post_parse_hook (GOptionContext *context,
   if (cmd_gegl_chunk_size)
     config->chunk_size = atoi (cmd_gegl_chunk_size);
   if (cmd_gegl_tile_size)
-    {
-      const gchar *str = cmd_gegl_tile_size;
-      gint         width;
-      gint         height;
-      width = height = atoi(str);
-      str = strchr (str, 'x');
-      if (str)
-        height = atoi(str+1);
-      g_object_set (config,
-                    "tile-width",  width,
-                    "tile-height", height,
-                    NULL);
-    }
+    gegl_config_parse_tile_size (config, cmd_gegl_tile_size);
   if (cmd_gegl_threads)
     {
       _gegl_threads = atoi (cmd_gegl_threads);
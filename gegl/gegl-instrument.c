@@ -40,9 +40,19 @@ struct _Timing
   Timing *next;
 };
 
+typedef struct _Bytes Bytes;
+
+struct _Bytes
+{
+  gchar   *parent;
+  gchar   *name;
+  guint64  bytes;
+};
+
 gboolean gegl_instrument_enabled = FALSE;
 
 static Timing *root = NULL;
+static GList  *bytes_list = NULL;
 
 static Timing *
 iter_next (Timing *iter)
@@ -141,6 +151,34 @@ real_gegl_instrument (const gchar *parent_name,
   iter->usecs += usecs;
 }
 
+void
+real_gegl_instrument_bytes (const gchar *parent,
+                            const gchar *name,
+                            guint64      bytes)
+{
+  GList *iter;
+  Bytes *record;
+
+  for (iter = bytes_list; iter; iter = iter->next)
+    {
+      record = iter->data;
+
+      if (! strcmp (record->parent, parent) && ! strcmp (record->name, name))
+        {
+          record->bytes += bytes;
+
+          return;
+        }
+    }
+
+  record         = g_slice_new (Bytes);
+  record->parent = g_strdup (parent);
+  record->name   = g_strdup (name);
+  record->bytes  = bytes;
+
+  bytes_list = g_list_append (bytes_list, record);
+}
+
 
 static glong 
 timing_child_sum (Timing *timing)
@@ -301,6 +339,94 @@ sort_children (Timing *parent)
     }
 }
 
+static gint
+bytes_compare (const Bytes *a,
+               const Bytes *b)
+{
+  if (a->bytes > b->bytes)
+    return -1;
+  else if (a->bytes < b->bytes)
+    return +1;
+  else
+    return 0;
+}
+
+static gchar *
+format_bytes (guint64 bytes)
+{
+  if (bytes < (1 << 20))
+    return g_strdup_printf ("%5.1fK", bytes / (gdouble) (1 << 10));
+  else if (bytes < (1 << 30))
+    return g_strdup_printf ("%5.1fM", bytes / (gdouble) (1 << 20));
+  else
+    return g_strdup_printf ("%5.1fG", bytes / (gdouble) (1 << 30));
+}
+
+static GString *
+bytes_utf8 (GString *s)
+{
+  GList *parents = NULL;
+  GList *iter;
+
+  for (iter = bytes_list; iter; iter = iter->next)
+    {
+      Bytes *record = iter->data;
+
+      if (! g_list_find_custom (parents, record->parent, (GCompareFunc) strcmp))
+        parents = g_list_append (parents, record->parent);
+    }
+
+  for (; parents; parents = g_list_delete_link (parents, parents))
+    {
+      const gchar *parent  = parents->data;
+      GList       *records = NULL;
+      guint64      total   = 0;
+      guint64      max     = 0;
+      gchar       *buf;
+
+      for (iter = bytes_list; iter; iter = iter->next)
+        {
+          Bytes *record = iter->data;
+
+          if (! strcmp (record->parent, parent))
+            {
+              records = g_list_prepend (records, record);
+
+              total += record->bytes;
+              max    = MAX (max, record->bytes);
+            }
+        }
+
+      records = g_list_sort (records, (GCompareFunc) bytes_compare);
+
+      buf = format_bytes (total);
+      g_string_append_printf (s, "Total %s: %s\n", parent, g_strstrip (buf));
+      g_free (buf);
+
+      for (iter = records; iter; iter = iter->next)
+        {
+          Bytes *record = iter->data;
+
+          s = tab_to (s, INDENT_SPACES);
+          s = g_string_append (s, record->name);
+
+          s   = tab_to (s, SECONDS_COL);
+          buf = format_bytes (record->bytes);
+          s   = g_string_append (s, buf);
+          g_free (buf);
+          s = tab_to (s, BAR_COL);
+          s = bar (s, BAR_WIDTH, max ? (gfloat) record->bytes / max : 0.0f);
+          s = g_string_append (s, "\n");
+        }
+
+      s = g_string_append (s, "\n");
+
+      g_list_free (records);
+    }
+
+  return s;
+}
+
 gchar *
 gegl_instrument_utf8 (void)
 {
@@ -352,6 +478,8 @@ gegl_instrument_utf8 (void)
       iter = iter_next (iter);
     }
 
+  s = bytes_utf8 (s);
+
   ret = g_strdup (s->str);
   g_string_free (s, TRUE);
   return ret;
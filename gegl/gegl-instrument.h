@@ -47,6 +47,17 @@ void real_gegl_instrument     (const gchar *parent,
                                const gchar *scale,
                                long         usecs);
 
+/* store an amount of memory, such as the scratch memory allocated by an
+ * operation, reported separately from the timings, per parent */
+#define gegl_instrument_bytes(parent, name, bytes) \
+  { if (gegl_instrument_enabled) { \
+real_gegl_instrument_bytes (parent, name, bytes); \
+                                 } }
+
+void real_gegl_instrument_bytes (const gchar *parent,
+                                 const gchar *name,
+                                 guint64      bytes);
+
 /* create a utf8 string with bar charts for where time disappears
  * during a gegl-run
  */
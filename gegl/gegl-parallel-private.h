@@ -32,6 +32,13 @@ gint      gegl_parallel_distribute_get_optimal_n_threads (gdouble n_elements,
                                                           gdouble thread_cost);
 
 
+/*  cancellation  */
+
+void      gegl_parallel_set_cancel_flag                  (volatile gint *flag);
+volatile gint *
+          gegl_parallel_get_cancel_flag                  (void);
+
+
 /*  stats  */
 
 gint      gegl_parallel_get_n_assigned_worker_threads    (void);
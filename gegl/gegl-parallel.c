@@ -27,6 +27,7 @@
 #include "gegl-config.h"
 #include "gegl-parallel.h"
 #include "gegl-parallel-private.h"
+#include "buffer/gegl-scratch-private.h"
 
 
 #define GEGL_PARALLEL_DISTRIBUTE_MAX_THREADS           GEGL_MAX_THREADS
@@ -38,6 +39,8 @@ typedef struct
   GeglParallelDistributeFunc func;
   gint                       n;
   gpointer                   user_data;
+  volatile gint             *cancel_flag;
+  volatile guintptr         *scratch_counter;
 } GeglParallelDistributeTask;
 
 typedef struct
@@ -78,6 +81,11 @@ static gint                         gegl_parallel_distribute_n_assigned_threads;
 
 static gdouble                      gegl_parallel_distribute_thread_time;
 
+/* the cancellation flag of the render the current thread takes part in, if
+ * any.  worker threads inherit the flag of the thread distributing the task.
+ */
+static GPrivate                     gegl_parallel_cancel_flag;
+
 
 /*  public functions  */
 
@@ -170,9 +178,12 @@ gegl_parallel_distribute (gint                       max_n,
       return;
     }
 
-  task.n         = max_n;
-  task.func      = func;
-  task.user_data = user_data;
+  task.n           = max_n;
+  task.func        = func;
+  task.user_data   = user_data;
+  task.cancel_flag = gegl_parallel_get_cancel_flag ();
+
+  task.scratch_counter = gegl_scratch_get_counter ();
 
   gegl_parallel_distribute_n_assigned_threads = task.n - 1;
 
@@ -228,6 +239,9 @@ gegl_parallel_distribute_range_func (gint                             i,
   gsize offset;
   gsize sub_size;
 
+  if (gegl_parallel_is_cancelled ())
+    return;
+
   offset   = (2 * i       * data->size + n) / (2 * n);
   sub_size = (2 * (i + 1) * data->size + n) / (2 * n) - offset;
 
@@ -286,6 +300,9 @@ gegl_parallel_distribute_area_func (gint                            i,
 {
   GeglRectangle sub_area;
 
+  if (gegl_parallel_is_cancelled ())
+    return;
+
   switch (data->split_strategy)
     {
     case GEGL_SPLIT_STRATEGY_HORIZONTAL:
@@ -380,6 +397,30 @@ gegl_parallel_distribute_area (const GeglRectangle            *area,
 }
 
 
+/*  public functions (cancellation)  */
+
+
+gboolean
+gegl_parallel_is_cancelled (void)
+{
+  volatile gint *flag = g_private_get (&gegl_parallel_cancel_flag);
+
+  return flag && g_atomic_int_get (flag);
+}
+
+void
+gegl_parallel_set_cancel_flag (volatile gint *flag)
+{
+  g_private_set (&gegl_parallel_cancel_flag, (gpointer) flag);
+}
+
+volatile gint *
+gegl_parallel_get_cancel_flag (void)
+{
+  return g_private_get (&gegl_parallel_cancel_flag);
+}
+
+
 /*  public functions (stats)  */
 
 
@@ -489,9 +530,15 @@ gegl_parallel_distribute_thread_func (GeglParallelDistributeThread *thread)
         }
       else if (thread->task)
         {
+          gegl_parallel_set_cancel_flag (thread->task->cancel_flag);
+          gegl_scratch_set_counter (thread->task->scratch_counter);
+
           thread->task->func (thread->i, thread->task->n,
                               thread->task->user_data);
 
+          gegl_scratch_set_counter (NULL);
+          gegl_parallel_set_cancel_flag (NULL);
+
           if (g_atomic_int_dec_and_test (
                 &gegl_parallel_distribute_completion_counter))
             {
@@ -119,6 +119,19 @@ void   gegl_parallel_distribute_area  (const GeglRectangle             *area,
                                        GeglParallelDistributeAreaFunc   func,
                                        gpointer                         user_data);
 
+/**
+ * gegl_parallel_is_cancelled:
+ *
+ * Checks whether the render the calling thread is taking part in has
+ * been cancelled, see gegl_processor_cancel().  Buffer iterators and
+ * gegl_parallel_distribute_range()/gegl_parallel_distribute_area() poll
+ * this on their own; operations with long-running loops that don't go
+ * through either may poll it themselves to bail out early.
+ *
+ * Returns: TRUE if the current render has been cancelled.
+ */
+gboolean gegl_parallel_is_cancelled   (void);
+
 
 #ifdef __cplusplus
 #if __cplusplus >= 201103
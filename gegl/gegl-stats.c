@@ -53,6 +53,10 @@ enum
   PROP_SWAP_WRITE_TOTAL,
   PROP_ZOOM_TOTAL,
   PROP_TILE_ALLOC_TOTAL,
+  PROP_TILE_ALLOC_BLOCKS,
+  PROP_TILE_ALLOC_HUGE_PAGE_BLOCKS,
+  PROP_TILE_ALLOC_FRAGMENTATION,
+  PROP_TILE_ALLOC_FALLBACKS,
   PROP_SCRATCH_TOTAL,
   PROP_ASSIGNED_THREADS,
   PROP_ACTIVE_THREADS
@@ -211,6 +215,34 @@ gegl_stats_class_init (GeglStatsClass *klass)
                                                         0, G_MAXUINT64, 0,
                                                         G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (object_class, PROP_TILE_ALLOC_BLOCKS,
+                                   g_param_spec_int ("tile-alloc-blocks",
+                                                     "Tile allocator blocks",
+                                                     "Number of tile-allocator blocks",
+                                                     0, G_MAXINT, 0,
+                                                     G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (object_class, PROP_TILE_ALLOC_HUGE_PAGE_BLOCKS,
+                                   g_param_spec_int ("tile-alloc-huge-page-blocks",
+                                                     "Tile allocator huge-page blocks",
+                                                     "Number of tile-allocator blocks backed by huge pages",
+                                                     0, G_MAXINT, 0,
+                                                     G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (object_class, PROP_TILE_ALLOC_FRAGMENTATION,
+                                   g_param_spec_double ("tile-alloc-fragmentation",
+                                                        "Tile allocator fragmentation",
+                                                        "Fraction of tile-allocator memory not holding tiles",
+                                                        0.0, 1.0, 0.0,
+                                                        G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (object_class, PROP_TILE_ALLOC_FALLBACKS,
+                                   g_param_spec_uint64 ("tile-alloc-fallbacks",
+                                                        "Tile allocator fallbacks",
+                                                        "Number of tiles allocated outside of tile-allocator blocks",
+                                                        0, G_MAXUINT64, 0,
+                                                        G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
   g_object_class_install_property (object_class, PROP_SCRATCH_TOTAL,
                                    g_param_spec_uint64 ("scratch-total",
                                                         "Scratch total",
@@ -332,6 +364,22 @@ gegl_stats_get_property (GObject    *object,
         g_value_set_uint64 (value, gegl_tile_alloc_get_total ());
         break;
 
+      case PROP_TILE_ALLOC_BLOCKS:
+        g_value_set_int (value, gegl_tile_alloc_get_n_blocks ());
+        break;
+
+      case PROP_TILE_ALLOC_HUGE_PAGE_BLOCKS:
+        g_value_set_int (value, gegl_tile_alloc_get_n_huge_page_blocks ());
+        break;
+
+      case PROP_TILE_ALLOC_FRAGMENTATION:
+        g_value_set_double (value, gegl_tile_alloc_get_fragmentation ());
+        break;
+
+      case PROP_TILE_ALLOC_FALLBACKS:
+        g_value_set_uint64 (value, gegl_tile_alloc_get_n_fallbacks ());
+        break;
+
       case PROP_SCRATCH_TOTAL:
         g_value_set_uint64 (value, gegl_scratch_get_total ());
         break;
@@ -356,4 +404,5 @@ gegl_stats_reset (GeglStats *stats)
   gegl_tile_handler_cache_reset_stats ();
   gegl_tile_backend_swap_reset_stats ();
   gegl_tile_handler_zoom_reset_stats ();
+  gegl_tile_alloc_reset_stats ();
 }
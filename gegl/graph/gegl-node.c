@@ -1208,12 +1208,14 @@ gegl_node_blit (GeglNode            *self,
               gint  level = gegl_mipmap_rendering_enabled()?gegl_level_from_scale (scale):0;
 
               gegl_node_blit_buffer (self, buffer, &unscaled_roi, level, GEGL_ABYSS_NONE);
-              gegl_cache_computed (cache, &unscaled_roi, level);
+              if (! gegl_parallel_is_cancelled ())
+                gegl_cache_computed (cache, &unscaled_roi, level);
             }
           else
             {
               gegl_node_blit_buffer (self, buffer, roi, 0, GEGL_ABYSS_NONE);
-              gegl_cache_computed (cache, roi, 0);
+              if (! gegl_parallel_is_cancelled ())
+                gegl_cache_computed (cache, roi, 0);
             }
         }
 
@@ -2078,6 +2080,7 @@ gegl_node_get_cache (GeglNode *node)
         GEGL_TYPE_CACHE,
         "format",      format,
         "initialized", gegl_operation_context_get_init_output (),
+        "access-hint", gegl_operation_context_get_access_hint (real_node),
         NULL);
 
       gegl_object_set_has_forked (G_OBJECT (cache));
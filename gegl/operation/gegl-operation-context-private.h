@@ -64,6 +64,9 @@ struct _GeglOperationContext
   GHashTable    *contexts;      /* to be able to look up the context of
                                    other nodes/ops in the graph we store the
                                    hashtable we will be stored in */
+  const Babl    *output_format; /* format to allocate the output buffer in,
+                                   when chosen by the graph instead of the
+                                   operation */
 };
 
 GeglOperationContext *gegl_operation_context_new       (GeglOperation        *operation,
@@ -91,6 +94,9 @@ void            gegl_operation_context_set_result_rect (GeglOperationContext *no
 
 gboolean        gegl_operation_context_get_init_output (void);
 
+GeglBufferAccessHint
+                gegl_operation_context_get_access_hint (GeglNode             *node);
+
 /* could deserve its own private non-installed header */
 gboolean _gegl_operation_is_attached (GeglOperation *self);
 
@@ -35,7 +35,14 @@
 #include "gegl-tile-backend-buffer.h"
 #include "gegl-config.h"
 
+#include "graph/gegl-connection.h"
+#include "graph/gegl-pad.h"
+
 #include "operation/gegl-operation.h"
+#include "operation/gegl-operation-area-filter.h"
+#include "operation/gegl-operation-point-composer.h"
+#include "operation/gegl-operation-point-composer3.h"
+#include "operation/gegl-operation-point-filter.h"
 
 static GValue *
 gegl_operation_context_add_value (GeglOperationContext *self,
@@ -321,7 +328,10 @@ gegl_operation_context_get_target (GeglOperationContext *context,
 
   operation = context->operation;
   node = operation->node; /* <ick */
-  format = gegl_operation_get_format (operation, padname);
+  format = context->output_format;
+
+  if (! format)
+    format = gegl_operation_get_format (operation, padname);
 
   if (format == NULL)
     {
@@ -370,6 +380,7 @@ gegl_operation_context_get_target (GeglOperationContext *context,
             "height",      result->height,
             "format",      format,
             "initialized", gegl_operation_context_get_init_output (),
+            "access-hint", gegl_operation_context_get_access_hint (node),
             NULL);
         }
     }
@@ -395,8 +406,13 @@ gegl_operation_context_get_output_maybe_in_place (GeglOperation *operation,
   GeglOperationClass *klass = GEGL_OPERATION_GET_CLASS (operation);
   GeglBuffer *output;
 
+  /* the input can't be reused when the graph chose another format for
+   * the output buffer
+   */
   if (klass->want_in_place                    &&
       ! gegl_node_use_cache (operation->node) &&
+      (! context->output_format ||
+       (input && context->output_format == gegl_buffer_get_format (input))) &&
       gegl_can_do_inplace_processing (operation, input, roi))
     {
       output = g_object_ref (input);
@@ -546,6 +562,92 @@ gegl_operation_context_dup_input_maybe_copy (GeglOperationContext *context,
   return result;
 }
 
+/* accumulates how the consumers of @pad access its buffer.  gegl:nop
+ * nodes, which include the proxies of meta-operations, and passthrough
+ * nodes hand the buffer on, so their own consumers are followed instead.
+ */
+static void
+gegl_operation_context_get_consumers_access (GeglPad  *pad,
+                                             gboolean *any_point,
+                                             gboolean *any_area,
+                                             gboolean *any_other)
+{
+  GSList *iter;
+
+  for (iter = gegl_pad_get_connections (pad); iter; iter = g_slist_next (iter))
+    {
+      GeglConnection *connection = iter->data;
+      GeglNode       *consumer   = gegl_connection_get_sink_node (connection);
+      GeglPad        *sink_pad   = gegl_connection_get_sink_pad (connection);
+      GeglOperation  *operation  = consumer->operation;
+      GeglPad        *output;
+
+      output = gegl_node_get_pad (consumer, "output");
+
+      if (output &&
+          (! g_strcmp0 (gegl_node_get_operation (consumer), "gegl:nop") ||
+           (consumer->passthrough &&
+            ! strcmp (gegl_pad_get_name (sink_pad), "input"))))
+        {
+          gegl_operation_context_get_consumers_access (output,
+                                                       any_point,
+                                                       any_area,
+                                                       any_other);
+        }
+      else if (GEGL_IS_OPERATION_POINT_FILTER (operation)   ||
+               GEGL_IS_OPERATION_POINT_COMPOSER (operation) ||
+               GEGL_IS_OPERATION_POINT_COMPOSER3 (operation))
+        {
+          *any_point = TRUE;
+        }
+      else if (GEGL_IS_OPERATION_AREA_FILTER (operation))
+        {
+          *any_area = TRUE;
+        }
+      else
+        {
+          *any_other = TRUE;
+        }
+    }
+}
+
+/* the access hint of the output buffers of @node, used to choose their tile
+ * size when the "tile-size-auto" config property is set.  the hint follows
+ * how the buffers are read, that is, the operations consuming them; buffers
+ * read by operations of different kinds, or by sinks, which may hand them
+ * out, keep the configured tile size.
+ */
+GeglBufferAccessHint
+gegl_operation_context_get_access_hint (GeglNode *node)
+{
+  GeglPad  *pad;
+  gboolean  any_point = FALSE;
+  gboolean  any_area  = FALSE;
+  gboolean  any_other = FALSE;
+
+  if (! gegl_config ()->tile_size_auto)
+    return GEGL_BUFFER_ACCESS_HINT_DEFAULT;
+
+  pad = gegl_node_get_pad (node, "output");
+
+  if (! pad)
+    return GEGL_BUFFER_ACCESS_HINT_DEFAULT;
+
+  gegl_operation_context_get_consumers_access (pad,
+                                               &any_point,
+                                               &any_area,
+                                               &any_other);
+
+  if (any_other)
+    return GEGL_BUFFER_ACCESS_HINT_DEFAULT;
+  else if (any_area)
+    return GEGL_BUFFER_ACCESS_HINT_AREA;
+  else if (any_point)
+    return GEGL_BUFFER_ACCESS_HINT_POINT;
+
+  return GEGL_BUFFER_ACCESS_HINT_DEFAULT;
+}
+
 gboolean
 gegl_operation_context_get_init_output (void)
 {
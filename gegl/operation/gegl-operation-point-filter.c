@@ -249,6 +249,52 @@ gegl_operation_point_filter_init (GeglOperationPointFilter *self)
 
 }
 
+/* processes a uniform input as a single pixel, filling the output with the
+ * result, for operations whose output only depends on the input color, as
+ * declared by their "position-independent" key.
+ */
+static gboolean
+gegl_operation_point_filter_process_uniform (GeglOperation       *operation,
+                                             GeglBuffer          *input,
+                                             GeglBuffer          *output,
+                                             const GeglRectangle *result)
+{
+  GeglOperationClass            *operation_class;
+  GeglOperationPointFilterClass *point_filter_class;
+  const Babl                    *in_format;
+  const Babl                    *out_format;
+  const gchar                   *position_independent;
+  gdouble                        in_pixel[16];
+  gdouble                        out_pixel[16];
+
+  operation_class    = GEGL_OPERATION_GET_CLASS (operation);
+  point_filter_class = GEGL_OPERATION_POINT_FILTER_GET_CLASS (operation);
+
+  position_independent = gegl_operation_class_get_key (operation_class,
+                                                       "position-independent");
+
+  if (g_strcmp0 (position_independent, "true"))
+    return FALSE;
+
+  in_format  = gegl_operation_get_format (operation, "input");
+  out_format = gegl_operation_get_format (operation, "output");
+
+  if (babl_format_get_bytes_per_pixel (in_format)  > sizeof (in_pixel) ||
+      babl_format_get_bytes_per_pixel (out_format) > sizeof (out_pixel))
+    {
+      return FALSE;
+    }
+
+  if (! gegl_buffer_get_uniform_pixel (input, result, in_format, in_pixel))
+    return FALSE;
+
+  point_filter_class->process (operation, in_pixel, out_pixel, 1, result, 0);
+
+  gegl_buffer_set_color_from_pixel (output, result, out_pixel, out_format);
+
+  return TRUE;
+}
+
 static gboolean
 gegl_operation_point_filter_process (GeglOperation       *operation,
                                        GeglBuffer          *input,
@@ -264,6 +310,13 @@ gegl_operation_point_filter_process (GeglOperation       *operation,
 
   if ((result->width > 0) && (result->height > 0))
     {
+      if (input && level == 0 &&
+          gegl_operation_point_filter_process_uniform (operation,
+                                                       input, output, result))
+        {
+          return TRUE;
+        }
+
       if (gegl_operation_use_opencl (operation) && (operation_class->cl_data || point_filter_class->cl_process))
       {
         if (gegl_operation_point_filter_cl_process (operation, input, output, result, level))
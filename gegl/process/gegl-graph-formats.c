@@ -0,0 +1,274 @@
+/* This file is part of GEGL.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* Format negotiation.
+ *
+ * Every operation chooses the formats of its pads in prepare(), and a
+ * consumer reading a buffer in another format than the one it was written
+ * in converts every pixel it reads.  When the output of a node is read by
+ * several consumers wanting the same format, each of them converts the
+ * same pixels.  This pass has such nodes write their output directly in
+ * the format wanted downstream, converting once, on write, instead.
+ *
+ * Only operations writing their output through the buffer iterator in
+ * their own output format are given another buffer format, the others
+ * might depend on the buffer format matching theirs.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib-object.h>
+
+#include "gegl-types-internal.h"
+#include "gegl.h"
+#include "gegl-debug.h"
+
+#include "graph/gegl-connection.h"
+#include "graph/gegl-node-private.h"
+#include "graph/gegl-pad.h"
+
+#include "process/gegl-graph-traversal.h"
+#include "process/gegl-graph-traversal-private.h"
+#include "process/gegl-graph-optimize.h"
+#include "process/gegl-graph-rewrite.h"
+#include "process/gegl-graph-formats.h"
+
+#include "operation/gegl-operation.h"
+#include "operation/gegl-operation-context.h"
+#include "operation/gegl-operation-context-private.h"
+#include "operation/gegl-operation-point-composer.h"
+#include "operation/gegl-operation-point-composer3.h"
+#include "operation/gegl-operation-point-filter.h"
+#include "operation/gegl-operation-point-render.h"
+
+
+/* appends the formats read from @node's output, by the nodes processed in
+ * @path, to @formats.
+ */
+static GSList *
+gegl_graph_formats_get_consumers (GeglGraphTraversal *path,
+                                  GeglNode           *node,
+                                  GSList             *formats)
+{
+  GeglPad *output_pad = gegl_node_get_pad (node, "output");
+  GSList  *iter;
+
+  if (! output_pad)
+    return formats;
+
+  for (iter = gegl_pad_get_connections (output_pad); iter; iter = iter->next)
+    {
+      GeglNode    *target = gegl_connection_get_sink_node (iter->data);
+      GeglPad     *pad    = gegl_connection_get_sink_pad (iter->data);
+      const Babl  *format;
+
+      if (! g_hash_table_contains (path->contexts, target) ||
+          g_hash_table_contains (path->aliases, target))
+        continue;
+
+      format = gegl_graph_formats_get_input_format (path, target,
+                                                    gegl_pad_get_name (pad));
+
+      if (format)
+        formats = g_slist_prepend (formats, (gpointer) format);
+    }
+
+  return formats;
+}
+
+static gint
+gegl_graph_formats_count (GSList     *formats,
+                          const Babl *format)
+{
+  gint count = 0;
+
+  for (; formats; formats = formats->next)
+    {
+      if (formats->data != format)
+        count++;
+    }
+
+  return count;
+}
+
+static gboolean
+gegl_graph_formats_can_write (GeglOperation *operation)
+{
+  return GEGL_IS_OPERATION_POINT_FILTER (operation)    ||
+         GEGL_IS_OPERATION_POINT_COMPOSER (operation)  ||
+         GEGL_IS_OPERATION_POINT_COMPOSER3 (operation) ||
+         GEGL_IS_OPERATION_POINT_RENDER (operation);
+}
+
+/* whether storing pixels in @format, and converting them from there,
+ * loses nothing over converting them from @original.
+ */
+static gboolean
+gegl_graph_formats_is_lossless (const Babl *format,
+                                const Babl *original)
+{
+  gint n_components          = babl_format_get_n_components (format);
+  gint original_n_components = babl_format_get_n_components (original);
+
+  return n_components >= original_n_components                   &&
+         (babl_format_has_alpha (format) ||
+          ! babl_format_has_alpha (original))                    &&
+         babl_format_get_bytes_per_pixel (format) / n_components >=
+         babl_format_get_bytes_per_pixel (original) / original_n_components;
+}
+
+/**
+ * gegl_graph_formats:
+ * @path: The traversal path
+ *
+ * Choose the output buffer format of each node of @path, and count the
+ * conversions per pixel left in @path->conversions.
+ */
+void
+gegl_graph_formats (GeglGraphTraversal *path)
+{
+  GList    *list_iter;
+  GeglNode *tail        = g_queue_peek_tail (&path->path);
+  gint      conversions = 0;
+  gint      saved       = 0;
+
+  for (list_iter = g_queue_peek_head_link (&path->path);
+       list_iter;
+       list_iter = list_iter->next)
+    {
+      GeglNode             *node = GEGL_NODE (list_iter->data);
+      GeglOperationContext *context;
+      GeglOperation        *operation;
+      const Babl           *output_format;
+      const Babl           *best_format;
+      GSList               *formats;
+      GSList               *iter;
+      gint                  best_cost;
+
+      context = g_hash_table_lookup (path->contexts, node);
+
+      if (! context)
+        continue;
+
+      context->output_format = NULL;
+
+      if (g_hash_table_contains (path->aliases, node))
+        continue;
+
+      operation     = gegl_graph_rewrite_get_operation (path, node);
+      output_format = gegl_operation_get_format (operation, "output");
+
+      if (! output_format)
+        continue;
+
+      formats = gegl_graph_formats_get_consumers (path, node, NULL);
+
+      for (iter = gegl_graph_get_duplicates (path, node);
+           iter;
+           iter = iter->next)
+        {
+          formats = gegl_graph_formats_get_consumers (path, iter->data,
+                                                      formats);
+        }
+
+      best_format = output_format;
+      best_cost   = gegl_graph_formats_count (formats, output_format);
+
+      /* the output of the last node goes to the caller, in an unknown
+       * format, and cached outputs are stored in the cache's format.
+       */
+      if (best_cost > 1                              &&
+          node != tail                               &&
+          ! gegl_node_use_cache (node)               &&
+          gegl_graph_formats_can_write (operation))
+        {
+          for (iter = formats; iter; iter = iter->next)
+            {
+              const Babl *format = iter->data;
+              gint        cost;
+
+              if (format == output_format)
+                continue;
+
+              cost = 1 + gegl_graph_formats_count (formats, format);
+
+              if (cost < best_cost &&
+                  (cost == 1 ||
+                   gegl_graph_formats_is_lossless (format, output_format)))
+                {
+                  best_format = format;
+                  best_cost   = cost;
+                }
+            }
+        }
+
+      if (best_format != output_format)
+        {
+          GEGL_NOTE (GEGL_DEBUG_PROCESS,
+                     "Writing %s as %s instead of %s, %d conversions instead of %d",
+                     gegl_node_get_debug_name (node),
+                     babl_get_name (best_format),
+                     babl_get_name (output_format),
+                     best_cost,
+                     gegl_graph_formats_count (formats, output_format));
+
+          saved += gegl_graph_formats_count (formats, output_format) -
+                   best_cost;
+
+          context->output_format = best_format;
+        }
+
+      conversions += best_cost;
+
+      g_slist_free (formats);
+    }
+
+  GEGL_NOTE (GEGL_DEBUG_PROCESS,
+             "%d format conversions per pixel, %d avoided",
+             conversions, saved);
+
+  path->conversions = conversions;
+}
+
+/**
+ * gegl_graph_formats_get_input_format:
+ * @path: The traversal path
+ * @node: A node of @path
+ * @pad_name: An input pad of @node
+ *
+ * Return value: the format @node is processed with on @pad_name.
+ */
+const Babl *
+gegl_graph_formats_get_input_format (GeglGraphTraversal *path,
+                                     GeglNode           *node,
+                                     const gchar        *pad_name)
+{
+  GeglGraphRewrite *rewrite = g_hash_table_lookup (path->rewrites, node);
+
+  if (rewrite && rewrite->has_matrix)
+    {
+      if (! strcmp (pad_name, "input"))
+        return babl_format_with_space ("RGBA float", rewrite->space);
+      else
+        return NULL;
+    }
+
+  return gegl_operation_get_format (gegl_graph_rewrite_get_operation (path,
+                                                                      node),
+                                    pad_name);
+}
@@ -0,0 +1,31 @@
+/* This file is part of GEGL.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GEGL_GRAPH_FORMATS_H__
+#define __GEGL_GRAPH_FORMATS_H__
+
+/* Chooses the formats of the buffers passed between the nodes of @path,
+ * such that the number of conversions done when the consumers read them
+ * is minimal.
+ */
+void         gegl_graph_formats                  (GeglGraphTraversal *path);
+
+/* Returns the format @node reads on @pad_name, in @path. */
+const Babl * gegl_graph_formats_get_input_format (GeglGraphTraversal *path,
+                                                  GeglNode           *node,
+                                                  const gchar        *pad_name);
+
+#endif /* __GEGL_GRAPH_FORMATS_H__ */
@@ -0,0 +1,329 @@
+/* This file is part of GEGL.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+
+#include <glib-object.h>
+
+#include "gegl-types-internal.h"
+#include "gegl.h"
+#include "gegl-debug.h"
+#include "gegl-instrument.h"
+
+#include "graph/gegl-node-private.h"
+#include "graph/gegl-pad.h"
+
+#include "process/gegl-graph-traversal.h"
+#include "process/gegl-graph-traversal-private.h"
+#include "process/gegl-graph-optimize.h"
+#include "process/gegl-graph-rewrite.h"
+#include "process/gegl-graph-formats.h"
+
+#include "operation/gegl-operation.h"
+#include "operation/gegl-operation-sink.h"
+#include "operation/gegl-operation-temporal.h"
+
+
+static gboolean
+gegl_graph_optimize_enabled (const gchar *variable,
+                             gint        *enabled)
+{
+  if (*enabled < 0)
+    {
+      if (g_getenv (variable))
+        *enabled = atoi (g_getenv (variable)) ? TRUE : FALSE;
+      else
+        *enabled = TRUE;
+    }
+
+  return *enabled;
+}
+
+static void
+append_value (GString      *key,
+              const GValue *value)
+{
+  GType type = G_VALUE_TYPE (value);
+
+  /* doubles are printed exactly, the default transform rounds them */
+  if (type == G_TYPE_DOUBLE)
+    {
+      g_string_append_printf (key, "%a", g_value_get_double (value));
+    }
+  else if (type == G_TYPE_FLOAT)
+    {
+      g_string_append_printf (key, "%a", (gdouble) g_value_get_float (value));
+    }
+  else if (g_type_is_a (type, GEGL_TYPE_COLOR))
+    {
+      GeglColor *color = g_value_get_object (value);
+
+      if (color)
+        {
+          gdouble rgba[4];
+
+          gegl_color_get_rgba (color, &rgba[0], &rgba[1], &rgba[2], &rgba[3]);
+          g_string_append_printf (key, "%a,%a,%a,%a",
+                                  rgba[0], rgba[1], rgba[2], rgba[3]);
+        }
+    }
+  else if (g_type_is_a (type, GEGL_TYPE_PATH))
+    {
+      GeglPath *path = g_value_get_object (value);
+
+      if (path)
+        {
+          gchar *str = gegl_path_to_string (path);
+
+          g_string_append (key, str);
+          g_free (str);
+        }
+    }
+  else if (G_TYPE_IS_OBJECT (type) || G_TYPE_IS_BOXED (type) ||
+           type == G_TYPE_POINTER)
+    {
+      /* we can't tell whether two objects are equivalent, only whether
+       * they're the same one.
+       */
+      g_string_append_printf (key, "%p", g_value_peek_pointer (value));
+    }
+  else
+    {
+      gchar *str = g_strdup_value_contents (value);
+
+      g_string_append (key, str);
+      g_free (str);
+    }
+}
+
+/* builds a string identifying the output of @node: its operation, its
+ * property values and the nodes computing its inputs.  Returns NULL if the
+ * node must not be merged with others.
+ */
+static gchar *
+gegl_graph_optimize_node_key (GeglGraphTraversal *path,
+                              GeglNode           *node)
+{
+  GeglOperation  *operation = node->operation;
+  GParamSpec    **properties;
+  guint           n_properties;
+  GString        *key;
+  GSList         *iter;
+  guint           i;
+
+  if (! operation                              ||
+      ! gegl_node_has_pad (node, "output")     ||
+      GEGL_IS_OPERATION_SINK (operation)       ||
+      GEGL_IS_OPERATION_TEMPORAL (operation))
+    {
+      return NULL;
+    }
+
+  key = g_string_new (G_OBJECT_TYPE_NAME (operation));
+
+  if (node->passthrough)
+    g_string_append (key, "|passthrough");
+
+  properties = g_object_class_list_properties (G_OBJECT_GET_CLASS (operation),
+                                               &n_properties);
+
+  for (i = 0; i < n_properties; i++)
+    {
+      GParamSpec *pspec = properties[i];
+      GValue      value = G_VALUE_INIT;
+
+      if (! (pspec->flags & G_PARAM_READABLE) ||
+          pspec->flags & (GEGL_PARAM_PAD_INPUT | GEGL_PARAM_PAD_OUTPUT))
+        continue;
+
+      g_value_init (&value, G_PARAM_SPEC_VALUE_TYPE (pspec));
+      g_object_get_property (G_OBJECT (operation), pspec->name, &value);
+
+      g_string_append_printf (key, "|%s=", pspec->name);
+      append_value (key, &value);
+
+      g_value_unset (&value);
+    }
+
+  g_free (properties);
+
+  for (iter = node->input_pads; iter; iter = iter->next)
+    {
+      GeglPad *source_pad = gegl_pad_get_connected_to (iter->data);
+
+      if (source_pad)
+        {
+          GeglNode *source_node = gegl_pad_get_node (source_pad);
+
+          g_string_append_printf (key, "|%s<%p:%s",
+                                  gegl_pad_get_name (iter->data),
+                                  gegl_graph_get_canonical (path, source_node),
+                                  gegl_pad_get_name (source_pad));
+        }
+    }
+
+  return g_string_free (key, FALSE);
+}
+
+/* common subexpression elimination: nodes performing the same operation,
+ * with the same properties, on the same inputs are evaluated only once.
+ * The first such node in the path computes the result for all of them.
+ */
+static void
+gegl_graph_optimize_cse (GeglGraphTraversal *path)
+{
+  GHashTable *keys;
+  GList      *list_iter;
+  GeglNode   *tail = g_queue_peek_tail (&path->path);
+
+  keys = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+  /* the path is in topological order, so the inputs of each node are
+   * resolved before the node itself.
+   */
+  for (list_iter = g_queue_peek_head_link (&path->path);
+       list_iter;
+       list_iter = list_iter->next)
+    {
+      GeglNode *node = GEGL_NODE (list_iter->data);
+      GeglNode *canonical;
+      gchar    *key;
+
+      /* rewritten nodes compute something other than their properties
+       * say, and skipped ones nothing at all.
+       */
+      if (node == tail                                ||
+          g_hash_table_contains (path->aliases, node) ||
+          g_hash_table_contains (path->rewrites, node))
+        continue;
+
+      key = gegl_graph_optimize_node_key (path, node);
+
+      if (! key)
+        continue;
+
+      canonical = g_hash_table_lookup (keys, key);
+
+      if (! canonical)
+        {
+          g_hash_table_insert (keys, key, node);
+          continue;
+        }
+
+      g_free (key);
+
+      GEGL_NOTE (GEGL_DEBUG_PROCESS,
+                 "Merging %s into %s",
+                 gegl_node_get_debug_name (node),
+                 gegl_node_get_debug_name (canonical));
+
+      gegl_graph_optimize_alias (path, node, canonical);
+    }
+
+  g_hash_table_destroy (keys);
+}
+
+/**
+ * gegl_graph_optimize:
+ * @path: The traversal path
+ *
+ * Run the optimization passes over the prepared nodes of @path.
+ */
+void
+gegl_graph_optimize (GeglGraphTraversal *path)
+{
+  static gint rewrite_enabled = -1;
+  static gint cse_enabled     = -1;
+  static gint formats_enabled = -1;
+
+  g_hash_table_remove_all (path->aliases);
+  g_hash_table_remove_all (path->duplicates);
+  g_hash_table_remove_all (path->rewrites);
+
+  if (gegl_graph_optimize_enabled ("GEGL_GRAPH_REWRITE", &rewrite_enabled))
+    gegl_graph_rewrite (path);
+
+  if (gegl_graph_optimize_enabled ("GEGL_GRAPH_CSE", &cse_enabled))
+    gegl_graph_optimize_cse (path);
+
+  /* formats are chosen last, once it is known which nodes are processed */
+  if (gegl_graph_optimize_enabled ("GEGL_GRAPH_FORMATS", &formats_enabled))
+    {
+      GEGL_INSTRUMENT_START();
+
+      gegl_graph_formats (path);
+
+      GEGL_INSTRUMENT_END ("process", "format negotiation");
+    }
+  else
+    {
+      path->conversions = 0;
+    }
+}
+
+/**
+ * gegl_graph_optimize_alias:
+ * @path: The traversal path
+ * @node: A node of @path
+ * @canonical: The node computing the output of @node
+ *
+ * Record that @node isn't processed, and that its consumers are to be
+ * given the output of @canonical instead.
+ */
+void
+gegl_graph_optimize_alias (GeglGraphTraversal *path,
+                           GeglNode           *node,
+                           GeglNode           *canonical)
+{
+  GSList *duplicates;
+  GSList *moved;
+  GSList *iter;
+
+  canonical = gegl_graph_get_canonical (path, canonical);
+
+  /* the nodes merged into @node so far move along */
+  moved = g_hash_table_lookup (path->duplicates, node);
+  g_hash_table_steal (path->duplicates, node);
+
+  for (iter = moved; iter; iter = iter->next)
+    g_hash_table_insert (path->aliases, iter->data, canonical);
+
+  duplicates = g_hash_table_lookup (path->duplicates, canonical);
+  g_hash_table_steal (path->duplicates, canonical);
+
+  duplicates = g_slist_concat (moved, g_slist_prepend (duplicates, node));
+
+  g_hash_table_insert (path->duplicates, canonical, duplicates);
+  g_hash_table_insert (path->aliases, node, canonical);
+}
+
+GeglNode *
+gegl_graph_get_canonical (GeglGraphTraversal *path,
+                          GeglNode           *node)
+{
+  GeglNode *canonical = g_hash_table_lookup (path->aliases, node);
+
+  return canonical ? canonical : node;
+}
+
+GSList *
+gegl_graph_get_duplicates (GeglGraphTraversal *path,
+                           GeglNode           *node)
+{
+  return g_hash_table_lookup (path->duplicates, node);
+}
@@ -0,0 +1,43 @@
+/* This file is part of GEGL.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GEGL_GRAPH_OPTIMIZE_H__
+#define __GEGL_GRAPH_OPTIMIZE_H__
+
+/* Runs the optimization passes over a prepared traversal.  The passes
+ * don't modify the graph itself, they only record, in the traversal, which
+ * nodes can be evaluated in place of others.
+ */
+void       gegl_graph_optimize       (GeglGraphTraversal *path);
+
+/* Records that @node computes the same output as @canonical, and needn't
+ * be processed.
+ */
+void       gegl_graph_optimize_alias (GeglGraphTraversal *path,
+                                      GeglNode           *node,
+                                      GeglNode           *canonical);
+
+/* Returns the node computing the output of @node in @path, which is @node
+ * itself unless it was found to be redundant.
+ */
+GeglNode * gegl_graph_get_canonical  (GeglGraphTraversal *path,
+                                      GeglNode           *node);
+
+/* Returns the nodes of @path whose output is computed by @node. */
+GSList   * gegl_graph_get_duplicates (GeglGraphTraversal *path,
+                                      GeglNode           *node);
+
+#endif /* __GEGL_GRAPH_OPTIMIZE_H__ */
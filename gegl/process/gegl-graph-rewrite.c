@@ -0,0 +1,741 @@
+/* This file is part of GEGL.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <math.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <glib-object.h>
+
+#include "gegl-types-internal.h"
+#include "gegl.h"
+#include "gegl-debug.h"
+
+#include "graph/gegl-node-private.h"
+#include "graph/gegl-pad.h"
+
+#include "process/gegl-graph-traversal.h"
+#include "process/gegl-graph-traversal-private.h"
+#include "process/gegl-graph-optimize.h"
+#include "process/gegl-graph-rewrite.h"
+
+#include "operation/gegl-operation.h"
+#include "operation/gegl-operation-context.h"
+#include "operation/gegl-operation-context-private.h"
+
+/* The rewrite pass recognizes a few families of operations, by name and
+ * property values:
+ *
+ *  - identities (gegl:nop, zero radius blurs, ...) are skipped, their
+ *    consumers read the node's input directly.
+ *  - chains of affine color operations are evaluated as a single 4×5
+ *    matrix, by the last node of the chain.
+ *  - chains of 1d gaussian blurs, such as consecutive gegl:gaussian-blur
+ *    nodes, are folded into at most one horizontal and one vertical blur
+ *    with the combined standard deviation.  this is only exact when no
+ *    stage clips its result, or fills the abyss with anything but zeros,
+ *    so only such blurs are folded.
+ *
+ * Only nodes whose output is used by the next node of the chain alone are
+ * folded, the graph itself is never modified.
+ */
+
+#define MATRIX_EPSILON 1e-7
+
+/* GEGL_GBLUR_1D_ABYSS_NONE, of gegl:gblur-1d's "abyss-policy" */
+#define GBLUR_ABYSS_NONE 0
+
+typedef enum
+{
+  REWRITE_NONE,
+  REWRITE_IDENTITY,
+  REWRITE_MATRIX,
+  REWRITE_GBLUR
+} RewriteKind;
+
+typedef struct
+{
+  RewriteKind  kind;
+
+  /* REWRITE_MATRIX */
+  gdouble      matrix[20];
+  const Babl  *space;
+
+  /* REWRITE_GBLUR */
+  gdouble      std_dev;
+  gint         orientation;
+  gint         filter;
+  gint         abyss_policy;
+} Rule;
+
+typedef struct
+{
+  RewriteKind  kind;
+  GeglNode    *input; /* the node computing the input of the chain */
+  GeglNode    *last;
+  GSList      *nodes; /* the nodes of the chain, last first */
+
+  gdouble      matrix[20];
+  const Babl  *space;
+
+  gint         filter;
+  gint         abyss_policy;
+  gdouble      variance[2]; /* per GeglOrientation */
+} Run;
+
+static const gdouble identity_matrix[20] = { 1.0, 0.0, 0.0, 0.0, 0.0,
+                                             0.0, 1.0, 0.0, 0.0, 0.0,
+                                             0.0, 0.0, 1.0, 0.0, 0.0,
+                                             0.0, 0.0, 0.0, 1.0, 0.0 };
+
+
+/* @result = @a applied after @b */
+static void
+matrix_multiply (const gdouble *a,
+                 const gdouble *b,
+                 gdouble       *result)
+{
+  gdouble tmp[20];
+  gint    r, c, k;
+
+  for (r = 0; r < 4; r++)
+    {
+      for (c = 0; c < 5; c++)
+        {
+          gdouble sum = c == 4 ? a[r * 5 + 4] : 0.0;
+
+          for (k = 0; k < 4; k++)
+            sum += a[r * 5 + k] * b[k * 5 + c];
+
+          tmp[r * 5 + c] = sum;
+        }
+    }
+
+  memcpy (result, tmp, sizeof (tmp));
+}
+
+static gboolean
+matrix_is_identity (const gdouble *matrix)
+{
+  gint i;
+
+  for (i = 0; i < 20; i++)
+    {
+      if (fabs (matrix[i] - identity_matrix[i]) > MATRIX_EPSILON)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+/* gegl:svg-matrix operates on premultiplied data, which is only an affine
+ * transform of the straight color when alpha is left alone.
+ */
+static gboolean
+svg_matrix_get_matrix (const gchar *values,
+                       gdouble     *matrix)
+{
+  gchar **split;
+  gchar  *str;
+  gint    i;
+
+  memcpy (matrix, identity_matrix, sizeof (identity_matrix));
+
+  if (! values)
+    return TRUE;
+
+  str = g_strstrip (g_strdup (values));
+  g_strdelimit (str, " ", ',');
+  split = g_strsplit (str, ",", 20);
+
+  for (i = 0; i < 20; i++)
+    {
+      gchar *end;
+
+      if (! split[i])
+        break;
+
+      matrix[i] = g_ascii_strtod (split[i], &end);
+
+      if (end == split[i])
+        break;
+    }
+
+  /* the operation falls back to the identity on malformed values */
+  if (i < 20)
+    memcpy (matrix, identity_matrix, sizeof (identity_matrix));
+
+  g_strfreev (split);
+  g_free (str);
+
+  return matrix[3]  == 0.0 && matrix[4]  == 0.0 &&
+         matrix[8]  == 0.0 && matrix[9]  == 0.0 &&
+         matrix[13] == 0.0 && matrix[14] == 0.0 &&
+         matrix[15] == 0.0 && matrix[16] == 0.0 && matrix[17] == 0.0 &&
+         matrix[18] == 1.0 && matrix[19] == 0.0;
+}
+
+static gboolean
+gegl_graph_rewrite_get_matrix (GeglOperation *operation,
+                               const gchar   *name,
+                               gdouble       *matrix)
+{
+  memcpy (matrix, identity_matrix, sizeof (identity_matrix));
+
+  if (! strcmp (name, "gegl:brightness-contrast"))
+    {
+      gdouble brightness;
+      gdouble contrast;
+      gint    c;
+
+      g_object_get (operation,
+                    "brightness", &brightness,
+                    "contrast",   &contrast,
+                    NULL);
+
+      for (c = 0; c < 3; c++)
+        {
+          matrix[c * 5 + c] = contrast;
+          matrix[c * 5 + 4] = brightness + 0.5 - 0.5 * contrast;
+        }
+    }
+  else if (! strcmp (name, "gegl:exposure"))
+    {
+      gdouble black_level;
+      gdouble exposure;
+      gdouble gain;
+      gint    c;
+
+      g_object_get (operation,
+                    "black-level", &black_level,
+                    "exposure",    &exposure,
+                    NULL);
+
+      gain = 1.0 / MAX (exp2 (-exposure) - black_level, 0.000001);
+
+      for (c = 0; c < 3; c++)
+        {
+          matrix[c * 5 + c] = gain;
+          matrix[c * 5 + 4] = -black_level * gain;
+        }
+    }
+  else if (! strcmp (name, "gegl:opacity"))
+    {
+      g_object_get (operation, "value", &matrix[18], NULL);
+    }
+  else if (! strcmp (name, "gegl:mono-mixer"))
+    {
+      gboolean preserve_luminosity;
+      gdouble  gains[3];
+      gdouble  norm = 1.0;
+      gint     c;
+
+      g_object_get (operation,
+                    "preserve-luminosity", &preserve_luminosity,
+                    "red",                 &gains[0],
+                    "green",               &gains[1],
+                    "blue",                &gains[2],
+                    NULL);
+
+      if (preserve_luminosity && gains[0] + gains[1] + gains[2] != 0.0)
+        norm = fabs (1.0 / (gains[0] + gains[1] + gains[2]));
+
+      /* the output is gray, which reads back as equal R, G and B */
+      for (c = 0; c < 3; c++)
+        {
+          matrix[c * 5 + 0] = gains[0] * norm;
+          matrix[c * 5 + 1] = gains[1] * norm;
+          matrix[c * 5 + 2] = gains[2] * norm;
+        }
+    }
+  else if (! strcmp (name, "gegl:channel-mixer"))
+    {
+      static const gchar *gain_names[9] = { "rr-gain", "rg-gain", "rb-gain",
+                                            "gr-gain", "gg-gain", "gb-gain",
+                                            "br-gain", "bg-gain", "bb-gain" };
+      gboolean preserve_luminosity;
+      gint     r, c;
+
+      g_object_get (operation,
+                    "preserve-luminosity", &preserve_luminosity,
+                    NULL);
+
+      for (r = 0; r < 3; r++)
+        {
+          gdouble sum = 0.0;
+
+          for (c = 0; c < 3; c++)
+            {
+              g_object_get (operation,
+                            gain_names[r * 3 + c], &matrix[r * 5 + c],
+                            NULL);
+              sum += matrix[r * 5 + c];
+            }
+
+          if (preserve_luminosity && sum != 0.0)
+            {
+              for (c = 0; c < 3; c++)
+                matrix[r * 5 + c] *= fabs (1.0 / sum);
+            }
+        }
+    }
+  else if (! strcmp (name, "gegl:svg-matrix"))
+    {
+      gchar    *values = NULL;
+      gboolean  affine;
+
+      g_object_get (operation, "values", &values, NULL);
+      affine = svg_matrix_get_matrix (values, matrix);
+      g_free (values);
+
+      return affine;
+    }
+  else
+    {
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+/* returns the node connected to the "input" pad of @node, if it is the
+ * only connected input.
+ */
+static GeglNode *
+gegl_graph_rewrite_get_input (GeglNode *node)
+{
+  GeglNode *input = NULL;
+  GSList   *iter;
+
+  for (iter = node->input_pads; iter; iter = iter->next)
+    {
+      GeglPad *source_pad = gegl_pad_get_connected_to (iter->data);
+
+      if (! source_pad)
+        continue;
+
+      if (strcmp (gegl_pad_get_name (iter->data), "input") ||
+          strcmp (gegl_pad_get_name (source_pad), "output"))
+        return NULL;
+
+      input = gegl_pad_get_node (source_pad);
+    }
+
+  return input;
+}
+
+static RewriteKind
+gegl_graph_rewrite_classify (GeglNode *node,
+                             Rule     *rule)
+{
+  GeglOperation *operation = node->operation;
+  const gchar   *name;
+
+  rule->kind = REWRITE_NONE;
+
+  if (! operation || ! gegl_node_has_pad (node, "output"))
+    return rule->kind;
+
+  name = gegl_operation_get_name (operation);
+
+  if (node->passthrough || ! g_strcmp0 (name, "gegl:nop"))
+    {
+      rule->kind = REWRITE_IDENTITY;
+    }
+  else if (! g_strcmp0 (name, "gegl:gblur-1d"))
+    {
+      gboolean clip_extent;
+
+      g_object_get (operation,
+                    "std-dev",      &rule->std_dev,
+                    "orientation",  &rule->orientation,
+                    "filter",       &rule->filter,
+                    "abyss-policy", &rule->abyss_policy,
+                    "clip-extent",  &clip_extent,
+                    NULL);
+
+      if (rule->std_dev <= 0.0)
+        rule->kind = REWRITE_IDENTITY;
+      /* the intermediate results have to be neither clipped, nor
+       * re-extended by the next blur, for the folded blur to be exact
+       */
+      else if (! clip_extent && rule->abyss_policy == GBLUR_ABYSS_NONE)
+        rule->kind = REWRITE_GBLUR;
+    }
+  else if (name && gegl_graph_rewrite_get_matrix (operation, name,
+                                                  rule->matrix))
+    {
+      const Babl *format = gegl_operation_get_format (operation, "input");
+
+      if (format && ! (babl_get_model_flags (format) & BABL_MODEL_FLAG_CMYK))
+        {
+          rule->kind  = REWRITE_MATRIX;
+          rule->space = babl_format_get_space (format);
+        }
+    }
+
+  return rule->kind;
+}
+
+static gint
+get_n_consumers (GeglNode *node)
+{
+  GeglPad *pad = gegl_node_get_pad (node, "output");
+
+  return pad ? g_slist_length (gegl_pad_get_connections (pad)) : 0;
+}
+
+/* checks that the output of every node from @end up to @start is only
+ * used by the next one.
+ */
+static gboolean
+is_single_consumer_chain (GeglNode *start,
+                          GeglNode *end)
+{
+  GeglNode *node;
+
+  for (node = end; node != start; node = gegl_graph_rewrite_get_input (node))
+    {
+      if (! node || get_n_consumers (node) != 1)
+        return FALSE;
+    }
+
+  return get_n_consumers (start) == 1;
+}
+
+static gboolean
+run_accepts (Run        *run,
+             const Rule *rule)
+{
+  if (run->kind != rule->kind)
+    return FALSE;
+
+  if (run->kind == REWRITE_MATRIX)
+    return run->space == rule->space;
+
+  return run->filter       == rule->filter &&
+         run->abyss_policy == rule->abyss_policy;
+}
+
+static void
+run_add (Run        *run,
+         GeglNode   *node,
+         const Rule *rule)
+{
+  run->last  = node;
+  run->nodes = g_slist_prepend (run->nodes, node);
+
+  if (run->kind == REWRITE_MATRIX)
+    {
+      matrix_multiply (rule->matrix, run->matrix, run->matrix);
+    }
+  else
+    {
+      run->variance[rule->orientation] += rule->std_dev * rule->std_dev;
+    }
+}
+
+static GeglOperation *
+gegl_graph_rewrite_gblur_operation (GeglNode *node,
+                                    Run      *run,
+                                    gint      orientation)
+{
+  GeglOperation *operation;
+
+  operation = g_object_new (G_OBJECT_TYPE (node->operation),
+                            "std-dev",      sqrt (run->variance[orientation]),
+                            "orientation",  orientation,
+                            "filter",       run->filter,
+                            "abyss-policy", run->abyss_policy,
+                            "clip-extent",  FALSE,
+                            NULL);
+
+  /* the operation is evaluated on behalf of @node, using its pads, but
+   * isn't attached to it.
+   */
+  operation->node = node;
+  gegl_operation_prepare (operation);
+
+  return operation;
+}
+
+static void
+gegl_graph_rewrite_set (GeglGraphTraversal *path,
+                        GeglNode           *node,
+                        GeglGraphRewrite   *rewrite)
+{
+  GEGL_NOTE (GEGL_DEBUG_PROCESS,
+             "Rewriting %s",
+             gegl_node_get_debug_name (node));
+
+  g_hash_table_insert (path->rewrites, node, rewrite);
+}
+
+static void
+run_finish (GeglGraphTraversal *path,
+            Run                *run,
+            GeglNode           *tail)
+{
+  GeglGraphRewrite *rewrite;
+  GSList           *iter;
+  gint              length = g_slist_length (run->nodes);
+
+  if (run->kind == REWRITE_MATRIX)
+    {
+      if (matrix_is_identity (run->matrix) && run->last != tail)
+        {
+          for (iter = run->nodes; iter; iter = iter->next)
+            gegl_graph_optimize_alias (path, iter->data, run->input);
+        }
+      else if (length > 1)
+        {
+          for (iter = run->nodes->next; iter; iter = iter->next)
+            gegl_graph_optimize_alias (path, iter->data, run->input);
+
+          rewrite             = g_slice_new0 (GeglGraphRewrite);
+          rewrite->has_matrix = TRUE;
+          rewrite->space      = run->space;
+          memcpy (rewrite->matrix, run->matrix, sizeof (run->matrix));
+
+          gegl_graph_rewrite_set (path, run->last, rewrite);
+        }
+    }
+  else if (length > 1)
+    {
+      GeglNode *first       = g_slist_last (run->nodes)->data;
+      gint      orientation;
+      gint      other;
+
+      g_object_get (first->operation, "orientation", &orientation, NULL);
+      other = orientation == GEGL_ORIENTATION_HORIZONTAL ?
+                GEGL_ORIENTATION_VERTICAL : GEGL_ORIENTATION_HORIZONTAL;
+
+      if (run->variance[other] == 0.0)
+        {
+          /* a single direction, blur once at the end */
+          for (iter = run->nodes->next; iter; iter = iter->next)
+            gegl_graph_optimize_alias (path, iter->data, run->input);
+
+          rewrite = g_slice_new0 (GeglGraphRewrite);
+          rewrite->operation =
+            gegl_graph_rewrite_gblur_operation (run->last, run, orientation);
+
+          gegl_graph_rewrite_set (path, run->last, rewrite);
+        }
+      else
+        {
+          /* the first node blurs in its direction, and the last one in the
+           * other; separable blurs commute.
+           */
+          for (iter = run->nodes->next; iter->data != first; iter = iter->next)
+            gegl_graph_optimize_alias (path, iter->data, first);
+
+          rewrite = g_slice_new0 (GeglGraphRewrite);
+          rewrite->operation =
+            gegl_graph_rewrite_gblur_operation (first, run, orientation);
+
+          gegl_graph_rewrite_set (path, first, rewrite);
+
+          rewrite = g_slice_new0 (GeglGraphRewrite);
+          rewrite->operation =
+            gegl_graph_rewrite_gblur_operation (run->last, run, other);
+
+          gegl_graph_rewrite_set (path, run->last, rewrite);
+        }
+    }
+
+  g_slist_free (run->nodes);
+  g_slice_free (Run, run);
+}
+
+/**
+ * gegl_graph_rewrite:
+ * @path: The traversal path
+ *
+ * Skip identity nodes and fold chains of operations in @path.
+ */
+void
+gegl_graph_rewrite (GeglGraphTraversal *path)
+{
+  GHashTable *open_runs;
+  GList      *runs = NULL;
+  GList      *list_iter;
+  GeglNode   *tail = g_queue_peek_tail (&path->path);
+
+  /* the last node of each run -> run */
+  open_runs = g_hash_table_new (NULL, NULL);
+
+  for (list_iter = g_queue_peek_head_link (&path->path);
+       list_iter;
+       list_iter = list_iter->next)
+    {
+      GeglNode *node = GEGL_NODE (list_iter->data);
+      GeglNode *input;
+      Run      *run;
+      Rule      rule = { 0, };
+
+      input = gegl_graph_rewrite_get_input (node);
+
+      if (! input)
+        continue;
+
+      switch (gegl_graph_rewrite_classify (node, &rule))
+        {
+        case REWRITE_NONE:
+          break;
+
+        case REWRITE_IDENTITY:
+          if (node != tail)
+            gegl_graph_optimize_alias (path, node, input);
+          break;
+
+        case REWRITE_MATRIX:
+        case REWRITE_GBLUR:
+          run = g_hash_table_lookup (open_runs,
+                                     gegl_graph_get_canonical (path, input));
+
+          if (run && run_accepts (run, &rule) &&
+              is_single_consumer_chain (run->last, input))
+            {
+              g_hash_table_remove (open_runs, run->last);
+            }
+          else
+            {
+              run               = g_slice_new0 (Run);
+              run->kind         = rule.kind;
+              run->input        = input;
+              run->space        = rule.space;
+              run->filter       = rule.filter;
+              run->abyss_policy = rule.abyss_policy;
+              memcpy (run->matrix, identity_matrix, sizeof (identity_matrix));
+
+              runs = g_list_prepend (runs, run);
+            }
+
+          run_add (run, node, &rule);
+          g_hash_table_insert (open_runs, node, run);
+          break;
+        }
+    }
+
+  g_hash_table_destroy (open_runs);
+
+  runs = g_list_reverse (runs);
+
+  for (list_iter = runs; list_iter; list_iter = list_iter->next)
+    run_finish (path, list_iter->data, tail);
+
+  g_list_free (runs);
+}
+
+void
+gegl_graph_rewrite_free (GeglGraphRewrite *rewrite)
+{
+  g_clear_object (&rewrite->operation);
+  g_slice_free (GeglGraphRewrite, rewrite);
+}
+
+GeglOperation *
+gegl_graph_rewrite_get_operation (GeglGraphTraversal *path,
+                                  GeglNode           *node)
+{
+  GeglGraphRewrite *rewrite = g_hash_table_lookup (path->rewrites, node);
+
+  if (rewrite && rewrite->operation)
+    return rewrite->operation;
+
+  return node->operation;
+}
+
+typedef struct
+{
+  GeglBuffer *input;
+  GeglBuffer *output;
+  const Babl *format;
+  gint        level;
+  gfloat      matrix[20];
+} MatrixData;
+
+static void
+gegl_graph_rewrite_process_matrix (const GeglRectangle *area,
+                                   gpointer             user_data)
+{
+  MatrixData         *data = user_data;
+  const gfloat       *m    = data->matrix;
+  GeglBufferIterator *iter;
+
+  iter = gegl_buffer_iterator_new (data->output, area, data->level,
+                                   data->format,
+                                   GEGL_ACCESS_WRITE, GEGL_ABYSS_NONE, 2);
+  gegl_buffer_iterator_add (iter, data->input, area, data->level,
+                            data->format,
+                            GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
+
+  while (gegl_buffer_iterator_next (iter))
+    {
+      gfloat       *out = iter->items[0].data;
+      const gfloat *in  = iter->items[1].data;
+      gint          n   = iter->length;
+
+      while (n--)
+        {
+          out[0] = m[0]  * in[0] + m[1]  * in[1] + m[2]  * in[2] + m[3]  * in[3] + m[4];
+          out[1] = m[5]  * in[0] + m[6]  * in[1] + m[7]  * in[2] + m[8]  * in[3] + m[9];
+          out[2] = m[10] * in[0] + m[11] * in[1] + m[12] * in[2] + m[13] * in[3] + m[14];
+          out[3] = m[15] * in[0] + m[16] * in[1] + m[17] * in[2] + m[18] * in[3] + m[19];
+
+          in  += 4;
+          out += 4;
+        }
+    }
+}
+
+gboolean
+gegl_graph_rewrite_process (GeglGraphTraversal   *path,
+                            GeglNode             *node,
+                            GeglOperationContext *context,
+                            gint                  level)
+{
+  GeglGraphRewrite *rewrite = g_hash_table_lookup (path->rewrites, node);
+  MatrixData        data;
+  gint              i;
+
+  if (! rewrite || ! rewrite->has_matrix)
+    return FALSE;
+
+  data.input = GEGL_BUFFER (gegl_operation_context_get_object (context,
+                                                               "input"));
+
+  if (! data.input)
+    return FALSE;
+
+  data.output = gegl_operation_context_get_target (context, "output");
+  data.format = babl_format_with_space ("RGBA float", rewrite->space);
+  data.level  = level;
+
+  for (i = 0; i < 20; i++)
+    data.matrix[i] = rewrite->matrix[i];
+
+  gegl_parallel_distribute_area (
+    &context->need_rect,
+    gegl_operation_get_pixels_per_thread (node->operation),
+    GEGL_SPLIT_STRATEGY_AUTO,
+    gegl_graph_rewrite_process_matrix, &data);
+
+  return TRUE;
+}
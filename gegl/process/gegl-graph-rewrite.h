@@ -0,0 +1,51 @@
+/* This file is part of GEGL.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GEGL_GRAPH_REWRITE_H__
+#define __GEGL_GRAPH_REWRITE_H__
+
+/* How a node of a traversal is evaluated after rewriting, in place of its
+ * own operation.
+ */
+typedef struct
+{
+  /* an operation of the same node, with different property values */
+  GeglOperation *operation;
+
+  /* or an affine color transform, applied to the node's "input" in
+   * linear RGBA of @space; rows of 4 coefficients and an offset.
+   */
+  gboolean       has_matrix;
+  gdouble        matrix[20];
+  const Babl    *space;
+} GeglGraphRewrite;
+
+void            gegl_graph_rewrite               (GeglGraphTraversal   *path);
+void            gegl_graph_rewrite_free          (GeglGraphRewrite     *rewrite);
+
+/* Returns the operation evaluated for @node in @path. */
+GeglOperation * gegl_graph_rewrite_get_operation (GeglGraphTraversal   *path,
+                                                  GeglNode             *node);
+
+/* Processes @node if it was rewritten to something other than an
+ * operation, returns FALSE if the node should be processed normally.
+ */
+gboolean        gegl_graph_rewrite_process       (GeglGraphTraversal   *path,
+                                                  GeglNode             *node,
+                                                  GeglOperationContext *context,
+                                                  gint                  level);
+
+#endif /* __GEGL_GRAPH_REWRITE_H__ */
@@ -49,11 +49,16 @@ gegl_graph_dump_outputs (GeglNode *node)
        list_iter = list_iter->next)
   {
     GeglNode *cur_node = GEGL_NODE (list_iter->data);
+    GeglOperationContext *context = g_hash_table_lookup (path->contexts, cur_node);
+
     if (gegl_node_get_pad (cur_node, "output"))
       {
         const Babl *format = gegl_operation_get_format (cur_node->operation, "output");
-        printf ("%s: output=%s\n", gegl_node_get_debug_name (cur_node),
-                                   format ? babl_get_name (format) : "N/A");
+        printf ("%s: output=%s", gegl_node_get_debug_name (cur_node),
+                                 format ? babl_get_name (format) : "N/A");
+        if (context && context->output_format)
+          printf (" buffer=%s", babl_get_name (context->output_format));
+        printf ("\n");
       }
     else
       {
@@ -67,6 +72,8 @@ gegl_graph_dump_outputs (GeglNode *node)
       }
   }
 
+  printf ("format conversions per pixel: %d\n", path->conversions);
+
   gegl_graph_free (path);
 }
 
@@ -25,6 +25,10 @@ struct _GeglGraphTraversal
   GQueue      path;
   gboolean    rects_dirty;
   GeglBuffer *shared_empty;
+  GHashTable *aliases;    /* redundant node -> node computing its output */
+  GHashTable *duplicates; /* node -> GSList of the nodes it computes for */
+  GHashTable *rewrites;   /* node -> GeglGraphRewrite */
+  gint        conversions; /* format conversions per pixel */
 };
 
 #endif /* __GEGL_GRAPH_TRAVERSAL_PRIVATE_H__ */
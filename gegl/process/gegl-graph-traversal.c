@@ -28,6 +28,8 @@
 
 #include "gegl-region.h"
 
+#include "buffer/gegl-scratch-private.h"
+
 #include "graph/gegl-node-private.h"
 #include "graph/gegl-pad.h"
 #include "graph/gegl-visitor.h"
@@ -37,6 +39,8 @@
 
 #include "process/gegl-graph-traversal.h"
 #include "process/gegl-graph-traversal-private.h"
+#include "process/gegl-graph-optimize.h"
+#include "process/gegl-graph-rewrite.h"
 
 #include "operation/gegl-operation.h"
 #include "operation/gegl-operation-context.h"
@@ -95,6 +99,15 @@ _gegl_graph_do_build (GeglGraphTraversal *path, GeglNode *node)
                                           NULL,
                                           NULL,
                                           (GDestroyNotify)gegl_operation_context_destroy);
+  path->aliases = g_hash_table_new (NULL, NULL);
+  path->duplicates = g_hash_table_new_full (NULL,
+                                            NULL,
+                                            NULL,
+                                            (GDestroyNotify)g_slist_free);
+  path->rewrites = g_hash_table_new_full (NULL,
+                                          NULL,
+                                          NULL,
+                                          (GDestroyNotify)gegl_graph_rewrite_free);
   path->rects_dirty = FALSE;
 }
 
@@ -131,6 +144,9 @@ gegl_graph_rebuild (GeglGraphTraversal *path, GeglNode *node)
 {
   g_queue_clear (&path->path);
   g_hash_table_unref (path->contexts);
+  g_hash_table_unref (path->aliases);
+  g_hash_table_unref (path->duplicates);
+  g_hash_table_unref (path->rewrites);
 
   /* Replaces everything but shared_empty */
   _gegl_graph_do_build (path, node);
@@ -141,6 +157,9 @@ gegl_graph_free (GeglGraphTraversal *path)
 {
   g_queue_clear (&path->path);
   g_hash_table_unref (path->contexts);
+  g_hash_table_unref (path->aliases);
+  g_hash_table_unref (path->duplicates);
+  g_hash_table_unref (path->rewrites);
   g_clear_object (&path->shared_empty);
   g_free (path);
 }
@@ -170,7 +189,8 @@ gegl_graph_get_bounding_box (GeglGraphTraversal *path)
  * gegl_graph_prepare:
  * @path: The traversal path
  *
- * Prepare all nodes, initializing their output formats and have rects.
+ * Prepare all nodes, initializing their output formats and have rects,
+ * and run the optimization passes over the result.
  */
 void
 gegl_graph_prepare (GeglGraphTraversal *path)
@@ -232,6 +252,8 @@ gegl_graph_prepare (GeglGraphTraversal *path)
                              context);
       }
   }
+
+  gegl_graph_optimize (path);
 }
 
 /**
@@ -294,7 +316,7 @@ gegl_graph_prepare_request (GeglGraphTraversal  *path,
        list_iter = list_iter->prev)
     {
       GeglNode             *node      = GEGL_NODE (list_iter->data);
-      GeglOperation        *operation = node->operation;
+      GeglOperation        *operation = gegl_graph_rewrite_get_operation (path, node);
       GeglOperationContext *context;
       GeglRectangle        *request;
       GSList               *input_pads;
@@ -342,11 +364,17 @@ gegl_graph_prepare_request (GeglGraphTraversal  *path,
             if (source_pad)
               {
                 GeglNode             *source_node    = gegl_pad_get_node (source_pad);
-                GeglOperationContext *source_context = g_hash_table_lookup (path->contexts, source_node);
+                GeglOperationContext *source_context;
                 const gchar          *pad_name       = gegl_pad_get_name (input_pads->data);
 
                 GeglRectangle rect, current_need, new_need;
 
+                /* Redundant nodes are never processed, request the data
+                 * from the node computing it instead.
+                 */
+                source_node    = gegl_graph_get_canonical (path, source_node);
+                source_context = g_hash_table_lookup (path->contexts, source_node);
+
                 /* Combine this need rect with any existing request */
                 rect = gegl_operation_get_required_for_output (operation, pad_name, &full_request);
                 current_need = *gegl_operation_context_get_need_rect (source_context);
@@ -381,8 +409,11 @@ gegl_graph_get_connected_output_contexts (GeglGraphTraversal *path,
       GeglNode *target_node = gegl_connection_get_sink_node (targets_iter->data);
       GeglOperationContext *target_context = g_hash_table_lookup (path->contexts, target_node);
       
-      /* Only include this target if it's part of the current path */
-      if (target_context)
+      /* Only include this target if it's part of the current path, and
+       * will actually be processed
+       */
+      if (target_context &&
+          ! g_hash_table_contains (path->aliases, target_node))
         {
           const gchar *target_pad_name = gegl_pad_get_name (gegl_connection_get_sink_pad (targets_iter->data));
           
@@ -438,12 +469,21 @@ gegl_graph_process (GeglGraphTraversal *path,
        list_iter = list_iter->next)
     {
       GeglNode *node = GEGL_NODE (list_iter->data);
-      GeglOperation *operation = node->operation;
+      GeglOperation *operation = gegl_graph_rewrite_get_operation (path, node);
+      volatile guintptr scratch_allocated = 0;
+      volatile guintptr *scratch_counter = NULL;
       g_return_val_if_fail (node, NULL);
       g_return_val_if_fail (operation, NULL);
       
       GEGL_INSTRUMENT_START();
 
+      if (gegl_instrument_enabled)
+        {
+          scratch_counter = gegl_scratch_get_counter ();
+
+          gegl_scratch_set_counter (&scratch_allocated);
+        }
+
       operation_result = NULL;
 
       if (last_context)
@@ -457,7 +497,11 @@ gegl_graph_process (GeglGraphTraversal *path,
                  gegl_node_get_debug_name (node),
                  context->result_rect.x, context->result_rect.y, context->result_rect.width, context->result_rect.height);
       
-      if (context->need_rect.width > 0 && context->need_rect.height > 0)
+      /* a cancelled render leaves the remaining nodes unprocessed, their
+       * output would be discarded anyway.
+       */
+      if (context->need_rect.width > 0 && context->need_rect.height > 0 &&
+          ! gegl_parallel_is_cancelled ())
         {
           if (context->cached)
             {
@@ -483,10 +527,12 @@ gegl_graph_process (GeglGraphTraversal *path,
               /* note: this hard-coding of "output" makes some more custom
                * graph topologies harder than necessary.
                */
-              gegl_operation_process (operation, context, "output", &context->need_rect, context->level);
+              if (! gegl_graph_rewrite_process (path, node, context, context->level))
+                gegl_operation_process (operation, context, "output", &context->need_rect, context->level);
               operation_result = GEGL_BUFFER (gegl_operation_context_get_object (context, "output"));
 
-              if (operation_result && operation_result == (GeglBuffer *)operation->node->cache)
+              if (operation_result && operation_result == (GeglBuffer *)operation->node->cache &&
+                  ! gegl_parallel_is_cancelled ())
                 gegl_cache_computed (operation->node->cache, &context->need_rect, level);
             }
         }
@@ -500,6 +546,20 @@ gegl_graph_process (GeglGraphTraversal *path,
           GeglPad *output_pad = gegl_node_get_pad (node, "output");
           GList   *targets = gegl_graph_get_connected_output_contexts (path, output_pad);
           GList   *targets_iter;
+          GSList  *duplicates;
+
+          /* also deliver the result in place of the nodes found to compute
+           * the same thing
+           */
+          for (duplicates = gegl_graph_get_duplicates (path, node);
+               duplicates;
+               duplicates = duplicates->next)
+            {
+              output_pad = gegl_node_get_pad (duplicates->data, "output");
+              targets = g_list_concat (
+                targets,
+                gegl_graph_get_connected_output_contexts (path, output_pad));
+            }
 
           GEGL_NOTE (GEGL_DEBUG_PROCESS,
                      "Will deliver the results of %s:%s to %d targets",
@@ -519,6 +579,18 @@ gegl_graph_process (GeglGraphTraversal *path,
         }
       last_context = context;
 
+      /* the scratch memory allocated by this thread, and by the worker
+       * threads it distributed the processing to, which other operations,
+       * processed concurrently, don't add to.
+       */
+      if (gegl_instrument_enabled)
+        {
+          gegl_scratch_set_counter (scratch_counter);
+
+          gegl_instrument_bytes ("scratch", gegl_node_get_operation (node),
+                                 scratch_allocated);
+        }
+
       GEGL_INSTRUMENT_END ("process", gegl_node_get_operation (node));
     }
   if (last_context)
@@ -43,6 +43,9 @@ void           gegl_processor_set_rectangle (GeglProcessor       *processor,
                                              const GeglRectangle *rectangle);
 gboolean       gegl_processor_work          (GeglProcessor       *processor,
                                              gdouble             *progress);
+
+void           gegl_processor_cleanup       (void);
+
 G_END_DECLS
 
 #endif /* __GEGL_PROCESSOR_PRIVATE_H__ */
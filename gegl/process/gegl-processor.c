@@ -32,6 +32,7 @@
 #include "operation/gegl-operation-sink.h"
 
 #include "gegl-config.h"
+#include "gegl-parallel-private.h"
 #include "gegl-processor.h"
 #include "gegl-processor-private.h"
 
@@ -86,9 +87,22 @@ struct _GeglProcessor
   gint             chunk_size;
 
   gdouble          progress;
+
+  /* asynchronous rendering */
+  gint                    priority;
+  volatile gint           cancelled;
+  gboolean                async_running;
+  GeglProcessorChunkFunc  chunk_func;
+  GeglProcessorDoneFunc   done_func;
+  gpointer                user_data;
 };
 
 
+static GThreadPool *async_pool     = NULL;
+static gboolean     async_shutdown = FALSE;
+G_LOCK_DEFINE_STATIC (async_pool);
+
+
 G_DEFINE_TYPE (GeglProcessor, gegl_processor, G_TYPE_OBJECT)
 
 
@@ -146,6 +160,7 @@ gegl_processor_init (GeglProcessor *processor)
   processor->context          = NULL;
   processor->queued_region    = NULL;
   processor->dirty_rectangles = NULL;
+  processor->priority         = G_PRIORITY_DEFAULT;
   //processor->chunk_size       = 128 * 128;
 }
 
@@ -227,7 +242,11 @@ gegl_processor_get_property (GObject    *gobject,
         g_value_set_int (value, self->chunk_size);
         break;
       case PROP_PROGRESS:
-        g_value_set_double (value, gegl_processor_progress (self));
+        /* the regions are being modified by the render thread */
+        if (self->async_running)
+          g_value_set_double (value, self->progress);
+        else
+          g_value_set_double (value, gegl_processor_progress (self));
         break;
 
       default:
@@ -514,9 +533,23 @@ render_rectangle (GeglProcessor *processor)
                               dr, format, NULL,
                               GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_CACHE);
 
-              /* tells the cache that the rectangle (dr) has been computed */
+              /* tells the cache that the rectangle (dr) has been computed,
+               * unless we were cancelled halfway through, in which case it
+               * stays dirty, for the next time the processor works. */
+              if (g_atomic_int_get (&processor->cancelled))
+                {
+                  processor->dirty_rectangles =
+                    g_slist_prepend (processor->dirty_rectangles, dr);
+
+                  return FALSE;
+                }
+
               gegl_cache_computed (cache, dr, processor->level);
             }
+
+          if (processor->chunk_func)
+            processor->chunk_func (processor, dr, processor->user_data);
+
           g_slice_free (GeglRectangle, dr);
         }
       else
@@ -524,7 +557,20 @@ render_rectangle (GeglProcessor *processor)
            gegl_node_blit (processor->real_node, 1.0/(1<<processor->level),
                            dr, NULL, NULL,
                            GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+
+           if (g_atomic_int_get (&processor->cancelled))
+             {
+               processor->dirty_rectangles =
+                 g_slist_prepend (processor->dirty_rectangles, dr);
+
+               return FALSE;
+             }
+
            gegl_region_union_with_rect (processor->valid_region, dr);
+
+           if (processor->chunk_func)
+             processor->chunk_func (processor, dr, processor->user_data);
+
            g_slice_free (GeglRectangle, dr);
         }
     }
@@ -836,3 +882,186 @@ void gegl_processor_set_scale (GeglProcessor *processor,
   processor->level = gegl_level_from_scale (scale);
   set_scaled_rectangle (processor);
 }
+
+
+/* lower values come first, like GSource priorities */
+static gint
+gegl_processor_async_compare (gconstpointer a,
+                              gconstpointer b,
+                              gpointer      user_data)
+{
+  gint priority_a = g_atomic_int_get (&((GeglProcessor *) a)->priority);
+  gint priority_b = g_atomic_int_get (&((GeglProcessor *) b)->priority);
+
+  return (priority_a > priority_b) - (priority_a < priority_b);
+}
+
+gint
+gegl_processor_get_priority (GeglProcessor *processor)
+{
+  g_return_val_if_fail (GEGL_IS_PROCESSOR (processor), G_PRIORITY_DEFAULT);
+
+  return g_atomic_int_get (&processor->priority);
+}
+
+void
+gegl_processor_set_priority (GeglProcessor *processor,
+                             gint           priority)
+{
+  g_return_if_fail (GEGL_IS_PROCESSOR (processor));
+
+  g_atomic_int_set (&processor->priority, priority);
+
+  /* the queue is only sorted as processors are pushed, sort it again so
+   * that a queued processor moves according to its new priority.
+   */
+  G_LOCK (async_pool);
+
+  if (async_pool)
+    {
+      g_thread_pool_set_sort_function (async_pool,
+                                       gegl_processor_async_compare, NULL);
+    }
+
+  G_UNLOCK (async_pool);
+}
+
+void
+gegl_processor_cancel (GeglProcessor *processor)
+{
+  g_return_if_fail (GEGL_IS_PROCESSOR (processor));
+
+  g_atomic_int_set (&processor->cancelled, TRUE);
+}
+
+gboolean
+gegl_processor_is_cancelled (GeglProcessor *processor)
+{
+  g_return_val_if_fail (GEGL_IS_PROCESSOR (processor), FALSE);
+
+  return g_atomic_int_get (&processor->cancelled);
+}
+
+/* renders a single chunk, and puts the processor back in the queue if there
+ * is more work to do.  this way, a higher-priority processor added while
+ * another one is rendering gets served starting with the next chunk.
+ */
+static void
+gegl_processor_async_func (GeglProcessor *processor,
+                           gpointer       user_data)
+{
+  gboolean more_work = FALSE;
+  gboolean cancelled;
+
+  /* processors still queued once the pool is being freed aren't rendered */
+  G_LOCK (async_pool);
+
+  if (async_shutdown)
+    g_atomic_int_set (&processor->cancelled, TRUE);
+
+  G_UNLOCK (async_pool);
+
+  if (! g_atomic_int_get (&processor->cancelled))
+    {
+      gdouble progress = processor->progress;
+
+      gegl_parallel_set_cancel_flag (&processor->cancelled);
+
+      more_work = gegl_processor_work (processor, &progress);
+
+      gegl_parallel_set_cancel_flag (NULL);
+
+      processor->progress = progress;
+    }
+
+  G_LOCK (async_pool);
+
+  if (async_shutdown)
+    g_atomic_int_set (&processor->cancelled, TRUE);
+
+  cancelled = g_atomic_int_get (&processor->cancelled);
+
+  if (more_work && ! cancelled)
+    {
+      g_thread_pool_push (async_pool, processor, NULL);
+
+      G_UNLOCK (async_pool);
+
+      return;
+    }
+
+  G_UNLOCK (async_pool);
+
+  if (! cancelled)
+    processor->progress = 1.0;
+
+  processor->async_running = FALSE;
+
+  if (processor->done_func)
+    processor->done_func (processor, cancelled, processor->user_data);
+
+  processor->chunk_func = NULL;
+  processor->done_func  = NULL;
+  processor->user_data  = NULL;
+
+  g_object_unref (processor);
+}
+
+void
+gegl_processor_work_async (GeglProcessor          *processor,
+                           GeglProcessorChunkFunc  chunk_func,
+                           GeglProcessorDoneFunc   done_func,
+                           gpointer                user_data)
+{
+  g_return_if_fail (GEGL_IS_PROCESSOR (processor));
+  g_return_if_fail (! processor->async_running);
+
+  processor->chunk_func    = chunk_func;
+  processor->done_func     = done_func;
+  processor->user_data     = user_data;
+  processor->progress      = 0.0;
+  processor->async_running = TRUE;
+
+  g_atomic_int_set (&processor->cancelled, FALSE);
+
+  G_LOCK (async_pool);
+
+  if (! async_pool)
+    {
+      /* a single render thread; the renders themselves are parallelized
+       * through gegl_parallel_distribute().
+       */
+      async_pool = g_thread_pool_new (
+        (GFunc) gegl_processor_async_func, NULL,
+        1, FALSE, NULL);
+
+      g_thread_pool_set_sort_function (async_pool,
+                                       gegl_processor_async_compare, NULL);
+    }
+
+  g_thread_pool_push (async_pool, g_object_ref (processor), NULL);
+
+  G_UNLOCK (async_pool);
+}
+
+void
+gegl_processor_cleanup (void)
+{
+  GThreadPool *pool;
+
+  G_LOCK (async_pool);
+
+  async_shutdown = TRUE;
+  pool           = async_pool;
+  async_pool     = NULL;
+
+  G_UNLOCK (async_pool);
+
+  /* let the pending processors see the shutdown flag, so that their done
+   * functions are called and their references dropped.
+   */
+  if (pool)
+    g_thread_pool_free (pool, FALSE, TRUE);
+
+  async_shutdown = FALSE;
+}
@@ -92,6 +92,89 @@ gboolean       gegl_processor_work          (GeglProcessor *processor,
 GeglBuffer *gegl_processor_get_buffer (GeglProcessor *processor);
 
 
+/**
+ * GeglProcessorChunkFunc:
+ * @processor: the #GeglProcessor doing the work
+ * @rectangle: the area that has finished rendering
+ * @user_data: user data pointer
+ *
+ * Specifies the type of function passed to gegl_processor_work_async(),
+ * called each time a chunk of the processor's rectangle has been rendered.
+ * @rectangle is in the coordinates of the processor's level.
+ */
+typedef void (* GeglProcessorChunkFunc) (GeglProcessor       *processor,
+                                         const GeglRectangle *rectangle,
+                                         gpointer             user_data);
+
+/**
+ * GeglProcessorDoneFunc:
+ * @processor: the #GeglProcessor doing the work
+ * @cancelled: whether the processor was cancelled before finishing
+ * @user_data: user data pointer
+ *
+ * Specifies the type of function passed to gegl_processor_work_async(),
+ * called once the processor has no more work to do, or was cancelled.
+ */
+typedef void (* GeglProcessorDoneFunc)  (GeglProcessor       *processor,
+                                         gboolean             cancelled,
+                                         gpointer             user_data);
+
+/**
+ * gegl_processor_work_async:
+ * @processor: a #GeglProcessor
+ * @chunk_func: (nullable) (scope notified) (closure user_data): function
+ * called for each rendered chunk
+ * @done_func: (nullable) (scope notified) (closure user_data): function
+ * called when the processor is done
+ * @user_data: user data to pass to the functions
+ *
+ * Renders the processor's rectangle in the background.  Work is split
+ * into chunks, and all asynchronous processors share a single render
+ * thread which picks the next chunk from the processor with the highest
+ * priority, see gegl_processor_set_priority().  Rendering stops early when
+ * gegl_processor_cancel() is called.
+ *
+ * Both callbacks are invoked from the render thread.  The graph must not
+ * be modified until @done_func has been called.
+ */
+void           gegl_processor_work_async    (GeglProcessor          *processor,
+                                             GeglProcessorChunkFunc  chunk_func,
+                                             GeglProcessorDoneFunc   done_func,
+                                             gpointer                user_data);
+
+/**
+ * gegl_processor_set_priority:
+ * @processor: a #GeglProcessor
+ * @priority: the new priority
+ *
+ * Sets the priority of an asynchronous processor.  As with #GMainContext
+ * sources, lower values mean higher priority; the default is
+ * %G_PRIORITY_DEFAULT.  The new priority takes effect with the next chunk.
+ */
+void           gegl_processor_set_priority  (GeglProcessor *processor,
+                                             gint           priority);
+gint           gegl_processor_get_priority  (GeglProcessor *processor);
+
+/**
+ * gegl_processor_cancel:
+ * @processor: a #GeglProcessor
+ *
+ * Aborts the processor's asynchronous rendering.  Work already in flight
+ * stops at the next tile boundary, and the partially rendered chunk is
+ * not marked valid in the cache.  The done function passed to
+ * gegl_processor_work_async() is called with @cancelled set.
+ */
+void           gegl_processor_cancel        (GeglProcessor *processor);
+
+/**
+ * gegl_processor_is_cancelled:
+ * @processor: a #GeglProcessor
+ *
+ * Returns: TRUE if gegl_processor_cancel() was called on @processor.
+ */
+gboolean       gegl_processor_is_cancelled  (GeglProcessor *processor);
+
+
 G_END_DECLS
 
 #endif /* __GEGL_PROCESSOR_H__ */
@@ -0,0 +1,344 @@
+/* This file is an image processing operation for GEGL
+ *
+ * GEGL is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * GEGL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <glib/gi18n-lib.h>
+
+#ifdef GEGL_PROPERTIES
+
+property_boolean (normalize, _("Normalize"), TRUE)
+  description (_("Scale the kernel so that its values sum to 1"))
+
+property_boolean (clip, _("Clip to input extents"), TRUE)
+  description (_("Clip output to the input extents"))
+
+#else
+
+#define GEGL_OP_COMPOSER
+#define GEGL_OP_NAME     convolve
+#define GEGL_OP_C_SOURCE convolve.c
+
+#include "gegl-op.h"
+#include "fft-convolve.h"
+
+/* the largest kernel side */
+#define MAX_KERNEL_SIZE 1024
+
+static void
+prepare (GeglOperation *operation)
+{
+  const Babl *space  = gegl_operation_get_source_space (operation, "input");
+  const Babl *format = babl_format_with_space ("RaGaBaA float", space);
+
+  gegl_operation_set_format (operation, "input",  format);
+  gegl_operation_set_format (operation, "output", format);
+  gegl_operation_set_format (operation, "aux",
+                             babl_format_with_space (
+                               "Y float",
+                               gegl_operation_get_source_space (operation,
+                                                                "aux")));
+}
+
+/* returns the extent of the kernel, or NULL if there is no usable one */
+static const GeglRectangle *
+get_kernel_rect (GeglOperation *operation)
+{
+  const GeglRectangle *aux_rect;
+
+  aux_rect = gegl_operation_source_get_bounding_box (operation, "aux");
+
+  if (! aux_rect                                 ||
+      gegl_rectangle_is_empty (aux_rect)         ||
+      gegl_rectangle_is_infinite_plane (aux_rect) ||
+      aux_rect->width  > MAX_KERNEL_SIZE         ||
+      aux_rect->height > MAX_KERNEL_SIZE)
+    {
+      return NULL;
+    }
+
+  return aux_rect;
+}
+
+/* grows @rect by the reach of the kernel, whose origin is at its center,
+ * or by its mirror image.
+ */
+static GeglRectangle
+grow_rect (const GeglRectangle *rect,
+           const GeglRectangle *kernel_rect,
+           gboolean             mirror)
+{
+  GeglRectangle result = *rect;
+  gint          left   = kernel_rect->width  / 2;
+  gint          top    = kernel_rect->height / 2;
+
+  if (mirror)
+    {
+      left = kernel_rect->width  - 1 - left;
+      top  = kernel_rect->height - 1 - top;
+    }
+
+  result.x      -= left;
+  result.y      -= top;
+  result.width  += kernel_rect->width  - 1;
+  result.height += kernel_rect->height - 1;
+
+  return result;
+}
+
+static GeglRectangle
+get_bounding_box (GeglOperation *operation)
+{
+  GeglProperties      *o           = GEGL_PROPERTIES (operation);
+  const GeglRectangle *in_rect;
+  const GeglRectangle *kernel_rect = get_kernel_rect (operation);
+  GeglRectangle        result      = { 0, };
+
+  in_rect = gegl_operation_source_get_bounding_box (operation, "input");
+
+  if (in_rect)
+    {
+      result = *in_rect;
+
+      if (! o->clip && kernel_rect &&
+          ! gegl_rectangle_is_infinite_plane (in_rect))
+        {
+          result = grow_rect (in_rect, kernel_rect, TRUE);
+        }
+    }
+
+  return result;
+}
+
+static GeglRectangle
+get_required_for_output (GeglOperation       *operation,
+                         const gchar         *input_pad,
+                         const GeglRectangle *roi)
+{
+  const GeglRectangle *kernel_rect = get_kernel_rect (operation);
+
+  if (! strcmp (input_pad, "aux"))
+    {
+      if (kernel_rect)
+        return *kernel_rect;
+
+      return *GEGL_RECTANGLE (0, 0, 0, 0);
+    }
+
+  if (! kernel_rect)
+    return *roi;
+
+  return grow_rect (roi, kernel_rect, FALSE);
+}
+
+static GeglRectangle
+get_invalidated_by_change (GeglOperation       *operation,
+                           const gchar         *input_pad,
+                           const GeglRectangle *input_region)
+{
+  const GeglRectangle *kernel_rect = get_kernel_rect (operation);
+
+  if (! strcmp (input_pad, "aux"))
+    return get_bounding_box (operation);
+
+  if (! kernel_rect)
+    return *input_region;
+
+  return grow_rect (input_region, kernel_rect, TRUE);
+}
+
+static gboolean
+operation_process (GeglOperation        *operation,
+                   GeglOperationContext *context,
+                   const gchar          *output_prop,
+                   const GeglRectangle  *roi,
+                   gint                  level)
+{
+  const GeglRectangle *in_rect;
+
+  in_rect = gegl_operation_source_get_bounding_box (operation, "input");
+
+  if (! get_kernel_rect (operation) ||
+      (in_rect && gegl_rectangle_is_infinite_plane (in_rect)))
+    {
+      gegl_operation_context_set_object (
+        context, "output",
+        gegl_operation_context_get_object (context, "input"));
+
+      return TRUE;
+    }
+
+  return GEGL_OPERATION_CLASS (gegl_op_parent_class)->process (
+    operation, context, output_prop, roi, level);
+}
+
+static void
+convolve_direct (const gfloat *kernel,
+                 gint          kernel_width,
+                 gint          kernel_height,
+                 const gfloat *src,
+                 gint          src_stride,
+                 gfloat       *dst,
+                 gint          width,
+                 gint          height)
+{
+  gint y;
+
+  memset (dst, 0, 4 * sizeof (gfloat) * width * height);
+
+  for (y = 0; y < height; y++)
+    {
+      gfloat *d = dst + 4 * y * width;
+      gint    i, j;
+
+      for (j = 0; j < kernel_height; j++)
+        {
+          const gfloat *s = src + (y + j) * src_stride;
+
+          for (i = 0; i < kernel_width; i++, s += 4)
+            {
+              gfloat k = kernel[j * kernel_width + i];
+              gint   x;
+
+              if (k == 0.0f)
+                continue;
+
+              for (x = 0; x < 4 * width; x++)
+                d[x] += k * s[x];
+            }
+        }
+    }
+}
+
+static gboolean
+process (GeglOperation       *operation,
+         GeglBuffer          *input,
+         GeglBuffer          *aux,
+         GeglBuffer          *output,
+         const GeglRectangle *roi,
+         gint                 level)
+{
+  GeglProperties      *o           = GEGL_PROPERTIES (operation);
+  const Babl          *format      = gegl_operation_get_format (operation, "output");
+  const Babl          *aux_format  = gegl_operation_get_format (operation, "aux");
+  const GeglRectangle *kernel_rect = get_kernel_rect (operation);
+  GeglRectangle        src_rect;
+  gint                 kernel_width;
+  gint                 kernel_height;
+  gint                 n_kernel;
+  gfloat              *kernel;
+  gfloat              *src;
+  gfloat              *dst;
+  gint                 i;
+
+  if (! aux || ! kernel_rect)
+    {
+      gegl_buffer_copy (input, roi, GEGL_ABYSS_NONE, output, roi);
+
+      return TRUE;
+    }
+
+  kernel_width  = kernel_rect->width;
+  kernel_height = kernel_rect->height;
+  n_kernel      = kernel_width * kernel_height;
+
+  kernel = g_new (gfloat, n_kernel);
+
+  gegl_buffer_get (aux, kernel_rect, 1.0, aux_format, kernel,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  if (o->normalize)
+    {
+      gdouble sum = 0.0;
+
+      for (i = 0; i < n_kernel; i++)
+        sum += kernel[i];
+
+      if (fabs (sum) > 1e-6)
+        {
+          for (i = 0; i < n_kernel; i++)
+            kernel[i] /= sum;
+        }
+    }
+
+  src_rect = grow_rect (roi, kernel_rect, FALSE);
+
+  src = gegl_malloc (4 * sizeof (gfloat) * src_rect.width * src_rect.height);
+  dst = gegl_malloc (4 * sizeof (gfloat) * roi->width * roi->height);
+
+  gegl_buffer_get (input, &src_rect, 1.0, format, src,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  /* the direct convolution costs a multiply-add per kernel value */
+  if (fft_convolve_get_cost (kernel_width, kernel_height,
+                             roi->width, roi->height) < n_kernel)
+    {
+      FftConvolve *conv;
+
+      conv = fft_convolve_new (kernel, kernel_width, kernel_height,
+                               kernel_width / 2, kernel_height / 2,
+                               roi->width, roi->height);
+
+      fft_convolve_process (conv, src, 4 * src_rect.width,
+                            dst, 4 * roi->width,
+                            roi->width, roi->height, 4,
+                            gegl_operation_get_pixels_per_thread (operation));
+
+      fft_convolve_free (conv);
+    }
+  else
+    {
+      convolve_direct (kernel, kernel_width, kernel_height,
+                       src, 4 * src_rect.width,
+                       dst, roi->width, roi->height);
+    }
+
+  gegl_buffer_set (output, roi, 0, format, dst, GEGL_AUTO_ROWSTRIDE);
+
+  gegl_free (dst);
+  gegl_free (src);
+  g_free (kernel);
+
+  return TRUE;
+}
+
+static void
+gegl_op_class_init (GeglOpClass *klass)
+{
+  GeglOperationClass         *operation_class;
+  GeglOperationComposerClass *composer_class;
+
+  operation_class = GEGL_OPERATION_CLASS (klass);
+  composer_class  = GEGL_OPERATION_COMPOSER_CLASS (klass);
+
+  operation_class->prepare                   = prepare;
+  operation_class->get_bounding_box          = get_bounding_box;
+  operation_class->get_required_for_output   = get_required_for_output;
+  operation_class->get_invalidated_by_change = get_invalidated_by_change;
+  operation_class->process                   = operation_process;
+
+  composer_class->process                    = process;
+
+  gegl_operation_class_set_keys (operation_class,
+    "name",        "gegl:convolve",
+    "title",       _("Convolve"),
+    "categories",  "blur",
+    "description", _("Convolve the input with the kernel given by the "
+                     "luminance of the aux input, centered on its extent. "
+                     "Large kernels are convolved through the FFT"),
+    NULL);
+}
+
+#endif
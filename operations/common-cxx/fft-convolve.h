@@ -0,0 +1,479 @@
+/* This file is an image processing operation for GEGL
+ *
+ * GEGL is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * GEGL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* FFT convolution of interleaved float pixel data with a large kernel,
+ * shared by the operations of this directory.
+ *
+ * The area is split into blocks, each convolved on its own using
+ * overlap-save: the block, together with the margin the kernel reaches
+ * into, is transformed, multiplied by the spectrum of the kernel and
+ * transformed back, keeping the part unaffected by wrap-around.  Blocks
+ * are distributed over the worker threads.  Since the kernel is real, the
+ * channels are transformed in pairs, as the real and imaginary parts of a
+ * single complex transform.
+ *
+ * The result is the correlation of the data with the kernel:
+ *
+ *   dst(x, y) = sum k(i, j) * src(x + i - origin_x, y + j - origin_y)
+ */
+
+#include <math.h>
+#include <string.h>
+
+/* the largest transform size tried */
+#define FFT_CONVOLVE_MAX_SIZE         1024
+
+typedef struct
+{
+  gint    n;           /* transform size, a power of 2 */
+  gint   *bit_reverse;
+  gfloat *twiddles;    /* n / 2 complex values, exp (-2 pi i k / n) */
+} FftPlan;
+
+typedef struct
+{
+  FftPlan  plan;
+  gint     kernel_width;
+  gint     kernel_height;
+  gint     origin_x;
+  gint     origin_y;
+  gint     block_width;
+  gint     block_height;
+  /* the transposed spectrum of the kernel, scaled by 1 / n^2 */
+  gfloat  *spectrum;
+} FftConvolve;
+
+static void
+fft_plan_init (FftPlan *plan,
+               gint     n)
+{
+  gint log2_n = 0;
+  gint i;
+
+  while ((1 << log2_n) < n)
+    log2_n++;
+
+  plan->n           = n;
+  plan->bit_reverse = g_new (gint, n);
+  plan->twiddles    = g_new (gfloat, n);
+
+  for (i = 0; i < n; i++)
+    {
+      gint r = 0;
+      gint b;
+
+      for (b = 0; b < log2_n; b++)
+        r |= ((i >> b) & 1) << (log2_n - 1 - b);
+
+      plan->bit_reverse[i] = r;
+    }
+
+  for (i = 0; i < n / 2; i++)
+    {
+      plan->twiddles[2 * i]     = cos (-2.0 * G_PI * i / n);
+      plan->twiddles[2 * i + 1] = sin (-2.0 * G_PI * i / n);
+    }
+}
+
+static void
+fft_plan_clear (FftPlan *plan)
+{
+  g_free (plan->bit_reverse);
+  g_free (plan->twiddles);
+}
+
+/* in-place transform of the plan->n interleaved complex values of @data */
+static void
+fft_transform (const FftPlan *plan,
+               gfloat        *data,
+               gboolean       inverse)
+{
+  const gint    n    = plan->n;
+  const gfloat *tw   = plan->twiddles;
+  const gfloat  sign = inverse ? -1.0f : 1.0f;
+  gint          size;
+  gint          i;
+
+  for (i = 0; i < n; i++)
+    {
+      gint j = plan->bit_reverse[i];
+
+      if (i < j)
+        {
+          gfloat re = data[2 * i];
+          gfloat im = data[2 * i + 1];
+
+          data[2 * i]     = data[2 * j];
+          data[2 * i + 1] = data[2 * j + 1];
+          data[2 * j]     = re;
+          data[2 * j + 1] = im;
+        }
+    }
+
+  for (size = 2; size <= n; size *= 2)
+    {
+      gint half = size / 2;
+      gint step = n / size;
+      gint start;
+
+      for (start = 0; start < n; start += size)
+        {
+          gfloat *a = data + 2 * start;
+          gfloat *b = a    + 2 * half;
+          gint    k;
+
+          for (k = 0; k < half; k++)
+            {
+              gfloat wr = tw[2 * k * step];
+              gfloat wi = tw[2 * k * step + 1] * sign;
+              gfloat tr = b[2 * k] * wr - b[2 * k + 1] * wi;
+              gfloat ti = b[2 * k] * wi + b[2 * k + 1] * wr;
+
+              b[2 * k]     = a[2 * k]     - tr;
+              b[2 * k + 1] = a[2 * k + 1] - ti;
+              a[2 * k]     += tr;
+              a[2 * k + 1] += ti;
+            }
+        }
+    }
+}
+
+/* transforms rows @first to @last, exclusive, of the n x n @data */
+static void
+fft_transform_rows (const FftPlan *plan,
+                    gfloat        *data,
+                    gint           first,
+                    gint           last,
+                    gboolean       inverse)
+{
+  gint y;
+
+  for (y = first; y < last; y++)
+    fft_transform (plan, data + 2 * y * plan->n, inverse);
+}
+
+static void
+fft_transpose (const FftPlan *plan,
+               gfloat        *data)
+{
+  const gint n = plan->n;
+  gint       x, y;
+
+  for (y = 0; y < n; y++)
+    {
+      for (x = y + 1; x < n; x++)
+        {
+          gfloat *a  = data + 2 * (y * n + x);
+          gfloat *b  = data + 2 * (x * n + y);
+          gfloat  re = a[0];
+          gfloat  im = a[1];
+
+          a[0] = b[0];
+          a[1] = b[1];
+          b[0] = re;
+          b[1] = im;
+        }
+    }
+}
+
+/* the cost, in multiply-adds per pixel and channel, of convolving a
+ * @width x @height area using transforms of size @n.
+ */
+static gdouble
+fft_convolve_get_size_cost (gint kernel_width,
+                            gint kernel_height,
+                            gint width,
+                            gint height,
+                            gint n)
+{
+  gint    block_width  = n - kernel_width  + 1;
+  gint    block_height = n - kernel_height + 1;
+  gint    n_blocks;
+  gdouble log2_n       = log2 (n);
+
+  if (block_width < 1 || block_height < 1)
+    return G_MAXDOUBLE;
+
+  n_blocks = ((width  + block_width  - 1) / block_width) *
+             ((height + block_height - 1) / block_height);
+
+  /* a forward and an inverse 2D transform, n^2 log2 (n) butterflies each,
+   * and the product of the spectra, for every pair of channels.
+   */
+  return n_blocks * (gdouble) n * n * (5.0 * log2_n + 1.5) /
+         ((gdouble) width * height);
+}
+
+static gint
+fft_convolve_get_size (gint kernel_width,
+                       gint kernel_height,
+                       gint width,
+                       gint height)
+{
+  gint    best_n    = 0;
+  gdouble best_cost = G_MAXDOUBLE;
+  gint    n;
+
+  for (n = 2; n <= FFT_CONVOLVE_MAX_SIZE; n *= 2)
+    {
+      gdouble cost = fft_convolve_get_size_cost (kernel_width, kernel_height,
+                                                 width, height, n);
+
+      if (cost < best_cost)
+        {
+          best_n    = n;
+          best_cost = cost;
+        }
+    }
+
+  return best_n;
+}
+
+/* Returns the cost, in multiply-adds per pixel and channel, of convolving
+ * a @width x @height area with a @kernel_width x @kernel_height kernel,
+ * to be compared against the cost of a direct convolution.
+ */
+static gdouble
+fft_convolve_get_cost (gint kernel_width,
+                       gint kernel_height,
+                       gint width,
+                       gint height)
+{
+  gint n;
+
+  if (width <= 0 || height <= 0)
+    return G_MAXDOUBLE;
+
+  n = fft_convolve_get_size (kernel_width, kernel_height, width, height);
+
+  if (! n)
+    return G_MAXDOUBLE;
+
+  return fft_convolve_get_size_cost (kernel_width, kernel_height,
+                                     width, height, n);
+}
+
+/* Prepares the convolution of a @width x @height area with the
+ * @kernel_width x @kernel_height @kernel, whose origin is at
+ * (@origin_x, @origin_y).  Returns NULL if the kernel is too large.
+ */
+static FftConvolve *
+fft_convolve_new (const gfloat *kernel,
+                  gint          kernel_width,
+                  gint          kernel_height,
+                  gint          origin_x,
+                  gint          origin_y,
+                  gint          width,
+                  gint          height)
+{
+  FftConvolve *conv;
+  gfloat       scale;
+  gint         n;
+  gint         i, j;
+
+  n = fft_convolve_get_size (kernel_width, kernel_height, width, height);
+
+  if (! n)
+    return NULL;
+
+  conv = g_slice_new (FftConvolve);
+
+  fft_plan_init (&conv->plan, n);
+
+  conv->kernel_width  = kernel_width;
+  conv->kernel_height = kernel_height;
+  conv->origin_x      = origin_x;
+  conv->origin_y      = origin_y;
+  conv->block_width   = n - kernel_width  + 1;
+  conv->block_height  = n - kernel_height + 1;
+  conv->spectrum      = g_new0 (gfloat, 2 * n * n);
+
+  /* the kernel is mirrored around its origin, wrapping around, so that the
+   * circular convolution computes the correlation.
+   */
+  scale = 1.0f / ((gfloat) n * n);
+
+  for (j = 0; j < kernel_height; j++)
+    {
+      gint y = (origin_y - j + n) % n;
+
+      for (i = 0; i < kernel_width; i++)
+        {
+          gint x = (origin_x - i + n) % n;
+
+          conv->spectrum[2 * (y * n + x)] = kernel[j * kernel_width + i] *
+                                            scale;
+        }
+    }
+
+  fft_transform_rows (&conv->plan, conv->spectrum, 0, n, FALSE);
+  fft_transpose (&conv->plan, conv->spectrum);
+  fft_transform_rows (&conv->plan, conv->spectrum, 0, n, FALSE);
+
+  return conv;
+}
+
+static void
+fft_convolve_free (FftConvolve *conv)
+{
+  fft_plan_clear (&conv->plan);
+  g_free (conv->spectrum);
+
+  g_slice_free (FftConvolve, conv);
+}
+
+typedef struct
+{
+  const FftConvolve *conv;
+  const gfloat      *src;
+  gint               src_stride;
+  gint               src_width;
+  gint               src_height;
+  gfloat            *dst;
+  gint               dst_stride;
+  gint               width;
+  gint               height;
+  gint               n_components;
+  gint               n_blocks_x;
+} FftConvolveData;
+
+static void
+fft_convolve_blocks (gsize    offset,
+                     gsize    size,
+                     gpointer user_data)
+{
+  const FftConvolveData *data = (const FftConvolveData *) user_data;
+  const FftConvolve     *conv = data->conv;
+  const FftPlan         *plan = &conv->plan;
+  const gint             n    = plan->n;
+  gfloat                *tile;
+  gsize                  block;
+
+  tile = (gfloat *) gegl_malloc (2 * sizeof (gfloat) * n * n);
+
+  for (block = offset; block < offset + size; block++)
+    {
+      gint bx     = (block % data->n_blocks_x) * conv->block_width;
+      gint by     = (block / data->n_blocks_x) * conv->block_height;
+      gint bw     = MIN (conv->block_width,  data->width  - bx);
+      gint bh     = MIN (conv->block_height, data->height - by);
+      gint rows   = MIN (n, data->src_height - by);
+      gint cols   = MIN (n, data->src_width  - bx);
+      gint c;
+
+      for (c = 0; c < data->n_components; c += 2)
+        {
+          gboolean pair = c + 1 < data->n_components;
+          gint     x, y;
+
+          memset (tile, 0, 2 * sizeof (gfloat) * n * n);
+
+          for (y = 0; y < rows; y++)
+            {
+              const gfloat *s = data->src + (gsize) (by + y) * data->src_stride +
+                                (gsize) bx * data->n_components + c;
+              gfloat       *t = tile + 2 * y * n;
+
+              for (x = 0; x < cols; x++, s += data->n_components)
+                {
+                  t[2 * x] = s[0];
+
+                  if (pair)
+                    t[2 * x + 1] = s[1];
+                }
+            }
+
+          /* rows past the source are zero, as are their transforms */
+          fft_transform_rows (plan, tile, 0, rows, FALSE);
+          fft_transpose (plan, tile);
+          fft_transform_rows (plan, tile, 0, n, FALSE);
+
+          for (x = 0; x < n * n; x++)
+            {
+              gfloat re = tile[2 * x];
+              gfloat im = tile[2 * x + 1];
+              gfloat kr = conv->spectrum[2 * x];
+              gfloat ki = conv->spectrum[2 * x + 1];
+
+              tile[2 * x]     = re * kr - im * ki;
+              tile[2 * x + 1] = re * ki + im * kr;
+            }
+
+          /* only the rows of the block are needed out of the last pass */
+          fft_transform_rows (plan, tile, 0, n, TRUE);
+          fft_transpose (plan, tile);
+          fft_transform_rows (plan, tile,
+                              conv->origin_y, conv->origin_y + bh, TRUE);
+
+          for (y = 0; y < bh; y++)
+            {
+              const gfloat *t = tile + 2 * ((conv->origin_y + y) * n +
+                                            conv->origin_x);
+              gfloat       *d = data->dst + (gsize) (by + y) * data->dst_stride +
+                                (gsize) bx * data->n_components + c;
+
+              for (x = 0; x < bw; x++, d += data->n_components)
+                {
+                  d[0] = t[2 * x];
+
+                  if (pair)
+                    d[1] = t[2 * x + 1];
+                }
+            }
+        }
+    }
+
+  gegl_free (tile);
+}
+
+/* Convolves the @n_components interleaved channels of @src, which covers
+ * the @width x @height result area together with the margins the kernel
+ * reaches into, with the kernel, storing the result in @dst.  Strides are
+ * in floats.  @pixels_per_thread is the calling operation's
+ * gegl_operation_get_pixels_per_thread().
+ */
+static void
+fft_convolve_process (const FftConvolve *conv,
+                      const gfloat      *src,
+                      gint               src_stride,
+                      gfloat            *dst,
+                      gint               dst_stride,
+                      gint               width,
+                      gint               height,
+                      gint               n_components,
+                      gdouble            pixels_per_thread)
+{
+  FftConvolveData data;
+  gint            n_blocks_y;
+
+  data.conv         = conv;
+  data.src          = src;
+  data.src_stride   = src_stride;
+  data.src_width    = width  + conv->kernel_width  - 1;
+  data.src_height   = height + conv->kernel_height - 1;
+  data.dst          = dst;
+  data.dst_stride   = dst_stride;
+  data.width        = width;
+  data.height       = height;
+  data.n_components = n_components;
+  data.n_blocks_x   = (width  + conv->block_width  - 1) / conv->block_width;
+  n_blocks_y        = (height + conv->block_height - 1) / conv->block_height;
+
+  gegl_parallel_distribute_range (
+    data.n_blocks_x * n_blocks_y,
+    pixels_per_thread / (conv->block_width * conv->block_height),
+    fft_convolve_blocks, &data);
+}
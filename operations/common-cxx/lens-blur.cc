@@ -56,6 +56,7 @@ property_boolean (linear_mask, _("Linear mask"), FALSE)
 #define GEGL_OP_C_SOURCE lens-blur.cc
 
 #include "gegl-op.h"
+#include "fft-convolve.h"
 
 static void
 prepare (GeglOperation *operation)
@@ -192,21 +193,6 @@ process (GeglOperation       *operation,
         gegl_operation_source_get_bounding_box (operation, "input"));
     }
 
-  size = MIN (size, rect.height);
-
-  in    = (gfloat *) gegl_malloc (4 * sizeof (gfloat) * rect.width * size);
-  in_w  = (gfloat *) gegl_malloc (    sizeof (gfloat) * rect.width * size);
-  out   = (gfloat *) gegl_malloc (4 * sizeof (gfloat) * roi->width);
-  out_w = (gfloat *) gegl_malloc (    sizeof (gfloat) * roi->width);
-
-  if (aux)
-    mask = (gfloat *) gegl_malloc (sizeof (gfloat) * rect.width * size);
-
-  auto row_index = [&] (gint y)
-  {
-    return (y - rect.y) % size;
-  };
-
   auto weight = [&] (gfloat v)
   {
     v = (v                        - highlight_threshold_low) /
@@ -220,6 +206,131 @@ process (GeglOperation       *operation,
     return expf (v * highlight_factor);
   };
 
+  /* convolving with a large disk is cheaper through the FFT, whose cost
+   * doesn't depend on the radius.  this doesn't apply to the per-pixel
+   * radius of a mask.
+   */
+  if (! aux &&
+      fft_convolve_get_cost (size, size, roi->width, roi->height) < 2.0 * size)
+    {
+      FftConvolve *conv;
+      gfloat      *kernel;
+      gfloat      *src;
+      gfloat      *dst;
+      gint         src_width  = roi->width  + 2 * iradius;
+      gint         src_height = roi->height + 2 * iradius;
+      gint         n          = rect.width * rect.height;
+      gint         i;
+
+      kernel = g_new0 (gfloat, size * size);
+
+      for (y = -iradius; y <= iradius; y++)
+        {
+          gint s = sqrtf ((radius + 0.5f) * (radius + 0.5f) - y * y);
+          gint x;
+
+          for (x = -s; x <= s; x++)
+            kernel[(y + iradius) * size + (x + iradius)] = 1.0f;
+        }
+
+      /* the disk is convolved with the premultiplied, weighted, pixels and
+       * with their weights, out of the input area being zero.
+       */
+      src = (gfloat *) gegl_calloc (5 * sizeof (gfloat),
+                                    src_width * src_height);
+
+      if (n > 0)
+        {
+          in   = (gfloat *) gegl_malloc (4 * sizeof (gfloat) * n);
+          in_w = (gfloat *) gegl_malloc (    sizeof (gfloat) * n);
+
+          gegl_buffer_get (input, &rect, 1.0, format, in,
+                           GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+          if (highlight_factor)
+            {
+              babl_process (weight_fish, in, in_w, n);
+            }
+          else
+            {
+              gfloat w = 1.0f;
+
+              gegl_memset_pattern (in_w, &w, sizeof (gfloat), n);
+            }
+
+          for (i = 0; i < n; i++)
+            {
+              gfloat *s = src + 5 * ((i / rect.width + rect.y - roi->y + iradius) *
+                                     src_width +
+                                     (i % rect.width + rect.x - roi->x + iradius));
+              gint    c;
+
+              if (highlight_factor)
+                in_w[i] = weight (in_w[i]);
+
+              s[3] = in[4 * i + 3] * in_w[i];
+
+              for (c = 0; c < 3; c++)
+                s[c] = in[4 * i + c] * s[3];
+
+              s[4] = in_w[i];
+            }
+
+          gegl_free (in_w);
+          gegl_free (in);
+        }
+
+      dst  = (gfloat *) gegl_malloc (5 * sizeof (gfloat) *
+                                     roi->width * roi->height);
+
+      conv = fft_convolve_new (kernel, size, size, iradius, iradius,
+                               roi->width, roi->height);
+      fft_convolve_process (conv, src, 5 * src_width, dst, 5 * roi->width,
+                            roi->width, roi->height, 5,
+                            gegl_operation_get_pixels_per_thread (operation));
+      fft_convolve_free (conv);
+
+      out = (gfloat *) gegl_malloc (4 * sizeof (gfloat) *
+                                    roi->width * roi->height);
+
+      for (i = 0; i < roi->width * roi->height; i++)
+        {
+          gint c;
+
+          for (c = 0; c < 3; c++)
+            out[4 * i + c] = dst[5 * i + c] / dst[5 * i + 3];
+
+          out[4 * i + 3] = dst[5 * i + 3] / dst[5 * i + 4];
+        }
+
+      gegl_buffer_set (output, roi, 0, format, out, GEGL_AUTO_ROWSTRIDE);
+
+      gegl_free (out);
+      gegl_free (dst);
+      gegl_free (src);
+      g_free (kernel);
+
+      return TRUE;
+    }
+
+  size = MIN (size, rect.height);
+
+  /* the row buffers are freed by gegl_scratch_end() */
+  gegl_scratch_begin ();
+
+  in    = gegl_scratch_new (gfloat, 4 * rect.width * size);
+  in_w  = gegl_scratch_new (gfloat,     rect.width * size);
+  out   = gegl_scratch_new (gfloat, 4 * roi->width);
+  out_w = gegl_scratch_new (gfloat,     roi->width);
+
+  if (aux)
+    mask = gegl_scratch_new (gfloat, rect.width * size);
+
+  auto row_index = [&] (gint y)
+  {
+    return (y - rect.y) % size;
+  };
+
   auto read = [&] (gint y,
                    gint height)
   {
@@ -473,11 +584,7 @@ process (GeglOperation       *operation,
         read ((y + 1) + iradius, 1);
     }
 
-  gegl_free (mask);
-  gegl_free (out_w);
-  gegl_free (out);
-  gegl_free (in_w);
-  gegl_free (in);
+  gegl_scratch_end ();
 
   return TRUE;
 }
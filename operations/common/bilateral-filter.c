@@ -18,11 +18,18 @@
  */
 
 #include "config.h"
+#include <string.h>
 #include <glib/gi18n-lib.h>
 
 
 #ifdef GEGL_PROPERTIES
 
+enum_start (gegl_bilateral_filter_method)
+  enum_value (GEGL_BILATERAL_FILTER_AUTO,    "auto",    N_("Auto"))
+  enum_value (GEGL_BILATERAL_FILTER_EXACT,   "exact",   N_("Exact"))
+  enum_value (GEGL_BILATERAL_FILTER_LATTICE, "lattice", N_("Permutohedral lattice"))
+enum_end (GeglBilateralFilterMethod)
+
 property_double (blur_radius, _("Blur radius"), 4.0)
   description(_("Radius of square pixel region, (width and height will be radius*2+1)."))
   value_range   (0.0, 1000.0)
@@ -33,6 +40,14 @@ property_double (edge_preservation, _("Edge preservation"), 8.0)
   description   (_("Amount of edge preservation"))
   value_range   (0.0, 100.0)
 
+property_enum (method, _("Method"),
+               GeglBilateralFilterMethod, gegl_bilateral_filter_method,
+               GEGL_BILATERAL_FILTER_EXACT)
+  description (_("How the filter is computed: exactly, summing the whole "
+                 "pixel region, approximated on a lattice, in time "
+                 "independent of the radius, or automatically, using the "
+                 "lattice for large radii"))
+
 #else
 
 #define GEGL_OP_AREA_FILTER
@@ -41,6 +56,12 @@ property_double (edge_preservation, _("Edge preservation"), 8.0)
 
 #include "gegl-op.h"
 
+/* the smallest radius the lattice is used for, when the method is "auto" */
+#define LATTICE_MIN_RADIUS 6.0
+
+/* the largest area the lattice is built for at once */
+#define LATTICE_MAX_PIXELS (1 << 18)
+
 static void
 bilateral_filter (GeglBuffer          *src,
                   const GeglRectangle *src_rect,
@@ -50,16 +71,50 @@ bilateral_filter (GeglBuffer          *src,
                   gdouble              preserve,
                   const Babl          *format);
 
+static void
+bilateral_filter_lattice (GeglBuffer          *src,
+                          const GeglRectangle *src_rect,
+                          GeglBuffer          *dst,
+                          const GeglRectangle *dst_rect,
+                          gdouble              radius,
+                          gdouble              preserve,
+                          const Babl          *format);
+
 #include <stdio.h>
 
+static gboolean
+use_lattice (GeglProperties *o)
+{
+  switch (o->method)
+    {
+    case GEGL_BILATERAL_FILTER_EXACT:
+      return FALSE;
+
+    case GEGL_BILATERAL_FILTER_LATTICE:
+      return TRUE;
+
+    case GEGL_BILATERAL_FILTER_AUTO:
+    default:
+      return o->blur_radius >= LATTICE_MIN_RADIUS;
+    }
+}
+
 static void prepare (GeglOperation *operation)
 {
   const Babl *space = gegl_operation_get_source_space (operation, "input");
   const Babl *format = babl_format_with_space ("RGBA float", space);
   GeglOperationAreaFilter *area = GEGL_OPERATION_AREA_FILTER (operation);
   GeglProperties              *o = GEGL_PROPERTIES (operation);
+  gdouble                  margin = o->blur_radius;
+
+  /* the spatial weights are a gaussian of variance blur_radius, which is
+   * negligible beyond 3 standard deviations; only the exact filter sums
+   * the whole region.
+   */
+  if (use_lattice (o))
+    margin = MIN (margin, 3.0 * sqrt (o->blur_radius));
 
-  area->left = area->right = area->top = area->bottom = ceil (o->blur_radius);
+  area->left = area->right = area->top = area->bottom = ceil (margin);
   gegl_operation_set_format (operation, "input", format);
   gegl_operation_set_format (operation, "output", format);
 }
@@ -170,7 +225,8 @@ process (GeglOperation       *operation,
   GeglRectangle compute;
   const Babl *format = gegl_operation_get_format (operation, "output");
 
-  if (o->blur_radius >= 1.0 && gegl_operation_use_opencl (operation))
+  if (o->blur_radius >= 1.0 && ! use_lattice (o) &&
+      gegl_operation_use_opencl (operation))
     if (cl_process (operation, input, output, result))
       return TRUE;
 
@@ -181,6 +237,25 @@ process (GeglOperation       *operation,
       gegl_buffer_copy (input, result, GEGL_ABYSS_NONE,
                         output, result);
     }
+  else if (use_lattice (o))
+    {
+      /* the lattice takes about 100 bytes per pixel, filter large areas in
+       * bands
+       */
+      gint band_height = MAX (LATTICE_MAX_PIXELS / result->width, 1);
+      gint y;
+
+      for (y = 0; y < result->height; y += band_height)
+        {
+          GeglRectangle band = { result->x, result->y + y, result->width,
+                                 MIN (band_height, result->height - y) };
+
+          compute = gegl_operation_get_required_for_output (operation, "input",
+                                                            &band);
+
+          bilateral_filter_lattice (input, &compute, output, &band, o->blur_radius, o->edge_preservation, format);
+        }
+    }
   else
     {
       bilateral_filter (input, &compute, output, result, o->blur_radius, o->edge_preservation, format);
@@ -275,6 +350,421 @@ bilateral_filter (GeglBuffer          *src,
 }
 
 
+/* The lattice method is the permutohedral lattice filter from:
+ *
+ *  Fast High-Dimensional Filtering Using the Permutohedral Lattice
+ *  Andrew Adams, Jongmin Baek and Myers Abe Davis
+ *  Computer Graphics Forum (Eurographics 2010)
+ *
+ * Each pixel is a point in the 5 dimensional space of its position and
+ * color, scaled such that the filter is a unit gaussian there.  The pixels
+ * are splatted onto the vertices of the enclosing simplices of a lattice
+ * tiling that space, the lattice is blurred along each of its axes, and
+ * the result is sliced back at the pixels.  The cost per pixel doesn't
+ * depend on the radius.
+ */
+
+#define LATTICE_D  5 /* x, y, r, g, b */
+#define LATTICE_VD 5 /* r, g, b, a and the sum of the weights */
+
+typedef struct
+{
+  gint   *keys;     /* LATTICE_D coordinates per point, the last coordinate
+                       of the lattice is implied by them summing to 0 */
+  gfloat *values;   /* LATTICE_VD values per point */
+  gint    n_points;
+  gint    max_points;
+
+  gint   *entries;  /* open addressing hash table of point indices */
+  gint    n_entries;
+} Lattice;
+
+static inline guint
+lattice_hash (const gint *key)
+{
+  guint hash = 0;
+  gint  i;
+
+  for (i = 0; i < LATTICE_D; i++)
+    {
+      hash += key[i];
+      hash *= 2531011;
+    }
+
+  return hash;
+}
+
+static void
+lattice_init (Lattice *lattice,
+              gint     n_points)
+{
+  lattice->max_points = MAX (n_points, 16);
+  lattice->n_points   = 0;
+  lattice->keys       = g_new (gint, lattice->max_points * LATTICE_D);
+  lattice->values     = g_new0 (gfloat, lattice->max_points * LATTICE_VD);
+
+  lattice->n_entries  = 1 << g_bit_storage (lattice->max_points * 2 - 1);
+  lattice->entries    = g_new (gint, lattice->n_entries);
+
+  memset (lattice->entries, -1, lattice->n_entries * sizeof (gint));
+}
+
+static void
+lattice_clear (Lattice *lattice)
+{
+  g_free (lattice->keys);
+  g_free (lattice->values);
+  g_free (lattice->entries);
+}
+
+static void
+lattice_grow (Lattice *lattice)
+{
+  gint i;
+
+  lattice->max_points *= 2;
+  lattice->keys   = g_renew (gint, lattice->keys,
+                             lattice->max_points * LATTICE_D);
+  lattice->values = g_renew (gfloat, lattice->values,
+                             lattice->max_points * LATTICE_VD);
+
+  memset (lattice->values + lattice->n_points * LATTICE_VD, 0,
+          (lattice->max_points - lattice->n_points) * LATTICE_VD *
+          sizeof (gfloat));
+
+  lattice->n_entries *= 2;
+  lattice->entries    = g_renew (gint, lattice->entries, lattice->n_entries);
+
+  memset (lattice->entries, -1, lattice->n_entries * sizeof (gint));
+
+  for (i = 0; i < lattice->n_points; i++)
+    {
+      guint h = lattice_hash (lattice->keys + i * LATTICE_D) &
+                (lattice->n_entries - 1);
+
+      while (lattice->entries[h] >= 0)
+        h = (h + 1) & (lattice->n_entries - 1);
+
+      lattice->entries[h] = i;
+    }
+}
+
+/* returns the index of the point at @key, adding it if @insert is set,
+ * or -1.
+ */
+static gint
+lattice_lookup (Lattice    *lattice,
+                const gint *key,
+                gboolean    insert)
+{
+  guint h;
+
+  if (insert && lattice->n_points == lattice->max_points)
+    lattice_grow (lattice);
+
+  h = lattice_hash (key) & (lattice->n_entries - 1);
+
+  while (lattice->entries[h] >= 0)
+    {
+      const gint *entry_key = lattice->keys +
+                              lattice->entries[h] * LATTICE_D;
+
+      if (! memcmp (entry_key, key, LATTICE_D * sizeof (gint)))
+        return lattice->entries[h];
+
+      h = (h + 1) & (lattice->n_entries - 1);
+    }
+
+  if (! insert)
+    return -1;
+
+  memcpy (lattice->keys + lattice->n_points * LATTICE_D, key,
+          LATTICE_D * sizeof (gint));
+  lattice->entries[h] = lattice->n_points;
+
+  return lattice->n_points++;
+}
+
+static void
+bilateral_filter_lattice (GeglBuffer          *src,
+                          const GeglRectangle *src_rect,
+                          GeglBuffer          *dst,
+                          const GeglRectangle *dst_rect,
+                          gdouble              radius,
+                          gdouble              preserve,
+                          const Babl          *format)
+{
+  const gint  d          = LATTICE_D;
+  const gint  n_pixels   = src_rect->width * src_rect->height;
+  const gint  dx         = dst_rect->x - src_rect->x;
+  const gint  dy         = dst_rect->y - src_rect->y;
+  /* the spatial weights are exp (-0.5 * distance² / radius), and the
+   * color weights exp (-difference² * preserve)
+   */
+  const gdouble spatial_scale = 1.0 / sqrt (radius);
+  const gdouble color_scale   = sqrt (2.0 * preserve);
+  gdouble     scale_factor[LATTICE_D];
+  gint        canonical[(LATTICE_D + 1) * (LATTICE_D + 1)];
+  gfloat     *src_buf;
+  gfloat     *dst_buf;
+  gint       *offsets;
+  gfloat     *weights;
+  gfloat     *blurred;
+  Lattice     lattice;
+  gint        i, j, x, y;
+
+  for (i = 0; i < d; i++)
+    scale_factor[i] = (d + 1) * sqrt (2.0 / 3.0) / sqrt ((i + 1) * (i + 2));
+
+  for (i = 0; i <= d; i++)
+    {
+      for (j = 0; j <= d - i; j++)
+        canonical[i * (d + 1) + j] = i;
+      for (j = d - i + 1; j <= d; j++)
+        canonical[i * (d + 1) + j] = i - (d + 1);
+    }
+
+  src_buf = g_new (gfloat, n_pixels * 4);
+  dst_buf = g_new (gfloat, dst_rect->width * dst_rect->height * 4);
+  offsets = g_new (gint, n_pixels * (d + 1));
+  weights = g_new (gfloat, n_pixels * (d + 1));
+
+  gegl_buffer_get (src, src_rect, 1.0, format, src_buf, GEGL_AUTO_ROWSTRIDE,
+                   GEGL_ABYSS_NONE);
+
+  lattice_init (&lattice, n_pixels);
+
+  /* splat */
+  for (y = 0; y < src_rect->height; y++)
+    for (x = 0; x < src_rect->width; x++)
+      {
+        const gint    n        = x + y * src_rect->width;
+        const gfloat *pixel    = src_buf + n * 4;
+        gdouble       position[LATTICE_D];
+        gdouble       elevated[LATTICE_D + 1];
+        gdouble       barycentric[LATTICE_D + 2];
+        gint          rem0[LATTICE_D + 1];
+        gint          rank[LATTICE_D + 1];
+        gint          key[LATTICE_D];
+        gdouble       sum_cf = 0.0;
+        gint          sum    = 0;
+        gint          r;
+
+        /* positions are absolute, for the lattice to be aligned the same
+         * way in all the areas processed
+         */
+        position[0] = (src_rect->x + x) * spatial_scale;
+        position[1] = (src_rect->y + y) * spatial_scale;
+        position[2] = pixel[0] * color_scale;
+        position[3] = pixel[1] * color_scale;
+        position[4] = pixel[2] * color_scale;
+
+        /* elevate the position onto the hyperplane the lattice lies in */
+        for (i = d; i > 0; i--)
+          {
+            gdouble cf = position[i - 1] * scale_factor[i - 1];
+
+            elevated[i] = sum_cf - i * cf;
+            sum_cf += cf;
+          }
+        elevated[0] = sum_cf;
+
+        /* find the closest remainder-0 point */
+        for (i = 0; i <= d; i++)
+          {
+            gdouble v    = elevated[i] / (d + 1);
+            gint    up   = (gint) ceil (v)  * (d + 1);
+            gint    down = (gint) floor (v) * (d + 1);
+
+            if (up - elevated[i] < elevated[i] - down)
+              rem0[i] = up;
+            else
+              rem0[i] = down;
+
+            sum += rem0[i] / (d + 1);
+          }
+
+        /* rank the differences to it */
+        for (i = 0; i <= d; i++)
+          rank[i] = 0;
+
+        for (i = 0; i < d; i++)
+          {
+            gdouble di = elevated[i] - rem0[i];
+
+            for (j = i + 1; j <= d; j++)
+              {
+                if (di < elevated[j] - rem0[j])
+                  rank[i]++;
+                else
+                  rank[j]++;
+              }
+          }
+
+        /* move it back onto the hyperplane, if needed */
+        if (sum > 0)
+          {
+            for (i = 0; i <= d; i++)
+              {
+                if (rank[i] >= d + 1 - sum)
+                  {
+                    rem0[i] -= d + 1;
+                    rank[i] += sum - (d + 1);
+                  }
+                else
+                  {
+                    rank[i] += sum;
+                  }
+              }
+          }
+        else if (sum < 0)
+          {
+            for (i = 0; i <= d; i++)
+              {
+                if (rank[i] < -sum)
+                  {
+                    rem0[i] += d + 1;
+                    rank[i] += (d + 1) + sum;
+                  }
+                else
+                  {
+                    rank[i] += sum;
+                  }
+              }
+          }
+
+        /* the barycentric coordinates in the enclosing simplex */
+        for (i = 0; i <= d + 1; i++)
+          barycentric[i] = 0.0;
+
+        for (i = 0; i <= d; i++)
+          {
+            gdouble delta = (elevated[i] - rem0[i]) / (d + 1);
+
+            barycentric[d - rank[i]]     += delta;
+            barycentric[d + 1 - rank[i]] -= delta;
+          }
+        barycentric[0] += 1.0 + barycentric[d + 1];
+
+        for (r = 0; r <= d; r++)
+          {
+            gfloat *value;
+            gint    index;
+
+            for (i = 0; i < d; i++)
+              key[i] = rem0[i] + canonical[r * (d + 1) + rank[i]];
+
+            index = lattice_lookup (&lattice, key, TRUE);
+            value = lattice.values + index * LATTICE_VD;
+
+            value[0] += pixel[0] * barycentric[r];
+            value[1] += pixel[1] * barycentric[r];
+            value[2] += pixel[2] * barycentric[r];
+            value[3] += pixel[3] * barycentric[r];
+            value[4] += barycentric[r];
+
+            offsets[n * (d + 1) + r] = index;
+            weights[n * (d + 1) + r] = barycentric[r];
+          }
+      }
+
+  /* blur along each axis of the lattice */
+  blurred = g_new (gfloat, lattice.n_points * LATTICE_VD);
+
+  for (j = 0; j <= d; j++)
+    {
+      gfloat *swap;
+
+      for (i = 0; i < lattice.n_points; i++)
+        {
+          const gint   *key   = lattice.keys + i * LATTICE_D;
+          const gfloat *value = lattice.values + i * LATTICE_VD;
+          gfloat       *out   = blurred + i * LATTICE_VD;
+          gint          neighbor1[LATTICE_D];
+          gint          neighbor2[LATTICE_D];
+          gint          n1, n2;
+          gint          c, k;
+
+          for (k = 0; k < d; k++)
+            {
+              neighbor1[k] = key[k] + 1;
+              neighbor2[k] = key[k] - 1;
+            }
+
+          if (j < d)
+            {
+              neighbor1[j] = key[j] - d;
+              neighbor2[j] = key[j] + d;
+            }
+
+          n1 = lattice_lookup (&lattice, neighbor1, FALSE);
+          n2 = lattice_lookup (&lattice, neighbor2, FALSE);
+
+          for (c = 0; c < LATTICE_VD; c++)
+            out[c] = 0.5f * value[c];
+
+          if (n1 >= 0)
+            {
+              for (c = 0; c < LATTICE_VD; c++)
+                out[c] += 0.25f * lattice.values[n1 * LATTICE_VD + c];
+            }
+
+          if (n2 >= 0)
+            {
+              for (c = 0; c < LATTICE_VD; c++)
+                out[c] += 0.25f * lattice.values[n2 * LATTICE_VD + c];
+            }
+        }
+
+      swap           = lattice.values;
+      lattice.values = blurred;
+      blurred        = swap;
+    }
+
+  g_free (blurred);
+
+  /* slice */
+  for (y = 0; y < dst_rect->height; y++)
+    for (x = 0; x < dst_rect->width; x++)
+      {
+        const gint  n   = (x + dx) + (y + dy) * src_rect->width;
+        gfloat     *out = dst_buf + (x + y * dst_rect->width) * 4;
+        gfloat      accumulated[LATTICE_VD] = { 0, };
+        gint        r, c;
+
+        for (r = 0; r <= d; r++)
+          {
+            const gfloat *value  = lattice.values +
+                                   offsets[n * (d + 1) + r] * LATTICE_VD;
+            gfloat        weight = weights[n * (d + 1) + r];
+
+            for (c = 0; c < LATTICE_VD; c++)
+              accumulated[c] += value[c] * weight;
+          }
+
+        if (accumulated[4] > 0.0f)
+          {
+            for (c = 0; c < 4; c++)
+              out[c] = accumulated[c] / accumulated[4];
+          }
+        else
+          {
+            for (c = 0; c < 4; c++)
+              out[c] = src_buf[n * 4 + c];
+          }
+      }
+
+  gegl_buffer_set (dst, dst_rect, 0, format, dst_buf,
+                   GEGL_AUTO_ROWSTRIDE);
+
+  lattice_clear (&lattice);
+  g_free (src_buf);
+  g_free (dst_buf);
+  g_free (offsets);
+  g_free (weights);
+}
+
+
 static void
 gegl_op_class_init (GeglOpClass *klass)
 {
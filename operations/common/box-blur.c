@@ -374,7 +374,7 @@ process (GeglOperation       *operation,
   tmprect.y      -= o->radius;
   tmprect.height += o->radius * 2;
 
-  temp  = gegl_buffer_new (&tmprect, out_format);
+  temp  = gegl_buffer_new_exclusive (&tmprect, out_format);
 
   /* doing second pass in separate gegl op may be significantly faster */
   hor_blur (input, &rect, temp, &tmprect, o->radius, out_format);
@@ -158,6 +158,7 @@ gegl_op_class_init (GeglOpClass *klass)
       "name",       "gegl:brightness-contrast",
       "title",      _("Brightness Contrast"),
       "categories", "color",
+      "position-independent", "true",
       "reference-hash", "a60848d705029cad1cb89e44feb7f56e",
 
       /* xgettext:no-c-format */
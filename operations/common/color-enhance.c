@@ -32,47 +32,29 @@
 #define GEGL_OP_C_SOURCE color-enhance.c
 
 #include "gegl-op.h"
+#include "global-stats.h"
 
+/* finds the range of the chroma of the input */
 static void
-buffer_get_min_max (GeglOperation       *operation,
-                    GeglBuffer          *buffer,
-                    const GeglRectangle *result,
-                    gdouble             *min,
-                    gdouble             *max,
-                    const Babl          *format)
+get_min_max (GeglOperation *operation,
+             GeglBuffer    *input,
+             gdouble       *min,
+             gdouble       *max)
 {
-  GeglBufferIterator *gi;
-  gint                done_pixels = 0;
-
-  gegl_operation_progress (operation, 0.0, "");
-
-  gi = gegl_buffer_iterator_new (buffer, result, 0, format,
-                                 GEGL_ACCESS_READ, GEGL_ABYSS_NONE, 1);
-
-  *min = G_MAXDOUBLE;
-  *max = -G_MAXDOUBLE;
-
-  while (gegl_buffer_iterator_next (gi))
-    {
-      gint o;
-      gfloat *buf = gi->items[0].data;
+  GeglProperties *o     = GEGL_PROPERTIES (operation);
+  const Babl     *space = gegl_operation_get_source_space (operation, "input");
+  GlobalStats     stats = { GLOBAL_STATS_MIN_MAX, };
 
-      for (o = 0; o < gi->length; o++)
-        {
-          *min = MIN (buf[1], *min);
-          *max = MAX (buf[1], *max);
-          buf += 3;
-        }
+  global_stats_cache_get (o->user_data, operation, input,
+                          gegl_operation_source_get_bounding_box (operation,
+                                                                  "input"),
+                          babl_format_with_space ("CIE LCH(ab) float", space),
+                          &stats);
 
-      done_pixels += gi->length;
-
-      gegl_operation_progress (operation,
-                               (gdouble) 0.5 * done_pixels /
-                               (gdouble) (result->width * result->height),
-                               "");
-    }
+  *min = stats.min[1];
+  *max = stats.max[1];
 
-  gegl_operation_progress (operation, 0.5, "");
+  global_stats_clear (&stats);
 }
 
 static void prepare (GeglOperation *operation)
@@ -80,6 +62,10 @@ static void prepare (GeglOperation *operation)
   const Babl *space = gegl_operation_get_source_space (operation, "input");
   const Babl *format;
   const Babl *in_format = gegl_operation_get_source_format (operation, "input");
+  GeglProperties *o = GEGL_PROPERTIES (operation);
+
+  if (! o->user_data)
+    o->user_data = global_stats_cache_new ();
 
   if (in_format)
     {
@@ -111,18 +97,6 @@ get_required_for_output (GeglOperation       *operation,
   return result;
 }
 
-static GeglRectangle
-get_cached_region (GeglOperation       *operation,
-                   const GeglRectangle *roi)
-{
-  GeglRectangle result = *gegl_operation_source_get_bounding_box (operation, "input");
-
-  if (gegl_rectangle_is_infinite_plane (&result))
-    return *roi;
-
-  return result;
-}
-
 
 static gboolean
 process (GeglOperation       *operation,
@@ -134,23 +108,18 @@ process (GeglOperation       *operation,
   const Babl *format = gegl_operation_get_format (operation, "output");
   gboolean has_alpha = babl_format_has_alpha (format);
   GeglBufferIterator *gi;
-  gint                done_pixels = 0;
   gdouble  min;
   gdouble  max;
   gdouble  delta;
 
-  buffer_get_min_max (operation, input, result, &min, &max,
-                      babl_format_with_space ("CIE LCH(ab) float",
-                      babl_format_get_space (format)));
-
-  gegl_operation_progress (operation, 0.5, "");
+  get_min_max (operation, input, &min, &max);
 
   delta = max - min;
 
   if (! delta)
     {
-      gegl_buffer_copy (input, NULL, GEGL_ABYSS_NONE,
-                        output, NULL);
+      gegl_buffer_copy (input, result, GEGL_ABYSS_NONE,
+                        output, result);
       return TRUE;
     }
 
@@ -179,14 +148,6 @@ process (GeglOperation       *operation,
               in  += 4;
               out += 4;
             }
-
-          done_pixels += gi->length;
-
-          gegl_operation_progress (operation,
-                                   0.5 +
-                                   (gdouble) 0.5 * done_pixels /
-                                   (gdouble) (result->width * result->height),
-                                   "");
        }
     }
   else
@@ -206,19 +167,9 @@ process (GeglOperation       *operation,
               in  += 3;
               out += 3;
             }
-
-          done_pixels += gi->length;
-
-          gegl_operation_progress (operation,
-                                   0.5 +
-                                   (gdouble) 0.5 * done_pixels /
-                                   (gdouble) (result->width * result->height),
-                                   "");
         }
     }
 
-  gegl_operation_progress (operation, 1.0, "");
-
   return TRUE;
 }
 
@@ -246,6 +197,19 @@ operation_process (GeglOperation        *operation,
       return TRUE;
     }
 
+  /* gather the statistics using all threads, before the area is split
+   * between them, each then finding them in the cache.
+   */
+  if (in_rect)
+    {
+      GeglBuffer *input = GEGL_BUFFER (
+        gegl_operation_context_get_object (context, "input"));
+      gdouble     min, max;
+
+      if (input)
+        get_min_max (operation, input, &min, &max);
+    }
+
   /* chain up, which will create the needed buffers for our actual
    * process function
    */
@@ -253,23 +217,35 @@ operation_process (GeglOperation        *operation,
                                    gegl_operation_context_get_level (context));
 }
 
+static void
+finalize (GObject *object)
+{
+  GeglProperties *o = GEGL_PROPERTIES (object);
+
+  g_clear_pointer (&o->user_data, global_stats_cache_free);
+
+  G_OBJECT_CLASS (gegl_op_parent_class)->finalize (object);
+}
+
 static void
 gegl_op_class_init (GeglOpClass *klass)
 {
+  GObjectClass             *object_class;
   GeglOperationClass       *operation_class;
   GeglOperationFilterClass *filter_class;
 
+  object_class    = G_OBJECT_CLASS (klass);
   operation_class = GEGL_OPERATION_CLASS (klass);
   filter_class    = GEGL_OPERATION_FILTER_CLASS (klass);
 
+  object_class->finalize = finalize;
+
   filter_class->process = process;
 
   operation_class->prepare = prepare;
   operation_class->process = operation_process;
   operation_class->get_required_for_output = get_required_for_output;
-  operation_class->get_cached_region = get_cached_region;
   operation_class->opencl_support = FALSE;
-  operation_class->threaded = FALSE;
 
   gegl_operation_class_set_keys (operation_class,
     "name",        "gegl:color-enhance",
@@ -76,112 +76,377 @@ quantize_value (guint value,
   return floorf (value / recip) * recip;
 }
 
-static void
-process_floyd_steinberg (GeglBuffer          *input,
-                         GeglBuffer          *output,
-                         const GeglRectangle *result,
-                         guint               *channel_levels,
-                         const Babl          *format)
-{
-  GeglRectangle  line_rect;
-  guint16       *line_buf;
-  gdouble       *error_buf [2];
-  gint           y;
+/* error diffusion processes the area in bands of this many rows */
+#define BAND_HEIGHT   64
 
-  line_rect.x      = result->x;
-  line_rect.y      = result->y;
-  line_rect.width  = result->width;
-  line_rect.height = 1;
+/* the number of pixels a row publishes its progress after */
+#define PROGRESS_STEP 16
 
-  line_buf      = g_new  (guint16, line_rect.width * 4);
-  error_buf [0] = g_new0 (gdouble, line_rect.width * 4);
-  error_buf [1] = g_new0 (gdouble, line_rect.width * 4);
+/* the narrowest rows worth processing in parallel */
+#define MIN_PARALLEL_WIDTH 256
 
-  for (y = 0; y < result->height; y++)
-    {
-      gdouble  *error_buf_swap;
-      gint      step;
-      gint      start_x;
-      gint      end_x;
-      gint      x;
+typedef struct
+{
+  guint16 *planes[4];
+  gdouble *error_buf[4][2];
+  gint     width;
+  gint     height;
+  gint     y;
+  guint   *channel_levels;
+} FloydSteinbergData;
+
+/* Floyd-Steinberg uses serpentine scanning, so each row depends on the
+ * whole row above it, and rows can't overlap.  the channels are diffused
+ * independently though, and are processed in parallel, each from its own
+ * plane.
+ */
+static void
+process_floyd_steinberg_channels (gint     i,
+                                  gint     n,
+                                  gpointer user_data)
+{
+  FloydSteinbergData *data = user_data;
+  gint                ch;
 
-      /* Serpentine scanning; reverse direction every row */
+  for (ch = 4 * i / n; ch < 4 * (i + 1) / n; ch++)
+    {
+      gdouble **error_buf = data->error_buf[ch];
+      gint      r;
 
-      if (y & 1)
-        {
-          start_x = result->width - 1;
-          end_x   = -1;
-          step    = -1;
-        }
-      else
+      for (r = 0; r < data->height; r++)
         {
-          start_x = 0;
-          end_x   = result->width;
-          step    = 1;
-        }
-
-      /* Pull input row */
+          guint16  *row = data->planes[ch] + r * data->width;
+          gdouble  *error_buf_swap;
+          gint      step;
+          gint      start_x;
+          gint      end_x;
+          gint      x;
 
-      gegl_buffer_get (input, &line_rect, 1.0, format, line_buf,
-                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+          /* Serpentine scanning; reverse direction every row */
 
-      /* Process the row */
+          if ((data->y + r) & 1)
+            {
+              start_x = data->width - 1;
+              end_x   = -1;
+              step    = -1;
+            }
+          else
+            {
+              start_x = 0;
+              end_x   = data->width;
+              step    = 1;
+            }
 
-      for (x = start_x; x != end_x; x += step)
-        {
-          guint16  *pixel = &line_buf [x * 4];
-          guint     ch;
+          /* Process the row */
 
-          for (ch = 0; ch < 4; ch++)
+          for (x = start_x; x != end_x; x += step)
             {
               gdouble value;
               gdouble value_clamped;
               gdouble quantized;
               gdouble qerror;
 
-              value         = pixel [ch] + error_buf [0] [x * 4 + ch];
+              value         = row [x] + error_buf [0] [x];
               value_clamped = CLAMP (value, 0.0, 65535.0);
-              quantized     = quantize_value ((guint) (value_clamped + 0.5 * 65536 / channel_levels[ch] ), channel_levels [ch]);
+              quantized     = quantize_value ((guint) (value_clamped + 0.5 * 65536 / data->channel_levels[ch] ), data->channel_levels [ch]);
               qerror        = value - quantized;
 
-              pixel [ch] = (guint16) quantized;
+              row [x] = (guint16) quantized;
 
               /* Distribute the error */
 
-              error_buf [1] [x * 4 + ch] += qerror * 5.0 / 16.0;  /* Down */
+              error_buf [1] [x] += qerror * 5.0 / 16.0;  /* Down */
 
-              if (x + step >= 0 && x + step < result->width)
+              if (x + step >= 0 && x + step < data->width)
                 {
-                  error_buf [0] [(x + step) * 4 + ch] += qerror * 6.0 / 16.0;  /* Ahead */
-                  error_buf [1] [(x + step) * 4 + ch] += qerror * 1.0 / 16.0;  /* Down, ahead */
+                  error_buf [0] [x + step] += qerror * 6.0 / 16.0;  /* Ahead */
+                  error_buf [1] [x + step] += qerror * 1.0 / 16.0;  /* Down, ahead */
                 }
 
-              if (x - step >= 0 && x - step < result->width)
+              if (x - step >= 0 && x - step < data->width)
                 {
-                  error_buf [1] [(x - step) * 4 + ch] += qerror * 3.0 / 16.0;  /* Down, behind */
+                  error_buf [1] [x - step] += qerror * 3.0 / 16.0;  /* Down, behind */
                 }
             }
+
+          /* Swap error accumulation rows */
+
+          error_buf_swap = error_buf [0];
+          error_buf [0]  = error_buf [1];
+          error_buf [1]  = error_buf_swap;
+
+          /* Clear error buffer for next-plus-one line */
+
+          memset (error_buf [1], 0, data->width * sizeof (gdouble));
+        }
+    }
+}
+
+static void
+process_floyd_steinberg (GeglBuffer          *input,
+                         GeglBuffer          *output,
+                         const GeglRectangle *result,
+                         guint               *channel_levels,
+                         const Babl          *format)
+{
+  FloydSteinbergData  data;
+  GeglRectangle       band_rect;
+  guint16            *band_buf;
+  gint                n_pixels;
+  gint                ch;
+  gint                i;
+
+  data.width          = result->width;
+  data.channel_levels = channel_levels;
+
+  band_buf = g_new (guint16, data.width * BAND_HEIGHT * 4);
+
+  for (ch = 0; ch < 4; ch++)
+    {
+      data.planes[ch]       = g_new  (guint16, data.width * BAND_HEIGHT);
+      data.error_buf[ch][0] = g_new0 (gdouble, data.width);
+      data.error_buf[ch][1] = g_new0 (gdouble, data.width);
+    }
+
+  for (data.y = 0; data.y < result->height; data.y += BAND_HEIGHT)
+    {
+      data.height = MIN (BAND_HEIGHT, result->height - data.y);
+      n_pixels    = data.width * data.height;
+
+      band_rect.x      = result->x;
+      band_rect.y      = result->y + data.y;
+      band_rect.width  = data.width;
+      band_rect.height = data.height;
+
+      /* Pull input band */
+
+      gegl_buffer_get (input, &band_rect, 1.0, format, band_buf,
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+      for (i = 0; i < n_pixels; i++)
+        {
+          for (ch = 0; ch < 4; ch++)
+            data.planes[ch][i] = band_buf[4 * i + ch];
+        }
+
+      gegl_parallel_distribute (data.width >= MIN_PARALLEL_WIDTH ? 4 : 1,
+                                process_floyd_steinberg_channels, &data);
+
+      for (i = 0; i < n_pixels; i++)
+        {
+          for (ch = 0; ch < 4; ch++)
+            band_buf[4 * i + ch] = data.planes[ch][i];
+        }
+
+      /* Push output band */
+
+      gegl_buffer_set (output, &band_rect, 0, format, band_buf,
+                       GEGL_AUTO_ROWSTRIDE);
+    }
+
+  for (ch = 0; ch < 4; ch++)
+    {
+      g_free (data.planes[ch]);
+      g_free (data.error_buf[ch][0]);
+      g_free (data.error_buf[ch][1]);
+    }
+
+  g_free (band_buf);
+}
+
+typedef struct
+{
+  /* the weights the error is spread with, over the current row and the two
+   * rows below it, from two pixels behind to two pixels ahead.
+   */
+  gint weights[3][5];
+  gint divisor;
+} ErrorDiffusionKernel;
+
+static const ErrorDiffusionKernel jarvis_judice_ninke_kernel =
+{
+  {
+    { 0, 0, 0, 7, 5 },
+    { 3, 5, 7, 5, 3 },
+    { 1, 3, 5, 3, 1 }
+  },
+  48
+};
+
+static const ErrorDiffusionKernel stucki_kernel =
+{
+  {
+    { 0, 0, 0, 8, 4 },
+    { 2, 4, 8, 4, 2 },
+    { 1, 2, 4, 2, 1 }
+  },
+  42
+};
+
+typedef struct
+{
+  const ErrorDiffusionKernel *kernel;
+  guint16                    *band;
+  /* the quantization errors of the rows of the band, preceded by the last
+   * two rows of the previous band.
+   */
+  gdouble                    *qerror;
+  /* the number of pixels done in each row of the band */
+  gint                       *progress;
+  gint                        width;
+  gint                        height;
+  gint                        n_prev_rows;
+  guint                      *channel_levels;
+} ErrorDiffusionData;
+
+static void
+process_error_diffusion_row (ErrorDiffusionData *data,
+                             gint                r)
+{
+  const ErrorDiffusionKernel *kernel = data->kernel;
+  const gint                  stride = 4 * data->width;
+  guint16                    *row    = data->band   + r * stride;
+  gdouble                    *qerror = data->qerror + (r + 2) * stride;
+  gint                        ready  = r > 0 ? 0 : data->width;
+  gint                        x;
+
+  for (x = 0; x < data->width; x++)
+    {
+      gdouble err[4] = { 0.0, 0.0, 0.0, 0.0 };
+      gint    dy, dx;
+      gint    ch;
+
+      /* wait for the row above to be far enough ahead, which in turn
+       * waited for the row above it.
+       */
+      while (ready < MIN (x + 3, data->width))
+        {
+          ready = g_atomic_int_get (&data->progress[r - 1]);
+
+          if (ready < MIN (x + 3, data->width))
+            g_thread_yield ();
+        }
+
+      /* gather the error spread onto the pixel, always in the same order,
+       * so that the result doesn't depend on how rows are distributed.
+       */
+      for (dy = 2; dy >= 0; dy--)
+        {
+          const gdouble *q = qerror - dy * stride;
+
+          if (r - dy < -data->n_prev_rows)
+            continue;
+
+          for (dx = -2; dx <= 2; dx++)
+            {
+              gint w  = kernel->weights[dy][dx + 2];
+              gint sx = x - dx;
+
+              if (! w || sx < 0 || sx >= data->width || (dy == 0 && sx >= x))
+                continue;
+
+              for (ch = 0; ch < 4; ch++)
+                err[ch] += w * q[4 * sx + ch];
+            }
+        }
+
+      for (ch = 0; ch < 4; ch++)
+        {
+          gdouble value;
+          gdouble value_clamped;
+          gdouble quantized;
+
+          value         = row [4 * x + ch] + err[ch] / kernel->divisor;
+          value_clamped = CLAMP (value, 0.0, 65535.0);
+          quantized     = quantize_value ((guint) (value_clamped + 0.5 * 65536 / data->channel_levels[ch] ), data->channel_levels [ch]);
+
+          qerror [4 * x + ch] = value - quantized;
+          row [4 * x + ch]    = (guint16) quantized;
         }
 
-      /* Swap error accumulation rows */
+      if ((x + 1) % PROGRESS_STEP == 0)
+        g_atomic_int_set (&data->progress[r], x + 1);
+    }
+
+  g_atomic_int_set (&data->progress[r], data->width);
+}
+
+/* each row only depends on the two rows above it, up to two pixels ahead,
+ * so rows are processed in a wavefront: a row starts once the row above it
+ * is a few pixels ahead.  rows are dealt out to the threads in turn.
+ */
+static void
+process_error_diffusion_rows (gint     i,
+                              gint     n,
+                              gpointer user_data)
+{
+  ErrorDiffusionData *data = user_data;
+  gint                r;
+
+  for (r = i; r < data->height; r += n)
+    process_error_diffusion_row (data, r);
+}
+
+static void
+process_error_diffusion (GeglBuffer                 *input,
+                         GeglBuffer                 *output,
+                         const GeglRectangle        *result,
+                         guint                      *channel_levels,
+                         const ErrorDiffusionKernel *kernel,
+                         const Babl                 *format)
+{
+  ErrorDiffusionData data;
+  GeglRectangle      band_rect;
+  gint               stride = 4 * result->width;
+  gint               y;
+
+  data.kernel         = kernel;
+  data.width          = result->width;
+  data.n_prev_rows    = 0;
+  data.channel_levels = channel_levels;
+  data.band           = g_new  (guint16, stride * BAND_HEIGHT);
+  data.qerror         = g_new0 (gdouble, stride * (BAND_HEIGHT + 2));
+  data.progress       = g_new  (gint, BAND_HEIGHT);
+
+  for (y = 0; y < result->height; y += BAND_HEIGHT)
+    {
+      data.height = MIN (BAND_HEIGHT, result->height - y);
+
+      band_rect.x      = result->x;
+      band_rect.y      = result->y + y;
+      band_rect.width  = data.width;
+      band_rect.height = data.height;
 
-      error_buf_swap = error_buf [0];
-      error_buf [0]  = error_buf [1];
-      error_buf [1]  = error_buf_swap;
+      gegl_buffer_get (input, &band_rect, 1.0, format, data.band,
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+      memset (data.progress, 0, data.height * sizeof (gint));
 
-      /* Clear error buffer for next-plus-one line */
+      gegl_parallel_distribute (data.width >= MIN_PARALLEL_WIDTH ?
+                                  data.height : 1,
+                                process_error_diffusion_rows, &data);
 
-      memset (error_buf [1], 0, line_rect.width * 4 * sizeof (gdouble));
+      gegl_buffer_set (output, &band_rect, 0, format, data.band,
+                       GEGL_AUTO_ROWSTRIDE);
 
-      /* Push output row */
+      /* keep the errors of the last two rows for the next band */
+      memmove (data.qerror, data.qerror + data.height * stride,
+               2 * stride * sizeof (gdouble));
 
-      gegl_buffer_set (output, &line_rect, 0, format, line_buf, GEGL_AUTO_ROWSTRIDE);
-      line_rect.y++;
+      data.n_prev_rows = MIN (data.n_prev_rows + data.height, 2);
     }
 
-  g_free (line_buf);
-  g_free (error_buf [0]);
-  g_free (error_buf [1]);
+  g_free (data.progress);
+  g_free (data.qerror);
+  g_free (data.band);
+}
+
+static inline gboolean
+is_error_diffusion (GeglDitherMethod dither_method)
+{
+  return dither_method == GEGL_DITHER_FLOYD_STEINBERG     ||
+         dither_method == GEGL_DITHER_JARVIS_JUDICE_NINKE ||
+         dither_method == GEGL_DITHER_STUCKI;
 }
 
 static const gdouble bayer_matrix_8x8 [] =
@@ -491,6 +756,8 @@ process_standard (GeglBuffer          *input,
               process_row_bayer (gi, channel_levels, y);
             break;
           case GEGL_DITHER_FLOYD_STEINBERG:
+          case GEGL_DITHER_JARVIS_JUDICE_NINKE:
+          case GEGL_DITHER_STUCKI:
             /* Done separately */
             break;
           case GEGL_DITHER_ARITHMETIC_ADD:
@@ -522,7 +789,7 @@ get_cached_region (GeglOperation       *self,
 {
   GeglProperties *o = GEGL_PROPERTIES (self);
 
-  if (o->dither_method == GEGL_DITHER_FLOYD_STEINBERG)
+  if (is_error_diffusion (o->dither_method))
     {
       const GeglRectangle *in_rect =
           gegl_operation_source_get_bounding_box (self, "input");
@@ -558,11 +825,17 @@ process (GeglOperation       *operation,
   channel_levels [2] = o->blue_levels;
   channel_levels [3] = o->alpha_levels;
 
-  if (o->dither_method != GEGL_DITHER_FLOYD_STEINBERG)
+  if (o->dither_method == GEGL_DITHER_FLOYD_STEINBERG)
+    process_floyd_steinberg (input, output, result, channel_levels, format);
+  else if (o->dither_method == GEGL_DITHER_JARVIS_JUDICE_NINKE)
+    process_error_diffusion (input, output, result, channel_levels,
+                             &jarvis_judice_ninke_kernel, format);
+  else if (o->dither_method == GEGL_DITHER_STUCKI)
+    process_error_diffusion (input, output, result, channel_levels,
+                             &stucki_kernel, format);
+  else
     process_standard (input, output, result, channel_levels,
                       o->rand, o->dither_method, format);
-  else
-    process_floyd_steinberg (input, output, result, channel_levels, format);
 
   return TRUE;
 }
@@ -577,7 +850,7 @@ operation_process (GeglOperation        *operation,
   GeglProperties  *o = GEGL_PROPERTIES (operation);
   gboolean         success = FALSE;
 
-  if (o->dither_method == GEGL_DITHER_FLOYD_STEINBERG)
+  if (is_error_diffusion (o->dither_method))
     {
       const GeglRectangle *in_rect =
         gegl_operation_source_get_bounding_box (operation, "input");
@@ -54,9 +54,20 @@ property_double (edge_preservation, _("Edge preservation"),  0.8)
 #define RF_TABLE_SIZE 768
 #define SQRT3 1.7320508075f
 #define SQRT2 1.4142135623f
-#define BLOCK_STRIDE 1
+#define COLUMN_BLOCK 16  /* columns filtered together by the vertical passes */
 #define REPORT_PROGRESS_TIME 0.5  /* time to report gegl_operation_progress */
 
+typedef struct
+{
+  gint          width;
+  gint          height;
+  const guint8 *pixels_u8;     /* R'G'B' u8, for the domain transforms */
+  guint16      *h_transforms;  /* sum of the channel differences with the */
+  guint16      *v_transforms;  /* previous pixel of the row, or column */
+  gfloat       *pixels;        /* R'G'B'A float, filtered in place */
+  const gfloat *rf_table;
+} DomainTransformData;
+
 static gint16
 absolute (gint16 x)
 {
@@ -83,6 +94,167 @@ report_progress (GeglOperation  *operation,
     gegl_operation_progress (operation, progress, "");
 }
 
+/* @NOTE: 'd' should be 1.0f + s_s / s_r * sum_diff
+ * However, we will store just sum_diff.
+ * 1.0f + s_s / s_r will be calculated later when calculating
+ * the RF table. This is done this way because the sum_diff is
+ * perfect to be used as the index of the RF table.
+ * d = 1.0f + (vdt_information->spatial_factor /
+ *   vdt_information->range_factor) * sum_channels_difference;
+ */
+static inline guint16
+get_transform (const guint8 *current,
+               const guint8 *last)
+{
+  return absolute ((gint16) current[0] - last[0]) +
+         absolute ((gint16) current[1] - last[1]) +
+         absolute ((gint16) current[2] - last[2]);
+}
+
+/* The domain transforms only depend on the input, and are computed once
+ * for all iterations.
+ */
+static void
+compute_transforms (gsize    offset,
+                    gsize    size,
+                    gpointer user_data)
+{
+  DomainTransformData *data  = user_data;
+  const gint           width = data->width;
+  gsize                i;
+
+  for (i = offset; i < offset + size; i++)
+    {
+      const guint8 *row      = data->pixels_u8 + 3 * i * width;
+      const guint8 *last_row = i > 0 ? row - 3 * width : row;
+      guint16      *h        = data->h_transforms + i * width;
+      guint16      *v        = data->v_transforms + i * width;
+      gint          k;
+
+      h[0] = 0;
+
+      for (k = 1; k < width; k++)
+        h[k] = get_transform (row + 3 * k, row + 3 * (k - 1));
+
+      for (k = 0; k < width; k++)
+        v[k] = get_transform (row + 3 * k, last_row + 3 * k);
+    }
+}
+
+/* Horizontal Filter, each row by itself */
+static void
+filter_rows (gsize    offset,
+             gsize    size,
+             gpointer user_data)
+{
+  DomainTransformData *data     = user_data;
+  const gint           width    = data->width;
+  const gfloat        *rf_table = data->rf_table;
+  gsize                i;
+
+  for (i = offset; i < offset + size; i++)
+    {
+      gfloat        *buffer = data->pixels + 4 * i * width;
+      const guint16 *d      = data->h_transforms + i * width;
+      gfloat         lastf[4];
+      gfloat         w;
+      gint           k, c;
+
+      /* Left-Right */
+      for (c = 0; c < 4; c++)
+        lastf[c] = buffer[c];
+
+      for (k = 0; k < width; ++k)
+        {
+          w = rf_table[d[k]];
+
+          for (c = 0; c < 4; c++)
+            {
+              lastf[c] = ((1 - w) * buffer[k * 4 + c] + w * lastf[c]);
+              buffer[k * 4 + c] = lastf[c];
+            }
+        }
+
+      /* Right-Left */
+      for (c = 0; c < 4; c++)
+        lastf[c] = buffer[(width - 1) * 4 + c];
+
+      for (k = width - 1; k >= 0; --k)
+        {
+          w = rf_table[d[(k < width - 1) ? k + 1 : k]];
+
+          for (c = 0; c < 4; c++)
+            {
+              lastf[c] = ((1 - w) * buffer[k * 4 + c] + w * lastf[c]);
+              buffer[k * 4 + c] = lastf[c];
+            }
+        }
+    }
+}
+
+/* Vertical Filter, COLUMN_BLOCK columns at a time, so that each step reads
+ * and writes a contiguous span of a row, vectorized across the columns.
+ */
+static void
+filter_columns (gsize    offset,
+                gsize    size,
+                gpointer user_data)
+{
+  DomainTransformData *data     = user_data;
+  const gint           width    = data->width;
+  const gint           height   = data->height;
+  const gfloat        *rf_table = data->rf_table;
+  gsize                block;
+
+  for (block = offset; block < offset + size; block++)
+    {
+      gint    x0 = block * COLUMN_BLOCK;
+      gint    n  = 4 * MIN (COLUMN_BLOCK, width - x0);
+      gfloat  lastf[4 * COLUMN_BLOCK];
+      gfloat  w[4 * COLUMN_BLOCK];
+      gint    j, k;
+
+      /* Top-Down */
+      memcpy (lastf, data->pixels + 4 * x0, n * sizeof (gfloat));
+
+      for (k = 0; k < height; ++k)
+        {
+          gfloat        *buffer = data->pixels + 4 * ((gsize) k * width + x0);
+          const guint16 *d      = data->v_transforms + (gsize) k * width + x0;
+
+          for (j = 0; j < n; j++)
+            w[j] = rf_table[d[j / 4]];
+
+          for (j = 0; j < n; j++)
+            {
+              lastf[j] = ((1 - w[j]) * buffer[j] + w[j] * lastf[j]);
+              buffer[j] = lastf[j];
+            }
+        }
+
+      /* Bottom-Up */
+      memcpy (lastf, data->pixels + 4 * ((gsize) (height - 1) * width + x0),
+              n * sizeof (gfloat));
+
+      for (k = height - 1; k >= 0; --k)
+        {
+          gfloat        *buffer = data->pixels + 4 * ((gsize) k * width + x0);
+          const guint16 *d      = data->v_transforms +
+                                  (gsize) ((k < height - 1) ? k + 1 : k) *
+                                  width + x0;
+
+          for (j = 0; j < n; j++)
+            w[j] = rf_table[d[j / 4]];
+
+          for (j = 0; j < n; j++)
+            {
+              lastf[j] = ((1 - w[j]) * buffer[j] + w[j] * lastf[j]);
+              buffer[j] = lastf[j];
+            }
+        }
+    }
+}
+
 static gint
 domain_transform (GeglOperation  *operation,
                   gint            width,
@@ -97,27 +269,31 @@ domain_transform (GeglOperation  *operation,
   const Babl *space    = gegl_operation_get_source_space (operation, "input");
   const Babl *formatu8 = babl_format_with_space ("R'G'B' u8", space);
   const Babl *format   = babl_format_with_space ("R'G'B'A float", space);
+  DomainTransformData data;
   gfloat  **rf_table;
-  guint16  *transforms_buffer;
-  gfloat   *buffer;
-
-  gint16    last[3];
-  gint16    current[3];
-  gfloat    lastf[4];
-  gfloat    currentf[4];
-  gfloat    sum_channels_difference, a, w, sdt_dev;
-  gint      i, j, k, n;
-  gint      real_stride, d_x_position, d_y_position, biggest_dimension;
-  guint16   d;
-  GeglRectangle rect;
+  guint8   *pixels_u8;
+  gfloat    a, sdt_dev;
+  gdouble   pixels_per_thread;
+  gint      i, j, n;
+  gint      n_blocks;
+  GeglRectangle rect = { 0, 0, width, height };
   GTimer  *timer;
 
+  if (width <= 0 || height <= 0)
+    return 0;
+
   timer = g_timer_new ();
 
+  pixels_per_thread = gegl_operation_get_pixels_per_thread (operation);
+
   /* PRE-ALLOC MEMORY */
-  biggest_dimension = (width > height) ? width : height;
-  buffer            = g_new (gfloat, BLOCK_STRIDE * biggest_dimension * n_chan);
-  transforms_buffer = g_new (guint16, BLOCK_STRIDE * biggest_dimension);
+  pixels_u8         = gegl_malloc ((gsize) 3 * width * height);
+  data.width        = width;
+  data.height       = height;
+  data.pixels_u8    = pixels_u8;
+  data.h_transforms = g_new (guint16, (gsize) width * height);
+  data.v_transforms = g_new (guint16, (gsize) width * height);
+  data.pixels       = gegl_malloc (sizeof (gfloat) * n_chan * width * height);
 
   rf_table = g_new (gfloat *, n_iterations);
 
@@ -148,248 +324,49 @@ domain_transform (GeglOperation  *operation,
         }
     }
 
+  /* Domain Transform */
+  gegl_buffer_get (input, &rect, 1.0, formatu8, pixels_u8,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_CLAMP);
+
+  gegl_parallel_distribute_range (height,
+                                  pixels_per_thread / width,
+                                  compute_transforms, &data);
+
+  gegl_free (pixels_u8);
+  data.pixels_u8 = NULL;
+
+  gegl_buffer_get (input, &rect, 1.0, format, data.pixels,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_CLAMP);
+
+  n_blocks = (width + COLUMN_BLOCK - 1) / COLUMN_BLOCK;
+
   /* Filter Iterations */
   for (n = 0; n < n_iterations; ++n)
     {
+      data.rf_table = rf_table[n];
+
       /* Horizontal Pass */
-      for (i = 0; i < height; i += BLOCK_STRIDE)
-        {
-          real_stride = (i + BLOCK_STRIDE > height) ? height - i : BLOCK_STRIDE;
-    
-          rect.x = 0;
-          rect.y = i;
-          rect.width = width;
-          rect.height = real_stride;
-    
-          gegl_buffer_get (input, &rect, 1.0, formatu8, buffer,
-                           GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_CLAMP);
-    
-          /* Domain Transform */
-          for (j = 0; j < rect.height; ++j)
-            {
-              last[0] = ((guint8*) buffer)[j * rect.width * 3];
-              last[1] = ((guint8*) buffer)[j * rect.width * 3 + 1];
-              last[2] = ((guint8*) buffer)[j * rect.width * 3 + 2];
-      
-              for (k = 0; k < rect.width; ++k)
-                {
-                  current[0] = ((guint8*) buffer)[j * rect.width * 3 + k * 3];
-                  current[1] = ((guint8*) buffer)[j * rect.width * 3 + k * 3 + 1];
-                  current[2] = ((guint8*) buffer)[j * rect.width * 3 + k * 3 + 2];
-        
-                  sum_channels_difference = absolute (current[0] - last[0]) +
-                                            absolute (current[1] - last[1]) +
-                                            absolute (current[2] - last[2]);
-        
-                  /* @NOTE: 'd' should be 1.0f + s_s / s_r * sum_diff
-                   * However, we will store just sum_diff.
-                   * 1.0f + s_s / s_r will be calculated later when calculating
-                   * the RF table. This is done this way because the sum_diff is
-                   * perfect to be used as the index of the RF table.
-                   * d = 1.0f + (vdt_information->spatial_factor /
-                   *   vdt_information->range_factor) * sum_channels_difference;
-                   */
-                  transforms_buffer[j * rect.width + k] = sum_channels_difference;
-        
-                  last[0] = current[0];
-                  last[1] = current[1];
-                  last[2] = current[2];
-                }
-            }
-    
-          if (n == 0)
-            gegl_buffer_get (input, &rect, 1.0, format, buffer,
-                             GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_CLAMP);
-          else
-            gegl_buffer_get (output, &rect, 1.0, format, buffer,
-                             GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_CLAMP);
-    
-          /* Horizontal Filter (Left-Right) */
-          for (j = 0; j < rect.height; ++j)
-            {
-              lastf[0] = buffer[j * rect.width * n_chan];
-              lastf[1] = buffer[j * rect.width * n_chan + 1];
-              lastf[2] = buffer[j * rect.width * n_chan + 2];
-              lastf[3] = buffer[j * rect.width * n_chan + 3];
-      
-              for (k = 0; k < rect.width; ++k)
-                {
-                  d = transforms_buffer[j * rect.width + k];
-                  w = rf_table[n][d];
-        
-                  currentf[0] = buffer[j * rect.width * n_chan + k * n_chan];
-                  currentf[1] = buffer[j * rect.width * n_chan + k * n_chan + 1];
-                  currentf[2] = buffer[j * rect.width * n_chan + k * n_chan + 2];
-                  currentf[3] = buffer[j * rect.width * n_chan + k * n_chan + 3];
-        
-                  lastf[0] = ((1 - w) * currentf[0] + w * lastf[0]);
-                  lastf[1] = ((1 - w) * currentf[1] + w * lastf[1]);
-                  lastf[2] = ((1 - w) * currentf[2] + w * lastf[2]);
-                  lastf[3] = ((1 - w) * currentf[3] + w * lastf[3]);
-        
-                  buffer[j * rect.width * n_chan + k * n_chan]     = lastf[0];
-                  buffer[j * rect.width * n_chan + k * n_chan + 1] = lastf[1];
-                  buffer[j * rect.width * n_chan + k * n_chan + 2] = lastf[2];
-                  buffer[j * rect.width * n_chan + k * n_chan + 3] = lastf[3];
-                }
-            }
-    
-          /* Horizontal Filter (Right-Left) */
-          for (j = 0; j < rect.height; ++j)
-            {
-              lastf[0] = buffer[j * rect.width * n_chan + (rect.width - 1) * n_chan];
-              lastf[1] = buffer[j * rect.width * n_chan + (rect.width - 1) * n_chan + 1];
-              lastf[2] = buffer[j * rect.width * n_chan + (rect.width - 1) * n_chan + 2];
-              lastf[3] = buffer[j * rect.width * n_chan + (rect.width - 1) * n_chan + 3];
-              
-              for (k = rect.width - 1; k >= 0; --k)
-                {
-                  d_x_position = (k < rect.width - 1) ? k + 1 : k;
-                  d = transforms_buffer[j * rect.width + d_x_position];
-                  w = rf_table[n][d];
-        
-                  currentf[0] = buffer[j * rect.width * n_chan + k * n_chan];
-                  currentf[1] = buffer[j * rect.width * n_chan + k * n_chan + 1];
-                  currentf[2] = buffer[j * rect.width * n_chan + k * n_chan + 2];
-                  currentf[3] = buffer[j * rect.width * n_chan + k * n_chan + 3];
-        
-                  lastf[0] = ((1 - w) * currentf[0] + w * lastf[0]);
-                  lastf[1] = ((1 - w) * currentf[1] + w * lastf[1]);
-                  lastf[2] = ((1 - w) * currentf[2] + w * lastf[2]);
-                  lastf[3] = ((1 - w) * currentf[3] + w * lastf[3]);
-        
-                  buffer[j * rect.width * n_chan + k * n_chan] = lastf[0];
-                  buffer[j * rect.width * n_chan + k * n_chan + 1] = lastf[1];
-                  buffer[j * rect.width * n_chan + k * n_chan + 2] = lastf[2];
-                  buffer[j * rect.width * n_chan + k * n_chan + 3] = lastf[3];
-                }
-            }
-    
-          gegl_buffer_set (output, &rect, 0, format, buffer,
-                           GEGL_AUTO_ROWSTRIDE);
-        }
-  
+      gegl_parallel_distribute_range (height,
+                                      pixels_per_thread / width,
+                                      filter_rows, &data);
+
       report_progress (operation, (2.0 * n + 1.0) / (2.0 * n_iterations), timer);
-  
+
       /* Vertical Pass */
-      for (i = 0; i < width; i += BLOCK_STRIDE)
-        {
-          real_stride = (i + BLOCK_STRIDE > width) ? width - i : BLOCK_STRIDE;
-    
-          rect.x = i;
-          rect.y = 0;
-          rect.width = real_stride;
-          rect.height = height;
-    
-          gegl_buffer_get (input, &rect, 1.0, formatu8, buffer,
-                           GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_CLAMP);
-    
-          /* Domain Transform */
-          for (j = 0; j < rect.width; ++j)
-            {
-              last[0] = ((guint8*) buffer)[j * 3];
-              last[1] = ((guint8*) buffer)[j * 3 + 1];
-              last[2] = ((guint8*) buffer)[j * 3 + 2];
-      
-              for (k = 0; k < rect.height; ++k)
-                {
-                  current[0] = ((guint8*) buffer)[k * rect.width * 3 + j * 3];
-                  current[1] = ((guint8*) buffer)[k * rect.width * 3 + j * 3 + 1];
-                  current[2] = ((guint8*) buffer)[k * rect.width * 3 + j * 3 + 2];
-        
-                  sum_channels_difference = absolute (current[0] - last[0]) +
-                                            absolute (current[1] - last[1]) +
-                                            absolute (current[2] - last[2]);
-        
-                  /* @NOTE: 'd' should be 1.0f + s_s / s_r * sum_diff
-                   * However, we will store just sum_diff.
-                   * 1.0f + s_s / s_r will be calculated later when calculating
-                   * the RF table. This is done this way because the sum_diff is
-                   * perfect to be used as the index of the RF table.
-                   * d = 1.0f + (vdt_information->spatial_factor /
-                   *   vdt_information->range_factor) * sum_channels_difference;
-                   */
-                  transforms_buffer[k * rect.width + j] = sum_channels_difference;
-        
-                  last[0] = current[0];
-                  last[1] = current[1];
-                  last[2] = current[2];
-                }
-            }
-    
-          gegl_buffer_get (output, &rect, 1.0, format, buffer,
-                           GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_CLAMP);
-    
-          /* Vertical Filter (Top-Down) */
-          for (j = 0; j < rect.width; ++j)
-            {
-              lastf[0] = buffer[j * n_chan];
-              lastf[1] = buffer[j * n_chan + 1];
-              lastf[2] = buffer[j * n_chan + 2];
-              lastf[3] = buffer[j * n_chan + 3];
-      
-              for (k = 0; k < rect.height; ++k)
-                {
-                  d = transforms_buffer[k * rect.width + j];
-                  w = rf_table[n][d];
-                  
-                  currentf[0] = buffer[k * rect.width * n_chan + j * n_chan];
-                  currentf[1] = buffer[k * rect.width * n_chan + j * n_chan + 1];
-                  currentf[2] = buffer[k * rect.width * n_chan + j * n_chan + 2];
-                  currentf[3] = buffer[k * rect.width * n_chan + j * n_chan + 3];
-        
-                  lastf[0] = ((1 - w) * currentf[0] + w * lastf[0]);
-                  lastf[1] = ((1 - w) * currentf[1] + w * lastf[1]);
-                  lastf[2] = ((1 - w) * currentf[2] + w * lastf[2]);
-                  lastf[3] = ((1 - w) * currentf[3] + w * lastf[3]);
-        
-                  buffer[k * rect.width * n_chan + j * n_chan]     = lastf[0];
-                  buffer[k * rect.width * n_chan + j * n_chan + 1] = lastf[1];
-                  buffer[k * rect.width * n_chan + j * n_chan + 2] = lastf[2];
-                  buffer[k * rect.width * n_chan + j * n_chan + 3] = lastf[3];
-                }
-            }
-    
-          /* Vertical Filter (Bottom-Up) */
-          for (j = 0; j < rect.width; ++j)
-            {
-              lastf[0] = buffer[(rect.height - 1) * rect.width * n_chan + j * n_chan];
-              lastf[1] = buffer[(rect.height - 1) * rect.width * n_chan + j * n_chan + 1];
-              lastf[2] = buffer[(rect.height - 1) * rect.width * n_chan + j * n_chan + 2];
-              lastf[3] = buffer[(rect.height - 1) * rect.width * n_chan + j * n_chan + 3];
-              
-              for (k = rect.height - 1; k >= 0; --k)
-                {
-                  d_y_position = (k < rect.height - 1) ? k + 1 : k;
-                  d = transforms_buffer[d_y_position * rect.width + j];
-                  w = rf_table[n][d];
-        
-                  currentf[0] = buffer[k * rect.width * n_chan + j * n_chan];
-                  currentf[1] = buffer[k * rect.width * n_chan + j * n_chan + 1];
-                  currentf[2] = buffer[k * rect.width * n_chan + j * n_chan + 2];
-                  currentf[3] = buffer[k * rect.width * n_chan + j * n_chan + 3];
-        
-                  lastf[0] = ((1 - w) * currentf[0] + w * lastf[0]);
-                  lastf[1] = ((1 - w) * currentf[1] + w * lastf[1]);
-                  lastf[2] = ((1 - w) * currentf[2] + w * lastf[2]);
-                  lastf[3] = ((1 - w) * currentf[3] + w * lastf[3]);
-        
-                  buffer[k * rect.width * n_chan + j * n_chan]     = lastf[0];
-                  buffer[k * rect.width * n_chan + j * n_chan + 1] = lastf[1];
-                  buffer[k * rect.width * n_chan + j * n_chan + 2] = lastf[2];
-                  buffer[k * rect.width * n_chan + j * n_chan + 3] = lastf[3];
-                }
-            }
-    
-          gegl_buffer_set (output, &rect, 0, format, buffer,
-                           GEGL_AUTO_ROWSTRIDE);
-        }
-  
+      gegl_parallel_distribute_range (n_blocks,
+                                      pixels_per_thread /
+                                      (COLUMN_BLOCK * height),
+                                      filter_columns, &data);
+
       report_progress (operation, (2.0 * n + 2.0) / (2.0 * n_iterations), timer);
     }
 
-  g_free (transforms_buffer);
-  g_free (buffer);
+  gegl_buffer_set (output, &rect, 0, format, data.pixels,
+                   GEGL_AUTO_ROWSTRIDE);
+
+  g_free (data.h_transforms);
+  g_free (data.v_transforms);
+  gegl_free (data.pixels);
 
   for (i = 0; i < n_iterations; ++i)
     g_free (rf_table[i]);
@@ -44,6 +44,12 @@ property_double (noise, _("Noise"), 0.0)
     description (_("Gradient threshold for lowering detail enhancement"))
     value_range (0.0, 1.0)
 
+property_double (solve_scale, _("Solve scale"), 1.0)
+    description (_("Scale at which the luminance is tone mapped, the "
+                   "result being upsampled to the full size. Lower values "
+                   "are faster, at the cost of the finest details"))
+    value_range (0.01, 1.0)
+
 
 #else
 
@@ -55,6 +61,8 @@ property_double (noise, _("Noise"), 0.0)
 #include "gegl-debug.h"
 #include <stdlib.h>
 
+#include "tonemap-common.h"
+
 static const gchar *OUTPUT_FORMAT   = "RGB float";
 static const gint   MINIMUM_PYRAMID = 32;
 
@@ -122,9 +130,7 @@ fattal02_add_array (gfloat       *accum,
                     guint         size,
                     const gfloat *input)
 {
-  guint i;
-  for (i = 0; i < size; ++i)
-    accum[i] += input[i];
+  tonemap_axpby (size, 1.0f, input, 1.0f, accum);
 }
 
 
@@ -137,31 +143,48 @@ fattal02_copy_array (const gfloat *input,
 }
 
 
+typedef struct
+{
+  const gfloat        *input;
+  const GeglRectangle *extent_i;
+  gfloat              *output;
+  const GeglRectangle *extent_o;
+} Fattal02LevelData;
+
+
 /*
  * Full Multigrid Algorithm for solving partial differential equations
  */
 
 static void
-fattal02_restrict (const gfloat        *input,
-                   const GeglRectangle *extent_i,
-                   gfloat              *output,
-                   const GeglRectangle *extent_o)
+fattal02_restrict_rows (gsize    offset,
+                        gsize    size,
+                        gpointer user_data)
 {
-  const guint inRows = extent_i->height,
-              inCols = extent_i->width;
+  const Fattal02LevelData *data = user_data;
+  const gfloat            *input  = data->input;
+  gfloat                  *output = data->output;
 
-  const guint outRows = extent_o->height,
-              outCols = extent_o->width;
+  const guint inRows = data->extent_i->height,
+              inCols = data->extent_i->width;
+
+  const guint outCols = data->extent_o->width;
 
   const gfloat dx = (gfloat)inCols / (gfloat)outCols,
-               dy = (gfloat)inRows / (gfloat)outRows;
+               dy = (gfloat)inRows / (gfloat)data->extent_o->height;
 
   const gfloat filterSize = 0.5;
 
   gfloat sx, sy;
   guint   x,  y;
 
-  for (y = 0, sy = dy / 2 - 0.5; y < outRows; ++y, sy += dy)
+  /* accumulate sy up to the first row, the same way the rows before it
+   * do, so that the sampling positions don't depend on the threads
+   */
+  for (y = 0, sy = dy / 2 - 0.5; y < offset; ++y)
+    sy += dy;
+
+  for (y = offset; y < offset + size; ++y, sy += dy)
     {
       for (x = 0, sx = dx / 2 - 0.5; x < outCols; ++x, sx += dx )
         {
@@ -189,26 +212,45 @@ fattal02_restrict (const gfloat        *input,
 
 
 static void
-fattal02_prolongate (const gfloat        *input,
-                     const GeglRectangle *extent_i,
-                     gfloat              *output,
-                     const GeglRectangle *extent_o)
+fattal02_restrict (const gfloat        *input,
+                   const GeglRectangle *extent_i,
+                   gfloat              *output,
+                   const GeglRectangle *extent_o)
+{
+  Fattal02LevelData data = { input, extent_i, output, extent_o };
+
+  tonemap_distribute_rows (extent_o->height, extent_o->width,
+                           fattal02_restrict_rows, &data);
+}
+
+
+static void
+fattal02_prolongate_rows (gsize    offset,
+                          gsize    size,
+                          gpointer user_data)
 {
-  gfloat dx = (gfloat)extent_i->width  / (gfloat)extent_o->width,
-         dy = (gfloat)extent_i->height / (gfloat)extent_o->height;
+  const Fattal02LevelData *data = user_data;
+  const gfloat            *input  = data->input;
+  gfloat                  *output = data->output;
+
+  gfloat dx = (gfloat)data->extent_i->width  / (gfloat)data->extent_o->width,
+         dy = (gfloat)data->extent_i->height / (gfloat)data->extent_o->height;
 
-  const guint outRows = extent_o->height,
-              outCols = extent_o->width;
+  const guint outCols = data->extent_o->width;
 
-  const gfloat inRows = extent_i->height,
-               inCols = extent_i->width;
+  const gfloat inRows = data->extent_i->height,
+               inCols = data->extent_i->width;
 
   const float filterSize = 1;
 
   gfloat sx, sy;
   guint   x,  y;
 
-  for (y = 0, sy = -dy / 2; y < outRows; ++y, sy += dy)
+  /* see fattal02_restrict_rows() */
+  for (y = 0, sy = -dy / 2; y < offset; ++y)
+    sy += dy;
+
+  for (y = offset; y < offset + size; ++y, sy += dy)
     {
       for (x = 0, sx = -dx / 2; x < outCols; ++x, sx += dx )
         {
@@ -241,6 +283,19 @@ fattal02_prolongate (const gfloat        *input,
 }
 
 
+static void
+fattal02_prolongate (const gfloat        *input,
+                     const GeglRectangle *extent_i,
+                     gfloat              *output,
+                     const GeglRectangle *extent_o)
+{
+  Fattal02LevelData data = { input, extent_i, output, extent_o };
+
+  tonemap_distribute_rows (extent_o->height, extent_o->width,
+                           fattal02_prolongate_rows, &data);
+}
+
+
 static void
 fattal02_exact_solution (gfloat              *F,
                          const GeglRectangle *extent_f,
@@ -276,19 +331,35 @@ fattal02_smooth (gfloat              *U,
 }
 
 
+typedef struct
+{
+  gfloat              *D;
+  const GeglRectangle *extent_d;
+  const gfloat        *U;
+  const GeglRectangle *extent_u;
+  const gfloat        *F;
+  const GeglRectangle *extent_f;
+} Fattal02DefectData;
+
+
 static void
-fattal02_calculate_defect (gfloat              *D,
-                           const GeglRectangle *extent_d,
-                           gfloat              *U,
-                           const GeglRectangle *extent_u,
-                           gfloat              *F,
-                           const GeglRectangle *extent_f)
+fattal02_calculate_defect_rows (gsize    offset,
+                                gsize    size,
+                                gpointer user_data)
 {
+  const Fattal02DefectData *data     = user_data;
+  gfloat                   *D        = data->D;
+  const gfloat             *U        = data->U;
+  const gfloat             *F        = data->F;
+  const GeglRectangle      *extent_d = data->extent_d;
+  const GeglRectangle      *extent_u = data->extent_u;
+  const GeglRectangle      *extent_f = data->extent_f;
+
   guint sx = extent_f->width,
         sy = extent_f->height;
   guint x, y;
 
-  for (y = 0; y < sy; ++y)
+  for (y = offset; y < offset + size; ++y)
     {
       for (x = 0; x < sx; ++x)
         {
@@ -309,6 +380,21 @@ fattal02_calculate_defect (gfloat              *D,
 }
 
 
+static void
+fattal02_calculate_defect (gfloat              *D,
+                           const GeglRectangle *extent_d,
+                           gfloat              *U,
+                           const GeglRectangle *extent_u,
+                           gfloat              *F,
+                           const GeglRectangle *extent_f)
+{
+  Fattal02DefectData data = { D, extent_d, U, extent_u, F, extent_f };
+
+  tonemap_distribute_rows (extent_f->height, extent_f->width,
+                           fattal02_calculate_defect_rows, &data);
+}
+
+
 static void
 fattal02_solve_pde_multigrid (gfloat              *F,
                               const GeglRectangle *extent_f,
@@ -481,24 +567,32 @@ asolve (gulong n,
         gfloat x[],
         gint   itrnsp)
 {
-  guint i;
-
-  for (i = 0; i < n; ++i)
-    x[i] = -4 * b[i];
+  tonemap_axpby (n, -4.0f, b, 0.0f, x);
 }
 
+typedef struct
+{
+  guint         rows;
+  guint         cols;
+  const gfloat *x;
+  gfloat       *res;
+} Fattal02AtimesData;
+
 static void
-atimes (guint  rows,
-        guint  cols,
-        gfloat x[],
-        gfloat res[],
-        gint   itrnsp)
+atimes_rows (gsize    offset,
+             gsize    size,
+             gpointer user_data)
 {
-  guint r, c;
+  const Fattal02AtimesData *data = user_data;
+  const guint               cols = data->cols;
+  const gfloat             *x    = data->x;
+  gfloat                   *res  = data->res;
+  guint                     r, c;
 
 #define IDX(R,C) ((R) * cols + (C))
 
-  for (r = 1; r < rows - 1; ++r)
+  /* the interior rows, offset by one */
+  for (r = offset + 1; r < offset + size + 1; ++r)
     {
       for (c = 1; c < cols - 1; ++c)
         {
@@ -506,6 +600,19 @@ atimes (guint  rows,
             x[IDX (r,c-1)] + x[IDX (r,c+1)] - 4*x[IDX (r,c)];
         }
     }
+}
+
+static void
+atimes (guint  rows,
+        guint  cols,
+        gfloat x[],
+        gfloat res[],
+        gint   itrnsp)
+{
+  Fattal02AtimesData data = { rows, cols, x, res };
+  guint              r, c;
+
+  tonemap_distribute_rows (rows - 2, cols, atimes_rows, &data);
 
   for (r = 1; r < rows - 1; ++r)
     {
@@ -556,10 +663,7 @@ snrm (gulong n,
 
   if (itol <= 3)
     {
-      gfloat ans = 0.0;
-      for (i = 0; i < n; ++i)
-          ans += sx[i] * sx[i];
-      return sqrtf (ans);
+      return sqrtf (tonemap_dot_product (sx, sx, n));
     }
   else
     {
@@ -589,7 +693,6 @@ linbcg (guint   rows,
 {
   guint  n = rows * cols;
 
-  gulong j;
   gfloat ak,akden,bk,bkden,bknum,bnrm,dxnrm,xnrm,zm1nrm,znrm;
   gfloat *p,*pp,*r,*rr,*z,*zz;
 
@@ -605,11 +708,8 @@ linbcg (guint   rows,
 
   *iter=0;
   atimes (rows, cols, x, r, 0);
-  for (j = 0; j < n; ++j)
-    {
-       r[j] = b[j] - r[j];
-      rr[j] = r[j];
-    }
+  tonemap_axpby (n, 1.0f, b, -1.0f, r);
+  fattal02_copy_array (r, n, rr);
 
   atimes (rows, cols, r, rr, 0);       /* minimum residual */
   znrm = 1.0;
@@ -643,47 +743,32 @@ linbcg (guint   rows,
 
       zm1nrm = znrm;
       asolve (n, rr, zz, 1);
-      for (bknum = 0.0, j = 0; j < n; ++j)
-        {
-          bknum += z[j] * rr[j];
-        }
+      bknum = tonemap_dot_product (z, rr, n);
 
       if (*iter == 1)
         {
-          for (j = 0; j < n; ++j)
-            {
-               p[j] =  z[j];
-              pp[j] = zz[j];
-            }
+          fattal02_copy_array ( z, n,  p);
+          fattal02_copy_array (zz, n, pp);
         }
       else
         {
           bk = bknum / bkden;
 
-          for (j = 0; j < n; ++j)
-            {
-               p[j] = bk *  p[j] +  z[j];
-              pp[j] = bk * pp[j] + zz[j];
-            }
+          tonemap_axpby (n, 1.0f,  z, bk,  p);
+          tonemap_axpby (n, 1.0f, zz, bk, pp);
         }
 
       bkden = bknum;
       atimes (rows, cols, p, z, 0);
 
-      for (akden = 0.0, j = 0; j < n; ++j)
-        {
-          akden += z[j] * pp[j];
-        }
+      akden = tonemap_dot_product (z, pp, n);
 
       ak = bknum / akden;
       atimes (rows, cols, pp, zz, 1);
 
-      for (j = 0; j < n; ++j)
-        {
-           x[j] += ak *  p[j];
-           r[j] -= ak *  z[j];
-          rr[j] -= ak * zz[j];
-        }
+      tonemap_axpby (n,  ak,  p, 1.0f,  x);
+      tonemap_axpby (n, -ak,  z, 1.0f,  r);
+      tonemap_axpby (n, -ak, zz, 1.0f, rr);
 
       asolve (n, r, z, 0);
 
@@ -732,28 +817,19 @@ linbcg (guint   rows,
 }
 
 
-/* Downscale the input buffer by a factor of two. Extent describes the input
- * buffer. Assumes a pixel stride of 1, as we're really only dealing with
- * luminance. Output should be preallocated with a size that is half of the
- * input.
- */
 static void
-fattal02_downsample (const gfloat        *input,
-                     const GeglRectangle *extent,
-                     gfloat              *output)
+fattal02_downsample_rows (gsize    offset,
+                          gsize    size,
+                          gpointer user_data)
 {
-  guint x, y, width, height;
-  g_return_if_fail (input);
-  g_return_if_fail (extent);
-  g_return_if_fail (output);
-
-  width  = extent->width  / 2,
-  height = extent->height / 2;
-
-  g_return_if_fail (width  > 0);
-  g_return_if_fail (height > 0);
-
-  for (y = 0; y < height; ++y)
+  const Fattal02LevelData *data   = user_data;
+  const gfloat            *input  = data->input;
+  const GeglRectangle     *extent = data->extent_i;
+  gfloat                  *output = data->output;
+  guint                    width  = data->extent_o->width;
+  guint                    x, y;
+
+  for (y = offset; y < offset + size; ++y)
     {
       for (x = 0; x < width; ++x)
         {
@@ -773,30 +849,50 @@ fattal02_downsample (const gfloat        *input,
 }
 
 
-/* Blur the input buffer with a one pixel radius. Output should be
- * preallocated with the same size as the input buffer. This must perform
- * correctly when input and output alias.
+/* Downscale the input buffer by a factor of two. Extent describes the input
+ * buffer. Assumes a pixel stride of 1, as we're really only dealing with
+ * luminance. Output should be preallocated with a size that is half of the
+ * input.
  */
 static void
-fattal02_gaussian_blur (const gfloat        *input,
-                        const GeglRectangle *extent,
-                        gfloat              *output)
+fattal02_downsample (const gfloat        *input,
+                     const GeglRectangle *extent,
+                     gfloat              *output)
 {
-  const guint  width  = extent->width,
-               height = extent->height,
-               size   = width * height;
-  guint        x, y;
-  gfloat      *temp;
+  Fattal02LevelData data;
+  GeglRectangle     extent_o;
 
   g_return_if_fail (input);
   g_return_if_fail (extent);
   g_return_if_fail (output);
-  g_return_if_fail (size > 0);
 
-  temp   = g_new (gfloat, size);
+  extent_o = LEVEL_EXTENT (extent, 1);
 
-  /* horizontal blur */
-  for (y = 0; y < height; ++y)
+  g_return_if_fail (extent_o.width  > 0);
+  g_return_if_fail (extent_o.height > 0);
+
+  data.input    = input;
+  data.extent_i = extent;
+  data.output   = output;
+  data.extent_o = &extent_o;
+
+  tonemap_distribute_rows (extent_o.height, extent_o.width,
+                           fattal02_downsample_rows, &data);
+}
+
+
+static void
+fattal02_blur_horizontal_rows (gsize    offset,
+                               gsize    size,
+                               gpointer user_data)
+{
+  const Fattal02LevelData *data   = user_data;
+  const gfloat            *input  = data->input;
+  gfloat                  *temp   = data->output;
+  const guint              width  = data->extent_i->width;
+  guint                    x, y;
+
+  for (y = offset; y < offset + size; ++y)
     {
       for (x = 1; x < width - 1; ++x)
         {
@@ -804,7 +900,7 @@ fattal02_gaussian_blur (const gfloat        *input,
           p        +=     input[x - 1 + y * width];
           p        +=     input[x + 1 + y * width];
 
-          temp[x + y * extent->width] = p / 4.0f;
+          temp[x + y * width] = p / 4.0f;
         }
 
       temp[0         + y * width] = (3 * input[0         + y * width] +
@@ -812,24 +908,87 @@ fattal02_gaussian_blur (const gfloat        *input,
       temp[width - 1 + y * width] = (3 * input[width - 1 + y * width] +
                                          input[width - 2 + y * width]) / 4.0f;
     }
+}
 
-  /* vertical blur */
-  for (x = 0; x < width; ++x)
+
+static void
+fattal02_blur_vertical_rows (gsize    offset,
+                             gsize    size,
+                             gpointer user_data)
+{
+  const Fattal02LevelData *data   = user_data;
+  const gfloat            *temp   = data->input;
+  gfloat                  *output = data->output;
+  const guint              width  = data->extent_i->width,
+                           height = data->extent_i->height;
+  guint                    x, y;
+
+  for (y = offset; y < offset + size; ++y)
     {
-      for (y = 1; y < height - 1; ++y)
+      const gfloat *row = temp   + y * width;
+      gfloat       *out = output + y * width;
+
+      if (y == 0 || y + 1 == height)
         {
-          gfloat p  = 2 * temp[x +      y  * width];
-          p        +=     temp[x + (y - 1) * width];
-          p        +=     temp[x + (y + 1) * width];
+          const gfloat *next = temp + (y == 0 ? 1 : height - 2) * width;
 
-          output[x + y * width] = p / 4.0f;
+          for (x = 0; x < width; ++x)
+            out[x] = (3 * row[x] + next[x]) / 4.0f;
         }
+      else
+        {
+          const gfloat *above = row - width,
+                       *below = row + width;
+
+          for (x = 0; x < width; ++x)
+            {
+              gfloat p  = 2 * row[x];
+              p        +=     above[x];
+              p        +=     below[x];
 
-      output[x +           0  * width] = (3 * temp[x +           0  * width] +
-                                              temp[x +           1  * width]) / 4.0f;
-      output[x + (height - 1) * width] = (3 * temp[x + (height - 1) * width] +
-                                              temp[x + (height - 2) * width]) / 4.0f;
+              out[x] = p / 4.0f;
+            }
+        }
     }
+}
+
+
+/* Blur the input buffer with a one pixel radius. Output should be
+ * preallocated with the same size as the input buffer. This must perform
+ * correctly when input and output alias.
+ */
+static void
+fattal02_gaussian_blur (const gfloat        *input,
+                        const GeglRectangle *extent,
+                        gfloat              *output)
+{
+  const guint        width  = extent->width,
+                     height = extent->height,
+                     size   = width * height;
+  gfloat            *temp;
+  Fattal02LevelData  data;
+
+  g_return_if_fail (input);
+  g_return_if_fail (extent);
+  g_return_if_fail (output);
+  g_return_if_fail (size > 0);
+
+  temp   = g_new (gfloat, size);
+
+  data.extent_i = extent;
+  data.extent_o = extent;
+
+  /* horizontal blur */
+  data.input  = input;
+  data.output = temp;
+  tonemap_distribute_rows (height, width,
+                           fattal02_blur_horizontal_rows, &data);
+
+  /* vertical blur */
+  data.input  = temp;
+  data.output = output;
+  tonemap_distribute_rows (height, width,
+                           fattal02_blur_vertical_rows, &data);
 
   g_free (temp);
 }
@@ -847,10 +1006,8 @@ fattal02_create_gaussian_pyramids (const gfloat         *zero,
 
   /* Copy the first level of the pyramid into place */
   pyramid[0] = g_new (gfloat, level_extent.width * level_extent.height);
-  for (i = 0; i < level_extent.width * level_extent.height; ++i)
-    {
-      pyramid[0][i] = zero[i];
-    }
+  fattal02_copy_array (zero, level_extent.width * level_extent.height,
+                       pyramid[0]);
 
   /* Establish a temporary blur buffer. The allocated memory will be used for
    * progressively smaller levels, and we don't free this until the end.
@@ -880,20 +1037,29 @@ fattal02_create_gaussian_pyramids (const gfloat         *zero,
 
 /********************************************************************/
 
-static gfloat
-fattal02_calculate_gradients (const gfloat        *input,   /* H */
-                              const GeglRectangle *extent,  /*  */
-                              gfloat              *output,  /* G */
-                              gint                 k)
+typedef struct
 {
-  guint  width   = extent->width,
-         height  = extent->height;
-  gfloat divider = powf (2.0f, k + 1),
-         average = 0.0f;
+  const gfloat        *input;
+  const GeglRectangle *extent;
+  gfloat              *output;
+  gfloat               divider;
+} Fattal02GradientData;
 
-  guint  x, y;
 
-  for (y = 0; y < height; ++y)
+static void
+fattal02_calculate_gradients_rows (gsize    offset,
+                                   gsize    size,
+                                   gpointer user_data)
+{
+  const Fattal02GradientData *data    = user_data;
+  const gfloat               *input   = data->input;
+  gfloat                     *output  = data->output;
+  guint                       width   = data->extent->width,
+                              height  = data->extent->height;
+  gfloat                      divider = data->divider;
+  guint                       x, y;
+
+  for (y = offset; y < offset + size; ++y)
     {
       for (x = 0; x < width; ++x)
         {
@@ -909,28 +1075,50 @@ fattal02_calculate_gradients (const gfloat        *input,   /* H */
           gy = (input[x + s * width] - input[x + n * width]) / divider;
 
           output[x + y * width] = sqrtf (gx * gx + gy * gy);
-          average += output[x + y * width];
         }
     }
+}
+
 
-  return average / (width * height);
+static gfloat
+fattal02_calculate_gradients (const gfloat        *input,   /* H */
+                              const GeglRectangle *extent,  /*  */
+                              gfloat              *output,  /* G */
+                              gint                 k)
+{
+  Fattal02GradientData data;
+  guint                width  = extent->width,
+                       height = extent->height;
+
+  data.input   = input;
+  data.extent  = extent;
+  data.output  = output;
+  data.divider = powf (2.0f, k + 1);
+
+  tonemap_distribute_rows (height, width,
+                           fattal02_calculate_gradients_rows, &data);
+
+  return tonemap_dot_product (output, NULL, width * height) /
+         (width * height);
 }
 
 
 /********************************************************************/
 
 static void
-fattal02_upsample (const gfloat        *input,
-                   const GeglRectangle *extent,
-                   gfloat              *output)
+fattal02_upsample_rows (gsize    offset,
+                        gsize    size,
+                        gpointer user_data)
 {
-  guint  width_i = extent->width,
-        height_i = extent->height,
-         width_o =  width_i * 2,
-        height_o = height_i * 2;
+  const Fattal02LevelData *data   = user_data;
+  const gfloat            *input  = data->input;
+  gfloat                  *output = data->output;
+  guint  width_i = data->extent_i->width,
+        height_i = data->extent_i->height,
+         width_o = data->extent_o->width;
   guint x_o, y_o;
 
-  for (y_o = 0; y_o < height_o; ++y_o)
+  for (y_o = offset; y_o < offset + size; ++y_o)
     {
       for (x_o = 0; x_o < width_o; ++x_o)
         {
@@ -946,6 +1134,56 @@ fattal02_upsample (const gfloat        *input,
 }
 
 
+static void
+fattal02_upsample (const gfloat        *input,
+                   const GeglRectangle *extent,
+                   gfloat              *output)
+{
+  GeglRectangle     extent_o = { 0, 0, extent->width * 2, extent->height * 2 };
+  Fattal02LevelData data     = { input, extent, output, &extent_o };
+
+  tonemap_distribute_rows (extent_o.height, extent_o.width,
+                           fattal02_upsample_rows, &data);
+}
+
+
+typedef struct
+{
+  gfloat              *fi;
+  const gfloat        *gradient;
+  const GeglRectangle *extent;
+  gfloat               a;
+  gfloat               beta;
+  gfloat               noise;
+} Fattal02AttenuationData;
+
+
+static void
+fattal02_attenuate_rows (gsize    offset,
+                         gsize    size,
+                         gpointer user_data)
+{
+  const Fattal02AttenuationData *data  = user_data;
+  const gint                     width = data->extent->width;
+  const gfloat                   a     = data->a;
+  const gfloat                   beta  = data->beta;
+  const gfloat                   noise = data->noise;
+  gsize                          y;
+  gint                           x;
+
+  for (y = offset; y < offset + size; ++y)
+    for (x = 0; x < width; ++x)
+      {
+        gfloat grad  = data->gradient[x + y * width],
+               value = 1.0f;
+
+        if (grad > 1e-4f)
+          value = a / (grad + noise) * powf ((grad + noise) / a, beta);
+        data->fi[x + y * width] *= value;
+      }
+}
+
+
 static void
 fattal02_FI_matrix (gfloat               *FI,
                     const GeglRectangle  *extent,
@@ -974,22 +1212,20 @@ fattal02_FI_matrix (gfloat               *FI,
 
   for (i = levels - 1; i >= 0; --i)
     {
-      gint x, y;
+      Fattal02AttenuationData data;
 
       level_extent.width  = LEVEL_WIDTH  (extent, i);
       level_extent.height = LEVEL_HEIGHT (extent, i);
 
-      for (y = 0; y < level_extent.height; ++y)
-          for (x = 0; x < level_extent.width; ++x)
-            {
-              gfloat grad  = gradients[i][x + y * level_extent.width],
-                     a     = alfa * averages[i],
-                     value = 1.0f;
+      data.fi       = fi[i];
+      data.gradient = gradients[i];
+      data.extent   = &level_extent;
+      data.a        = alfa * averages[i];
+      data.beta     = beta;
+      data.noise    = noise;
 
-              if (grad > 1e-4f)
-                value = a / (grad + noise) * powf ((grad + noise) / a, beta);
-              fi[i][x + y * level_extent.width] *= value;
-            }
+      tonemap_distribute_rows (level_extent.height, level_extent.width,
+                               fattal02_attenuate_rows, &data);
 
       /* create next level */
       if (i > 1)
@@ -1068,6 +1304,124 @@ fattal02_find_percentiles (const gfloat *array,
 
 /********************************************************************/
 
+typedef struct
+{
+  const gfloat        *input;
+  gfloat              *output;
+  gfloat               min;
+  gfloat               max;
+} Fattal02MapData;
+
+
+static void
+fattal02_log_range (gsize    offset,
+                    gsize    size,
+                    gpointer user_data)
+{
+  const Fattal02MapData *data = user_data;
+  gsize                  i;
+
+  for (i = offset; i < offset + size; ++i)
+    data->output[i] = log (100.0f * data->input[i] / data->max + 1e-4f);
+}
+
+
+static void
+fattal02_exp_range (gsize    offset,
+                    gsize    size,
+                    gpointer user_data)
+{
+  const Fattal02MapData *data = user_data;
+  gsize                  i;
+
+  for (i = offset; i < offset + size; ++i)
+    data->output[i] = expf (data->input[i]) - 1e-4f;
+}
+
+
+static void
+fattal02_normalize_range (gsize    offset,
+                          gsize    size,
+                          gpointer user_data)
+{
+  const Fattal02MapData *data  = user_data;
+  const gfloat           range = data->max - data->min;
+  gsize                  i;
+
+  for (i = offset; i < offset + size; ++i)
+    {
+      data->output[i] = (data->output[i] - data->min) / range;
+      if (data->output[i] <= 0.0f)
+          data->output[i] = 1e-4f;
+    }
+}
+
+
+typedef struct
+{
+  const gfloat        *H;
+  const gfloat        *FI;
+  gfloat              *Gx;
+  gfloat              *Gy;
+  gfloat              *divergence;
+  const GeglRectangle *extent;
+} Fattal02DivergenceData;
+
+
+static void
+fattal02_attenuate_gradients_rows (gsize    offset,
+                                   gsize    size,
+                                   gpointer user_data)
+{
+  const Fattal02DivergenceData *data   = user_data;
+  const gfloat                 *H      = data->H;
+  const gfloat                 *FI     = data->FI;
+  gfloat                       *Gx     = data->Gx;
+  gfloat                       *Gy     = data->Gy;
+  const guint                   width  = data->extent->width,
+                                height = data->extent->height;
+  guint                         x, y;
+
+  for (y = offset; y < offset + size; ++y)
+    {
+      for (x = 0; x < width; ++x)
+        {
+          guint s = (y + 1 == height ? y : y + 1),
+            e = (x + 1 ==  width ? x : x + 1);
+
+          Gx[x + y * width] = ( H[e + y * width] - H[x + y * width]) *
+                               FI[x + y * width];
+          Gy[x + y * width] = ( H[x + s * width] - H[x + y * width]) *
+                               FI[x + y * width];
+        }
+    }
+}
+
+
+static void
+fattal02_divergence_rows (gsize    offset,
+                          gsize    size,
+                          gpointer user_data)
+{
+  const Fattal02DivergenceData *data       = user_data;
+  const gfloat                 *Gx         = data->Gx;
+  const gfloat                 *Gy         = data->Gy;
+  gfloat                       *divergence = data->divergence;
+  const guint                   width      = data->extent->width;
+  guint                         x, y;
+
+  for (y = offset; y < offset + size; ++y)
+    {
+      for (x = 0; x < width; ++x)
+        {
+          divergence[x + y * width] = Gx[x + y * width] + Gy[x + y * width];
+          if (x > 0) divergence[x + y * width] -= Gx[x - 1 + (y    ) * width];
+          if (y > 0) divergence[x + y * width] -= Gy[x     + (y - 1) * width];
+        }
+    }
+}
+
+
 static void
 fattal02_tonemap (const gfloat        *input,   /* Y */
                   const GeglRectangle *extent,
@@ -1076,33 +1430,33 @@ fattal02_tonemap (const gfloat        *input,   /* Y */
                   gfloat               beta,
                   gfloat               noise)
 {
-  gint     height = extent->height,
-           width  = extent->width,
-           size   = height * width;
-  gint     x, y, i;
-  gfloat  *H, *FI, *Gx, *Gy, *divergence, *U;
-  gint     levels;
-  gfloat **pyramid;
-  gfloat **gradient,
-          *averages;
+  gint                    height = extent->height,
+                          width  = extent->width,
+                          size   = height * width;
+  gint                    i;
+  gfloat                 *H, *FI, *Gx, *Gy, *divergence, *U;
+  gint                    levels;
+  gfloat                **pyramid;
+  gfloat                **gradient,
+                         *averages;
+  Fattal02MapData         map;
+  Fattal02DivergenceData  div;
 
   /* find max & min values, normalize to range 0..100 and take logarithm */
   {
-    gfloat min_input = G_MAXFLOAT,
-           max_input = G_MINFLOAT;
+    gfloat min_input,
+           max_input;
 
-    for (i = 0; i < size; ++i)
-      {
-        min_input = MIN (min_input, input[i]);
-        max_input = MAX (max_input, input[i]);
-      }
+    tonemap_min_max (input, size, &min_input, &max_input);
+    max_input = MAX (max_input, G_MINFLOAT);
     g_return_if_fail (min_input <= max_input);
 
     H = g_new (gfloat, size);
-    for (i = 0; i < size; ++i)
-      {
-        H[i] = log (100.0f * input[i] / max_input + 1e-4f);
-      }
+
+    map.input  = input;
+    map.output = H;
+    map.max    = max_input;
+    tonemap_distribute (size, fattal02_log_range, &map);
   }
 
   GEGL_NOTE (GEGL_DEBUG_PROCESS, "calculating attenuation matrix");
@@ -1143,33 +1497,21 @@ fattal02_tonemap (const gfloat        *input,   /* Y */
   Gx = g_new (gfloat, size);
   Gy = g_new (gfloat, size);
 
-  for (y = 0; y < extent->height; ++y)
-    {
-      for (x = 0; x < extent->width; ++x)
-        {
-          guint s = (y + 1 == height ? y : y + 1),
-            e = (x + 1 ==  width ? x : x + 1);
-
-          Gx[x + y * width] = ( H[e + y * width] - H[x + y * width]) *
-                               FI[x + y * width];
-          Gy[x + y * width] = ( H[x + s * width] - H[x + y * width]) *
-                               FI[x + y * width];
-        }
-    }
+  div.H      = H;
+  div.FI     = FI;
+  div.Gx     = Gx;
+  div.Gy     = Gy;
+  div.extent = extent;
+  tonemap_distribute_rows (height, width,
+                           fattal02_attenuate_gradients_rows, &div);
 
   GEGL_NOTE (GEGL_DEBUG_PROCESS, "compressing gradients");
 
   /* calculate divergence */
   divergence = g_new (gfloat, size);
-  for (y = 0; y < height; ++y)
-    {
-      for (x = 0; x < width; ++x)
-        {
-          divergence[x + y * width] = Gx[x + y * width] + Gy[x + y * width];
-          if (x > 0) divergence[x + y * width] -= Gx[x - 1 + (y    ) * width];
-          if (y > 0) divergence[x + y * width] -= Gy[x     + (y - 1) * width];
-        }
-    }
+
+  div.divergence = divergence;
+  tonemap_distribute_rows (height, width, fattal02_divergence_rows, &div);
 
   GEGL_NOTE (GEGL_DEBUG_PROCESS, "recovering image");
 
@@ -1177,25 +1519,16 @@ fattal02_tonemap (const gfloat        *input,   /* Y */
   U = g_new (gfloat, size);
   fattal02_solve_pde_multigrid (divergence, extent, U, extent);
 
-  for (i = 0; i < size; ++i)
-    output[i] = expf (U[i]) - 1e-4f;
-
-  {
-    gfloat min, max, range;
+  map.input  = U;
+  map.output = output;
+  tonemap_distribute (size, fattal02_exp_range, &map);
 
-    /* remove percentile of min and max values and renormalize */
-    fattal02_find_percentiles (output, size,
-                               0.001f, &min,
-                               0.995f, &max);
-    range = max - min;
+  /* remove percentile of min and max values and renormalize */
+  fattal02_find_percentiles (output, size,
+                             0.001f, &map.min,
+                             0.995f, &map.max);
 
-    for (i = 0; i < size; ++i)
-      {
-        output[i] = (output[i] - min) / range;
-        if (output[i] <= 0.0f)
-            output[i] = 1e-4f;
-      }
-  }
+  tonemap_distribute (size, fattal02_normalize_range, &map);
 
   /* clean up */
   g_free (H);
@@ -1245,6 +1578,37 @@ fattal02_get_required_for_output (GeglOperation       *operation,
   return fattal02_get_cached_region (operation, roi);
 }
 
+typedef struct
+{
+  gfloat       *pix;
+  const gfloat *lum_in;
+  const gfloat *lum_out;
+  gfloat        saturation;
+} Fattal02ColorData;
+
+static void
+fattal02_color_range (gsize    offset,
+                      gsize    size,
+                      gpointer user_data)
+{
+  const Fattal02ColorData *data       = user_data;
+  const gint               pix_stride = 3; /* RGB */
+  gsize                    i;
+  gint                     c;
+
+  for (i = offset; i < offset + size; ++i)
+    {
+      for (c = 0; c < pix_stride; ++c)
+        {
+          gfloat *pix = data->pix + i * pix_stride + c;
+
+          *pix = (powf (*pix / data->lum_in[i],
+                        data->saturation) *
+                  data->lum_out[i]);
+        }
+    }
+}
+
 static gboolean
 fattal02_process (GeglOperation       *operation,
                   GeglBuffer          *input,
@@ -1256,12 +1620,15 @@ fattal02_process (GeglOperation       *operation,
   gfloat            noise;
   const Babl *out_format = gegl_operation_get_format (operation, "output");
   const Babl *space = babl_format_get_space (out_format);
+  const Babl *lum_format = babl_format_with_space ("Y float", space);
 
   const gint  pix_stride = 3; /* RGBA */
   gfloat     *lum_in,
              *lum_out,
              *pix;
-  gint        i;
+  GeglRectangle     solve_rect;
+  gdouble           scale;
+  Fattal02ColorData color;
 
   g_return_val_if_fail (operation, FALSE);
   g_return_val_if_fail (input, FALSE);
@@ -1284,21 +1651,54 @@ fattal02_process (GeglOperation       *operation,
   lum_in  = g_new (gfloat, result->width * result->height);
   lum_out = g_new (gfloat, result->width * result->height);
 
-  gegl_buffer_get (input, result, 1.0, babl_format_with_space ("Y float", space),
+  gegl_buffer_get (input, result, 1.0, lum_format,
                    lum_in, GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
 
   pix = g_new (gfloat, result->width * result->height * pix_stride);
   gegl_buffer_get (input, result, 1.0, out_format,
                    pix, GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
 
-  fattal02_tonemap (lum_in, result, lum_out, o->alpha, o->beta, noise);
+  scale = tonemap_get_solve_rect (result, o->solve_scale, &solve_rect);
 
-  for (i = 0; i < result->width * result->height * pix_stride; ++i)
+  if (scale < 1.0)
     {
-      pix[i] = (powf (pix[i] / lum_in[i / pix_stride],
-                      o->saturation) *
-                lum_out[i / pix_stride]);
+      /* tone map a downscaled luminance, and apply the gain it got to
+       * the full size one.
+       */
+      gint    solve_size = solve_rect.width * solve_rect.height;
+      gfloat *solve_in   = g_new (gfloat, solve_size);
+      gfloat *solve_out  = g_new (gfloat, solve_size);
+      gfloat  min, max;
+
+      gegl_buffer_get (input, &solve_rect, scale, lum_format,
+                       solve_in, GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+      fattal02_tonemap (solve_in, &solve_rect, solve_out,
+                        o->alpha, o->beta, noise);
+
+      /* the tone mapping clips the luminance at about 1e-6 of its maximum */
+      tonemap_min_max (solve_in, solve_size, &min, &max);
+
+      fattal02_copy_array (lum_in, result->width * result->height, lum_out);
+      tonemap_apply_gain (lum_out, result->width, result->height,
+                          solve_in, solve_out,
+                          solve_rect.width, solve_rect.height,
+                          1e-6f * max);
+
+      g_free (solve_in);
+      g_free (solve_out);
     }
+  else
+    {
+      fattal02_tonemap (lum_in, result, lum_out, o->alpha, o->beta, noise);
+    }
+
+  color.pix        = pix;
+  color.lum_in     = lum_in;
+  color.lum_out    = lum_out;
+  color.saturation = o->saturation;
+  tonemap_distribute (result->width * result->height,
+                      fattal02_color_range, &color);
 
   gegl_buffer_set (output, result, 0, out_format, pix,
                    GEGL_AUTO_ROWSTRIDE);
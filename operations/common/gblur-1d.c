@@ -78,19 +78,13 @@ property_boolean (clip_extent, _("Clip to the input extent"), TRUE)
  *
  **********************************************/
 
-typedef void (*IirYoungBlur1dFunc) (gfloat           *buf,
-                                    gdouble          *tmp,
-                                    const gdouble    *b,
-                                    gdouble         (*m)[3],
-                                    const gfloat     *iminus,
-                                    const gfloat     *uplus,
-                                    const gint        len,
-                                    const gint        components,
-                                    GeglAbyssPolicy   policy);
-
-static const gfloat white[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
-static const gfloat black[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
-static const gfloat none[4]  = { 0.0f, 0.0f, 0.0f, 0.0f };
+/* the number of rows, or columns, blurred together */
+#define IIR_N_LINES 8
+
+/* wide enough for the five components of "camayakaA float" */
+static const gfloat white[5] = { 1.0f, 1.0f, 1.0f, 1.0f, 1.0f };
+static const gfloat black[5] = { 0.0f, 0.0f, 0.0f, 1.0f, 1.0f };
+static const gfloat none[5]  = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
 
 static void
 iir_young_find_constants (gfloat   sigma,
@@ -138,472 +132,137 @@ get_boundaries (GeglAbyssPolicy   policy,
                 gfloat           *buf,
                 gint              len,
                 gint              nc,
-                const gfloat    **out_iminus,
-                const gfloat    **out_uplus)
+                gint              n_lines,
+                gfloat           *iminus,
+                gfloat           *uplus)
 {
-  const gfloat *iminus;
-  const gfloat *uplus;
+  const gint n = n_lines * nc;
+  gint       l;
 
   switch (policy)
     {
     case GEGL_ABYSS_CLAMP:
     default:
-      iminus = &buf[nc * 3]; uplus = &buf[nc * (len + 2)];
-      break;
+      memcpy (iminus, &buf[n * 3],         n * sizeof (gfloat));
+      memcpy (uplus,  &buf[n * (len + 2)], n * sizeof (gfloat));
+      return;
 
     case GEGL_ABYSS_NONE:
-      iminus = uplus = &none[0];
+      for (l = 0; l < n_lines; l++)
+        {
+          memcpy (&iminus[l * nc], &none[0], nc * sizeof (gfloat));
+          memcpy (&uplus[l * nc],  &none[0], nc * sizeof (gfloat));
+        }
       break;
 
     case GEGL_ABYSS_WHITE:
-      iminus = uplus = &white[0];
-      break;
-
-    case GEGL_ABYSS_BLACK:
-      iminus = uplus = &black[nc == 2 ? 2 : 0];
-      break;
-    }
-
-  if (out_iminus != NULL)
-    *out_iminus = iminus;
-
-  if (out_uplus != NULL)
-    *out_uplus = uplus;
-}
-
-static inline void
-fix_right_boundary_y (gdouble        *buf,
-                      gdouble       (*m)[3],
-                      const gfloat   *uplus)
-{
-  gdouble u[3] = { buf[-1] - uplus[0],
-                   buf[-2] - uplus[0],
-                   buf[-3] - uplus[0] };
-  gint    i, k;
-
-  for (i = 0; i < 3; i++)
-    {
-      gdouble tmp = 0.;
-
-      for (k = 0; k < 3; k++)
-        tmp += m[i][k] * u[k];
-
-      buf[i] = tmp + uplus[0];
-    }
-}
-
-static void
-iir_young_blur_1D_y (gfloat        *buf,
-                     gdouble       *tmp,
-                     const gdouble *b,
-                     gdouble      (*m)[3],
-                     const gfloat  *iminus,
-                     const gfloat  *uplus,
-                     const gint     len,
-                     const gint     components,
-                     GeglAbyssPolicy policy)
-{
-  gint    i, j;
-
-  for (i = 0; i < 3; i++, tmp++)
-    tmp[0] = iminus[0];
-
-  buf += 3;
-
-  for (i = 3; i < 3 + len; i++, buf++, tmp++)
-    {
-      tmp[0] = b[0] * buf[0];
-
-      for (j = 1; j < 4; ++j)
+      for (l = 0; l < n_lines; l++)
         {
-          gint offset = -1 * j;
-          tmp[0] += b[j] * tmp[offset + 0];
+          memcpy (&iminus[l * nc], &white[0], nc * sizeof (gfloat));
+          memcpy (&uplus[l * nc],  &white[0], nc * sizeof (gfloat));
         }
-    }
-
-  fix_right_boundary_y (tmp, m, uplus);
-
-  buf--;
-  tmp--;
-
-  for (i = 3 + len - 1; 3 <= i; i--, buf--, tmp--)
-    {
-      tmp[0] *= b[0];
+      break;
 
-      for (j = 1; j < 4; ++j)
+    case GEGL_ABYSS_BLACK:
+      for (l = 0; l < n_lines; l++)
         {
-          gint offset = j;
-          tmp[0] += b[j] * tmp[offset + 0];
+          memcpy (&iminus[l * nc], &black[nc == 2 ? 2 : 0], nc * sizeof (gfloat));
+          memcpy (&uplus[l * nc],  &black[nc == 2 ? 2 : 0], nc * sizeof (gfloat));
         }
-
-      buf[0] = tmp[0];
+      break;
     }
 }
 
 static inline void
-fix_right_boundary_yA (gdouble        *buf,
-                       gdouble       (*m)[3],
-                       const gfloat   *uplus)
+fix_right_boundary (gdouble        *buf,
+                    gdouble       (*m)[3],
+                    const gfloat   *uplus,
+                    const gint      n)
 {
-  gdouble u[6] = { buf[-2] - uplus[0], buf[-1] - uplus[1],
-                   buf[-4] - uplus[0], buf[-3] - uplus[1],
-                   buf[-6] - uplus[0], buf[-5] - uplus[1] };
-  gint    i, k;
+  gint i, k, c;
 
   for (i = 0; i < 3; i++)
     {
-      gdouble tmp[2] = { 0.0, 0.0 };
-
-      for (k = 0; k < 3; k++)
+      for (c = 0; c < n; c++)
         {
-          tmp[0] += m[i][k] * u[k * 2 + 0];
-          tmp[1] += m[i][k] * u[k * 2 + 1];
-        }
+          gdouble tmp = 0.0;
 
-      buf[2 * i + 0] = tmp[0] + uplus[0];
-      buf[2 * i + 1] = tmp[1] + uplus[1];
-    }
-}
+          for (k = 0; k < 3; k++)
+            tmp += m[i][k] * (buf[(-k - 1) * n + c] - uplus[c]);
 
-static void
-iir_young_blur_1D_yA (gfloat           *buf,
-                      gdouble          *tmp,
-                      const gdouble    *b,
-                      gdouble         (*m)[3],
-                      const gfloat     *iminus,
-                      const gfloat     *uplus,
-                      const gint        len,
-                      const gint        components,
-                      GeglAbyssPolicy   policy)
-{
-  gint    i, j;
-
-  for (i = 0; i < 3; i++, tmp += 2)
-    {
-      tmp[0] = iminus[0];
-      tmp[1] = iminus[1];
-    }
-
-  buf += 6;
-
-  for (i = 3; i < 3 + len; i++, buf += 2, tmp += 2)
-    {
-      tmp[0] = b[0] * buf[0];
-      tmp[1] = b[0] * buf[1];
-
-      for (j = 1; j < 4; ++j)
-        {
-          gint offset = -2 * j;
-
-          tmp[0] += b[j] * tmp[offset + 0];
-          tmp[1] += b[j] * tmp[offset + 1];
-        }
-    }
-
-  fix_right_boundary_yA (tmp, m, uplus);
-
-  buf -= 2;
-  tmp -= 2;
-
-  for (i = 3 + len - 1; 3 <= i; i--, buf -= 2, tmp -= 2)
-    {
-      tmp[0] *= b[0];
-      tmp[1] *= b[0];
-
-      for (j = 1; j < 4; ++j)
-        {
-          gint offset = 2 * j;
-
-          tmp[0] += b[j] * tmp[offset + 0];
-          tmp[1] += b[j] * tmp[offset + 1];
-        }
-
-      buf[0] = tmp[0];
-      buf[1] = tmp[1];
-    }
-}
-
-
-static inline void
-fix_right_boundary_generic (gdouble        *buf,
-                            gdouble       (*m)[3],
-                            const gfloat   *uplus,
-                            const gint      nc)
-{
-  gdouble u[nc*3];
-  gint    i, k, c;
-
-  for (k = 0; k < 3; k++)
-    for (c = 0; c < nc; c++)
-   u[k * nc + c] = buf[(-k-1)*nc+c] - uplus[c];
-
-  for (i = 0; i < 3; i++)
-    {
-      gdouble tmp[nc];
-      for (c = 0; c < nc ; c++)
-        tmp[c] = m[i][0] * u[0 * nc + c];
-
-      for (k = 1; k < 3; k++)
-        {
-          for (c = 0; c < nc ; c++)
-            tmp[c] += m[i][k] * u[k * nc + c];
+          buf[n * i + c] = tmp + uplus[c];
         }
-
-      for (c = 0; c < nc ; c++)
-        buf[nc * i + c] = tmp[c] + uplus[c];
     }
 }
 
+/* Blurs n_lines lines at once.  Their pixels are interleaved in @buf, the
+ * pixel of each line at a given position following the one of the
+ * previous line, such that each step of the recursion is computed for
+ * all the lines, and all their components, in a single vectorizable loop.
+ * @n is the number of lines times the number of components.
+ */
 static void
-iir_young_blur_1D_generic (gfloat           *buf,
-                           gdouble          *tmp,
-                           const gdouble    *b,
-                           gdouble         (*m)[3],
-                           const gfloat     *iminus,
-                           const gfloat     *uplus,
-                           const gint        len,
-                           const gint        components,
-                           GeglAbyssPolicy   policy)
+iir_young_blur_1D (gfloat           *buf,
+                   gdouble          *tmp,
+                   const gdouble    *b,
+                   gdouble         (*m)[3],
+                   const gfloat     *iminus,
+                   const gfloat     *uplus,
+                   const gint        len,
+                   const gint        n)
 {
   gint    i, j, c;
-  for (i = 0; i < 3; i++, tmp += components)
+
+  for (i = 0; i < 3; i++, tmp += n)
     {
-      for (c = 0; c < components; c++)
+      for (c = 0; c < n; c++)
         tmp[c] = iminus[c];
     }
 
-  buf += 3 * components;
+  buf += 3 * n;
 
-  for (i = 0; i < len; i++, buf += components, tmp += components)
+  for (i = 0; i < len; i++, buf += n, tmp += n)
     {
-      for (c = 0; c < components; c++)
+      for (c = 0; c < n; c++)
         tmp[c] = b[0] * buf[c];
 
       for (j = 1; j < 4; ++j)
         {
-          gint offset = -components * j;
+          const gdouble *prev = tmp - n * j;
 
-          for (c = 0; c < components; c++)
-            tmp[c] += b[j] * tmp[offset + c];
+          for (c = 0; c < n; c++)
+            tmp[c] += b[j] * prev[c];
         }
     }
 
-  fix_right_boundary_generic (tmp, m, uplus, components);
+  fix_right_boundary (tmp, m, uplus, n);
 
-  buf -= components;
-  tmp -= components;
+  buf -= n;
+  tmp -= n;
 
-  for (i = 3 + len - 1; 3 <= i; i--, buf -= components, tmp -= components)
+  for (i = 3 + len - 1; 3 <= i; i--, buf -= n, tmp -= n)
     {
-      for (c = 0; c < components; c++)
+      for (c = 0; c < n; c++)
         tmp[c] *= b[0];
 
       for (j = 1; j < 4; ++j)
         {
-          gint offset = components * j;
+          const gdouble *next = tmp + n * j;
 
-          for (c = 0; c < components; c++)
-            tmp[c] += b[j] * tmp[offset + c];
+          for (c = 0; c < n; c++)
+            tmp[c] += b[j] * next[c];
         }
 
-      for (c = 0; c < components; c++)
+      for (c = 0; c < n; c++)
         buf[c] = tmp[c];
     }
 }
 
-static inline void
-fix_right_boundary_rgb (gdouble        *buf,
-                        gdouble       (*m)[3],
-                        const gfloat   *uplus)
-{
-  gdouble u[9] = { buf[-3] - uplus[0], buf[-2] - uplus[1], buf[-1] - uplus[2],
-                   buf[-6] - uplus[0], buf[-5] - uplus[1], buf[-4] - uplus[2],
-                   buf[-9] - uplus[0], buf[-8] - uplus[1], buf[-7] - uplus[2] };
-  gint    i, k;
-
-  for (i = 0; i < 3; i++)
-    {
-      gdouble tmp[3] = { 0.0, 0.0, 0.0 };
-
-      for (k = 0; k < 3; k++)
-        {
-          tmp[0] += m[i][k] * u[k * 3 + 0];
-          tmp[1] += m[i][k] * u[k * 3 + 1];
-          tmp[2] += m[i][k] * u[k * 3 + 2];
-        }
-
-      buf[3 * i + 0] = tmp[0] + uplus[0];
-      buf[3 * i + 1] = tmp[1] + uplus[1];
-      buf[3 * i + 2] = tmp[2] + uplus[2];
-    }
-}
-
-static void
-iir_young_blur_1D_rgb (gfloat           *buf,
-                       gdouble          *tmp,
-                       const gdouble    *b,
-                       gdouble         (*m)[3],
-                       const gfloat     *iminus,
-                       const gfloat     *uplus,
-                       const gint        len,
-                       const gint        components,
-                       GeglAbyssPolicy   policy)
-{
-  gint    i, j;
-
-  for (i = 0; i < 3; i++, tmp += 3)
-    {
-      tmp[0] = iminus[0];
-      tmp[1] = iminus[1];
-      tmp[2] = iminus[2];
-    }
-
-  buf += 9;
-
-  for (i = 3; i < 3 + len; i++, buf += 3, tmp += 3)
-    {
-      tmp[0] = b[0] * buf[0];
-      tmp[1] = b[0] * buf[1];
-      tmp[2] = b[0] * buf[2];
-
-      for (j = 1; j < 4; ++j)
-        {
-          gint offset = -3 * j;
-
-          tmp[0] += b[j] * tmp[offset + 0];
-          tmp[1] += b[j] * tmp[offset + 1];
-          tmp[2] += b[j] * tmp[offset + 2];
-        }
-    }
-
-  fix_right_boundary_rgb (tmp, m, uplus);
-
-  buf -= 3;
-  tmp -= 3;
-
-  for (i = 3 + len - 1; 3 <= i; i--, buf -= 3, tmp -= 3)
-    {
-      tmp[0] *= b[0];
-      tmp[1] *= b[0];
-      tmp[2] *= b[0];
-
-      for (j = 1; j < 4; ++j)
-        {
-          gint offset = 3 * j;
-
-          tmp[0] += b[j] * tmp[offset + 0];
-          tmp[1] += b[j] * tmp[offset + 1];
-          tmp[2] += b[j] * tmp[offset + 2];
-        }
-
-      buf[0] = tmp[0];
-      buf[1] = tmp[1];
-      buf[2] = tmp[2];
-    }
-}
-
-static inline void
-fix_right_boundary_rgbA (gdouble        *buf,
-                         gdouble       (*m)[3],
-                         const gfloat   *uplus)
-{
-  gdouble u[12] = { buf[-4] - uplus[0], buf[-3] - uplus[1], buf[-2] - uplus[2], buf[-1] - uplus[3],
-                    buf[-8] - uplus[0], buf[-7] - uplus[1], buf[-6] - uplus[2], buf[-5] - uplus[3],
-                    buf[-12] - uplus[0], buf[-11] - uplus[1], buf[-10] - uplus[2], buf[-9] - uplus[3] };
-  gint    i, k;
-
-  for (i = 0; i < 3; i++)
-    {
-      gdouble tmp[4] = { 0.0, 0.0, 0.0, 0.0 };
-
-      for (k = 0; k < 3; k++)
-        {
-          tmp[0] += m[i][k] * u[k * 4 + 0];
-          tmp[1] += m[i][k] * u[k * 4 + 1];
-          tmp[2] += m[i][k] * u[k * 4 + 2];
-          tmp[3] += m[i][k] * u[k * 4 + 3];
-        }
-
-      buf[4 * i + 0] = tmp[0] + uplus[0];
-      buf[4 * i + 1] = tmp[1] + uplus[1];
-      buf[4 * i + 2] = tmp[2] + uplus[2];
-      buf[4 * i + 3] = tmp[3] + uplus[3];
-    }
-}
-
-static void
-iir_young_blur_1D_rgbA (gfloat           *buf,
-                        gdouble          *tmp,
-                        const gdouble    *b,
-                        gdouble         (*m)[3],
-                        const gfloat     *iminus,
-                        const gfloat     *uplus,
-                        const gint        len,
-                        const gint        components,
-                        GeglAbyssPolicy   policy)
-{
-  gint     i, j;
-
-  for (i = 0; i < 3; i++, tmp += 4)
-    {
-      tmp[0] = iminus[0];
-      tmp[1] = iminus[1];
-      tmp[2] = iminus[2];
-      tmp[3] = iminus[3];
-    }
-
-  buf += 12;
-
-  for (i = 0; i < len; i++, buf += 4, tmp += 4)
-    {
-      tmp[0] = b[0] * buf[0];
-      tmp[1] = b[0] * buf[1];
-      tmp[2] = b[0] * buf[2];
-      tmp[3] = b[0] * buf[3];
-
-      for (j = 1; j < 4; ++j)
-        {
-          gint offset = -4 * j;
-
-          tmp[0] += b[j] * tmp[offset + 0];
-          tmp[1] += b[j] * tmp[offset + 1];
-          tmp[2] += b[j] * tmp[offset + 2];
-          tmp[3] += b[j] * tmp[offset + 3];
-        }
-    }
-
-  fix_right_boundary_rgbA (tmp, m, uplus);
-
-  buf -= 4;
-  tmp -= 4;
-
-  for (i = 3 + len - 1; 3 <= i; i--, buf -= 4, tmp -= 4)
-    {
-      tmp[0] *= b[0];
-      tmp[1] *= b[0];
-      tmp[2] *= b[0];
-      tmp[3] *= b[0];
-
-      for (j = 1; j < 4; ++j)
-        {
-          gint offset = 4 * j;
-
-          tmp[0] += b[j] * tmp[offset + 0];
-          tmp[1] += b[j] * tmp[offset + 1];
-          tmp[2] += b[j] * tmp[offset + 2];
-          tmp[3] += b[j] * tmp[offset + 3];
-        }
-
-      buf[0] = tmp[0];
-      buf[1] = tmp[1];
-      buf[2] = tmp[2];
-      buf[3] = tmp[3];
-    }
-}
-
+/* The rows are read IIR_N_LINES at a time, and transposed into the
+ * interleaved layout of iir_young_blur_1D(), a pixel at a time, and back.
+ */
 static void
-iir_young_hor_blur (IirYoungBlur1dFunc   real_blur_1D,
-                    GeglBuffer          *src,
+iir_young_hor_blur (GeglBuffer          *src,
                     const GeglRectangle *rect,
                     GeglBuffer          *dst,
                     const gdouble       *b,
@@ -612,38 +271,64 @@ iir_young_hor_blur (IirYoungBlur1dFunc   real_blur_1D,
                     const Babl          *format,
                     gint                 level)
 {
-  GeglRectangle  cur_row = *rect;
-  const gint     nc = babl_format_get_n_components (format);
-  gfloat        *row = g_new (gfloat, (3 + rect->width + 3) * nc);
-  gdouble       *tmp = g_new (gdouble, (3 + rect->width + 3) * nc);
+  GeglRectangle  cur_rows = *rect;
+  const gint     nc     = babl_format_get_n_components (format);
+  const gint     stride = IIR_N_LINES * nc;
+  gfloat        *rows   = g_new (gfloat, rect->width * stride);
+  gfloat        *buf    = g_new (gfloat, (3 + rect->width + 3) * stride);
+  gdouble       *tmp    = g_new (gdouble, (3 + rect->width + 3) * stride);
+  gfloat         iminus[IIR_N_LINES * 5];
+  gfloat         uplus[IIR_N_LINES * 5];
   gint           v;
 
-  cur_row.height = 1;
-
-  for (v = 0; v < rect->height; v++)
+  for (v = 0; v < rect->height; v += IIR_N_LINES)
     {
-      const gfloat *iminus;
-      const gfloat *uplus;
+      gint n_lines = MIN (IIR_N_LINES, rect->height - v);
+      gint n       = n_lines * nc;
+      gint l, x;
 
-      cur_row.y = rect->y + v;
+      cur_rows.y      = rect->y + v;
+      cur_rows.height = n_lines;
 
-      gegl_buffer_get (src, &cur_row, 1.0/(1<<level), format, &row[3 * nc],
+      gegl_buffer_get (src, &cur_rows, 1.0/(1<<level), format, rows,
                        GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
 
-      get_boundaries (policy, row, rect->width, nc, &iminus, &uplus);
-      real_blur_1D (row, tmp, b, m, iminus, uplus, rect->width, nc, policy);
+      for (l = 0; l < n_lines; l++)
+        {
+          const gfloat *row = rows + l * rect->width * nc;
+
+          for (x = 0; x < rect->width; x++)
+            memcpy (&buf[(3 + x) * n + l * nc], &row[x * nc],
+                    nc * sizeof (gfloat));
+        }
+
+      get_boundaries (policy, buf, rect->width, nc, n_lines, iminus, uplus);
+      iir_young_blur_1D (buf, tmp, b, m, iminus, uplus, rect->width, n);
 
-      gegl_buffer_set (dst, &cur_row, level, format, &row[3 * nc],
+      for (l = 0; l < n_lines; l++)
+        {
+          gfloat *row = rows + l * rect->width * nc;
+
+          for (x = 0; x < rect->width; x++)
+            memcpy (&row[x * nc], &buf[(3 + x) * n + l * nc],
+                    nc * sizeof (gfloat));
+        }
+
+      gegl_buffer_set (dst, &cur_rows, level, format, rows,
                        GEGL_AUTO_ROWSTRIDE);
     }
 
   g_free (tmp);
-  g_free (row);
+  g_free (buf);
+  g_free (rows);
 }
 
+/* The columns are read IIR_N_LINES at a time, which is already the
+ * interleaved layout of iir_young_blur_1D(), and reads whole spans of the
+ * rows rather than a single pixel of each.
+ */
 static void
-iir_young_ver_blur (IirYoungBlur1dFunc   real_blur_1D,
-                    GeglBuffer          *src,
+iir_young_ver_blur (GeglBuffer          *src,
                     const GeglRectangle *rect,
                     GeglBuffer          *dst,
                     const gdouble       *b,
@@ -652,33 +337,35 @@ iir_young_ver_blur (IirYoungBlur1dFunc   real_blur_1D,
                     const Babl          *format,
                     gint                 level)
 {
-  GeglRectangle  cur_col = *rect;
-  const gint     nc = babl_format_get_n_components (format);
-  gfloat        *col = g_new (gfloat, (3 + rect->height + 3) * nc);
-  gdouble       *tmp = g_new (gdouble, (3 + rect->height + 3) * nc);
+  GeglRectangle  cur_cols = *rect;
+  const gint     nc     = babl_format_get_n_components (format);
+  const gint     stride = IIR_N_LINES * nc;
+  gfloat        *cols   = g_new (gfloat, (3 + rect->height + 3) * stride);
+  gdouble       *tmp    = g_new (gdouble, (3 + rect->height + 3) * stride);
+  gfloat         iminus[IIR_N_LINES * 5];
+  gfloat         uplus[IIR_N_LINES * 5];
   gint           i;
 
-  cur_col.width = 1;
-
-  for (i = 0; i < rect->width; i++)
+  for (i = 0; i < rect->width; i += IIR_N_LINES)
     {
-      const gfloat *iminus;
-      const gfloat *uplus;
+      gint n_lines = MIN (IIR_N_LINES, rect->width - i);
+      gint n       = n_lines * nc;
 
-      cur_col.x = rect->x + i;
+      cur_cols.x     = rect->x + i;
+      cur_cols.width = n_lines;
 
-      gegl_buffer_get (src, &cur_col, 1.0/(1<<level), format, &col[3 * nc],
+      gegl_buffer_get (src, &cur_cols, 1.0/(1<<level), format, &cols[3 * n],
                        GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
 
-      get_boundaries (policy, col, rect->height, nc, &iminus, &uplus);
-      real_blur_1D (col, tmp, b, m, iminus, uplus, rect->height, nc, policy);
+      get_boundaries (policy, cols, rect->height, nc, n_lines, iminus, uplus);
+      iir_young_blur_1D (cols, tmp, b, m, iminus, uplus, rect->height, n);
 
-      gegl_buffer_set (dst, &cur_col, level, format, &col[3 * nc],
+      gegl_buffer_set (dst, &cur_cols, level, format, &cols[3 * n],
                        GEGL_AUTO_ROWSTRIDE);
     }
 
   g_free (tmp);
-  g_free (col);
+  g_free (cols);
 }
 
 
@@ -688,6 +375,9 @@ iir_young_ver_blur (IirYoungBlur1dFunc   real_blur_1D,
  *
  **********************************************/
 
+/* the number of columns blurred together */
+#define FIR_N_LINES 16
+
 static inline void
 fir_blur_1D (const gfloat *input,
                    gfloat *output,
@@ -755,6 +445,10 @@ fir_hor_blur (GeglBuffer          *src,
   gegl_free (row);
 }
 
+/* The columns are read FIR_N_LINES at a time, transposed into rows, such
+ * that each column is blurred by fir_blur_1D() as a contiguous row, while
+ * the buffer is read and written whole spans of the rows at a time.
+ */
 static void
 fir_ver_blur (GeglBuffer          *src,
               const GeglRectangle *rect,
@@ -765,35 +459,44 @@ fir_ver_blur (GeglBuffer          *src,
               const Babl          *format,
               gint                 level)
 {
-  GeglRectangle  cur_col = *rect;
-  GeglRectangle  in_col;
+  GeglRectangle  cur_cols = *rect;
+  GeglRectangle  in_cols;
   const gint     nc = babl_format_get_n_components (format);
-  gfloat        *col;
+  gfloat        *cols;
   gfloat        *out;
   gint           v;
 
-  cur_col.width = 1;
+  in_cols         = cur_cols;
+  in_cols.height += clen - 1;
+  in_cols.y      -= clen / 2;
 
-  in_col         = cur_col;
-  in_col.height += clen - 1;
-  in_col.y      -= clen / 2;
+  cols = gegl_malloc (sizeof (gfloat) * FIR_N_LINES * in_cols.height  * nc);
+  out  = gegl_malloc (sizeof (gfloat) * FIR_N_LINES * cur_cols.height * nc);
 
-  col = gegl_malloc (sizeof (gfloat) * in_col.height  * nc);
-  out = gegl_malloc (sizeof (gfloat) * cur_col.height * nc);
-
-  for (v = 0; v < rect->width; v++)
+  for (v = 0; v < rect->width; v += FIR_N_LINES)
     {
-      cur_col.x = in_col.x = rect->x + v;
+      gint n_lines = MIN (FIR_N_LINES, rect->width - v);
+      gint i;
 
-      gegl_buffer_get (src, &in_col, 1.0/(1<<level), format, col, GEGL_AUTO_ROWSTRIDE, policy);
+      cur_cols.x     = in_cols.x     = rect->x + v;
+      cur_cols.width = in_cols.width = n_lines;
 
-      fir_blur_1D (col, out, cmatrix, clen, rect->height, nc);
+      gegl_buffer_get_transposed (src, &in_cols, 1.0/(1<<level), format, cols,
+                                  GEGL_AUTO_ROWSTRIDE, policy);
 
-      gegl_buffer_set (dst, &cur_col, level, format, out, GEGL_AUTO_ROWSTRIDE);
+      for (i = 0; i < n_lines; i++)
+        {
+          fir_blur_1D (cols + i * in_cols.height * nc,
+                       out  + i * cur_cols.height * nc,
+                       cmatrix, clen, rect->height, nc);
+        }
+
+      gegl_buffer_set_transposed (dst, &cur_cols, level, format, out,
+                                  GEGL_AUTO_ROWSTRIDE);
     }
 
   gegl_free (out);
-  gegl_free (col);
+  gegl_free (cols);
 }
 
 
@@ -1026,10 +729,8 @@ static void
 gegl_gblur_1d_prepare (GeglOperation *operation)
 {
   const Babl *space = gegl_operation_get_source_space (operation, "input");
-  GeglProperties *o = GEGL_PROPERTIES (operation);
   const Babl *src_format = gegl_operation_get_source_format (operation, "input");
   const char *format     = "RaGaBaA float";
-  o->user_data = iir_young_blur_1D_rgbA;
 
   /*
    * FIXME: when the abyss policy is _NONE, the behavior at the edge
@@ -1043,28 +744,23 @@ gegl_gblur_1d_prepare (GeglOperation *operation)
           babl_model_is (model, "R'G'B'"))
         {
           format = "RGB float";
-          o->user_data = iir_young_blur_1D_rgb;
         }
       else if (babl_model_is (model, "Y") || babl_model_is (model, "Y'"))
         {
           format = "Y float";
-          o->user_data = iir_young_blur_1D_y;
         }
       else if (babl_model_is (model, "YA") || babl_model_is (model, "Y'A") ||
                babl_model_is (model, "YaA") || babl_model_is (model, "Y'aA"))
         {
           format = "YaA float";
-          o->user_data = iir_young_blur_1D_yA;
         }
       else if (babl_model_is (model, "cmyk"))
         {
           format = "cmyk float";
-          o->user_data = iir_young_blur_1D_generic;
         }
       else if (babl_model_is (model, "CMYK"))
         {
           format = "CMYK float";
-          o->user_data = iir_young_blur_1D_generic;
         }
       else if (babl_model_is (model, "cmykA") ||
                babl_model_is (model, "camayakaA") ||
@@ -1072,7 +768,6 @@ gegl_gblur_1d_prepare (GeglOperation *operation)
                babl_model_is (model, "CaMaYaKaA"))
         {
           format = "camayakaA float";
-          o->user_data = iir_young_blur_1D_generic;
         }
     }
 
@@ -1289,15 +984,14 @@ gegl_gblur_1d_process (GeglOperation       *operation,
 
   if (filter == GEGL_GBLUR_1D_IIR)
     {
-      IirYoungBlur1dFunc real_blur_1D = (IirYoungBlur1dFunc) o->user_data;
       gdouble b[4], m[3][3];
 
       iir_young_find_constants (std_dev, b, m);
 
       if (o->orientation == GEGL_ORIENTATION_HORIZONTAL)
-        iir_young_hor_blur (real_blur_1D, input, result, output, b, m, abyss_policy, format, level);
+        iir_young_hor_blur (input, result, output, b, m, abyss_policy, format, level);
       else
-        iir_young_ver_blur (real_blur_1D, input, result, output, b, m, abyss_policy, format, level);
+        iir_young_ver_blur (input, result, output, b, m, abyss_policy, format, level);
     }
   else
     {
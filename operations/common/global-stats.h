@@ -0,0 +1,380 @@
+/* This file is an image processing operation for GEGL
+ *
+ * GEGL is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * GEGL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* Statistics over a whole input, for operations which map each pixel
+ * according to them, such as the contrast stretching operations.
+ *
+ * The statistics are gathered in parallel, and cached against the
+ * revision of the input buffer, such that rendering different parts of
+ * the output only reads the whole input once.  The operation can then be
+ * threaded, and only cache the requested region: its operation_process()
+ * calls global_stats_cache_get() before chaining up, which gathers the
+ * statistics using all threads, and its process() calls it again for
+ * each of the areas it is split into, which then hits the cache.
+ */
+
+#include <string.h>
+
+#define GLOBAL_STATS_MAX_COMPONENTS 4
+
+typedef enum
+{
+  GLOBAL_STATS_MIN_MAX   = 1 << 0,
+  GLOBAL_STATS_MEAN      = 1 << 1, /* the mean and variance */
+  GLOBAL_STATS_HISTOGRAM = 1 << 2
+} GlobalStatsFlags;
+
+typedef struct
+{
+  /* what to gather, set by the caller */
+  GlobalStatsFlags  flags;
+  gint              n_bins;   /* the histogram has n_bins bins per */
+  gfloat            bins_min; /* component, spanning [bins_min, bins_max], */
+  gfloat            bins_max; /* values outside of which go to the ends */
+
+  /* the statistics, per component */
+  gint              n_components;
+  gint64            n_pixels;
+  gfloat            min[GLOBAL_STATS_MAX_COMPONENTS];
+  gfloat            max[GLOBAL_STATS_MAX_COMPONENTS];
+  gdouble           mean[GLOBAL_STATS_MAX_COMPONENTS];
+  gdouble           variance[GLOBAL_STATS_MAX_COMPONENTS];
+  gint64           *histogram; /* n_components * n_bins, owned */
+} GlobalStats;
+
+typedef struct
+{
+  GMutex         mutex;
+
+  /* what the statistics were gathered from; the buffer is only compared,
+   * its revision telling whether its content is still the same.
+   */
+  gboolean       valid;
+  GeglBuffer    *buffer;
+  guint          revision;
+  GeglRectangle  rect;
+  const Babl    *format;
+
+  GlobalStats    stats;
+} GlobalStatsCache;
+
+
+typedef struct
+{
+  GMutex               mutex;
+  GeglBuffer          *buffer;
+  const GeglRectangle *rect;
+  const Babl          *format;
+  GlobalStats         *stats;
+  gdouble             *row_sums; /* 2 * n_components per row */
+} GlobalStatsData;
+
+static void
+global_stats_area (const GeglRectangle *area,
+                   gpointer             user_data)
+{
+  GlobalStatsData    *data  = user_data;
+  GlobalStats        *stats = data->stats;
+  const gint          n     = stats->n_components;
+  gfloat              min[GLOBAL_STATS_MAX_COMPONENTS];
+  gfloat              max[GLOBAL_STATS_MAX_COMPONENTS];
+  gint64             *histogram = NULL;
+  gfloat              bins_scale = 0.0f;
+  GeglBufferIterator *iter;
+  gint                c;
+
+  for (c = 0; c < n; c++)
+    {
+      min[c] =  G_MAXFLOAT;
+      max[c] = -G_MAXFLOAT;
+    }
+
+  if (stats->flags & GLOBAL_STATS_HISTOGRAM)
+    {
+      histogram  = g_new0 (gint64, n * stats->n_bins);
+      bins_scale = stats->n_bins / (stats->bins_max - stats->bins_min);
+    }
+
+  iter = gegl_buffer_iterator_new (data->buffer, area, 0, data->format,
+                                   GEGL_ACCESS_READ, GEGL_ABYSS_NONE, 1);
+
+  while (gegl_buffer_iterator_next (iter))
+    {
+      const GeglRectangle *roi = &iter->items[0].roi;
+      const gfloat        *in  = iter->items[0].data;
+      gint                 x, y;
+
+      if (stats->flags & GLOBAL_STATS_MIN_MAX)
+        {
+          const gfloat *p = in;
+          gint          i;
+
+          for (i = 0; i < iter->length; i++)
+            {
+              for (c = 0; c < n; c++)
+                {
+                  min[c] = MIN (min[c], p[c]);
+                  max[c] = MAX (max[c], p[c]);
+                }
+
+              p += n;
+            }
+        }
+
+      /* the sums are accumulated per row, one value at a time, so that
+       * they don't depend on how the area is split.
+       */
+      if (stats->flags & GLOBAL_STATS_MEAN)
+        {
+          const gfloat *p = in;
+
+          for (y = 0; y < roi->height; y++)
+            {
+              gdouble *sums = data->row_sums +
+                              (gsize) 2 * n * (roi->y + y - data->rect->y);
+
+              for (x = 0; x < roi->width; x++)
+                {
+                  for (c = 0; c < n; c++)
+                    {
+                      sums[2 * c]     += p[c];
+                      sums[2 * c + 1] += (gdouble) p[c] * p[c];
+                    }
+
+                  p += n;
+                }
+            }
+        }
+
+      if (histogram)
+        {
+          const gfloat *p = in;
+          gint          i;
+
+          for (i = 0; i < iter->length; i++)
+            {
+              for (c = 0; c < n; c++)
+                {
+                  gint bin = (p[c] - stats->bins_min) * bins_scale;
+
+                  bin = CLAMP (bin, 0, stats->n_bins - 1);
+
+                  histogram[c * stats->n_bins + bin]++;
+                }
+
+              p += n;
+            }
+        }
+    }
+
+  g_mutex_lock (&data->mutex);
+
+  for (c = 0; c < n; c++)
+    {
+      stats->min[c] = MIN (stats->min[c], min[c]);
+      stats->max[c] = MAX (stats->max[c], max[c]);
+    }
+
+  if (histogram)
+    {
+      gint i;
+
+      for (i = 0; i < n * stats->n_bins; i++)
+        stats->histogram[i] += histogram[i];
+    }
+
+  g_mutex_unlock (&data->mutex);
+
+  g_free (histogram);
+}
+
+/* Gathers the statistics of @rect of @buffer, in @format, which has to be
+ * a float format of at most GLOBAL_STATS_MAX_COMPONENTS components, for
+ * @operation.  The statistics to gather are given by the flags and
+ * histogram parameters of @stats, which have to be set beforehand.
+ */
+static void
+global_stats_gather (GeglOperation       *operation,
+                     GeglBuffer          *buffer,
+                     const GeglRectangle *rect,
+                     const Babl          *format,
+                     GlobalStats         *stats)
+{
+  GlobalStatsData data;
+  const gint      n = babl_format_get_n_components (format);
+  gdouble         pixels_per_thread;
+  gint            c;
+
+  g_return_if_fail (n <= GLOBAL_STATS_MAX_COMPONENTS);
+  g_return_if_fail (babl_format_get_bytes_per_pixel (format) ==
+                    n * sizeof (gfloat));
+
+  stats->n_components = n;
+  stats->n_pixels     = (gint64) rect->width * rect->height;
+  stats->histogram    = NULL;
+
+  for (c = 0; c < n; c++)
+    {
+      stats->min[c]      =  G_MAXFLOAT;
+      stats->max[c]      = -G_MAXFLOAT;
+      stats->mean[c]     = 0.0;
+      stats->variance[c] = 0.0;
+    }
+
+  if (stats->flags & GLOBAL_STATS_HISTOGRAM)
+    {
+      g_return_if_fail (stats->n_bins > 0 &&
+                        stats->bins_max > stats->bins_min);
+
+      stats->histogram = g_new0 (gint64, n * stats->n_bins);
+    }
+
+  if (! stats->n_pixels)
+    return;
+
+  pixels_per_thread = gegl_operation_get_pixels_per_thread (operation);
+
+  g_mutex_init (&data.mutex);
+  data.buffer   = buffer;
+  data.rect     = rect;
+  data.format   = format;
+  data.stats    = stats;
+  data.row_sums = NULL;
+
+  if (stats->flags & GLOBAL_STATS_MEAN)
+    data.row_sums = g_new0 (gdouble, (gsize) 2 * n * rect->height);
+
+  /* each row has to be in a single area, see global_stats_area() */
+  gegl_parallel_distribute_area (rect, pixels_per_thread,
+                                 GEGL_SPLIT_STRATEGY_HORIZONTAL,
+                                 global_stats_area, &data);
+
+  if (data.row_sums)
+    {
+      gdouble sums[2 * GLOBAL_STATS_MAX_COMPONENTS] = { 0.0, };
+      gint    y;
+
+      for (y = 0; y < rect->height; y++)
+        {
+          for (c = 0; c < 2 * n; c++)
+            sums[c] += data.row_sums[2 * n * y + c];
+        }
+
+      for (c = 0; c < n; c++)
+        {
+          stats->mean[c]     = sums[2 * c] / stats->n_pixels;
+          stats->variance[c] = MAX (sums[2 * c + 1] / stats->n_pixels -
+                                    stats->mean[c] * stats->mean[c], 0.0);
+        }
+
+      g_free (data.row_sums);
+    }
+
+  g_mutex_clear (&data.mutex);
+}
+
+/* frees the histogram of @stats */
+static void
+global_stats_clear (GlobalStats *stats)
+{
+  g_clear_pointer (&stats->histogram, g_free);
+}
+
+static void
+global_stats_copy (GlobalStats       *dest,
+                   const GlobalStats *src)
+{
+  *dest = *src;
+
+  if (src->histogram)
+    {
+      gsize n = (gsize) src->n_components * src->n_bins;
+
+      dest->histogram = g_new (gint64, n);
+      memcpy (dest->histogram, src->histogram, n * sizeof (gint64));
+    }
+}
+
+
+static GlobalStatsCache *
+global_stats_cache_new (void)
+{
+  GlobalStatsCache *cache = g_slice_new0 (GlobalStatsCache);
+
+  g_mutex_init (&cache->mutex);
+
+  return cache;
+}
+
+static void
+global_stats_cache_free (GlobalStatsCache *cache)
+{
+  global_stats_clear (&cache->stats);
+  g_mutex_clear (&cache->mutex);
+
+  g_slice_free (GlobalStatsCache, cache);
+}
+
+/* Stores the statistics of @rect of @buffer in @stats, like
+ * global_stats_gather(), gathering them only if @cache doesn't hold them
+ * yet.  The result has to be freed using global_stats_clear().
+ */
+static void
+global_stats_cache_get (GlobalStatsCache    *cache,
+                        GeglOperation       *operation,
+                        GeglBuffer          *buffer,
+                        const GeglRectangle *rect,
+                        const Babl          *format,
+                        GlobalStats         *stats)
+{
+  guint revision;
+
+  g_mutex_lock (&cache->mutex);
+
+  revision = gegl_buffer_get_revision (buffer);
+
+  if (! cache->valid                                      ||
+      cache->buffer   != buffer                           ||
+      cache->revision != revision                         ||
+      cache->format   != format                           ||
+      ! gegl_rectangle_equal (&cache->rect, rect)         ||
+      cache->stats.flags != stats->flags                  ||
+      ((stats->flags & GLOBAL_STATS_HISTOGRAM)            &&
+       (cache->stats.n_bins   != stats->n_bins            ||
+        cache->stats.bins_min != stats->bins_min          ||
+        cache->stats.bins_max != stats->bins_max)))
+    {
+      global_stats_clear (&cache->stats);
+
+      cache->stats.flags    = stats->flags;
+      cache->stats.n_bins   = stats->n_bins;
+      cache->stats.bins_min = stats->bins_min;
+      cache->stats.bins_max = stats->bins_max;
+
+      global_stats_gather (operation, buffer, rect, format, &cache->stats);
+
+      /* a cancelled render may have skipped parts of the input */
+      cache->valid    = ! gegl_parallel_is_cancelled ();
+      cache->buffer   = buffer;
+      cache->revision = revision;
+      cache->rect     = *rect;
+      cache->format   = format;
+    }
+
+  global_stats_copy (stats, &cache->stats);
+
+  g_mutex_unlock (&cache->mutex);
+}
@@ -51,6 +51,7 @@ gegl_op_class_init (GeglOpClass *klass)
     "name"       , "gegl:invert-gamma",
     "title",      _("Invert in Perceptual space"),
     "categories" , "color",
+    "position-independent", "true",
     "reference-hash", "db07b9d85f2786db29560bd50ae0e7a1",
     "description",
        _("Invert the components (except alpha) perceptually, "
@@ -54,6 +54,7 @@ gegl_op_class_init (GeglOpClass *klass)
     "title",       _("Invert"),
     "compat-name", "gegl:invert",
     "categories" , "color",
+    "position-independent", "true",
     "reference-hash", "3fc7e35d7a5c45b9e55bc2d15890005a",
     "description",
        _("Invert the components (except alpha) in linear light, "
@@ -199,6 +199,7 @@ gegl_op_class_init (GeglOpClass *klass)
     "name",        "gegl:levels",
     "title",       _("Levels"),
     "categories" , "color",
+    "position-independent", "true",
     "description", _("Remaps the intensity range of the image"),
     "reference-hash", "52e9dca541181f09f6cfac68afe987a2",
     "reference-composition", composition,
@@ -38,6 +38,12 @@ property_double (detail, _("Detail"), 1.0)
     description (_("Level of emphasis on image gradient details"))
     value_range (1.0, 99.0)
 
+property_double (solve_scale, _("Solve scale"), 1.0)
+    description (_("Scale at which the luminance is tone mapped, the "
+                   "result being upsampled to the full size. Lower values "
+                   "are faster, at the cost of the finest details"))
+    value_range (0.01, 1.0)
+
 #else
 
 #define GEGL_OP_FILTER
@@ -48,11 +54,7 @@ property_double (detail, _("Detail"), 1.0)
 #include <stdio.h>
 #include <stdlib.h>
 
-#ifdef HAVE_OPENMP
-#define _OMP(x) _Pragma(#x)
-#else
-#define _OMP(x) /* OMP disabled: "#x" */
-#endif
+#include "tonemap-common.h"
 
 /* Common return codes for operators */
 #define PFSTMO_OK 1             /* Successful */
@@ -223,17 +225,25 @@ static gfloat R_table[] =
 };
 
 
-/* upsample the matrix
- * upsampled matrix is twice bigger in each direction than data[]
- * res should be a pointer to allocated memory for bigger matrix
- * cols and rows are the dimmensions of the output matrix
- */
+typedef struct
+{
+  gint          cols;
+  gint          rows;
+  const gfloat *in;
+  gfloat       *out;
+} Mantiuk06MatrixData;
+
+
 static void
-mantiuk06_matrix_upsample (const gint          outCols,
-                           const gint          outRows,
-                           const gfloat *const in,
-                           gfloat       *const out)
+mantiuk06_matrix_upsample_rows (gsize    offset,
+                                gsize    size,
+                                gpointer user_data)
 {
+  const Mantiuk06MatrixData *data    = user_data;
+  const gint                 outCols = data->cols;
+  const gint                 outRows = data->rows;
+  const gfloat              *in      = data->in;
+  gfloat                    *out     = data->out;
   const int inRows = outRows/2;
   const int inCols = outCols/2;
   gint      x, y;
@@ -252,8 +262,7 @@ mantiuk06_matrix_upsample (const gint          outCols,
                                          * best.
                                          */
 
-  _OMP (omp parallel for schedule(static))
-  for (y = 0; y < outRows; y++)
+  for (y = offset; y < (gint) (offset + size); y++)
     {
       const gfloat sy  = y * dy;
       const gint   iy1 =      (  y   * inRows) / outRows;
@@ -275,13 +284,34 @@ mantiuk06_matrix_upsample (const gint          outCols,
 }
 
 
-/* downsample the matrix */
+/* upsample the matrix
+ * upsampled matrix is twice bigger in each direction than data[]
+ * res should be a pointer to allocated memory for bigger matrix
+ * cols and rows are the dimmensions of the output matrix
+ */
 static void
-mantiuk06_matrix_downsample (const gint          inCols,
-                             const gint          inRows,
-                             const gfloat *const data,
-                             gfloat       *const res)
+mantiuk06_matrix_upsample (const gint          outCols,
+                           const gint          outRows,
+                           const gfloat *const in,
+                           gfloat       *const out)
 {
+  Mantiuk06MatrixData data = { outCols, outRows, in, out };
+
+  tonemap_distribute_rows (outRows, outCols,
+                           mantiuk06_matrix_upsample_rows, &data);
+}
+
+
+static void
+mantiuk06_matrix_downsample_rows (gsize    offset,
+                                  gsize    size,
+                                  gpointer user_data)
+{
+  const Mantiuk06MatrixData *data   = user_data;
+  const gint                 inCols = data->cols;
+  const gint                 inRows = data->rows;
+  const gfloat              *in     = data->in;
+  gfloat                    *res    = data->out;
   const int outRows = inRows / 2;
   const int outCols = inCols / 2;
   gint      x, y, i, j;
@@ -307,8 +337,8 @@ mantiuk06_matrix_downsample (const gint          inCols,
    */
 
   const gfloat normalize = 1.0f/(dx*dy);
-  _OMP (omp parallel for schedule(static))
-  for (y = 0; y < outRows; y++)
+
+  for (y = offset; y < (gint) (offset + size); y++)
     {
       const gint   iy1 = (  y   * inRows) / outRows;
       const gint   iy2 = ((y+1) * inRows) / outRows;
@@ -361,7 +391,7 @@ mantiuk06_matrix_downsample (const gint          inCols,
                       factorx = 1.0f;
                     }
 
-                  pixVal += data[j + i*inCols] * factorx * factory;
+                  pixVal += in[j + i*inCols] * factorx * factory;
                 }
             }
 
@@ -372,17 +402,27 @@ mantiuk06_matrix_downsample (const gint          inCols,
 }
 
 
+/* downsample the matrix */
+static void
+mantiuk06_matrix_downsample (const gint          inCols,
+                             const gint          inRows,
+                             const gfloat *const data,
+                             gfloat       *const res)
+{
+  Mantiuk06MatrixData matrix = { inCols, inRows, data, res };
+
+  tonemap_distribute_rows (inRows / 2, inCols / 2,
+                           mantiuk06_matrix_downsample_rows, &matrix);
+}
+
+
 /* return = a - b */
 static inline void
 mantiuk06_matrix_subtract (const guint         n,
                            const gfloat *const a,
                            gfloat       *const b)
 {
-  guint i;
-
-  _OMP (omp parallel for schedule(static))
-  for (i = 0; i < n; i++)
-    b[i] = a[i] - b[i];
+  tonemap_axpby (n, 1.0f, a, -1.0f, b);
 }
 
 /* copy matix a to b, return = a  */
@@ -400,10 +440,7 @@ mantiuk06_matrix_multiply_const (const guint         n,
                                  gfloat       *const a,
                                  const gfloat        val)
 {
-  guint i;
-  _OMP (omp parallel for schedule(static))
-  for (i = 0; i < n; i++)
-    a[i] *= val;
+  tonemap_axpby (n, 0.0f, NULL, val, a);
 }
 
 /* b = a[i] / b[i] */
@@ -413,7 +450,7 @@ mantiuk06_matrix_divide (const guint         n,
                          gfloat       *const b)
 {
   guint i;
-  _OMP (omp parallel for schedule(static))
+
   for (i = 0; i < n; i++)
       b[i] = a[i] / b[i];
 }
@@ -438,14 +475,7 @@ mantiuk06_matrix_dot_product (const guint         n,
                               const gfloat *const a,
                               const gfloat *const b)
 {
-  gfloat val = 0;
-  guint j;
-
-  _OMP (omp parallel for reduction(+:val) schedule(static))
-  for (j = 0; j < n; j++)
-    val += a[j] * b[j];
-
-  return val;
+  return tonemap_dot_product (a, b, n);
 }
 
 /* set zeros for matrix elements */
@@ -456,20 +486,27 @@ mantiuk06_matrix_zero (guint   n,
   memset(m, 0, n * sizeof (gfloat));
 }
 
-/* calculate divergence of two gradient maps (Gx and Gy)
- * divG(x,y) = Gx(x,y) - Gx(x-1,y) + Gy(x,y) - Gy(x,y-1)
- */
-static inline void
-mantiuk06_calculate_and_add_divergence (const gint          cols,
-                                        const gint          rows,
-                                        const gfloat *const Gx,
-                                        const gfloat *const Gy,
-                                        gfloat       *const divG)
+typedef struct
 {
-  gint ky, kx;
+  gint          cols;
+  const gfloat *Gx;
+  const gfloat *Gy;
+  gfloat       *divG;
+} Mantiuk06DivergenceData;
 
-  _OMP (omp parallel for schedule(static))
-  for (ky = 0; ky < rows; ky++)
+static void
+mantiuk06_calculate_and_add_divergence_rows (gsize    offset,
+                                             gsize    size,
+                                             gpointer user_data)
+{
+  const Mantiuk06DivergenceData *data = user_data;
+  const gint                     cols = data->cols;
+  const gfloat                  *Gx   = data->Gx;
+  const gfloat                  *Gy   = data->Gy;
+  gfloat                        *divG = data->divG;
+  gint                           ky, kx;
+
+  for (ky = offset; ky < (gint) (offset + size); ky++)
     {
       for (kx = 0; kx<cols; kx++)
         {
@@ -491,6 +528,22 @@ mantiuk06_calculate_and_add_divergence (const gint          cols,
     }
 }
 
+/* calculate divergence of two gradient maps (Gx and Gy)
+ * divG(x,y) = Gx(x,y) - Gx(x-1,y) + Gy(x,y) - Gy(x,y-1)
+ */
+static inline void
+mantiuk06_calculate_and_add_divergence (const gint          cols,
+                                        const gint          rows,
+                                        const gfloat *const Gx,
+                                        const gfloat *const Gy,
+                                        gfloat       *const divG)
+{
+  Mantiuk06DivergenceData data = { cols, Gx, Gy, divG };
+
+  tonemap_distribute_rows (rows, cols,
+                           mantiuk06_calculate_and_add_divergence_rows, &data);
+}
+
 /* calculate the sum of divergences for the all pyramid level. the smaller
  * divergence map is upsamled and added to the divergence map for the higher
  * level of pyramid.
@@ -559,23 +612,28 @@ mantiuk06_pyramid_calculate_divergence_sum (pyramid_t *pyramid,
   mantiuk06_matrix_free (temp);
 }
 
-/* calculate scale factors (Cx,Cy) for gradients (Gx,Gy)
- * C is equal to EDGE_WEIGHT for gradients smaller than GFIXATE or
- * 1.0 otherwise
- */
-static inline void
-mantiuk06_calculate_scale_factor (const gint          n,
-                                  const gfloat *const G,
-                                  gfloat       *const C)
+typedef struct
 {
+  gfloat       *a;
+  const gfloat *b;
+} Mantiuk06ArrayData;
+
+static void
+mantiuk06_calculate_scale_factor_range (gsize    offset,
+                                        gsize    size,
+                                        gpointer user_data)
+{
+  const Mantiuk06ArrayData *data = user_data;
+  gfloat                   *C    = data->a;
+  const gfloat             *G    = data->b;
+
   const gfloat detectT = 0.001f;
   const gfloat a = 0.038737;
   const gfloat b = 0.537756;
 
-  gint i;
+  gsize i;
 
-  _OMP (omp parallel for schedule(static))
-  for (i = 0; i < n; i++)
+  for (i = offset; i < offset + size; i++)
     {
 #if 1
       const gfloat g = MAX (detectT, fabsf (G[i]));
@@ -592,6 +650,20 @@ mantiuk06_calculate_scale_factor (const gint          n,
     }
 }
 
+/* calculate scale factors (Cx,Cy) for gradients (Gx,Gy)
+ * C is equal to EDGE_WEIGHT for gradients smaller than GFIXATE or
+ * 1.0 otherwise
+ */
+static inline void
+mantiuk06_calculate_scale_factor (const gint          n,
+                                  const gfloat *const G,
+                                  gfloat       *const C)
+{
+  Mantiuk06ArrayData data = { C, G };
+
+  tonemap_distribute (n, mantiuk06_calculate_scale_factor_range, &data);
+}
+
 /* calculate scale factor for the whole pyramid */
 static void
 mantiuk06_pyramid_calculate_scale_factor (pyramid_t *pyramid,
@@ -610,15 +682,28 @@ mantiuk06_pyramid_calculate_scale_factor (pyramid_t *pyramid,
 /* Scale gradient (Gx and Gy) by C (Cx and Cy)
  * G = G / C
  */
+static void
+mantiuk06_scale_gradient_range (gsize    offset,
+                                gsize    size,
+                                gpointer user_data)
+{
+  const Mantiuk06ArrayData *data = user_data;
+  gfloat                   *G    = data->a;
+  const gfloat             *C    = data->b;
+  gsize                     i;
+
+  for (i = offset; i < offset + size; i++)
+    G[i] *= C[i];
+}
+
 static inline void
 mantiuk06_scale_gradient (const gint          n,
                           gfloat       *const G,
                           const gfloat *const C)
 {
-  gint i;
-  _OMP (omp parallel for schedule(static))
-  for (i = 0; i < n; i++)
-    G[i] *= C[i];
+  Mantiuk06ArrayData data = { G, C };
+
+  tonemap_distribute (n, mantiuk06_scale_gradient_range, &data);
 }
 
 /* scale gradients for the whole one pyramid with the use of (Cx,Cy) from the
@@ -695,18 +780,29 @@ mantiuk06_pyramid_allocate (int cols,
 }
 
 
-/* calculate gradients */
-static inline void
-mantiuk06_calculate_gradient (const gint          cols,
-                              const gint          rows,
-                              const gfloat *const lum,
-                              gfloat       *const Gx,
-                              gfloat       *const Gy)
+typedef struct
 {
-  gint ky, kx;
+  gint          cols;
+  gint          rows;
+  const gfloat *lum;
+  gfloat       *Gx;
+  gfloat       *Gy;
+} Mantiuk06GradientData;
 
-  _OMP (omp parallel for schedule(static))
-  for (ky = 0; ky < rows; ky++)
+static void
+mantiuk06_calculate_gradient_rows (gsize    offset,
+                                   gsize    size,
+                                   gpointer user_data)
+{
+  const Mantiuk06GradientData *data = user_data;
+  const gint                   cols = data->cols;
+  const gint                   rows = data->rows;
+  const gfloat                *lum  = data->lum;
+  gfloat                      *Gx   = data->Gx;
+  gfloat                      *Gy   = data->Gy;
+  gint                         ky, kx;
+
+  for (ky = offset; ky < (gint) (offset + size); ky++)
     {
       for (kx = 0; kx < cols; kx++)
         {
@@ -725,6 +821,20 @@ mantiuk06_calculate_gradient (const gint          cols,
     }
 }
 
+/* calculate gradients */
+static inline void
+mantiuk06_calculate_gradient (const gint          cols,
+                              const gint          rows,
+                              const gfloat *const lum,
+                              gfloat       *const Gx,
+                              gfloat       *const Gy)
+{
+  Mantiuk06GradientData data = { cols, rows, lum, Gx, Gy };
+
+  tonemap_distribute_rows (rows, cols,
+                           mantiuk06_calculate_gradient_rows, &data);
+}
+
 
 /* calculate gradients for the pyramid
  * lum_temp gets overwritten!
@@ -775,11 +885,7 @@ mantiuk06_solveX (const gint          n,
                   const gfloat *const b,
                   gfloat       *const x)
 {
-  gint i;
-
-  _OMP (omp parallel for schedule(static))
-  for (i = 0; i < n; i++)
-    x[i] = -0.25f * b[i];
+  tonemap_axpby (n, -0.25f, b, 0.0f, x);
 }
 
 /* divG_sum = A * x = sum (divG (x))
@@ -847,7 +953,6 @@ mantiuk06_linbcg (pyramid_t           *pyramid,
 
   for (; iter < itmax; iter++)
     {
-      guint i;
       gfloat bknum, ak, old_err2;
 
       if (progress_cb != NULL)
@@ -868,12 +973,8 @@ mantiuk06_linbcg (pyramid_t           *pyramid,
         {
           const gfloat bk = bknum / bkden; /* beta = ...  */
 
-          _OMP (omp parallel for schedule(static))
-          for (i = 0; i < n; i++)
-            {
-              p[i]  =  z[i] + bk *  p[i];
-              pp[i] = zz[i] + bk * pp[i];
-            }
+          tonemap_axpby (n, 1.0f,  z, bk,  p);
+          tonemap_axpby (n, 1.0f, zz, bk, pp);
         }
 
       bkden = bknum; /* numerator becomes the dominator for the next iteration */
@@ -883,12 +984,8 @@ mantiuk06_linbcg (pyramid_t           *pyramid,
 
       ak = bknum / mantiuk06_matrix_dot_product (n, z, pp); /* alfa = ...   */
 
-      _OMP (omp parallel for schedule(static))
-      for (i = 0 ; i < n ; i++ )
-        {
-          r[i]  -= ak *  z[i];  /*  r =  r - alfa *  z  */
-          rr[i] -= ak * zz[i];  /* rr = rr - alfa * zz  */
-        }
+      tonemap_axpby (n, -ak,  z, 1.0f,  r);  /*  r =  r - alfa *  z  */
+      tonemap_axpby (n, -ak, zz, 1.0f, rr);  /* rr = rr - alfa * zz  */
 
       old_err2 = err2;
       err2 = mantiuk06_matrix_dot_product (n, r, r);
@@ -910,9 +1007,7 @@ mantiuk06_linbcg (pyramid_t           *pyramid,
           num_backwards = 0;
         }
 
-      _OMP (omp parallel for schedule(static))
-      for (i = 0 ; i < n ; i++ )
-        x[i] += ak * p[i];      /* x =  x + alfa * p */
+      tonemap_axpby (n, ak, p, 1.0f, x);  /* x =  x + alfa * p */
 
       if (num_backwards > num_backwards_ceiling)
         {
@@ -1020,7 +1115,6 @@ mantiuk06_lincg (pyramid_t           *pyramid,
   percent_sf = 100.0f / logf (tol2 * bnrm2 / irdotr);
   for (; iter < itmax; iter++)
     {
-      gint  i;
       gfloat alpha, old_rdotr;
 
       if (progress_cb != NULL) {
@@ -1036,9 +1130,7 @@ mantiuk06_lincg (pyramid_t           *pyramid,
       alpha = rdotr / mantiuk06_matrix_dot_product (n, p, Ap);
 
       /* r = r - alpha Ap */
-      _OMP (omp parallel for schedule(static))
-      for (i = 0; i < n; i++)
-        r[i] -= alpha * Ap[i];
+      tonemap_axpby (n, -alpha, Ap, 1.0f, r);
 
       /* rdotr = r.r */
       old_rdotr = rdotr;
@@ -1062,9 +1154,7 @@ mantiuk06_lincg (pyramid_t           *pyramid,
         }
 
       /* x = x + alpha p */
-      _OMP (omp parallel for schedule(static))
-      for (i = 0; i < n; i++)
-        x[i] += alpha * p[i];
+      tonemap_axpby (n, alpha, p, 1.0f, x);
 
 
       /* Exit if we're done */
@@ -1095,9 +1185,7 @@ mantiuk06_lincg (pyramid_t           *pyramid,
           /* p = r + beta p */
           const gfloat beta = rdotr/old_rdotr;
 
-          _OMP (omp parallel for schedule(static))
-          for (i = 0; i < n; i++)
-            p[i] = r[i] + beta*p[i];
+          tonemap_axpby (n, 1.0f, r, beta, p);
         }
     }
 
@@ -1157,15 +1245,16 @@ mantiuk06_lookup_table (const gint          n,
 }
 
 
-/* transform gradient (Gx,Gy) to R */
-static inline void
-mantiuk06_transform_to_R (const gint        n,
-                          gfloat     *const G)
+static void
+mantiuk06_transform_to_R_range (gsize    offset,
+                                gsize    size,
+                                gpointer user_data)
 {
-  gint j;
+  const Mantiuk06ArrayData *data = user_data;
+  gfloat                   *G    = data->a;
+  gsize                     j;
 
-  _OMP (omp parallel for schedule(static))
-  for (j = 0; j < n; j++)
+  for (j = offset; j < offset + size; j++)
     {
       /* G to W */
       const gfloat absG = fabsf (G[j]);
@@ -1189,6 +1278,16 @@ mantiuk06_transform_to_R (const gint        n,
     }
 }
 
+/* transform gradient (Gx,Gy) to R */
+static inline void
+mantiuk06_transform_to_R (const gint        n,
+                          gfloat     *const G)
+{
+  Mantiuk06ArrayData data = { G, NULL };
+
+  tonemap_distribute (n, mantiuk06_transform_to_R_range, &data);
+}
+
 /* transform gradient (Gx,Gy) to R for the whole pyramid */
 static inline void
 mantiuk06_pyramid_transform_to_R (pyramid_t *pyramid)
@@ -1202,15 +1301,16 @@ mantiuk06_pyramid_transform_to_R (pyramid_t *pyramid)
     }
 }
 
-/* transform from R to G */
-static inline void
-mantiuk06_transform_to_G (const gint        n,
-                          gfloat     *const R)
+static void
+mantiuk06_transform_to_G_range (gsize    offset,
+                                gsize    size,
+                                gpointer user_data)
 {
-  gint j;
+  const Mantiuk06ArrayData *data = user_data;
+  gfloat                   *R    = data->a;
+  gsize                     j;
 
-  _OMP (omp parallel for schedule(static))
-  for (j = 0; j < n; j++){
+  for (j = offset; j < offset + size; j++){
     /* RESP to W */
     gint sign;
     if (R[j] < 0)
@@ -1232,6 +1332,16 @@ mantiuk06_transform_to_G (const gint        n,
   }
 }
 
+/* transform from R to G */
+static inline void
+mantiuk06_transform_to_G (const gint        n,
+                          gfloat     *const R)
+{
+  Mantiuk06ArrayData data = { R, NULL };
+
+  tonemap_distribute (n, mantiuk06_transform_to_G_range, &data);
+}
+
 /* transform from R to G for the pyramid */
 static inline void
 mantiuk06_pyramid_transform_to_G (pyramid_t *pyramid)
@@ -1336,13 +1446,60 @@ mantiuk06_hist_data_index (const void *const v1,
 }
 
 
+typedef struct
+{
+  pyramid_t        *level;
+  struct hist_data *hist;
+  gint              offset;
+  gfloat            contrastFactor;
+} Mantiuk06HistogramData;
+
+static void
+mantiuk06_histogram_range (gsize    offset,
+                           gsize    size,
+                           gpointer user_data)
+{
+  const Mantiuk06HistogramData *data = user_data;
+  const pyramid_t              *l    = data->level;
+  struct hist_data             *hist = data->hist + data->offset;
+  gsize                         c;
+
+  for (c = offset; c < offset + size; c++)
+    {
+      hist[c].size = sqrtf (l->Gx[c] * l->Gx[c] +
+                            l->Gy[c] * l->Gy[c]);
+      hist[c].index = c + data->offset;
+    }
+}
+
+static void
+mantiuk06_equalize_range (gsize    offset,
+                          gsize    size,
+                          gpointer user_data)
+{
+  const Mantiuk06HistogramData *data = user_data;
+  pyramid_t                    *l    = data->level;
+  const struct hist_data       *hist = data->hist + data->offset;
+  gsize                         c;
+
+  for (c = offset; c < offset + size; c++)
+    {
+      const gfloat scale = data->contrastFactor *
+                           hist[c].cdf          /
+                           hist[c].size;
+      l->Gx[c] *= scale;
+      l->Gy[c] *= scale;
+    }
+}
+
 static void
 mantiuk06_contrast_equalization (pyramid_t   *pp,
                                  const gfloat  contrastFactor )
 {
-  gint              i, idx;
-  struct hist_data *hist;
-  gint              total_pixels = 0;
+  gint                    i, idx;
+  struct hist_data       *hist;
+  gint                    total_pixels = 0;
+  Mantiuk06HistogramData  data;
 
   /* Count sizes */
   pyramid_t *l = pp;
@@ -1355,22 +1512,20 @@ mantiuk06_contrast_equalization (pyramid_t   *pp,
   /* Allocate memory */
   hist = g_new (struct hist_data, total_pixels);
 
+  data.hist           = hist;
+  data.contrastFactor = contrastFactor;
+
   /* Build histogram info */
   l   = pp;
   idx = 0;
   while (l != NULL)
     {
       const int pixels = l->rows*l->cols;
-      const int offset = idx;
-      gint      c;
 
-      _OMP (omp parallel for schedule(static))
-      for (c = 0; c < pixels; c++)
-        {
-          hist[c+offset].size = sqrtf (l->Gx[c] * l->Gx[c] +
-                                       l->Gy[c] * l->Gy[c]);
-          hist[c+offset].index = c + offset;
-        }
+      data.level  = l;
+      data.offset = idx;
+      tonemap_distribute (pixels, mantiuk06_histogram_range, &data);
+
       idx += pixels;
       l = l->next;
     }
@@ -1382,7 +1537,6 @@ mantiuk06_contrast_equalization (pyramid_t   *pp,
   /* Calculate cdf */
   {
     const gfloat norm = 1.0f / (gfloat) total_pixels;
-    _OMP (omp parallel for schedule(static))
     for (i = 0; i < total_pixels; i++)
       hist[i].cdf = ((gfloat) i) * norm;
   }
@@ -1397,19 +1551,12 @@ mantiuk06_contrast_equalization (pyramid_t   *pp,
   idx = 0;
   while (l != NULL )
     {
-      gint      c;
       const int pixels = l->rows*l->cols;
-      const int offset = idx;
 
-      _OMP (omp parallel for schedule(static))
-      for (c = 0; c < pixels; c++)
-        {
-          const gfloat scale = contrastFactor      *
-                               hist[c+offset].cdf  /
-                               hist[c+offset].size;
-          l->Gx[c] *= scale;
-          l->Gy[c] *= scale;
-        }
+      data.level  = l;
+      data.offset = idx;
+      tonemap_distribute (pixels, mantiuk06_equalize_range, &data);
+
       idx += pixels;
       l    = l->next;
     }
@@ -1418,46 +1565,114 @@ mantiuk06_contrast_equalization (pyramid_t   *pp,
 }
 
 
-/* tone mapping */
-static int
-mantiuk06_contmap (const int                       c,
-                   const int                       r,
-                   gfloat                   *const rgb,
-                   gfloat                   *const Y,
-                   const gfloat                    contrastFactor,
-                   const gfloat                    saturationFactor,
-                   const gboolean                  bcg,
-                   const int                       itmax,
-                   const gfloat                    tol,
-                   pfstmo_progress_callback        progress)
+typedef struct
 {
-  const guint n = c*r;
-        guint j;
+  gfloat  *rgb;
+  gfloat  *Y;
+  gfloat   clip_min;
+  gfloat   saturationFactor;
+  gdouble  l_min;
+  gdouble  l_max;
+} Mantiuk06ContmapData;
 
-  /* Normalize */
-  gfloat Ymax = Y[0],
-         clip_min;
-
-  for (j = 1; j < n; j++)
-      Ymax = MAX (Y[j], Ymax);
+static void
+mantiuk06_normalize_range (gsize    offset,
+                           gsize    size,
+                           gpointer user_data)
+{
+  const Mantiuk06ContmapData *data     = user_data;
+  gfloat                     *rgb      = data->rgb;
+  gfloat                     *Y        = data->Y;
+  const gfloat                clip_min = data->clip_min;
+  gsize                       j;
 
-  clip_min = 1e-7f * Ymax;
-  _OMP (omp parallel for schedule(static))
-  for (j = 0; j < n * 4; j++)
+  for (j = offset * 4; j < (offset + size) * 4; j++)
       if (G_UNLIKELY (rgb[j] < clip_min)) rgb[j] = clip_min;
 
-  _OMP (omp parallel for schedule(static))
-  for (j = 0; j < n; j++)
+  for (j = offset; j < offset + size; j++)
+    {
       if (G_UNLIKELY (  Y[j] < clip_min))   Y[j] = clip_min;
 
-  _OMP (omp parallel for schedule(static))
-  for (j = 0; j < n; j++)
-    {
       rgb[j * 4 + 0] /= Y[j];
       rgb[j * 4 + 1] /= Y[j];
       rgb[j * 4 + 2] /= Y[j];
-      Y[j]            = log10f (Y[j]);
     }
+}
+
+static void
+mantiuk06_log_range (gsize    offset,
+                     gsize    size,
+                     gpointer user_data)
+{
+  const Mantiuk06ContmapData *data = user_data;
+  gfloat                     *Y    = data->Y;
+  gsize                       j;
+
+  for (j = offset; j < offset + size; j++)
+    Y[j] = log10f (MAX (Y[j], data->clip_min));
+}
+
+static void
+mantiuk06_renormalize_range (gsize    offset,
+                             gsize    size,
+                             gpointer user_data)
+{
+  const Mantiuk06ContmapData *data           = user_data;
+  const gdouble               disp_dyn_range = 2.3;
+  gfloat                     *Y              = data->Y;
+  gsize                       j;
+
+  for (j = offset; j < offset + size; j++)
+    {
+      /* x scaled */
+      Y[j] = ( Y[j] - data->l_min) /
+             (data->l_max - data->l_min) *
+             disp_dyn_range - disp_dyn_range;
+
+      Y[j] = powf (10, Y[j]);
+    }
+}
+
+static void
+mantiuk06_color_range (gsize    offset,
+                       gsize    size,
+                       gpointer user_data)
+{
+  const Mantiuk06ContmapData *data             = user_data;
+  gfloat                     *rgb              = data->rgb;
+  const gfloat               *Y                = data->Y;
+  const gfloat                saturationFactor = data->saturationFactor;
+  gsize                       j;
+
+  /* Transform to linear scale RGB */
+  for (j = offset; j < offset + size; j++)
+    {
+      rgb[j * 4 + 0] = powf (rgb[j * 4 + 0], saturationFactor) * Y[j];
+      rgb[j * 4 + 1] = powf (rgb[j * 4 + 1], saturationFactor) * Y[j];
+      rgb[j * 4 + 2] = powf (rgb[j * 4 + 2], saturationFactor) * Y[j];
+    }
+}
+
+
+/* tone map the luminance Y in place, from linear to linear */
+static void
+mantiuk06_contmap_luminance (const int                       c,
+                             const int                       r,
+                             gfloat                   *const Y,
+                             const gfloat                    clip_min,
+                             const gfloat                    contrastFactor,
+                             const gboolean                  bcg,
+                             const int                       itmax,
+                             const gfloat                    tol,
+                             pfstmo_progress_callback        progress)
+{
+  const guint          n = c*r;
+  Mantiuk06ContmapData data;
+
+  data.Y        = Y;
+  data.clip_min = clip_min;
+
+  tonemap_distribute (n, mantiuk06_log_range, &data);
 
   {
     /* create pyramid */
@@ -1491,7 +1706,7 @@ mantiuk06_contmap (const int                       c,
   {
     const gdouble CUT_MARGIN = 0.1;
     gfloat       *temp = mantiuk06_matrix_alloc (n);
-    gdouble       trim, delta, l_min, l_max;
+    gdouble       trim, delta;
 
     /* copy Y to temp */
     mantiuk06_matrix_copy (n, Y, temp);
@@ -1502,36 +1717,81 @@ mantiuk06_contmap (const int                       c,
     /* calculate median */
     trim  = (n - 1) * CUT_MARGIN * 0.01;
     delta = trim - floor (trim);
-    l_min = temp[(int)floor (trim)] * delta +
-            temp[(int) ceil (trim)] * (1.0 - delta);
+    data.l_min = temp[(int)floor (trim)] * delta +
+                 temp[(int) ceil (trim)] * (1.0 - delta);
 
     trim  = (n - 1) * (100.0 - CUT_MARGIN) * 0.01;
     delta = trim - floor (trim);
-    l_max = temp[(int)floor (trim)] * delta +
-            temp[(int) ceil (trim)] * (1.0 - delta);
+    data.l_max = temp[(int)floor (trim)] * delta +
+                 temp[(int) ceil (trim)] * (1.0 - delta);
 
     mantiuk06_matrix_free (temp);
+
+    tonemap_distribute (n, mantiuk06_renormalize_range, &data);
+  }
+}
+
+
+/* tone mapping
+ *
+ * If low_Y is given, it is the luminance Y at a lower resolution of
+ * low_c x low_r pixels, which is tone mapped instead of Y, the change
+ * being upsampled to Y.
+ */
+static int
+mantiuk06_contmap (const int                       c,
+                   const int                       r,
+                   gfloat                   *const rgb,
+                   gfloat                   *const Y,
+                   const int                       low_c,
+                   const int                       low_r,
+                   gfloat                   *const low_Y,
+                   const gfloat                    contrastFactor,
+                   const gfloat                    saturationFactor,
+                   const gboolean                  bcg,
+                   const int                       itmax,
+                   const gfloat                    tol,
+                   pfstmo_progress_callback        progress)
+{
+  const guint          n = c*r;
+  Mantiuk06ContmapData data;
+
+  /* Normalize */
+  gfloat Ymin,
+         Ymax,
+         clip_min;
+
+  tonemap_min_max (Y, n, &Ymin, &Ymax);
+
+  clip_min = 1e-7f * Ymax;
+
+  data.rgb              = rgb;
+  data.Y                = Y;
+  data.clip_min         = clip_min;
+  data.saturationFactor = saturationFactor;
+
+  tonemap_distribute (n, mantiuk06_normalize_range, &data);
+
+  if (low_Y)
     {
-      const gdouble disp_dyn_range = 2.3;
-      _OMP (omp parallel for schedule(static))
-      for (j = 0; j < n; j++)
-          /* x scaled */
-          Y[j] = ( Y[j] - l_min) /
-                 (l_max - l_min) *
-                 disp_dyn_range - disp_dyn_range;
-    }
+      gfloat *low_in = mantiuk06_matrix_alloc (low_c * low_r);
 
-    /* Transform to linear scale RGB */
-    _OMP (omp parallel for schedule(static))
-    for (j = 0; j < n; j++)
-      {
-        Y[j] = powf (10,Y[j]);
+      mantiuk06_matrix_copy (low_c * low_r, low_Y, low_in);
 
-        rgb[j * 4 + 0] = powf (rgb[j * 4 + 0], saturationFactor) * Y[j];
-        rgb[j * 4 + 1] = powf (rgb[j * 4 + 1], saturationFactor) * Y[j];
-        rgb[j * 4 + 2] = powf (rgb[j * 4 + 2], saturationFactor) * Y[j];
-      }
-  }
+      mantiuk06_contmap_luminance (low_c, low_r, low_Y, clip_min,
+                                   contrastFactor, bcg, itmax, tol, progress);
+
+      tonemap_apply_gain (Y, c, r, low_in, low_Y, low_c, low_r, clip_min);
+
+      mantiuk06_matrix_free (low_in);
+    }
+  else
+    {
+      mantiuk06_contmap_luminance (c, r, Y, clip_min,
+                                   contrastFactor, bcg, itmax, tol, progress);
+    }
+
+  tonemap_distribute (n, mantiuk06_color_range, &data);
 
   return PFSTMO_OK;
 }
@@ -1576,7 +1836,9 @@ mantiuk06_process (GeglOperation       *operation,
   const Babl *space = gegl_operation_get_source_space (operation, "input");
   const GeglProperties *o      = GEGL_PROPERTIES (operation);
   const gint            pix_stride = 4; /* RGBA */
-  gfloat               *lum, *pix;
+  gfloat               *lum, *pix, *low_lum = NULL;
+  GeglRectangle         solve_rect;
+  gdouble               scale;
 
   g_return_val_if_fail (operation, FALSE);
   g_return_val_if_fail (input, FALSE);
@@ -1594,7 +1856,18 @@ mantiuk06_process (GeglOperation       *operation,
   gegl_buffer_get (input, result, 1.0, babl_format_with_space (OUTPUT_FORMAT, space),
                    pix, GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
 
+  scale = tonemap_get_solve_rect (result, o->solve_scale, &solve_rect);
+
+  if (scale < 1.0)
+    {
+      low_lum = g_new (gfloat, solve_rect.width * solve_rect.height);
+      gegl_buffer_get (input, &solve_rect, scale,
+                       babl_format_with_space ("Y float", space),
+                       low_lum, GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+    }
+
   mantiuk06_contmap (result->width, result->height, pix, lum,
+                     solve_rect.width, solve_rect.height, low_lum,
                      o->contrast, o->saturation, FALSE, 200, 1e-3, NULL);
 
   /* Cleanup and set the output */
@@ -1602,6 +1875,7 @@ mantiuk06_process (GeglOperation       *operation,
                    GEGL_AUTO_ROWSTRIDE);
   g_free (pix);
   g_free (lum);
+  g_free (low_lum);
 
   return TRUE;
 }
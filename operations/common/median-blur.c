@@ -72,6 +72,14 @@ property_boolean (high_precision, _("High precision"), FALSE)
 #define MAX_CHUNK_WIDTH  128
 #define MAX_CHUNK_HEIGHT 128
 
+/* square neighborhoods of quantized values, of at least this radius, are
+ * processed in constant time per pixel (see process_constant_time()).
+ */
+#define CONSTANT_TIME_MIN_RADIUS 8
+#define N_COARSE_BINS            16
+#define N_FINE_BINS              (DEFAULT_N_BINS / N_COARSE_BINS)
+#define MIN_STRIP_WIDTH          32
+
 #define SAFE_CLAMP(x, min, max) ((x) > (min) ? (x) < (max) ? (x) : (max) : (min))
 
 static gfloat        default_bin_values[DEFAULT_N_BINS];
@@ -108,6 +116,37 @@ typedef struct
   gint                n_color_components;
 } Histogram;
 
+typedef struct
+{
+  gint32 coarse[N_COARSE_BINS];
+  gint32 fine[DEFAULT_N_BINS];
+} ColumnHistogram;
+
+typedef struct
+{
+  ColumnHistogram hist;
+  /* the column at which each segment of fine bins was last brought up to
+   * date, the coarse bins always are.
+   */
+  gint            last_update[N_COARSE_BINS];
+} KernelHistogram;
+
+typedef struct
+{
+  const gint32  *src;
+  gint           src_stride;
+  gfloat        *dst;
+  gint           dst_stride;
+  gint           width;
+  gint           height;
+  gint           radius;
+  gint           n_components;
+  gint           n_color_components;
+  gboolean       has_alpha;
+  gdouble        percentile;
+  gdouble        alpha_percentile;
+} ConstantTimeData;
+
 typedef enum
 {
   LEFT_TO_RIGHT,
@@ -507,6 +546,12 @@ sort_input_values (InputValue **values,
   *scratch = out;
 }
 
+static inline gint32
+quantize_value (gfloat value)
+{
+  return floorf (SAFE_CLAMP (value, 0.0f, 1.0f) * (DEFAULT_N_BINS - 1) + 0.5f);
+}
+
 static void
 convert_values_to_bins (Histogram *hist,
                         gint32    *src,
@@ -530,14 +575,7 @@ convert_values_to_bins (Histogram *hist,
       while (n_pixels--)
         {
           for (c = 0; c < n_components; c++)
-            {
-              gfloat value = ((gfloat *) src)[c];
-              gint   bin;
-
-              bin = floorf (SAFE_CLAMP (value, 0.0f, 1.0f) * (DEFAULT_N_BINS - 1) + 0.5f);
-
-              src[c] = bin;
-            }
+            src[c] = quantize_value (((gfloat *) src)[c]);
 
           src += n_components;
         }
@@ -759,6 +797,321 @@ get_abyss_policy (GeglOperation *operation,
   g_return_val_if_reached (GEGL_ABYSS_NONE);
 }
 
+/* Constant-time median filtering (Perreault and Hebert, 2007).
+ *
+ * Each source column keeps the histogram of the 2 * radius + 1 pixels
+ * around the current row, and moving down a row only adds and removes one
+ * pixel from each of them.  The histogram of the neighborhood is the sum of
+ * 2 * radius + 1 column histograms, and moving right adds one column and
+ * removes another.  Histograms are split into coarse and fine bins: the
+ * coarse bins of the neighborhood are always kept up to date, while a
+ * segment of fine bins is only updated when the median falls into it.  All
+ * of these are fixed-size runs of additions, which the compiler vectorizes.
+ */
+
+static inline void
+column_histogram_modify_val (ColumnHistogram *col,
+                             gint32          *count,
+                             const gint32    *src,
+                             gint             n_color_components,
+                             gboolean         has_alpha,
+                             gint             diff)
+{
+  gint alpha = diff;
+  gint c;
+
+  if (has_alpha)
+    alpha *= default_alpha_values[src[n_color_components]];
+
+  for (c = 0; c < n_color_components; c++)
+    {
+      col[c].fine[src[c]]                 += alpha;
+      col[c].coarse[src[c] / N_FINE_BINS] += alpha;
+    }
+
+  if (has_alpha)
+    {
+      gint bin = src[n_color_components];
+
+      col[n_color_components].fine[bin]                 += diff;
+      col[n_color_components].coarse[bin / N_FINE_BINS] += diff;
+    }
+
+  *count += alpha;
+}
+
+static inline void
+column_histogram_modify_row (ColumnHistogram        *columns,
+                             gint32                 *counts,
+                             const gint32           *src,
+                             gint                    n_columns,
+                             const ConstantTimeData *data,
+                             gint                    diff)
+{
+  gint x;
+
+  for (x = 0; x < n_columns; x++, src += data->n_components)
+    {
+      column_histogram_modify_val (columns + x * data->n_components,
+                                   counts + x, src,
+                                   data->n_color_components,
+                                   data->has_alpha, diff);
+    }
+}
+
+static inline void
+histogram_add (gint32       *bins,
+               const gint32 *add,
+               const gint32 *sub,
+               gint          n_bins)
+{
+  gint i;
+
+  for (i = 0; i < n_bins; i++)
+    bins[i] += add[i] - sub[i];
+}
+
+static inline gfloat
+kernel_histogram_get_median (KernelHistogram       *kernel,
+                             const ColumnHistogram *columns,
+                             gint                   n_components,
+                             gint                   x,
+                             gint                   radius,
+                             gint                   count,
+                             gdouble                percentile)
+{
+  gint32 *fine;
+  gint    sum = 0;
+  gint    k;
+  gint    i;
+
+  if (count == 0)
+    return 0.0f;
+
+  count = (gint) ceil (count * percentile);
+  count = MAX (count, 1);
+
+  for (k = 0; k < N_COARSE_BINS - 1; k++)
+    {
+      if (sum + kernel->hist.coarse[k] >= count)
+        break;
+
+      sum += kernel->hist.coarse[k];
+    }
+
+  fine = kernel->hist.fine + k * N_FINE_BINS;
+
+  /* bring the fine bins of the segment up to date, either from the columns
+   * entering and leaving the neighborhood since, or from scratch if that's
+   * cheaper.
+   */
+  if (x - kernel->last_update[k] > radius)
+    {
+      memset (fine, 0, N_FINE_BINS * sizeof (gint32));
+
+      for (i = x - radius; i <= x + radius; i++)
+        {
+          const gint32 *col = columns[i * n_components].fine +
+                              k * N_FINE_BINS;
+          gint          j;
+
+          for (j = 0; j < N_FINE_BINS; j++)
+            fine[j] += col[j];
+        }
+    }
+  else
+    {
+      for (i = kernel->last_update[k] + 1; i <= x; i++)
+        {
+          histogram_add (fine,
+                         columns[(i + radius)     * n_components].fine +
+                         k * N_FINE_BINS,
+                         columns[(i - radius - 1) * n_components].fine +
+                         k * N_FINE_BINS,
+                         N_FINE_BINS);
+        }
+    }
+
+  kernel->last_update[k] = x;
+
+  for (i = 0; i < N_FINE_BINS - 1; i++)
+    {
+      if ((sum += fine[i]) >= count)
+        break;
+    }
+
+  return default_bin_values[k * N_FINE_BINS + i];
+}
+
+static void
+process_constant_time_strip (gint     i,
+                             gint     n,
+                             gpointer user_data)
+{
+  const ConstantTimeData *data               = user_data;
+  gint                    radius             = data->radius;
+  gint                    n_components       = data->n_components;
+  gint                    n_color_components = data->n_color_components;
+  gint                    x0                 = data->width * i       / n;
+  gint                    width              = data->width * (i + 1) / n - x0;
+  gint                    n_columns          = width + 2 * radius;
+  gint                    size               = (2 * radius + 1) *
+                                               (2 * radius + 1);
+  const gint32           *src                = data->src + x0 * n_components;
+  ColumnHistogram        *columns;
+  KernelHistogram        *kernels;
+  gint32                 *counts;
+  gint                    x, y;
+  gint                    c;
+
+  columns = gegl_scratch_new0 (ColumnHistogram, n_columns * n_components);
+  kernels = gegl_scratch_new (KernelHistogram, n_components);
+  counts  = gegl_scratch_new0 (gint32, n_columns);
+
+  for (y = 0; y < 2 * radius; y++)
+    {
+      column_histogram_modify_row (columns, counts,
+                                   src + y * data->src_stride,
+                                   n_columns, data, +1);
+    }
+
+  for (y = 0; y < data->height; y++)
+    {
+      gfloat *dst   = data->dst + y * data->dst_stride + x0 * n_components;
+      gint    count = 0;
+
+      column_histogram_modify_row (columns, counts,
+                                   src + (y + 2 * radius) * data->src_stride,
+                                   n_columns, data, +1);
+
+      if (y > 0)
+        {
+          column_histogram_modify_row (columns, counts,
+                                       src + (y - 1) * data->src_stride,
+                                       n_columns, data, -1);
+        }
+
+      /* compute the coarse bins of the first neighborhood of the row, the
+       * fine bins are computed on demand.
+       */
+      for (c = 0; c < n_components; c++)
+        {
+          KernelHistogram *kernel = &kernels[c];
+          gint             k;
+
+          memset (kernel->hist.coarse, 0, sizeof (kernel->hist.coarse));
+
+          for (x = 0; x <= 2 * radius; x++)
+            {
+              const gint32 *coarse = columns[x * n_components + c].coarse;
+
+              for (k = 0; k < N_COARSE_BINS; k++)
+                kernel->hist.coarse[k] += coarse[k];
+            }
+
+          for (k = 0; k < N_COARSE_BINS; k++)
+            kernel->last_update[k] = G_MININT / 2;
+        }
+
+      for (x = 0; x <= 2 * radius; x++)
+        count += counts[x];
+
+      for (x = radius; x < width + radius; x++, dst += n_components)
+        {
+          if (x > radius)
+            {
+              for (c = 0; c < n_components; c++)
+                {
+                  histogram_add (kernels[c].hist.coarse,
+                                 columns[(x + radius)     * n_components + c].coarse,
+                                 columns[(x - radius - 1) * n_components + c].coarse,
+                                 N_COARSE_BINS);
+                }
+
+              count += counts[x + radius] - counts[x - radius - 1];
+            }
+
+          for (c = 0; c < n_color_components; c++)
+            {
+              dst[c] = kernel_histogram_get_median (&kernels[c], columns + c,
+                                                    n_components, x, radius,
+                                                    count, data->percentile);
+            }
+          if (data->has_alpha)
+            {
+              dst[c] = kernel_histogram_get_median (&kernels[c], columns + c,
+                                                    n_components, x, radius,
+                                                    size,
+                                                    data->alpha_percentile);
+            }
+        }
+    }
+
+  gegl_scratch_free (counts);
+  gegl_scratch_free (kernels);
+  gegl_scratch_free (columns);
+}
+
+static gboolean
+process_constant_time (GeglOperation       *operation,
+                       GeglBuffer          *input,
+                       GeglBuffer          *output,
+                       const GeglRectangle *roi,
+                       gdouble              percentile,
+                       gdouble              alpha_percentile)
+{
+  GeglProperties   *o      = GEGL_PROPERTIES (operation);
+  const Babl       *format = gegl_operation_get_format (operation, "input");
+  ConstantTimeData  data;
+  GeglRectangle     src_rect;
+  gint32           *src_buf;
+  gfloat           *dst_buf;
+  gint              n_src_values;
+  gint              n_strips;
+  gint              i;
+
+  data.radius             = abs (o->radius);
+  data.n_components       = babl_format_get_n_components (format);
+  data.has_alpha          = babl_format_has_alpha (format);
+  data.n_color_components = data.n_components - data.has_alpha;
+  data.width              = roi->width;
+  data.height             = roi->height;
+  data.percentile         = percentile;
+  data.alpha_percentile   = alpha_percentile;
+
+  src_rect     = gegl_operation_get_required_for_output (operation, "input", roi);
+  n_src_values = src_rect.width * src_rect.height * data.n_components;
+
+  src_buf = gegl_scratch_new (gint32, n_src_values);
+  dst_buf = gegl_scratch_new (gfloat, roi->width * roi->height * data.n_components);
+
+  gegl_buffer_get (input, &src_rect, 1.0, format, src_buf,
+                   GEGL_AUTO_ROWSTRIDE, get_abyss_policy (operation, "input"));
+
+  for (i = 0; i < n_src_values; i++)
+    src_buf[i] = quantize_value (((gfloat *) src_buf)[i]);
+
+  data.src        = src_buf;
+  data.src_stride = src_rect.width * data.n_components;
+  data.dst        = dst_buf;
+  data.dst_stride = roi->width * data.n_components;
+
+  /* split the area into column strips, each overlapping its neighbors by
+   * the diameter of the neighborhood.
+   */
+  n_strips = roi->width / MAX (2 * (2 * data.radius + 1), MIN_STRIP_WIDTH);
+  n_strips = MAX (n_strips, 1);
+
+  gegl_parallel_distribute (n_strips, process_constant_time_strip, &data);
+
+  gegl_buffer_set (output, roi, 0, format, dst_buf, GEGL_AUTO_ROWSTRIDE);
+
+  gegl_scratch_free (dst_buf);
+  gegl_scratch_free (src_buf);
+
+  return TRUE;
+}
+
 static gboolean
 process (GeglOperation       *operation,
          GeglBuffer          *input,
@@ -836,6 +1189,13 @@ process (GeglOperation       *operation,
 
   g_return_val_if_fail (n_color_components == 1 || n_color_components == 3, FALSE);
 
+  if (o->neighborhood == GEGL_MEDIAN_BLUR_NEIGHBORHOOD_SQUARE &&
+      data->quantize && radius >= CONSTANT_TIME_MIN_RADIUS)
+    {
+      return process_constant_time (operation, input, output, roi,
+                                    percentile, alpha_percentile);
+    }
+
   hist = g_slice_new0 (Histogram);
 
   hist->n_components       = n_components;
@@ -846,8 +1206,8 @@ process (GeglOperation       *operation,
   dst_stride   = roi->width * n_components;
   n_src_pixels = src_rect.width * src_rect.height;
   n_dst_pixels = roi->width * roi->height;
-  src_buf = g_new (gint32, n_src_pixels * n_components);
-  dst_buf = g_new (gfloat, n_dst_pixels * n_components);
+  src_buf = gegl_scratch_new (gint32, n_src_pixels * n_components);
+  dst_buf = gegl_scratch_new (gfloat, n_dst_pixels * n_components);
 
   gegl_buffer_get (input, &src_rect, 1.0, format, src_buf,
                    GEGL_AUTO_ROWSTRIDE, get_abyss_policy (operation, "input"));
@@ -956,8 +1316,8 @@ process (GeglOperation       *operation,
     g_free (hist->alpha_values);
 
   g_slice_free (Histogram, hist);
-  g_free (dst_buf);
-  g_free (src_buf);
+  gegl_scratch_free (dst_buf);
+  gegl_scratch_free (src_buf);
 
   return TRUE;
 }
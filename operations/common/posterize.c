@@ -142,6 +142,7 @@ gegl_op_class_init (GeglOpClass *klass)
     "title",       _("Posterize"),
     "reference-hash", "ae15a5986f7345e997b61e360ca1559b",
     "categories" , "color",
+    "position-independent", "true",
     "description",
        _("Reduces the number of levels in each color component of the image."),
        NULL);
@@ -41,6 +41,7 @@ property_double (light, _("Light adaptation"), 1.0)
 #define GEGL_OP_C_SOURCE reinhard05.c
 
 #include "gegl-op.h"
+#include "tonemap-common.h"
 
 
 typedef struct {
@@ -51,6 +52,26 @@ typedef struct {
 
 static const gchar *OUTPUT_FORMAT = "RGBA float";
 
+#define RGB        3
+#define PIX_STRIDE 4 /* RGBA */
+
+typedef struct
+{
+  gfloat       *lum;
+  gfloat       *pix;
+  gsize         n;
+
+  /* the stats of each block of pixels, merged once done */
+  stats        *normalise;
+
+  const stats  *channel_avg;
+  gfloat        world_avg;
+  gfloat        intensity;
+  gfloat        contrast;
+  gfloat        chrom;
+  gfloat        light;
+} Reinhard05Data;
+
 
 static void
 reinhard05_prepare (GeglOperation *operation)
@@ -120,6 +141,83 @@ reinhard05_stats_finish (stats *s)
 }
 
 
+static void
+reinhard05_stats_merge (stats       *s,
+                        const stats *other)
+{
+  s->min  = MIN (s->min, other->min);
+  s->max  = MAX (s->max, other->max);
+  s->avg += other->avg;
+  s->num += other->num;
+}
+
+
+static void
+reinhard05_operator_blocks (gsize    offset,
+                            gsize    size,
+                            gpointer user_data)
+{
+  Reinhard05Data *data       = user_data;
+  const gfloat    chrom      =       data->chrom,
+                  chrom_comp = 1.0 - data->chrom,
+                  light      =       data->light,
+                  light_comp = 1.0 - data->light;
+  gsize           block;
+
+  for (block = offset; block < offset + size; block++)
+    {
+      gsize   start     = block * TONEMAP_BLOCK_SIZE;
+      gsize   end       = MIN (start + TONEMAP_BLOCK_SIZE, data->n);
+      stats  *normalise = data->normalise + block;
+      gsize   i;
+      gint    c;
+
+      reinhard05_stats_start (normalise);
+
+      for (i = start; i < end; ++i)
+        {
+          gfloat local, global, adapt;
+
+          if (data->lum[i] == 0.0)
+            continue;
+
+          for (c = 0; c < RGB; ++c)
+            {
+              gfloat *_p = data->pix + i * PIX_STRIDE + c,
+                       p = *_p;
+
+              local  = chrom      * p +
+                       chrom_comp * data->lum[i];
+              global = chrom      * data->channel_avg[c].avg +
+                       chrom_comp * data->world_avg;
+              adapt  = light      * local +
+                       light_comp * global;
+
+              p  /= p + powf (data->intensity * adapt, data->contrast);
+              *_p = p;
+              reinhard05_stats_update (normalise, p);
+            }
+        }
+    }
+}
+
+
+static void
+reinhard05_normalise_range (gsize    offset,
+                            gsize    size,
+                            gpointer user_data)
+{
+  Reinhard05Data *data  = user_data;
+  const gfloat    min   = data->normalise->min;
+  const gfloat    range = data->normalise->range;
+  gfloat         *p     = data->pix + offset;
+  gsize           i;
+
+  for (i = 0; i < size; ++i)
+    p[i] = (p[i] - min) / range;
+}
+
+
 static gboolean
 reinhard05_process (GeglOperation       *operation,
                     GeglBuffer          *input,
@@ -130,8 +228,7 @@ reinhard05_process (GeglOperation       *operation,
   const Babl *space = gegl_operation_get_format (operation, "output"); /* the format is sufficent */
   const GeglProperties *o = GEGL_PROPERTIES (operation);
 
-  const gint  pix_stride = 4, /* RGBA */
-              RGB        = 3;
+  const gint  pix_stride = PIX_STRIDE;
 
   gfloat *lum,
          *pix;
@@ -146,7 +243,10 @@ reinhard05_process (GeglOperation       *operation,
           channel [RGB],
           normalise;
 
-  gint    i, c;
+  Reinhard05Data data;
+  gsize          n_blocks;
+  gsize          block;
+  gint           i, c;
 
   g_return_val_if_fail (operation, FALSE);
   g_return_val_if_fail (input, FALSE);
@@ -170,7 +270,9 @@ reinhard05_process (GeglOperation       *operation,
   gegl_buffer_get (input, result, 1.0, babl_format_with_space (OUTPUT_FORMAT, space),
                    pix, GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
 
-  /* Collect the image stats, averages, etc */
+  /* Collect the image stats, averages, etc.  the averages are summed
+   * serially, since summing them in any other order changes the result.
+   */
   reinhard05_stats_start (&world_lin);
   reinhard05_stats_start (&world_log);
   reinhard05_stats_start (&normalise);
@@ -207,43 +309,40 @@ reinhard05_process (GeglOperation       *operation,
 
   g_return_val_if_fail (contrast >= 0.3 && contrast <= 1.0, FALSE);
 
-  /* Apply the operator */
-  for (i = 0; i < result->width * result->height; ++i)
-    {
-      gfloat local, global, adapt;
+  /* Apply the operator, over blocks of pixels, whose normalisation stats
+   * are then merged.  only their min and max are used, which don't depend
+   * on the order.
+   */
+  data.lum         = lum;
+  data.pix         = pix;
+  data.n           = (gsize) result->width * result->height;
 
-      if (lum[i] == 0.0)
-        continue;
+  n_blocks         = TONEMAP_N_BLOCKS (data.n);
 
-      for (c = 0; c < RGB; ++c)
-        {
-          gfloat *_p = pix + i * pix_stride + c,
-                   p = *_p;
-
-          local  = chrom      * p +
-                   chrom_comp * lum[i];
-          global = chrom      * channel[c].avg +
-                   chrom_comp * world_lin.avg;
-          adapt  = light      * local +
-                   light_comp * global;
-
-          p  /= p + powf (intensity * adapt, contrast);
-          *_p = p;
-          reinhard05_stats_update (&normalise, p);
-        }
-    }
+  data.normalise   = g_new (stats, n_blocks);
+  data.channel_avg = channel;
+  data.world_avg   = world_lin.avg;
+  data.intensity   = intensity;
+  data.contrast    = contrast;
+  data.chrom       = chrom;
+  data.light       = light;
+
+  gegl_parallel_distribute_range (n_blocks,
+                                  (gdouble) TONEMAP_PIXELS_PER_THREAD /
+                                  TONEMAP_BLOCK_SIZE,
+                                  reinhard05_operator_blocks, &data);
+
+  for (block = 0; block < n_blocks; block++)
+    reinhard05_stats_merge (&normalise, data.normalise + block);
+
+  g_free (data.normalise);
 
   /* Normalise the pixel values */
   reinhard05_stats_finish (&normalise);
 
-  for (i = 0; i < result->width * result->height; ++i)
-    {
-      for (c = 0; c < pix_stride; ++c)
-        {
-          gfloat *p = pix + i * pix_stride + c;
-          *p        = (*p - normalise.min) / normalise.range;
-        }
-    }
+  data.normalise = &normalise;
+
+  tonemap_distribute (data.n * pix_stride, reinhard05_normalise_range, &data);
 
   /* Cleanup and set the output */
   gegl_buffer_set (output, result, 0, babl_format_with_space (OUTPUT_FORMAT, space), pix,
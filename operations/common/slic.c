@@ -40,6 +40,10 @@ property_int (iterations, _("Iterations"), 1)
  value_range (1, 30)
     ui_range (1, 15)
 
+property_boolean (multi_resolution, _("Multi-resolution initialization"), FALSE)
+ description (_("Initialize the clusters by segmenting the input at lower "
+                "resolutions first"))
+
 #else
 
 #define GEGL_OP_FILTER
@@ -50,6 +54,16 @@ property_int (iterations, _("Iterations"), 1)
 
 #define POW2(x) ((x)*(x))
 
+/* the side of the chunks the downscaled images of the multi-resolution
+ * initialization are split into.
+ */
+#define CHUNK_SIZE        64
+
+/* the smallest cluster size the multi-resolution initialization
+ * segments a downscaled image with.
+ */
+#define MIN_CLUSTER_SIZE  8
+
 typedef struct
 {
   gfloat        center[5];
@@ -58,69 +72,256 @@ typedef struct
   GeglRectangle search_window;
 } Cluster;
 
+/* The labels are assigned per chunk, in parallel, after which the sums of
+ * each cluster are accumulated in parallel too, one thread per cluster,
+ * over the chunks in their order.  The sums are thus the same as if all
+ * pixels were visited in order, and don't depend on the number of
+ * threads.
+ */
+typedef struct
+{
+  GeglRectangle rect;
+  gboolean      assigned; /* whether any search window reaches the chunk */
+  gboolean      orphans;  /* whether any of its pixels went to the first
+                           * cluster for lack of a nearest one
+                           */
+} Chunk;
+
+/* consecutive chunks spanning the same rows */
+typedef struct
+{
+  guint first;
+  guint n_chunks;
+} ChunkRow;
+
+typedef struct
+{
+  GeglRectangle  extent;
+  gfloat        *pixels;  /* 3 floats per pixel */
+  guint32       *labels;
+  GArray        *chunks;
+  GArray        *rows;
+} Image;
+
+typedef struct
+{
+  gint    cluster_size;
+  gint    compactness;
+  gdouble pixels_per_thread;
+} Params;
+
+typedef struct
+{
+  Image        *image;
+  GArray       *clusters;
+  const Params *params;
+  GeglBuffer   *output;
+  const Babl   *format;
+} SlicData;
+
+
+static Image *
+image_new (const GeglRectangle *extent)
+{
+  Image *image = g_slice_new (Image);
+  gsize  n     = (gsize) extent->width * extent->height;
+
+  image->extent = *extent;
+  image->pixels = gegl_malloc (3 * sizeof (gfloat) * n);
+  image->labels = gegl_calloc (sizeof (guint32), n);
+  image->chunks = g_array_new (FALSE, FALSE, sizeof (Chunk));
+  image->rows   = g_array_new (FALSE, FALSE, sizeof (ChunkRow));
+
+  return image;
+}
+
+static void
+image_free (Image *image)
+{
+  gegl_free (image->pixels);
+  gegl_free (image->labels);
+  g_array_free (image->chunks, TRUE);
+  g_array_free (image->rows, TRUE);
+
+  g_slice_free (Image, image);
+}
+
+static void
+image_add_chunk (Image               *image,
+                 const GeglRectangle *rect)
+{
+  Chunk     chunk = { *rect, FALSE, FALSE };
+  ChunkRow *row   = NULL;
+
+  if (image->rows->len)
+    {
+      const Chunk *first;
+
+      row   = &g_array_index (image->rows, ChunkRow, image->rows->len - 1);
+      first = &g_array_index (image->chunks, Chunk, row->first);
+
+      if (first->rect.y      != rect->y ||
+          first->rect.height != rect->height)
+        {
+          row = NULL;
+        }
+    }
+
+  if (! row)
+    {
+      ChunkRow new_row = { image->chunks->len, 0 };
+
+      g_array_append_val (image->rows, new_row);
+
+      row = &g_array_index (image->rows, ChunkRow, image->rows->len - 1);
+    }
+
+  g_array_append_val (image->chunks, chunk);
+  row->n_chunks++;
+}
 
-static inline gfloat
-get_distance (gfloat         *c1,
-              gfloat         *c2,
-              GeglProperties *o)
+/* reads @input in the order it is iterated over, which is the order the
+ * cluster sums are accumulated in.
+ */
+static Image *
+image_read (GeglBuffer *input,
+            const Babl *format)
 {
-  gfloat color_dist = sqrtf (POW2(c2[0] - c1[0]) +
-                             POW2(c2[1] - c1[1]) +
-                             POW2(c2[2] - c1[2]));
+  const GeglRectangle *extent = gegl_buffer_get_extent (input);
+  Image               *image  = image_new (extent);
+  GeglBufferIterator  *iter;
+
+  iter = gegl_buffer_iterator_new (input, NULL, 0, format,
+                                   GEGL_ACCESS_READ, GEGL_ABYSS_NONE, 1);
+
+  while (gegl_buffer_iterator_next (iter))
+    {
+      const GeglRectangle *roi   = &iter->items[0].roi;
+      const gfloat        *pixel = iter->items[0].data;
+      gint                 y;
+
+      for (y = 0; y < roi->height; y++)
+        {
+          memcpy (image->pixels +
+                  3 * ((gsize) (roi->y + y - extent->y) * extent->width +
+                       roi->x - extent->x),
+                  pixel + 3 * y * roi->width,
+                  3 * sizeof (gfloat) * roi->width);
+        }
+
+      image_add_chunk (image, roi);
+    }
+
+  return image;
+}
+
+/* halves @image, with the pixel at (x, y) of the result covering the ones
+ * at (x + i, y + j) and around of @image, where (x, y) is the origin of
+ * the result and (i, j) are twice its offsets from it.
+ */
+static Image *
+image_downscale (const Image *image)
+{
+  const GeglRectangle *src_extent = &image->extent;
+  GeglRectangle        extent;
+  Image               *result;
+  gint                 x, y;
+
+  extent.x      = src_extent->x;
+  extent.y      = src_extent->y;
+  extent.width  = (src_extent->width  + 1) / 2;
+  extent.height = (src_extent->height + 1) / 2;
+
+  result = image_new (&extent);
+
+  for (y = 0; y < extent.height; y++)
+    {
+      gint y0 = 2 * y;
+      gint y1 = MIN (y0 + 1, src_extent->height - 1);
+
+      for (x = 0; x < extent.width; x++)
+        {
+          gint          x0  = 2 * x;
+          gint          x1  = MIN (x0 + 1, src_extent->width - 1);
+          const gfloat *p00 = image->pixels + 3 * (y0 * src_extent->width + x0);
+          const gfloat *p01 = image->pixels + 3 * (y0 * src_extent->width + x1);
+          const gfloat *p10 = image->pixels + 3 * (y1 * src_extent->width + x0);
+          const gfloat *p11 = image->pixels + 3 * (y1 * src_extent->width + x1);
+          gfloat       *d   = result->pixels + 3 * (y * extent.width + x);
+          gint          c;
+
+          for (c = 0; c < 3; c++)
+            d[c] = (p00[c] + p01[c] + p10[c] + p11[c]) / 4.0f;
+        }
+    }
 
-  gfloat spacial_dist = sqrtf (POW2(c2[3] - c1[3]) +
-                               POW2(c2[4] - c1[4]));
+  for (y = 0; y < extent.height; y += CHUNK_SIZE)
+    for (x = 0; x < extent.width; x += CHUNK_SIZE)
+      {
+        GeglRectangle rect = { extent.x + x, extent.y + y,
+                               MIN (CHUNK_SIZE, extent.width  - x),
+                               MIN (CHUNK_SIZE, extent.height - y) };
+
+        image_add_chunk (result, &rect);
+      }
+
+  return result;
+}
 
-  return sqrtf (POW2(color_dist) +
-                POW2(o->compactness) * POW2(spacial_dist / o->cluster_size));
+static void
+set_search_window (Cluster      *c,
+                   const Params *params)
+{
+  c->search_window.x      = (gint) c->center[3] - params->cluster_size;
+  c->search_window.y      = (gint) c->center[4] - params->cluster_size;
+  c->search_window.width  =
+  c->search_window.height = params->cluster_size * 2 + 1;
 }
 
 static GArray *
-init_clusters (GeglBuffer     *input,
-               GeglProperties *o,
-               gint            level,
-               const Babl     *format)
+init_clusters (const Image  *image,
+               const Params *params)
 {
-  GeglSampler *sampler;
+  const GeglRectangle *extent = &image->extent;
   GArray      *clusters;
   gint         n_clusters;
   gint i, x, y;
   gint cx, cy;
   gint h_offset, v_offset;
-  gint width  = gegl_buffer_get_width (input);
-  gint height = gegl_buffer_get_height (input);
+  gint width  = extent->width;
+  gint height = extent->height;
+  gint size   = params->cluster_size;
 
-  gint n_h_clusters = width / o->cluster_size;
-  gint n_v_clusters = height / o->cluster_size;
+  gint n_h_clusters = width / size;
+  gint n_v_clusters = height / size;
 
-  if (width % o->cluster_size)
+  if (width % size)
    n_h_clusters++;
 
-  if (height % o->cluster_size)
+  if (height % size)
     n_v_clusters++;
 
-  h_offset = (width % o->cluster_size) ? (width % o->cluster_size) / 2 : o->cluster_size / 2;
-  v_offset = (height % o->cluster_size) ? (height % o->cluster_size) / 2 : o->cluster_size / 2;
+  h_offset = (width % size) ? (width % size) / 2 : size / 2;
+  v_offset = (height % size) ? (height % size) / 2 : size / 2;
 
   n_clusters = n_h_clusters * n_v_clusters;
 
   clusters = g_array_sized_new (FALSE, TRUE, sizeof (Cluster), n_clusters);
 
-  sampler = gegl_buffer_sampler_new_at_level (input,
-                                              format,
-                                              GEGL_SAMPLER_NEAREST, level);
   x = y = 0;
 
   for (i = 0; i < n_clusters; i++)
     {
-      gfloat pixel[3];
+      const gfloat *pixel;
       Cluster c;
 
-      cx = x * o->cluster_size + h_offset;
-      cy = y * o->cluster_size + v_offset;
+      cx = x * size + h_offset;
+      cy = y * size + v_offset;
 
-      gegl_sampler_get (sampler, cx, cy, NULL,
-                        pixel, GEGL_ABYSS_CLAMP);
+      /* the pixel nearest to the center, clamped to the extent */
+      pixel = image->pixels +
+              3 * (CLAMP (cy - extent->y, 0, height - 1) * width +
+                   CLAMP (cx - extent->x, 0, width  - 1));
 
       c.center[0] = pixel[0];
       c.center[1] = pixel[1];
@@ -136,10 +337,7 @@ init_clusters (GeglBuffer     *input,
 
       c.n_pixels = 0;
 
-      c.search_window.x = cx - o->cluster_size;
-      c.search_window.y = cy - o->cluster_size;
-      c.search_window.width  =
-      c.search_window.height = o->cluster_size * 2 + 1;
+      set_search_window (&c, params);
 
       g_array_append_val (clusters, c);
 
@@ -151,122 +349,234 @@ init_clusters (GeglBuffer     *input,
         }
     }
 
-  g_object_unref (sampler);
-
   return clusters;
 }
 
 static void
-assign_labels (GeglBuffer     *labels,
-               GeglBuffer     *input,
-               GArray         *clusters,
-               GeglProperties *o,
-               const Babl     *format)
+assign_labels (gsize    offset,
+               gsize    size,
+               gpointer user_data)
 {
-  GeglBufferIterator *iter;
-  GArray  *clusters_index;
-
-  clusters_index = g_array_sized_new (FALSE, FALSE, sizeof (guint), 9);
-
-  iter = gegl_buffer_iterator_new (input, NULL, 0, format,
-                                   GEGL_ACCESS_READ, GEGL_ABYSS_NONE, 2);
-
-  gegl_buffer_iterator_add (iter, labels, NULL, 0,
-                            babl_format_n (babl_type ("u32"), 1),
-                            GEGL_ACCESS_WRITE, GEGL_ABYSS_NONE);
-
-  while (gegl_buffer_iterator_next (iter))
-   {
-      GeglRectangle *roi = &iter->items[0].roi;
-      gfloat  *pixel = iter->items[0].data;
-      guint32 *label = iter->items[1].data;
-      glong    n_pixels = iter->length;
-      gint     x, y;
-      guint    i;
-
-      x = roi->x;
-      y = roi->y;
-
-      /* construct an array of clusters index for which search_window
-       * intersect with the current roi
+  SlicData     *data         = user_data;
+  Image        *image        = data->image;
+  GArray       *clusters     = data->clusters;
+  const gint    cluster_size = data->params->cluster_size;
+  const gint    compactness2 = POW2 (data->params->compactness);
+  const gint    width        = image->extent.width;
+  guint        *index;
+  gfloat       *soa;
+  gfloat       *center[5];
+  gfloat       *window[4];
+  gfloat       *distance;
+  gsize         chunk_index;
+  gint          i;
+
+  /* the centers and search windows of the clusters which reach a chunk,
+   * stored component by component so that their distances to a pixel
+   * are computed in a vectorizable loop.
+   */
+  index = g_new (guint, clusters->len);
+  soa   = g_new (gfloat, 10 * clusters->len);
+
+  for (i = 0; i < 5; i++)
+    center[i] = soa + i * clusters->len;
+  for (i = 0; i < 4; i++)
+    window[i] = soa + (5 + i) * clusters->len;
+  distance = soa + 9 * clusters->len;
+
+  for (chunk_index = offset; chunk_index < offset + size; chunk_index++)
+    {
+      Chunk               *chunk = &g_array_index (image->chunks, Chunk,
+                                                   chunk_index);
+      const GeglRectangle *roi   = &chunk->rect;
+      gint                 n_candidates = 0;
+      gint                 x, y;
+      guint                j;
+
+      /* construct an array of the clusters whose search_window
+       * intersects with the current roi
        */
 
-      for (i = 0; i < clusters->len ; i++)
+      for (j = 0; j < clusters->len; j++)
         {
-          Cluster *c = &g_array_index (clusters, Cluster, i);
+          const Cluster *c = &g_array_index (clusters, Cluster, j);
 
           if (gegl_rectangle_intersect (NULL, &c->search_window, roi))
-            g_array_append_val (clusters_index, i);
+            {
+              index[n_candidates] = j;
+
+              for (i = 0; i < 5; i++)
+                center[i][n_candidates] = c->center[i];
+
+              window[0][n_candidates] = c->search_window.x;
+              window[1][n_candidates] = c->search_window.y;
+              window[2][n_candidates] = c->search_window.x +
+                                        c->search_window.width;
+              window[3][n_candidates] = c->search_window.y +
+                                        c->search_window.height;
+
+              n_candidates++;
+            }
         }
 
-      if (!clusters_index->len)
+      chunk->assigned = n_candidates > 0;
+      chunk->orphans  = FALSE;
+
+      if (! n_candidates)
         {
           g_printerr ("no clusters for roi %d,%d,%d,%d\n", roi->x, roi->y, roi->width, roi->height);
           continue;
         }
 
-      while (n_pixels--)
+      for (y = roi->y; y < roi->y + roi->height; y++)
         {
-          Cluster *c;
-          gfloat feature[5] = {pixel[0], pixel[1], pixel[2],
-                               (gfloat) x, (gfloat) y};
+          gsize         row   = (gsize) (y - image->extent.y) * width -
+                                image->extent.x;
+          const gfloat *pixel = image->pixels + 3 * (row + roi->x);
+          guint32      *label = image->labels + row + roi->x;
+          gfloat        fy    = (gfloat) y;
+
+          for (x = roi->x; x < roi->x + roi->width; x++)
+            {
+              gfloat  fx           = (gfloat) x;
+              gfloat  min_distance = G_MAXFLOAT;
+              guint   best_cluster = 0;
+              gboolean found       = FALSE;
 
-          /* find the nearest cluster */
+              for (i = 0; i < n_candidates; i++)
+                {
+                  gfloat color_dist = sqrtf (POW2(pixel[0] - center[0][i]) +
+                                             POW2(pixel[1] - center[1][i]) +
+                                             POW2(pixel[2] - center[2][i]));
 
-          gfloat  min_distance = G_MAXFLOAT;
-          guint   best_cluster = 0;
+                  gfloat spacial_dist = sqrtf (POW2(fx - center[3][i]) +
+                                               POW2(fy - center[4][i]));
 
-          for (i = 0; i < clusters_index->len ; i++)
-            {
-              gfloat distance;
-              guint index = g_array_index (clusters_index, guint, i);
-              Cluster *tmp = &g_array_index (clusters, Cluster, index);
-
-              if (x < tmp->search_window.x ||
-                  y < tmp->search_window.y ||
-                  x >= tmp->search_window.x + tmp->search_window.width ||
-                  y >= tmp->search_window.y + tmp->search_window.height)
-                continue;
+                  gfloat d = sqrtf (POW2(color_dist) +
+                                    compactness2 * POW2(spacial_dist / cluster_size));
 
-              distance = get_distance (tmp->center, feature, o);
+                  gboolean inside = fx >= window[0][i] &&
+                                    fy >= window[1][i] &&
+                                    fx <  window[2][i] &&
+                                    fy <  window[3][i];
 
-              if (distance < min_distance)
+                  distance[i] = inside ? d : G_MAXFLOAT;
+                }
+
+              /* find the nearest cluster */
+
+              for (i = 0; i < n_candidates; i++)
                 {
-                  min_distance = distance;
-                  best_cluster = index;
+                  if (distance[i] < min_distance)
+                    {
+                      min_distance = distance[i];
+                      best_cluster = index[i];
+                      found        = TRUE;
+                    }
                 }
+
+              if (! found)
+                chunk->orphans = TRUE;
+
+              *label = best_cluster;
+
+              pixel += 3;
+              label++;
             }
+        }
+    }
+
+  g_free (soa);
+  g_free (index);
+}
 
-          c = &g_array_index (clusters, Cluster, best_cluster);
-          c->sum[0] += pixel[0];
-          c->sum[1] += pixel[1];
-          c->sum[2] += pixel[2];
-          c->sum[3] += (gfloat) x;
-          c->sum[4] += (gfloat) y;
-          c->n_pixels++;
+static void
+accumulate_cluster (Cluster             *c,
+                    guint32              c_index,
+                    const Image         *image,
+                    const GeglRectangle *rect)
+{
+  const gint width = image->extent.width;
+  gint       x, y;
 
-          *label = best_cluster;
+  for (y = rect->y; y < rect->y + rect->height; y++)
+    {
+      gsize          row   = (gsize) (y - image->extent.y) * width -
+                             image->extent.x;
+      const gfloat  *pixel = image->pixels + 3 * (row + rect->x);
+      const guint32 *label = image->labels + row + rect->x;
+
+      for (x = rect->x; x < rect->x + rect->width; x++)
+        {
+          if (*label == c_index)
+            {
+              c->sum[0] += pixel[0];
+              c->sum[1] += pixel[1];
+              c->sum[2] += pixel[2];
+              c->sum[3] += (gfloat) x;
+              c->sum[4] += (gfloat) y;
+              c->n_pixels++;
+            }
 
           pixel += 3;
           label++;
+        }
+    }
+}
+
+static void
+accumulate_clusters (gsize    offset,
+                     gsize    size,
+                     gpointer user_data)
+{
+  SlicData    *data  = user_data;
+  const Image *image = data->image;
+  gsize        c_index;
 
-          x++;
-          if (x >= roi->x + roi->width)
+  for (c_index = offset; c_index < offset + size; c_index++)
+    {
+      Cluster             *c      = &g_array_index (data->clusters, Cluster,
+                                                    c_index);
+      const GeglRectangle *window = &c->search_window;
+      guint                r, i;
+
+      for (r = 0; r < image->rows->len; r++)
+        {
+          const ChunkRow *row   = &g_array_index (image->rows, ChunkRow, r);
+          const Chunk    *chunk = &g_array_index (image->chunks, Chunk,
+                                                  row->first);
+
+          /* the pixels which no cluster reached went to the first one,
+           * wherever they are.
+           */
+          if (c_index > 0 &&
+              (chunk->rect.y >= window->y + window->height ||
+               chunk->rect.y + chunk->rect.height <= window->y))
             {
-              y++;
-              x = roi->x;
+              continue;
             }
-        }
 
-      clusters_index->len = 0;
-   }
+          for (i = 0; i < row->n_chunks; i++, chunk++)
+            {
+              GeglRectangle rect;
 
-  g_array_free (clusters_index, TRUE);
+              if (! chunk->assigned)
+                continue;
+
+              if (c_index == 0 && chunk->orphans)
+                rect = chunk->rect;
+              else if (! gegl_rectangle_intersect (&rect, &chunk->rect, window))
+                continue;
+
+              accumulate_cluster (c, c_index, image, &rect);
+            }
+        }
+    }
 }
 
-static gboolean
-update_clusters (GArray         *clusters,
-                 GeglProperties *o)
+static void
+update_clusters (GArray       *clusters,
+                 const Params *params)
 {
   gint i;
 
@@ -288,45 +598,134 @@ update_clusters (GArray         *clusters,
 
       c->n_pixels = 0;
 
-      c->search_window.x = (gint) c->center[3] - o->cluster_size;
-      c->search_window.y = (gint) c->center[4] - o->cluster_size;
+      c->search_window.x = (gint) c->center[3] - params->cluster_size;
+      c->search_window.y = (gint) c->center[4] - params->cluster_size;
     }
+}
 
-  return TRUE;
+static void
+segment (Image        *image,
+         GArray       *clusters,
+         const Params *params,
+         gint          iterations)
+{
+  SlicData data = { image, clusters, params, };
+  gint     i;
+
+  for (i = 0; i < iterations; i++)
+    {
+      gegl_parallel_distribute_range (
+        image->chunks->len,
+        params->pixels_per_thread * image->chunks->len /
+        ((gdouble) image->extent.width * image->extent.height),
+        assign_labels, &data);
+
+      /* each cluster covers about four times its size, its search window */
+      gegl_parallel_distribute_range (
+        clusters->len,
+        params->pixels_per_thread / (4 * POW2 (params->cluster_size)),
+        accumulate_clusters, &data);
+
+      update_clusters (clusters, params);
+    }
+}
+
+/* initializes the clusters by segmenting @image at half its resolution,
+ * which is itself initialized the same way, down to MIN_CLUSTER_SIZE.
+ */
+static GArray *
+init_clusters_multi_resolution (const Image  *image,
+                                const Params *params,
+                                gint          iterations)
+{
+  Params  coarse_params = { params->cluster_size / 2, params->compactness,
+                            params->pixels_per_thread };
+  Image  *coarse;
+  GArray *coarse_clusters;
+  GArray *clusters;
+  gint    i;
+
+  if (coarse_params.cluster_size < MIN_CLUSTER_SIZE ||
+      image->extent.width  < 2 * params->cluster_size ||
+      image->extent.height < 2 * params->cluster_size)
+    {
+      return init_clusters (image, params);
+    }
+
+  coarse          = image_downscale (image);
+  coarse_clusters = init_clusters_multi_resolution (coarse, &coarse_params,
+                                                    iterations);
+
+  segment (coarse, coarse_clusters, &coarse_params, iterations);
+
+  clusters = g_array_sized_new (FALSE, TRUE, sizeof (Cluster),
+                                coarse_clusters->len);
+
+  for (i = 0; i < coarse_clusters->len; i++)
+    {
+      Cluster c = g_array_index (coarse_clusters, Cluster, i);
+
+      /* drop the clusters which lost all of their pixels */
+      if (isnan (c.center[0]))
+        continue;
+
+      c.center[3] = image->extent.x + 2.0f * (c.center[3] - image->extent.x) + 0.5f;
+      c.center[4] = image->extent.y + 2.0f * (c.center[4] - image->extent.y) + 0.5f;
+
+      set_search_window (&c, params);
+
+      g_array_append_val (clusters, c);
+    }
+
+  g_array_free (coarse_clusters, TRUE);
+  image_free (coarse);
+
+  if (! clusters->len)
+    {
+      g_array_free (clusters, TRUE);
+
+      return init_clusters (image, params);
+    }
+
+  return clusters;
 }
 
 static void
-set_output (GeglBuffer *output,
-            GeglBuffer *labels,
-            GArray     *clusters,
-            const Babl *format)
+set_output_area (const GeglRectangle *area,
+                 gpointer             user_data)
 {
+  SlicData           *data  = user_data;
+  const Image        *image = data->image;
   GeglBufferIterator *iter;
 
-  iter = gegl_buffer_iterator_new (output, NULL, 0,
-                                   format,
-                                   GEGL_ACCESS_WRITE, GEGL_ABYSS_NONE, 2);
-
-  gegl_buffer_iterator_add (iter, labels, NULL, 0,
-                            babl_format_n (babl_type ("u32"), 1),
-                            GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
+  iter = gegl_buffer_iterator_new (data->output, area, 0, data->format,
+                                   GEGL_ACCESS_WRITE, GEGL_ABYSS_NONE, 1);
 
   while (gegl_buffer_iterator_next (iter))
     {
-      gfloat  *pixel    = iter->items[0].data;
-      guint32 *label    = iter->items[1].data;
-      glong    n_pixels = iter->length;
+      const GeglRectangle *roi   = &iter->items[0].roi;
+      gfloat              *pixel = iter->items[0].data;
+      gint                 x, y;
 
-      while (n_pixels--)
+      for (y = roi->y; y < roi->y + roi->height; y++)
         {
-          Cluster *c = &g_array_index (clusters, Cluster, *label);
+          const guint32 *label = image->labels +
+                                 (gsize) (y - image->extent.y) *
+                                 image->extent.width +
+                                 roi->x - image->extent.x;
+
+          for (x = 0; x < roi->width; x++)
+            {
+              const Cluster *c = &g_array_index (data->clusters, Cluster,
+                                                 *label);
 
-          pixel[0] = c->center[0];
-          pixel[1] = c->center[1];
-          pixel[2] = c->center[2];
+              pixel[0] = c->center[0];
+              pixel[1] = c->center[1];
+              pixel[2] = c->center[2];
 
-          pixel += 3;
-          label++;
+              pixel += 3;
+              label++;
+            }
         }
     }
 }
@@ -376,31 +775,49 @@ process (GeglOperation       *operation,
 {
   GeglProperties *o = GEGL_PROPERTIES (operation);
   const Babl *format = gegl_operation_get_format (operation, "output");
-  const GeglRectangle *src_region = gegl_buffer_get_extent (input);
-  GeglBuffer *labels;
+  Params      params = { o->cluster_size, o->compactness,
+                         gegl_operation_get_pixels_per_thread (operation) };
+  SlicData    data;
+  GeglRectangle area;
+  Image      *image;
   GArray     *clusters;
-  gint        i;
 
-  labels = gegl_buffer_new (src_region, babl_format_n (babl_type ("u32"), 1));
+  image = image_read (input, format);
+
+  if (! image->chunks->len)
+    {
+      image_free (image);
+      return TRUE;
+    }
 
   /* clusters initialization */
 
-  clusters = init_clusters (input, o, level, format);
+  if (o->multi_resolution)
+    clusters = init_clusters_multi_resolution (image, &params, o->iterations);
+  else
+    clusters = init_clusters (image, &params);
 
   /* perform segmentation */
 
-  for (i = 0; i < o->iterations; i++)
-    {
-      assign_labels (labels, input, clusters, o, format);
-
-      update_clusters (clusters, o);
-    }
+  segment (image, clusters, &params, o->iterations);
 
   /* apply clusters colors to output */
 
-  set_output (output, labels, clusters, format);
+  data.image    = image;
+  data.clusters = clusters;
+  data.params   = &params;
+  data.output   = output;
+  data.format   = format;
+
+  if (gegl_rectangle_intersect (&area, gegl_buffer_get_extent (output),
+                                &image->extent))
+    {
+      gegl_parallel_distribute_area (&area, params.pixels_per_thread,
+                                     GEGL_SPLIT_STRATEGY_AUTO,
+                                     set_output_area, &data);
+    }
 
-  g_object_unref (labels);
+  image_free (image);
   g_array_free (clusters, TRUE);
 
   return TRUE;
@@ -32,6 +32,7 @@
 #define GEGL_OP_C_SOURCE stretch-contrast-hsv.c
 
 #include "gegl-op.h"
+#include "global-stats.h"
 
 typedef struct {
   gfloat slo;
@@ -40,63 +41,6 @@ typedef struct {
   gfloat vdiff;
 } AutostretchData;
 
-static void
-buffer_get_auto_stretch_data (GeglOperation       *operation,
-                              GeglBuffer          *buffer,
-                              const GeglRectangle *result,
-                              AutostretchData     *data,
-                              const Babl          *space)
-{
-  gfloat smin =  G_MAXFLOAT;
-  gfloat smax = -G_MAXFLOAT;
-  gfloat vmin =  G_MAXFLOAT;
-  gfloat vmax = -G_MAXFLOAT;
-
-  GeglBufferIterator *gi;
-  gint                done_pixels = 0;
-
-  gegl_operation_progress (operation, 0.0, "");
-
-  gi = gegl_buffer_iterator_new (buffer, result, 0, babl_format_with_space ("HSVA float", space),
-                                 GEGL_ACCESS_READ, GEGL_ABYSS_NONE, 1);
-
-  while (gegl_buffer_iterator_next (gi))
-    {
-      gfloat *buf = gi->items[0].data;
-      gint    i;
-
-      for (i = 0; i < gi->length; i++)
-        {
-          gfloat sval = buf[1];
-          gfloat vval = buf[2];
-
-          smin = MIN (sval, smin);
-          smax = MAX (sval, smax);
-          vmin = MIN (vval, vmin);
-          vmax = MAX (vval, vmax);
-
-          buf += 4;
-        }
-
-      done_pixels += gi->length;
-
-      gegl_operation_progress (operation,
-                               (gdouble) 0.5 * done_pixels /
-                               (gdouble) (result->width * result->height),
-                               "");
-    }
-
-  if (data)
-    {
-      data->slo   = smin;
-      data->sdiff = smax - smin;
-      data->vlo   = vmin;
-      data->vdiff = vmax - vmin;
-    }
-
-  gegl_operation_progress (operation, 0.5, "");
-}
-
 static void
 clean_autostretch_data (AutostretchData *data)
 {
@@ -113,10 +57,39 @@ clean_autostretch_data (AutostretchData *data)
     }
 }
 
+static void
+get_auto_stretch_data (GeglOperation   *operation,
+                       GeglBuffer      *input,
+                       AutostretchData *data)
+{
+  GeglProperties *o      = GEGL_PROPERTIES (operation);
+  const Babl     *format = gegl_operation_get_format (operation, "input");
+  GlobalStats     stats  = { GLOBAL_STATS_MIN_MAX, };
+
+  global_stats_cache_get (o->user_data, operation, input,
+                          gegl_operation_source_get_bounding_box (operation,
+                                                                  "input"),
+                          format, &stats);
+
+  data->slo   = stats.min[1];
+  data->sdiff = stats.max[1] - stats.min[1];
+  data->vlo   = stats.min[2];
+  data->vdiff = stats.max[2] - stats.min[2];
+
+  global_stats_clear (&stats);
+
+  clean_autostretch_data (data);
+}
+
 static void
 prepare (GeglOperation *operation)
 {
-  const Babl *space = gegl_operation_get_source_space (operation, "input");
+  const Babl     *space = gegl_operation_get_source_space (operation, "input");
+  GeglProperties *o     = GEGL_PROPERTIES (operation);
+
+  if (! o->user_data)
+    o->user_data = global_stats_cache_new ();
+
   gegl_operation_set_format (operation, "input",  babl_format_with_space ("HSVA float", space));
   gegl_operation_set_format (operation, "output", babl_format_with_space ("HSVA float", space));
 }
@@ -135,18 +108,6 @@ get_required_for_output (GeglOperation       *operation,
   return result;
 }
 
-static GeglRectangle
-get_cached_region (GeglOperation       *operation,
-                   const GeglRectangle *roi)
-{
-  GeglRectangle result = *gegl_operation_source_get_bounding_box (operation, "input");
-
-  if (gegl_rectangle_is_infinite_plane (&result))
-    return *roi;
-
-  return result;
-}
-
 static gboolean
 process (GeglOperation       *operation,
          GeglBuffer          *input,
@@ -154,20 +115,16 @@ process (GeglOperation       *operation,
          const GeglRectangle *result,
          gint                 level)
 {
-  const Babl *space = gegl_operation_get_format (operation, "output");
+  const Babl *format = gegl_operation_get_format (operation, "output");
   AutostretchData     data;
   GeglBufferIterator *gi;
-  gint                done_pixels = 0;
-
-  buffer_get_auto_stretch_data (operation, input, result, &data, space);
-  clean_autostretch_data (&data);
 
-  gegl_operation_progress (operation, 0.5, "");
+  get_auto_stretch_data (operation, input, &data);
 
-  gi = gegl_buffer_iterator_new (input, result, 0, babl_format_with_space ("HSVA float", space),
+  gi = gegl_buffer_iterator_new (input, result, 0, format,
                                  GEGL_ACCESS_READ, GEGL_ABYSS_NONE, 2);
 
-  gegl_buffer_iterator_add (gi, output, result, 0, babl_format_with_space ("HSVA float", space),
+  gegl_buffer_iterator_add (gi, output, result, 0, format,
                             GEGL_ACCESS_WRITE, GEGL_ABYSS_NONE);
 
   while (gegl_buffer_iterator_next (gi))
@@ -186,18 +143,8 @@ process (GeglOperation       *operation,
           in  += 4;
           out += 4;
         }
-
-      done_pixels += gi->length;
-
-      gegl_operation_progress (operation,
-                               0.5 +
-                               (gdouble) 0.5 * done_pixels /
-                               (gdouble) (result->width * result->height),
-                               "");
     }
 
-  gegl_operation_progress (operation, 1.0, "");
-
   return TRUE;
 }
 
@@ -225,6 +172,19 @@ operation_process (GeglOperation        *operation,
       return TRUE;
     }
 
+  /* gather the statistics using all threads, before the area is split
+   * between them, each then finding them in the cache.
+   */
+  if (in_rect)
+    {
+      GeglBuffer      *input = GEGL_BUFFER (
+        gegl_operation_context_get_object (context, "input"));
+      AutostretchData  data;
+
+      if (input)
+        get_auto_stretch_data (operation, input, &data);
+    }
+
   /* chain up, which will create the needed buffers for our actual
    * process function
    */
@@ -232,21 +192,33 @@ operation_process (GeglOperation        *operation,
                                    gegl_operation_context_get_level (context));
 }
 
+static void
+finalize (GObject *object)
+{
+  GeglProperties *o = GEGL_PROPERTIES (object);
+
+  g_clear_pointer (&o->user_data, global_stats_cache_free);
+
+  G_OBJECT_CLASS (gegl_op_parent_class)->finalize (object);
+}
+
 static void
 gegl_op_class_init (GeglOpClass *klass)
 {
+  GObjectClass             *object_class;
   GeglOperationClass       *operation_class;
   GeglOperationFilterClass *filter_class;
 
+  object_class    = G_OBJECT_CLASS (klass);
   operation_class = GEGL_OPERATION_CLASS (klass);
   filter_class    = GEGL_OPERATION_FILTER_CLASS (klass);
 
+  object_class->finalize                   = finalize;
+
   filter_class->process                    = process;
   operation_class->prepare                 = prepare;
   operation_class->process                 = operation_process;
-  operation_class->threaded                = FALSE;
   operation_class->get_required_for_output = get_required_for_output;
-  operation_class->get_cached_region       = get_cached_region;
 
   gegl_operation_class_set_keys (operation_class,
     "name",        "gegl:stretch-contrast-hsv",
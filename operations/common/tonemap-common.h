@@ -0,0 +1,322 @@
+/* This file is an image processing operation for GEGL
+ *
+ * GEGL is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * GEGL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* Helpers shared by the tone mapping operations.  These process the whole
+ * image in a single call, so rather than relying on the filter base class
+ * to split the work into areas, they distribute their inner loops over the
+ * worker threads themselves.
+ */
+
+#include <math.h>
+
+/* the helpers below are called deep within the solvers, away from the
+ * operation, so they can't use gegl_operation_get_pixels_per_thread(), and
+ * use its default cost instead.
+ */
+#define TONEMAP_PIXELS_PER_THREAD (64 * 64)
+
+/* min/max reductions are done over fixed blocks of this many values */
+#define TONEMAP_BLOCK_SIZE        4096
+
+/* the smallest side of an image which is tone mapped at a lower
+ * resolution, below it the pyramids become too shallow.
+ */
+#define TONEMAP_MIN_SOLVE_SIZE    128
+
+#define TONEMAP_N_BLOCKS(n) (((n) + TONEMAP_BLOCK_SIZE - 1) / TONEMAP_BLOCK_SIZE)
+
+/* distributes @func over the @rows rows of an image @cols pixels wide */
+#define tonemap_distribute_rows(rows, cols, func, data)                    \
+  gegl_parallel_distribute_range ((rows),                                  \
+                                  (gdouble) TONEMAP_PIXELS_PER_THREAD /    \
+                                  MAX ((cols), 1),                         \
+                                  (func), (data))
+
+/* distributes @func over @n values */
+#define tonemap_distribute(n, func, data)                                  \
+  gegl_parallel_distribute_range ((n), TONEMAP_PIXELS_PER_THREAD,          \
+                                  (func), (data))
+
+
+typedef struct
+{
+  const gfloat *a;
+  gsize         n;
+  gfloat       *mins;
+  gfloat       *maxs;
+} TonemapReduceData;
+
+/* returns the dot product of the @n values of @a and @b, or the sum of the
+ * values of @a when @b is NULL.  the sum is accumulated serially, in single
+ * precision, in the same order as the solvers always did, since summing in
+ * any other order changes their results.
+ */
+static gfloat
+tonemap_dot_product (const gfloat *a,
+                     const gfloat *b,
+                     gsize         n)
+{
+  gfloat sum = 0.0f;
+  gsize  i;
+
+  if (b)
+    {
+      for (i = 0; i < n; i++)
+        sum += a[i] * b[i];
+    }
+  else
+    {
+      for (i = 0; i < n; i++)
+        sum += a[i];
+    }
+
+  return sum;
+}
+
+static void
+tonemap_min_max_blocks (gsize    offset,
+                        gsize    size,
+                        gpointer user_data)
+{
+  TonemapReduceData *data = user_data;
+  gsize              block;
+
+  for (block = offset; block < offset + size; block++)
+    {
+      gsize  start = block * TONEMAP_BLOCK_SIZE;
+      gsize  end   = MIN (start + TONEMAP_BLOCK_SIZE, data->n);
+      gfloat min   = data->a[start];
+      gfloat max   = data->a[start];
+      gsize  i;
+
+      for (i = start + 1; i < end; i++)
+        {
+          min = MIN (min, data->a[i]);
+          max = MAX (max, data->a[i]);
+        }
+
+      data->mins[block] = min;
+      data->maxs[block] = max;
+    }
+}
+
+/* finds the smallest and largest of the @n values of @a, @n > 0 */
+static void
+tonemap_min_max (const gfloat *a,
+                 gsize         n,
+                 gfloat       *min,
+                 gfloat       *max)
+{
+  TonemapReduceData data;
+  gsize             n_blocks = TONEMAP_N_BLOCKS (n);
+  gsize             i;
+
+  data.a    = a;
+  data.n    = n;
+  data.mins = g_new (gfloat, 2 * n_blocks);
+  data.maxs = data.mins + n_blocks;
+
+  gegl_parallel_distribute_range (n_blocks,
+                                  (gdouble) TONEMAP_PIXELS_PER_THREAD /
+                                  TONEMAP_BLOCK_SIZE,
+                                  tonemap_min_max_blocks, &data);
+
+  *min = data.mins[0];
+  *max = data.maxs[0];
+
+  for (i = 1; i < n_blocks; i++)
+    {
+      *min = MIN (*min, data.mins[i]);
+      *max = MAX (*max, data.maxs[i]);
+    }
+
+  g_free (data.mins);
+}
+
+
+typedef struct
+{
+  gfloat        alpha;
+  const gfloat *x;
+  gfloat        beta;
+  gfloat       *y;
+} TonemapAxpbyData;
+
+static void
+tonemap_axpby_range (gsize    offset,
+                     gsize    size,
+                     gpointer user_data)
+{
+  const TonemapAxpbyData *data  = user_data;
+  const gfloat            alpha = data->alpha;
+  const gfloat            beta  = data->beta;
+  const gfloat           *x     = data->x ? data->x + offset : NULL;
+  gfloat                 *y     = data->y + offset;
+  gsize                   i;
+
+  /* y is write-only when beta is 0, it may hold anything */
+  if (! x)
+    {
+      for (i = 0; i < size; i++)
+        y[i] *= beta;
+    }
+  else if (beta == 0.0f)
+    {
+      for (i = 0; i < size; i++)
+        y[i] = alpha * x[i];
+    }
+  else if (beta == 1.0f)
+    {
+      for (i = 0; i < size; i++)
+        y[i] += alpha * x[i];
+    }
+  else
+    {
+      for (i = 0; i < size; i++)
+        y[i] = alpha * x[i] + beta * y[i];
+    }
+}
+
+/* y = alpha * x + beta * y, over @n values.  @x may be NULL, in which case
+ * y = beta * y.
+ */
+static void
+tonemap_axpby (gsize         n,
+               gfloat        alpha,
+               const gfloat *x,
+               gfloat        beta,
+               gfloat       *y)
+{
+  TonemapAxpbyData data = { alpha, x, beta, y };
+
+  tonemap_distribute (n, tonemap_axpby_range, &data);
+}
+
+
+/* Returns the scale, at most @scale, at which to tone map @rect such that
+ * its smaller side stays at least TONEMAP_MIN_SOLVE_SIZE pixels, and
+ * stores the area to tone map, at that scale, in @solve_rect.
+ */
+static gdouble
+tonemap_get_solve_rect (const GeglRectangle *rect,
+                        gdouble              scale,
+                        GeglRectangle       *solve_rect)
+{
+  gint size = MIN (rect->width, rect->height);
+
+  if (scale * size < TONEMAP_MIN_SOLVE_SIZE)
+    scale = (gdouble) TONEMAP_MIN_SOLVE_SIZE / MAX (size, 1);
+
+  if (scale >= 1.0)
+    {
+      *solve_rect = *rect;
+
+      return 1.0;
+    }
+
+  solve_rect->x      = floor (rect->x * scale);
+  solve_rect->y      = floor (rect->y * scale);
+  solve_rect->width  = ceil ((rect->x + rect->width)  * scale) - solve_rect->x;
+  solve_rect->height = ceil ((rect->y + rect->height) * scale) - solve_rect->y;
+
+  return scale;
+}
+
+
+typedef struct
+{
+  gfloat       *lum;
+  gint          width;
+  gint          height;
+  const gfloat *gain;
+  gint          low_width;
+  gint          low_height;
+} TonemapGainData;
+
+static void
+tonemap_apply_gain_rows (gsize    offset,
+                         gsize    size,
+                         gpointer user_data)
+{
+  const TonemapGainData *data = user_data;
+  const gfloat           sx   = (gfloat) data->low_width  / data->width;
+  const gfloat           sy   = (gfloat) data->low_height / data->height;
+  gsize                  y;
+  gint                   x;
+
+  for (y = offset; y < offset + size; y++)
+    {
+      gfloat        v   = CLAMP ((y + 0.5f) * sy - 0.5f,
+                                 0.0f, data->low_height - 1);
+      gint          y0  = MIN ((gint) v, MAX (data->low_height - 2, 0));
+      gint          y1  = MIN (y0 + 1, data->low_height - 1);
+      gfloat        fy  = v - y0;
+      const gfloat *g0  = data->gain + (gsize) y0 * data->low_width;
+      const gfloat *g1  = data->gain + (gsize) y1 * data->low_width;
+      gfloat       *lum = data->lum  + y * data->width;
+
+      for (x = 0; x < data->width; x++)
+        {
+          gfloat u  = CLAMP ((x + 0.5f) * sx - 0.5f,
+                             0.0f, data->low_width - 1);
+          gint   x0 = MIN ((gint) u, MAX (data->low_width - 2, 0));
+          gint   x1 = MIN (x0 + 1, data->low_width - 1);
+          gfloat fx = u - x0;
+          gfloat g;
+
+          g = (1.0f - fy) * ((1.0f - fx) * g0[x0] + fx * g0[x1]) +
+                      fy  * ((1.0f - fx) * g1[x0] + fx * g1[x1]);
+
+          lum[x] *= expf (g);
+        }
+    }
+}
+
+/* Multiplies the luminance @lum, of @width x @height pixels, by the gain
+ * from @low_in to @low_out, of @low_width x @low_height pixels, which is
+ * the same image tone mapped at a lower resolution.  The gain is
+ * interpolated in the log domain, @low_in being clipped to @clip_min.
+ */
+static void
+tonemap_apply_gain (gfloat       *lum,
+                    gint          width,
+                    gint          height,
+                    const gfloat *low_in,
+                    const gfloat *low_out,
+                    gint          low_width,
+                    gint          low_height,
+                    gfloat        clip_min)
+{
+  TonemapGainData data;
+  gfloat         *gain;
+  gint            i;
+
+  gain = g_new (gfloat, low_width * low_height);
+
+  for (i = 0; i < low_width * low_height; i++)
+    gain[i] = logf (MAX (low_out[i], clip_min)) - logf (MAX (low_in[i], clip_min));
+
+  data.lum        = lum;
+  data.width      = width;
+  data.height     = height;
+  data.gain       = gain;
+  data.low_width  = low_width;
+  data.low_height = low_height;
+
+  tonemap_distribute_rows (height, width, tonemap_apply_gain_rows, &data);
+
+  g_free (gain);
+}
@@ -75,11 +75,12 @@ typedef struct _Cell
 
 typedef struct _CellsGrid
 {
-  Cell  *cells;
-  gint   n_cells;
-  gint   cell_size;
-  gint   cells_per_row;
-  gint   cells_per_column;
+  Cell    *cells;
+  gint     n_cells;
+  gint     cell_size;
+  gint     cells_per_row;
+  gint     cells_per_column;
+  gdouble  pixels_per_thread;
 } CellsGrid;
 
 static void
@@ -170,15 +171,26 @@ generate_gradient (GeglBuffer *input,
   return gradient;
 }
 
+typedef struct
+{
+  GeglBuffer    *buffer;
+  GeglBuffer    *labels;
+  const Babl    *format;
+  gint32         regularization;
+  CellsGrid     *grid;
+  GeglRectangle *seeds; /* one per cell */
+} WaterpixelsData;
+
 static void
-regularize_gradient  (GeglBuffer *gradient,
-                      gint32      regularization,
-                      CellsGrid  *grid)
+regularize_gradient_area (const GeglRectangle *area,
+                          gpointer             user_data)
 {
+  WaterpixelsData    *data = user_data;
+  CellsGrid          *grid = data->grid;
   GeglBufferIterator *iter;
   gint x, y;
 
-  iter = gegl_buffer_iterator_new (gradient, NULL, 0, babl_format ("Y float"),
+  iter = gegl_buffer_iterator_new (data->buffer, area, 0, babl_format ("Y float"),
                                    GEGL_ACCESS_READWRITE, GEGL_ABYSS_NONE, 1);
 
   while (gegl_buffer_iterator_next (iter))
@@ -199,26 +211,44 @@ regularize_gradient  (GeglBuffer *gradient,
                                      + POW2(y - cell->center_y))
                                 / (gdouble) grid->cell_size;
 
-           *pixel = *pixel + regularization * 2.0 * distance / (gdouble) grid->cell_size;
+           *pixel = *pixel + data->regularization * 2.0 * distance / (gdouble) grid->cell_size;
 
             pixel++;
           }
     }
 }
 
-static GeglBuffer *
-generate_labels (GeglBuffer *gradient,
-                 CellsGrid  *grid)
+static void
+regularize_gradient  (GeglBuffer *gradient,
+                      gint32      regularization,
+                      CellsGrid  *grid)
 {
-  GeglBuffer  *labels;
-  gfloat      *buff;
-  guint32      i;
-  guint32      label[2];
+  WaterpixelsData data;
 
-  labels = gegl_buffer_new (gegl_buffer_get_extent (gradient),
-                            babl_format ("YA u32"));
+  data.buffer         = gradient;
+  data.regularization = regularization;
+  data.grid           = grid;
 
-  for (i = 0; i < grid->n_cells; i++)
+  gegl_parallel_distribute_area (gegl_buffer_get_extent (gradient),
+                                 grid->pixels_per_thread,
+                                 GEGL_SPLIT_STRATEGY_AUTO,
+                                 regularize_gradient_area, &data);
+}
+
+/* finds the pixel of lowest gradient of the area of each cell */
+static void
+find_cells_minimum (gsize    offset,
+                    gsize    size,
+                    gpointer user_data)
+{
+  WaterpixelsData *data = user_data;
+  CellsGrid       *grid = data->grid;
+  gfloat          *buff;
+  gsize            i;
+
+  buff = g_new (gfloat, POW2 (grid->cell_size));
+
+  for (i = offset; i < offset + size; i++)
     {
       Cell *cell   = grid->cells + i;
       GeglRectangle min_pixel = {0, 0, 1, 1};
@@ -228,9 +258,7 @@ generate_labels (GeglBuffer *gradient,
       gint y = cell->area.y;
       gint n_pixels = cell->area.width * cell->area.height;
 
-      buff = g_new (gfloat, n_pixels);
-
-      gegl_buffer_get (gradient, &cell->area, 1.0, babl_format ("Y float"),
+      gegl_buffer_get (data->buffer, &cell->area, 1.0, babl_format ("Y float"),
                        buff, GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
 
       pixel = buff;
@@ -254,14 +282,43 @@ generate_labels (GeglBuffer *gradient,
             }
         }
 
+      data->seeds[i] = min_pixel;
+    }
+
+  g_free (buff);
+}
+
+static GeglBuffer *
+generate_labels (GeglBuffer *gradient,
+                 CellsGrid  *grid)
+{
+  GeglBuffer      *labels;
+  WaterpixelsData  data;
+  guint32          i;
+  guint32          label[2];
+
+  labels = gegl_buffer_new (gegl_buffer_get_extent (gradient),
+                            babl_format ("YA u32"));
+
+  data.buffer = gradient;
+  data.grid   = grid;
+  data.seeds  = g_new (GeglRectangle, grid->n_cells);
+
+  gegl_parallel_distribute_range (grid->n_cells,
+                                  grid->pixels_per_thread /
+                                  POW2 (grid->cell_size),
+                                  find_cells_minimum, &data);
+
+  for (i = 0; i < grid->n_cells; i++)
+    {
       label[0] = i;
       label[1] = 1;
-      gegl_buffer_set (labels, &min_pixel, 0, babl_format ("YA u32"),
+      gegl_buffer_set (labels, &data.seeds[i], 0, babl_format ("YA u32"),
                        label, GEGL_AUTO_ROWSTRIDE);
-
-      g_free (buff);
     }
 
+  g_free (data.seeds);
+
   return labels;
 }
 
@@ -384,18 +441,17 @@ get_average_colors (GeglBuffer *input,
 }
 
 static void
-fill_output (GeglBuffer *output,
-             GeglBuffer *labels,
-             CellsGrid  *grid,
-             const Babl *space)
+fill_output_area (const GeglRectangle *area,
+                  gpointer             user_data)
 {
+  WaterpixelsData    *data = user_data;
+  CellsGrid          *grid = data->grid;
   GeglBufferIterator *iter;
 
-  iter = gegl_buffer_iterator_new (labels, NULL, 0, babl_format ("YA u32"),
+  iter = gegl_buffer_iterator_new (data->labels, area, 0, babl_format ("YA u32"),
                                    GEGL_ACCESS_READ, GEGL_ABYSS_NONE, 2);
 
-  gegl_buffer_iterator_add (iter, output, NULL, 0,
-                            babl_format_with_space ("R'G'B' float", space),
+  gegl_buffer_iterator_add (iter, data->buffer, area, 0, data->format,
                             GEGL_ACCESS_WRITE, GEGL_ABYSS_NONE);
 
   while (gegl_buffer_iterator_next (iter))
@@ -418,6 +474,25 @@ fill_output (GeglBuffer *output,
     }
 }
 
+static void
+fill_output (GeglBuffer *output,
+             GeglBuffer *labels,
+             CellsGrid  *grid,
+             const Babl *space)
+{
+  WaterpixelsData data;
+
+  data.buffer = output;
+  data.labels = labels;
+  data.grid   = grid;
+  data.format = babl_format_with_space ("R'G'B' float", space);
+
+  gegl_parallel_distribute_area (gegl_buffer_get_extent (labels),
+                                 grid->pixels_per_thread,
+                                 GEGL_SPLIT_STRATEGY_AUTO,
+                                 fill_output_area, &data);
+}
+
 static void
 prepare (GeglOperation *operation)
 {
@@ -471,6 +546,8 @@ process (GeglOperation       *operation,
 
   initiliaze_cellsgrid (&grid, gegl_buffer_get_extent (input), o->size);
 
+  grid.pixels_per_thread = gegl_operation_get_pixels_per_thread (operation);
+
   gradient       = generate_gradient (input, o->smoothness);
   initial_labels = generate_labels (gradient, &grid);
 
@@ -38,26 +38,67 @@ property_format (flag, _("flag"), NULL)
 
 #include "gegl-op.h"
 
-typedef struct _PixelCoords
+/* a FIFO of pixel offsets */
+typedef struct _Queue
 {
-  gint x;
-  gint y;
-} PixelCoords;
+  gint  *data;
+  gsize  head;
+  gsize  tail;
+  gsize  size;
+} Queue;
 
 typedef struct _HQ
 {
-  GQueue  *queues[256];
-  GQueue  *lowest_non_empty;
-  gint     lowest_non_empty_level;
+  Queue   queues[256];
+  Queue  *lowest_non_empty;
+  gint    lowest_non_empty_level;
 } HQ;
 
+static inline gboolean
+queue_is_empty (Queue *queue)
+{
+  return queue->head == queue->tail;
+}
+
+static inline void
+queue_push (Queue *queue,
+            gint   value)
+{
+  if (queue->tail == queue->size)
+    {
+      if (queue->head && queue->head >= queue->size / 2)
+        {
+          memmove (queue->data, queue->data + queue->head,
+                   (queue->tail - queue->head) * sizeof (gint));
+
+          queue->tail -= queue->head;
+          queue->head  = 0;
+        }
+      else
+        {
+          queue->size = MAX (2 * queue->size, 64);
+          queue->data = g_renew (gint, queue->data, queue->size);
+        }
+    }
+
+  queue->data[queue->tail++] = value;
+}
+
+static inline gint
+queue_pop (Queue *queue)
+{
+  gint value = queue->data[queue->head++];
+
+  if (queue->head == queue->tail)
+    queue->head = queue->tail = 0;
+
+  return value;
+}
+
 static void
 HQ_init (HQ *hq)
 {
-  gint i;
-
-  for (i = 0; i < 256; i++)
-    hq->queues[i] = g_queue_new ();
+  memset (hq->queues, 0, sizeof (hq->queues));
 
   hq->lowest_non_empty       = NULL;
   hq->lowest_non_empty_level = 255;
@@ -73,46 +114,46 @@ HQ_is_empty (HQ *hq)
 }
 
 static inline void
-HQ_push (HQ      *hq,
-         guint8   level,
-         gpointer data)
+HQ_push (HQ     *hq,
+         guint8  level,
+         gint    index)
 {
-  g_queue_push_head (hq->queues[level], data);
+  queue_push (&hq->queues[level], index);
 
   if (level <= hq->lowest_non_empty_level)
     {
       hq->lowest_non_empty_level = level;
-      hq->lowest_non_empty       = hq->queues[level];
+      hq->lowest_non_empty       = &hq->queues[level];
     }
 }
 
-static inline gpointer
+static inline gint
 HQ_pop (HQ *hq)
 {
   gint i, level;
-  gpointer data = NULL;
+  gint index = -1;
 
   if (hq->lowest_non_empty != NULL)
     {
-      data = g_queue_pop_tail (hq->lowest_non_empty);
+      index = queue_pop (hq->lowest_non_empty);
 
-      if (g_queue_is_empty (hq->lowest_non_empty))
+      if (queue_is_empty (hq->lowest_non_empty))
         {
           level = hq->lowest_non_empty_level;
           hq->lowest_non_empty_level = 255;
           hq->lowest_non_empty       = NULL;
 
           for (i = level + 1; i < 256; i++)
-            if (!g_queue_is_empty (hq->queues[i]))
+            if (!queue_is_empty (&hq->queues[i]))
               {
                 hq->lowest_non_empty_level = i;
-                hq->lowest_non_empty       = hq->queues[i];
+                hq->lowest_non_empty       = &hq->queues[i];
                 break;
               }
         }
     }
 
-  return data;
+  return index;
 }
 
 static void
@@ -122,10 +163,10 @@ HQ_clean (HQ *hq)
 
   for (i = 0; i < 256; i++)
     {
-      if (!g_queue_is_empty (hq->queues[i]))
+      if (!queue_is_empty (&hq->queues[i]))
         g_printerr ("queue %u is not empty!\n", i);
-      else
-        g_queue_free (hq->queues[i]);
+
+      g_free (hq->queues[i].data);
     }
 }
 
@@ -209,6 +250,91 @@ get_cached_region (GeglOperation       *operation,
   return get_bounding_box (operation);
 }
 
+static const gint neighbors_coords[8][2] = {{-1, -1},{0, -1},{1, -1},
+                                             {-1, 0},         {1, 0},
+                                             {-1, 1}, {0, 1}, {1, 1}};
+
+typedef struct
+{
+  const GeglRectangle *extent;
+  GArray              *chunks;
+  GArray             **seeds;
+  const guint8        *labels;
+  gint                 bpp;
+  gint                 bpc;
+  const guint8        *flag;
+  gint                 flag_idx;
+} SeedData;
+
+static inline gboolean
+is_flagged (const guint8 *label,
+            const guint8 *flag,
+            gint          flag_idx,
+            gint          bpc)
+{
+  gint i;
+
+  for (i = 0; i < bpc; i++)
+    if (label[flag_idx * bpc + i] != (flag ? flag[i] : 0))
+      return FALSE;
+
+  return TRUE;
+}
+
+/* finds the labelled pixels of the chunks which have at least one
+ * unlabelled neighbour, in the order the chunks have been read in.
+ */
+static void
+find_seeds (gsize    offset,
+            gsize    size,
+            gpointer user_data)
+{
+  SeedData *data   = user_data;
+  gint      width  = data->extent->width;
+  gint      height = data->extent->height;
+  gint      bpp    = data->bpp;
+  gsize     chunk;
+
+  for (chunk = offset; chunk < offset + size; chunk++)
+    {
+      const GeglRectangle *roi   = &g_array_index (data->chunks,
+                                                   GeglRectangle, chunk);
+      GArray              *seeds = g_array_new (FALSE, FALSE, sizeof (gint));
+      gint                 x, y, j;
+
+      for (y = roi->y; y < roi->y + roi->height; y++)
+        for (x = roi->x; x < roi->x + roi->width; x++)
+          {
+            gint          index = y * width + x;
+            const guint8 *label = data->labels + (gsize) index * bpp;
+
+            if (is_flagged (label, data->flag, data->flag_idx, data->bpc))
+              continue;
+
+            for (j = 0; j < 8; j++)
+              {
+                gint nx = x + neighbors_coords[j][0];
+                gint ny = y + neighbors_coords[j][1];
+
+                if (nx < 0 || nx >= width || ny < 0 || ny >= height)
+                  continue;
+
+                if (is_flagged (data->labels + ((gsize) ny * width + nx) * bpp,
+                                data->flag, data->flag_idx, data->bpc))
+                  {
+                    /* This pixel is not flagged and has at least one
+                     * flagged neighbour.
+                     */
+                    g_array_append_val (seeds, index);
+                    break;
+                  }
+              }
+          }
+
+      data->seeds[chunk] = seeds;
+    }
+}
+
 static gboolean
 process (GeglOperation       *operation,
          GeglBuffer          *input,
@@ -219,211 +345,137 @@ process (GeglOperation       *operation,
          guint8              *flag,
          gint                 flag_idx)
 {
-  HQ      hq;
-  guint8  square3x3[72];
-  gint    i;
-  gint    j;
-  gint    x, y;
+  HQ       hq;
+  SeedData data;
+  gint     i;
+  gint     j;
   GeglBufferIterator  *iter;
-  GeglSampler         *gradient_sampler = NULL;
   const GeglRectangle *extent = gegl_buffer_get_extent (input);
+  gint                 width  = extent->width;
+  gint                 height = extent->height;
+  guint8              *labels;
+  guint8              *gradient = NULL;
+  GArray              *chunks;
 
   const Babl  *gradient_format = babl_format ("Y u8");
   const Babl  *labels_format   = gegl_buffer_get_format (input);
   gint         bpp             = babl_format_get_bytes_per_pixel (labels_format);
   gint         bpc             = bpp / babl_format_get_n_components (labels_format);
 
-  gint neighbors_coords[8][2] = {{-1, -1},{0, -1},{1, -1},
-                                 {-1, 0},         {1, 0},
-                                 {-1, 1}, {0, 1}, {1, 1}};
-
-  /* initialize hierarchical queues */
+  if (gegl_rectangle_is_empty (extent))
+    return TRUE;
 
-  HQ_init (&hq);
+  /* The labels are flooded in memory, using pixel offsets as queue items.
+   * The seeds have to be queued in the same order as the input is read in,
+   * which is why the chunks are kept.
+   */
+  labels = gegl_malloc ((gsize) width * height * bpp);
+  chunks = g_array_new (FALSE, FALSE, sizeof (GeglRectangle));
 
   iter = gegl_buffer_iterator_new (input, extent, 0, labels_format,
-                                   GEGL_ACCESS_READ, GEGL_ABYSS_NONE,
-                                   aux ? 11 : 10);
-
-  gegl_buffer_iterator_add (iter, output, extent, 0, labels_format,
-                            GEGL_ACCESS_WRITE, GEGL_ABYSS_NONE);
-
-  /* Add 8 neighbours. */
-  gegl_buffer_iterator_add (iter, input,
-                            GEGL_RECTANGLE (-1, -1, extent->width, extent->height),
-                            0, labels_format, GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
-  gegl_buffer_iterator_add (iter, input,
-                            GEGL_RECTANGLE (0, -1, extent->width, extent->height),
-                            0, labels_format, GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
-  gegl_buffer_iterator_add (iter, input,
-                            GEGL_RECTANGLE (1, -1, extent->width, extent->height),
-                            0, labels_format, GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
-  gegl_buffer_iterator_add (iter, input,
-                            GEGL_RECTANGLE (-1, 0, extent->width, extent->height),
-                            0, labels_format, GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
-  gegl_buffer_iterator_add (iter, input,
-                            GEGL_RECTANGLE (1, 0, extent->width, extent->height),
-                            0, labels_format, GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
-  gegl_buffer_iterator_add (iter, input,
-                            GEGL_RECTANGLE (-1, 1, extent->width, extent->height),
-                            0, labels_format, GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
-  gegl_buffer_iterator_add (iter, input,
-                            GEGL_RECTANGLE (0, 1, extent->width, extent->height),
-                            0, labels_format, GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
-  gegl_buffer_iterator_add (iter, input,
-                            GEGL_RECTANGLE (1, 1, extent->width, extent->height),
-                            0, labels_format, GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
-  /* Priority map: lower is higher priority. */
-  if (aux)
-    gegl_buffer_iterator_add (iter, aux, extent, 0, gradient_format,
-                              GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
+                                   GEGL_ACCESS_READ, GEGL_ABYSS_NONE, 1);
 
   while (gegl_buffer_iterator_next (iter))
     {
-      GeglRectangle *roi      = &iter->items[0].roi;
-      guint8        *label    = iter->items[0].data;
-      guint8        *outlabel = iter->items[1].data;
-      guint8        *n[8]     =
-        {
-          iter->items[2].data,
-          iter->items[3].data,
-          iter->items[4].data,
-          iter->items[5].data,
-          iter->items[6].data,
-          iter->items[7].data,
-          iter->items[8].data,
-          iter->items[9].data
-        };
-      guint8        *prio    = aux ? iter->items[10].data : NULL;
+      GeglRectangle roi   = iter->items[0].roi;
+      const guint8 *label = iter->items[0].data;
+      gint          y;
 
-      for (y = roi->y; y < roi->y + roi->height; y++)
-        for (x = roi->x; x < roi->x + roi->width; x++)
-          {
-            gboolean flagged = TRUE;
-
-            for (i = 0; i < bpc; i++)
-              if (label[flag_idx * bpc + i] != (flag ? flag[i] : 0))
-                {
-                  flagged = FALSE;
-                  break;
-                }
-            if (! flagged)
-              {
-                for (j = 0; j < 8; j++)
-                  {
-                    if (x == 0 && (j == 0 || j == 3 || j == 5))
-                      continue;
-                    if (y == 0 && (j == 0 || j == 1 || j == 2))
-                      continue;
-                    if (x == extent->width - 1 && (j == 2 || j == 4 || j == 7))
-                      continue;
-                    if (y == extent->height - 1 && (j == 5 || j == 6 || j == 7))
-                      continue;
-
-                    flagged = TRUE;
-                    for (i = 0; i < bpc; i++)
-                      if (n[j][flag_idx * bpc + i] != (flag ? flag[i] : 0))
-                        {
-                          flagged = FALSE;
-                          break;
-                        }
-                    if (flagged)
-                      break;
-                  }
-                if (flagged)
-                  {
-                    /* This pixel is not flagged and has at least one flagged
-                     * neighbour.
-                     */
-                    PixelCoords *p = g_new (PixelCoords, 1);
-                    p->x = x;
-                    p->y = y;
+      roi.x -= extent->x;
+      roi.y -= extent->y;
 
-                    HQ_push (&hq, prio ? *prio : 0, p);
-                  }
-              }
-
-            for (i = 0; i < bpp; i++)
-              outlabel[i] = label[i];
+      for (y = 0; y < roi.height; y++)
+        {
+          memcpy (labels + ((gsize) (roi.y + y) * width + roi.x) * bpp,
+                  label + (gsize) y * roi.width * bpp,
+                  roi.width * bpp);
+        }
 
-            if (prio)
-              prio++;
-            label    += bpp;
-            outlabel += bpp;
-            for (j = 0; j < 8; j++)
-              n[j] += bpp;
-          }
+      g_array_append_val (chunks, roi);
     }
 
+  /* Priority map: lower is higher priority. */
   if (aux)
-    gradient_sampler = gegl_buffer_sampler_new_at_level (aux,
-                                                         gradient_format,
-                                                         GEGL_SAMPLER_NEAREST,
-                                                         level);
-  while (!HQ_is_empty (&hq))
     {
-      PixelCoords *p = (PixelCoords *) HQ_pop (&hq);
-      guint8       label[bpp];
-
-      GeglRectangle square_rect = {p->x - 1, p->y - 1, 3, 3};
+      gradient = gegl_malloc ((gsize) width * height);
 
-      gegl_buffer_get (output, &square_rect, 1.0, labels_format,
-                       square3x3,
+      gegl_buffer_get (aux, extent, 1.0, gradient_format, gradient,
                        GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+    }
+
+  /* initialize hierarchical queues */
+
+  data.extent   = extent;
+  data.chunks   = chunks;
+  data.seeds    = g_new (GArray *, chunks->len);
+  data.labels   = labels;
+  data.bpp      = bpp;
+  data.bpc      = bpc;
+  data.flag     = flag;
+  data.flag_idx = flag_idx;
+
+  gegl_parallel_distribute_range (chunks->len,
+                                  gegl_operation_get_pixels_per_thread (
+                                    operation) /
+                                  ((gdouble) width * height / chunks->len),
+                                  find_seeds, &data);
+
+  HQ_init (&hq);
+
+  for (i = 0; i < chunks->len; i++)
+    {
+      GArray *seeds = data.seeds[i];
 
-      for (i = 0; i < bpp; i++)
-        label[i] = square3x3[4 * bpp + i];
+      for (j = 0; j < seeds->len; j++)
+        {
+          gint index = g_array_index (seeds, gint, j);
+
+          HQ_push (&hq, gradient ? gradient[index] : 0, index);
+        }
+
+      g_array_free (seeds, TRUE);
+    }
+
+  g_free (data.seeds);
+  g_array_free (chunks, TRUE);
+
+  while (!HQ_is_empty (&hq))
+    {
+      gint          index = HQ_pop (&hq);
+      gint          x     = index % width;
+      gint          y     = index / width;
+      const guint8 *label = labels + (gsize) index * bpp;
 
-      /* compute neighbors coordinate */
       for (j = 0; j < 8; j++)
         {
-          guint8   *neighbor_label;
-          gint      nx = p->x + neighbors_coords[j][0];
-          gint      ny = p->y + neighbors_coords[j][1];
-          gboolean  flagged = TRUE;
+          guint8 *neighbor_label;
+          gint    nx = x + neighbors_coords[j][0];
+          gint    ny = y + neighbors_coords[j][1];
+          gint    n;
 
-          if (nx < 0 || nx >= extent->width || ny < 0 || ny >= extent->height)
+          if (nx < 0 || nx >= width || ny < 0 || ny >= height)
             continue;
 
-          neighbor_label = square3x3 + ((neighbors_coords[j][0] + 1) + (neighbors_coords[j][1] + 1) * 3) * bpp;
+          n              = ny * width + nx;
+          neighbor_label = labels + (gsize) n * bpp;
 
-          for (i = 0; i < bpc; i++)
-            if (neighbor_label[flag_idx * bpc + i] != (flag ? flag[i] : 0))
-              {
-                flagged = FALSE;
-                break;
-              }
-          if (flagged)
+          if (is_flagged (neighbor_label, flag, flag_idx, bpc))
             {
-              guint8 gradient_value = 0;
-              GeglRectangle n_rect = {nx, ny, 1, 1};
-              PixelCoords *n = g_new (PixelCoords, 1);
-              n->x = nx;
-              n->y = ny;
-
-              if (gradient_sampler)
-                gegl_sampler_get (gradient_sampler,
-                                  (gdouble) nx,
-                                  (gdouble) ny,
-                                  NULL, &gradient_value, GEGL_ABYSS_NONE);
-
-              HQ_push (&hq, gradient_value, n);
-
-              for (i = 0; i < bpp; i++)
-                neighbor_label[i] = label[i];
-
-              gegl_buffer_set (output, &n_rect,
-                               0, labels_format,
-                               neighbor_label, GEGL_AUTO_ROWSTRIDE);
+              HQ_push (&hq, gradient ? gradient[n] : 0, n);
+
+              memcpy (neighbor_label, label, bpp);
             }
         }
-
-      g_free (p);
     }
-  if (gradient_sampler)
-    g_object_unref (gradient_sampler);
 
   HQ_clean (&hq);
+
+  gegl_buffer_set (output, extent, 0, labels_format,
+                   labels, GEGL_AUTO_ROWSTRIDE);
+
+  gegl_free (gradient);
+  gegl_free (labels);
+
   return  TRUE;
 }
 
@@ -47,6 +47,9 @@ description (_("The orientation of the blur - hor/ver"))
 
 #include "gegl-op.h"
 
+/* the number of columns blurred together */
+#define WAV_N_LINES 16
+
 static inline void
 wav_get_mean_pixel_1D (gfloat  *src,
                        gfloat  *dst,
@@ -111,6 +114,9 @@ wav_hor_blur (GeglBuffer          *src,
   gegl_free (dst_buf);
 }
 
+/* the columns are read WAV_N_LINES at a time, transposed into rows, such
+ * that the buffer is read and written whole spans of the rows at a time.
+ */
 static void
 wav_ver_blur (GeglBuffer          *src,
               GeglBuffer          *dst,
@@ -125,28 +131,40 @@ wav_ver_blur (GeglBuffer          *src,
   GeglRectangle read_rect  = {dst_rect->x, dst_rect->y - radius,
                               1, dst_rect->height + 2 * radius};
 
-  gfloat *src_buf    = gegl_malloc (read_rect.height * sizeof(gfloat) * 3);
-  gfloat *dst_buf    = gegl_malloc (write_rect.height * sizeof(gfloat) * 3);
+  gfloat *src_buf    = gegl_malloc (WAV_N_LINES * read_rect.height *
+                                    sizeof(gfloat) * 3);
+  gfloat *dst_buf    = gegl_malloc (WAV_N_LINES * write_rect.height *
+                                    sizeof(gfloat) * 3);
 
-  for (x = 0; x < dst_rect->width; x++)
+  for (x = 0; x < dst_rect->width; x += WAV_N_LINES)
     {
-      gint offset     = 0;
+      gint n_lines    = MIN (WAV_N_LINES, dst_rect->width - x);
+      gint i;
+
       read_rect.x     = dst_rect->x + x;
       write_rect.x    = dst_rect->x + x;
+      read_rect.width = write_rect.width = n_lines;
 
-      gegl_buffer_get (src, &read_rect, 1.0, format, src_buf,
-                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_CLAMP);
+      gegl_buffer_get_transposed (src, &read_rect, 1.0, format, src_buf,
+                                  GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_CLAMP);
 
-      for (y = 0; y < dst_rect->height; y++)
+      for (i = 0; i < n_lines; i++)
         {
-          wav_get_mean_pixel_1D (src_buf + offset,
-                                 dst_buf + offset,
-                                 radius);
-          offset += 3;
+          gfloat *src_col = src_buf + i * read_rect.height  * 3;
+          gfloat *dst_col = dst_buf + i * write_rect.height * 3;
+          gint    offset  = 0;
+
+          for (y = 0; y < dst_rect->height; y++)
+            {
+              wav_get_mean_pixel_1D (src_col + offset,
+                                     dst_col + offset,
+                                     radius);
+              offset += 3;
+            }
         }
 
-      gegl_buffer_set (dst, &write_rect, 0, format, dst_buf,
-                       GEGL_AUTO_ROWSTRIDE);
+      gegl_buffer_set_transposed (dst, &write_rect, 0, format, dst_buf,
+                                  GEGL_AUTO_ROWSTRIDE);
     }
 
   gegl_free (src_buf);
@@ -85,6 +85,29 @@ prepare (GeglOperation *operation)
                                          babl_format ("Y' float"));
 }
 
+/* the input is labeled in strips of this many rows in parallel, whose
+ * labels are then merged across the borders of the strips.
+ */
+#define STRIP_HEIGHT 128
+
+typedef struct
+{
+  GeglProperties      *o;
+  GeglBuffer          *input;
+  GeglBuffer          *output;
+  const GeglRectangle *roi;
+  const Babl          *input_format;
+  const Babl          *output_format;
+  gint                 input_bpp;
+  guint8               separator[64];
+
+  GArray             **strip_indices; /* the labels of each strip */
+  gint32              *offsets;       /* added to the labels of each strip
+                                       * to make them global
+                                       */
+  const GArray        *values;        /* the output value of each label */
+} ConnectedComponentsData;
+
 static gint
 get_target_index (GArray *indices,
                   gint    index)
@@ -101,62 +124,60 @@ get_target_index (GArray *indices,
   return target;
 }
 
-static gboolean
-process (GeglOperation       *operation,
-         GeglBuffer          *input,
-         GeglBuffer          *output,
-         const GeglRectangle *roi,
-         gint                 level)
+static void
+get_strip_rect (const ConnectedComponentsData *data,
+                gint                           strip,
+                GeglRectangle                 *rect)
 {
-  GeglProperties     *o             = GEGL_PROPERTIES (operation);
-  gboolean            invert        = o->invert;
-  const Babl         *input_format  = gegl_buffer_get_format (input);
-  const Babl         *output_format = gegl_buffer_get_format (output);
-  gint                input_bpp     = babl_format_get_bytes_per_pixel (
-                                        input_format);
-  guint8             *in_row;
-  gint32             *out_rows[2];
-  guint8              separator[64];
-  GArray             *indices;
-  gint                n_indices;
-  gint32              index;
-  GeglBufferIterator *iter;
-  gint                y;
-  gint                i;
-
-  G_STATIC_ASSERT (sizeof (gint32) == sizeof (gfloat));
-
-  if (input_bpp > sizeof (separator))
-    return FALSE;
+  rect->x      = data->roi->x;
+  rect->y      = data->roi->y + strip * STRIP_HEIGHT;
+  rect->width  = data->roi->width;
+  rect->height = MIN (STRIP_HEIGHT, data->roi->y + data->roi->height - rect->y);
+}
 
-  gegl_color_get_pixel (o->separator, input_format, separator);
+/* labels the connected regions of a strip, writing the labels to the
+ * output, and returns the label each of them is merged into.  labels are
+ * always merged into a lower one, so that each region ends up with the
+ * label of its first pixel.
+ */
+static GArray *
+label_strip (const ConnectedComponentsData *data,
+             const GeglRectangle           *rect)
+{
+  gboolean  invert    = data->o->invert;
+  gint      input_bpp = data->input_bpp;
+  guint8   *in_row;
+  gint32   *out_rows[2];
+  GArray   *indices;
+  gint32    index;
+  gint      y;
+  gint      i;
 
   indices = g_array_new (FALSE, FALSE, sizeof (gint32));
 
-  in_row      = g_malloc (input_bpp * roi->width);
-  out_rows[0] = g_new (gint32, roi->width);
-  out_rows[1] = g_new (gint32, roi->width);
+  in_row      = g_malloc (input_bpp * rect->width);
+  out_rows[0] = g_new (gint32, rect->width);
+  out_rows[1] = g_new (gint32, rect->width);
 
   g_array_append_val (indices, (gint32) {0});
 
-  n_indices = 1;
-
-  for (y = 0; y < roi->height; y++)
+  for (y = 0; y < rect->height; y++)
     {
       guint8       *in   = in_row;
       const gint32 *out0 = out_rows[y       % 2];
       gint32       *out1 = out_rows[(y + 1) % 2];
       gint          x;
 
-      gegl_buffer_get (input,
-                       GEGL_RECTANGLE (roi->x, roi->y + y, roi->width, 1), 1.0,
-                       input_format, in, GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+      gegl_buffer_get (data->input,
+                       GEGL_RECTANGLE (rect->x, rect->y + y, rect->width, 1),
+                       1.0, data->input_format, in,
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
 
-      for (x = 0; x < roi->width; x++)
+      for (x = 0; x < rect->width; x++)
         {
           index = 0;
 
-          if ((! memcmp (in, separator, input_bpp)) == invert)
+          if ((! memcmp (in, data->separator, input_bpp)) == invert)
             {
               gint index1 = 0;
               gint index2 = 0;
@@ -178,8 +199,6 @@ process (GeglOperation       *operation,
                     {
                       g_array_index (indices, gint32,
                                      MAX (index1, index2)) = index;
-
-                      n_indices--;
                     }
                 }
               else
@@ -191,8 +210,6 @@ process (GeglOperation       *operation,
                       index = indices->len;
 
                       g_array_append_val (indices, index);
-
-                      n_indices++;
                     }
                 }
             }
@@ -205,16 +222,201 @@ process (GeglOperation       *operation,
           out1++;
         }
 
-      gegl_buffer_set (output,
-                       GEGL_RECTANGLE (roi->x, roi->y + y, roi->width, 1), 0,
-                       output_format, out1 - roi->width, GEGL_AUTO_ROWSTRIDE);
+      gegl_buffer_set (data->output,
+                       GEGL_RECTANGLE (rect->x, rect->y + y, rect->width, 1),
+                       0, data->output_format, out1 - rect->width,
+                       GEGL_AUTO_ROWSTRIDE);
     }
 
   g_free (in_row);
   g_free (out_rows[0]);
   g_free (out_rows[1]);
 
-  n_indices = MAX (n_indices - 1, 1);
+  for (i = 0; i < indices->len; i++)
+    get_target_index (indices, i);
+
+  return indices;
+}
+
+static void
+label_strips (gsize    offset,
+              gsize    size,
+              gpointer user_data)
+{
+  ConnectedComponentsData *data = user_data;
+  gint                     strip;
+
+  for (strip = offset; strip < offset + size; strip++)
+    {
+      GeglRectangle rect;
+
+      get_strip_rect (data, strip, &rect);
+
+      data->strip_indices[strip] = label_strip (data, &rect);
+    }
+}
+
+/* replaces the labels of the strips with their output values */
+static void
+map_strips (gsize    offset,
+            gsize    size,
+            gpointer user_data)
+{
+  ConnectedComponentsData *data = user_data;
+  gint                     strip;
+
+  for (strip = offset; strip < offset + size; strip++)
+    {
+      const gfloat       *values = (const gfloat *) data->values->data;
+      const gfloat       *strip_values;
+      GeglRectangle       rect;
+      GeglBufferIterator *iter;
+
+      /* the strip's labels start at 1, and 0 is shared */
+      strip_values = values + data->offsets[strip];
+
+      get_strip_rect (data, strip, &rect);
+
+      iter = gegl_buffer_iterator_new (data->output, &rect, 0,
+                                       data->output_format,
+                                       GEGL_ACCESS_READWRITE,
+                                       GEGL_ABYSS_NONE, 1);
+
+      while (gegl_buffer_iterator_next (iter))
+        {
+          gint32 *out = iter->items[0].data;
+          gint    i;
+
+          for (i = 0; i < iter->length; i++)
+            {
+              *(gfloat *) out = *out ? strip_values[*out] : values[0];
+
+              out++;
+            }
+        }
+    }
+}
+
+static gboolean
+process (GeglOperation       *operation,
+         GeglBuffer          *input,
+         GeglBuffer          *output,
+         const GeglRectangle *roi,
+         gint                 level)
+{
+  GeglProperties          *o = GEGL_PROPERTIES (operation);
+  ConnectedComponentsData  data;
+  GArray                  *indices;
+  gint32                  *rows;
+  gint                     n_strips;
+  gint                     n_indices;
+  gint32                   index;
+  gdouble                  thread_cost;
+  gint                     strip;
+  gint                     i;
+
+  G_STATIC_ASSERT (sizeof (gint32) == sizeof (gfloat));
+
+  if (gegl_rectangle_is_empty (roi))
+    return TRUE;
+
+  data.o             = o;
+  data.input         = input;
+  data.output        = output;
+  data.roi           = roi;
+  data.input_format  = gegl_buffer_get_format (input);
+  data.output_format = gegl_buffer_get_format (output);
+  data.input_bpp     = babl_format_get_bytes_per_pixel (data.input_format);
+
+  if (data.input_bpp > sizeof (data.separator))
+    return FALSE;
+
+  gegl_color_get_pixel (o->separator, data.input_format, data.separator);
+
+  n_strips = (roi->height + STRIP_HEIGHT - 1) / STRIP_HEIGHT;
+
+  data.strip_indices = g_new (GArray *, n_strips);
+  data.offsets       = g_new (gint32, n_strips);
+
+  thread_cost = gegl_operation_get_pixels_per_thread (operation) /
+                ((gdouble) roi->width * STRIP_HEIGHT);
+
+  gegl_parallel_distribute_range (n_strips, thread_cost, label_strips, &data);
+
+  /* number the labels of all the strips in order, keeping each of them
+   * merged into a lower one.
+   */
+  n_indices = 1;
+
+  for (strip = 0; strip < n_strips; strip++)
+    {
+      data.offsets[strip]  = n_indices - 1;
+      n_indices           += data.strip_indices[strip]->len - 1;
+    }
+
+  indices = g_array_sized_new (FALSE, FALSE, sizeof (gint32), n_indices);
+  g_array_set_size (indices, n_indices);
+
+  g_array_index (indices, gint32, 0) = 0;
+
+  for (strip = 0; strip < n_strips; strip++)
+    {
+      GArray *strip_indices = data.strip_indices[strip];
+      gint32  offset        = data.offsets[strip];
+
+      for (i = 1; i < strip_indices->len; i++)
+        {
+          g_array_index (indices, gint32, offset + i) =
+            offset + g_array_index (strip_indices, gint32, i);
+        }
+
+      g_array_unref (strip_indices);
+    }
+
+  /* merge the regions touching across the borders of the strips */
+  rows = g_new (gint32, 2 * roi->width);
+
+  for (strip = 1; strip < n_strips; strip++)
+    {
+      gint y = roi->y + strip * STRIP_HEIGHT;
+      gint x;
+
+      gegl_buffer_get (output, GEGL_RECTANGLE (roi->x, y - 1, roi->width, 2),
+                       1.0, data.output_format, rows,
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+      for (x = 0; x < roi->width; x++)
+        {
+          gint index1 = rows[x];
+          gint index2 = rows[roi->width + x];
+
+          if (index1 && index2)
+            {
+              index1 = get_target_index (indices,
+                                         data.offsets[strip - 1] + index1);
+              index2 = get_target_index (indices,
+                                         data.offsets[strip] + index2);
+
+              if (index1 != index2)
+                {
+                  g_array_index (indices, gint32, MAX (index1, index2)) =
+                    MIN (index1, index2);
+                }
+            }
+        }
+    }
+
+  g_free (rows);
+
+  n_indices = 0;
+
+  for (i = 1; i < indices->len; i++)
+    {
+      if (g_array_index (indices, gint32, i) == i)
+        n_indices++;
+    }
+
+  n_indices = MAX (n_indices, 1);
 
   index = 0;
 
@@ -238,22 +440,13 @@ process (GeglOperation       *operation,
       g_array_index (indices, gfloat, i) = v;
     }
 
-  iter = gegl_buffer_iterator_new (output, roi, 0, output_format,
-                                   GEGL_ACCESS_READWRITE, GEGL_ABYSS_NONE, 1);
-
-  while (gegl_buffer_iterator_next (iter))
-    {
-      gint32 *data = iter->items[0].data;
+  data.values = indices;
 
-      for (i = 0; i < iter->length; i++)
-        {
-          *(gfloat *) data = g_array_index (indices, gfloat, *data);
-
-          data++;
-        }
-    }
+  gegl_parallel_distribute_range (n_strips, thread_cost, map_strips, &data);
 
   g_array_unref (indices);
+  g_free (data.offsets);
+  g_free (data.strip_indices);
 
   return TRUE;
 }
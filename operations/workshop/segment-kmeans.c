@@ -46,15 +46,52 @@ property_seed (seed, _("Random seed"), rand)
 
 #define MAX_PIXELS 100000
 
+/* the cluster sums are accumulated over fixed blocks of this many pixels,
+ * then over the blocks in order, such that they don't depend on the
+ * number of threads.
+ */
+#define BLOCK_SIZE 4096
+
+/* the maximal number of clusters */
+#define MAX_CLUSTERS 255
+
 #define POW2(x) ((x)*(x))
 
 typedef struct
 {
-  gfloat center[3];
-  gfloat sum[3];
-  glong  count;
+  gfloat  center[3];
+  gdouble sum[3];
+  glong   count;
 } Cluster;
 
+/* the centers of the clusters, component by component, so that the
+ * distances of a pixel to all of them are computed in a vectorizable loop.
+ */
+typedef struct
+{
+  gint   n_clusters;
+  gfloat l[MAX_CLUSTERS];
+  gfloat a[MAX_CLUSTERS];
+  gfloat b[MAX_CLUSTERS];
+} Centers;
+
+typedef struct
+{
+  gdouble sum[3];
+  glong   count;
+} Accumulator;
+
+typedef struct
+{
+  const gfloat  *pixels;
+  gsize          n_pixels;
+  const Centers *centers;
+  Accumulator   *accumulators; /* n_clusters per block */
+  GeglBuffer    *input;
+  GeglBuffer    *output;
+  const Cluster *clusters;
+} KmeansData;
+
 static void
 downsample_buffer (GeglBuffer  *input,
                    GeglBuffer **downsampled)
@@ -100,30 +137,44 @@ downsample_buffer (GeglBuffer  *input,
     }
 }
 
-static inline gfloat
-get_distance (gfloat *c1, gfloat *c2)
+static void
+set_centers (Centers       *centers,
+             const Cluster *clusters,
+             gint           n_clusters)
 {
-  return POW2(c2[0] - c1[0]) +
-         POW2(c2[1] - c1[1]) +
-         POW2(c2[2] - c1[2]);
+  gint i;
+
+  centers->n_clusters = n_clusters;
+
+  for (i = 0; i < n_clusters; i++)
+    {
+      centers->l[i] = clusters[i].center[0];
+      centers->a[i] = clusters[i].center[1];
+      centers->b[i] = clusters[i].center[2];
+    }
 }
 
 static inline gint
-find_nearest_cluster (gfloat  *pixel,
-                      Cluster *clusters,
-                      gint     n_clusters)
+find_nearest_cluster (const gfloat  *pixel,
+                      const Centers *centers)
 {
+  gfloat distance[MAX_CLUSTERS];
   gfloat min_distance = G_MAXFLOAT;
   gint   min_cluster  = 0;
   gint   i;
 
-  for (i = 0; i < n_clusters; i++)
+  for (i = 0; i < centers->n_clusters; i++)
     {
-      gfloat distance = get_distance (clusters[i].center, pixel);
+      distance[i] = POW2(pixel[0] - centers->l[i]) +
+                    POW2(pixel[1] - centers->a[i]) +
+                    POW2(pixel[2] - centers->b[i]);
+    }
 
-      if (distance < min_distance)
+  for (i = 0; i < centers->n_clusters; i++)
+    {
+      if (distance[i] < min_distance)
         {
-          min_distance = distance;
+          min_distance = distance[i];
           min_cluster  = i;
         }
     }
@@ -157,9 +208,9 @@ init_clusters (GeglBuffer     *input,
       c->center[0] = color[0];
       c->center[1] = color[1];
       c->center[2] = color[2];
-      c->sum[0] = 0.0f;
-      c->sum[1] = 0.0f;
-      c->sum[2] = 0.0f;
+      c->sum[0] = 0.0;
+      c->sum[1] = 0.0;
+      c->sum[2] = 0.0;
       c->count = 0;
     }
 
@@ -169,34 +220,77 @@ init_clusters (GeglBuffer     *input,
 }
 
 static void
-assign_pixels_to_clusters (GeglBuffer *input,
-                           Cluster    *clusters,
-                           gint        n_clusters)
+assign_blocks (gsize    offset,
+               gsize    size,
+               gpointer user_data)
 {
-  GeglBufferIterator *iter;
-
-  iter = gegl_buffer_iterator_new (input, NULL, 0, babl_format ("CIE Lab float"),
-                                   GEGL_ACCESS_READ, GEGL_ABYSS_NONE, 1);
+  KmeansData    *data    = user_data;
+  const Centers *centers = data->centers;
+  gsize          block;
 
-  while (gegl_buffer_iterator_next (iter))
+  for (block = offset; block < offset + size; block++)
     {
-      gfloat *pixel = iter->items[0].data;
-      glong   n_pixels = iter->length;
+      Accumulator  *acc      = data->accumulators + block * centers->n_clusters;
+      gsize         start    = block * BLOCK_SIZE;
+      gsize         n_pixels = MIN (BLOCK_SIZE, data->n_pixels - start);
+      const gfloat *pixel    = data->pixels + 3 * start;
+
+      memset (acc, 0, sizeof (Accumulator) * centers->n_clusters);
 
       while (n_pixels--)
         {
-          gint index = find_nearest_cluster (pixel, clusters, n_clusters);
+          gint index = find_nearest_cluster (pixel, centers);
 
-          clusters[index].sum[0] += pixel[0];
-          clusters[index].sum[1] += pixel[1];
-          clusters[index].sum[2] += pixel[2];
-          clusters[index].count++;
+          acc[index].sum[0] += pixel[0];
+          acc[index].sum[1] += pixel[1];
+          acc[index].sum[2] += pixel[2];
+          acc[index].count++;
 
           pixel += 3;
         }
     }
 }
 
+static void
+assign_pixels_to_clusters (const gfloat *pixels,
+                           gsize         n_pixels,
+                           Cluster      *clusters,
+                           gint          n_clusters,
+                           gdouble       pixels_per_thread)
+{
+  KmeansData data;
+  Centers    centers;
+  gsize      n_blocks = (n_pixels + BLOCK_SIZE - 1) / BLOCK_SIZE;
+  gsize      block;
+  gint       i;
+
+  set_centers (&centers, clusters, n_clusters);
+
+  data.pixels       = pixels;
+  data.n_pixels     = n_pixels;
+  data.centers      = &centers;
+  data.accumulators = g_new (Accumulator, n_blocks * n_clusters);
+
+  gegl_parallel_distribute_range (n_blocks,
+                                  pixels_per_thread / BLOCK_SIZE,
+                                  assign_blocks, &data);
+
+  for (block = 0; block < n_blocks; block++)
+    {
+      const Accumulator *acc = data.accumulators + block * n_clusters;
+
+      for (i = 0; i < n_clusters; i++)
+        {
+          clusters[i].sum[0] += acc[i].sum[0];
+          clusters[i].sum[1] += acc[i].sum[1];
+          clusters[i].sum[2] += acc[i].sum[2];
+          clusters[i].count  += acc[i].count;
+        }
+    }
+
+  g_free (data.accumulators);
+}
+
 static gboolean
 update_clusters (Cluster  *clusters,
                  gint      n_clusters)
@@ -223,9 +317,9 @@ update_clusters (Cluster  *clusters,
       clusters[i].center[0] = new_center[0];
       clusters[i].center[1] = new_center[1];
       clusters[i].center[2] = new_center[2];
-      clusters[i].sum[0] = 0.0f;
-      clusters[i].sum[1] = 0.0f;
-      clusters[i].sum[2] = 0.0f;
+      clusters[i].sum[0] = 0.0;
+      clusters[i].sum[1] = 0.0;
+      clusters[i].sum[2] = 0.0;
       clusters[i].count  = 0;
     }
 
@@ -233,17 +327,17 @@ update_clusters (Cluster  *clusters,
 }
 
 static void
-set_output (GeglBuffer *input,
-            GeglBuffer *output,
-            Cluster    *clusters,
-            gint        n_clusters)
+set_output_area (const GeglRectangle *area,
+                 gpointer             user_data)
 {
+  KmeansData         *data     = user_data;
+  const Cluster      *clusters = data->clusters;
   GeglBufferIterator *iter;
 
-  iter = gegl_buffer_iterator_new (output, NULL, 0, babl_format ("CIE Lab float"),
+  iter = gegl_buffer_iterator_new (data->output, area, 0, babl_format ("CIE Lab float"),
                                    GEGL_ACCESS_WRITE, GEGL_ABYSS_NONE, 2);
 
-  gegl_buffer_iterator_add (iter, input, NULL, 0, babl_format ("CIE Lab float"),
+  gegl_buffer_iterator_add (iter, data->input, area, 0, babl_format ("CIE Lab float"),
                             GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
 
   while (gegl_buffer_iterator_next (iter))
@@ -254,7 +348,7 @@ set_output (GeglBuffer *input,
 
       while (n_pixels--)
         {
-          gint index = find_nearest_cluster (in_pixel, clusters, n_clusters);
+          gint index = find_nearest_cluster (in_pixel, data->centers);
 
           out_pixel[0] = clusters[index].center[0];
           out_pixel[1] = clusters[index].center[1];
@@ -266,6 +360,28 @@ set_output (GeglBuffer *input,
     }
 }
 
+static void
+set_output (GeglBuffer *input,
+            GeglBuffer *output,
+            Cluster    *clusters,
+            gint        n_clusters,
+            gdouble     pixels_per_thread)
+{
+  KmeansData data;
+  Centers    centers;
+
+  set_centers (&centers, clusters, n_clusters);
+
+  data.centers  = &centers;
+  data.input    = input;
+  data.output   = output;
+  data.clusters = clusters;
+
+  gegl_parallel_distribute_area (gegl_buffer_get_extent (output),
+                                 pixels_per_thread, GEGL_SPLIT_STRATEGY_AUTO,
+                                 set_output_area, &data);
+}
+
 static void
 prepare (GeglOperation *operation)
 {
@@ -310,13 +426,25 @@ process (GeglOperation       *operation,
 {
   GeglProperties *o = GEGL_PROPERTIES (operation);
   gint            iterations = o->max_iterations;
+  gdouble         pixels_per_thread;
   Cluster    *clusters;
   GeglBuffer *source;
+  gfloat     *pixels;
+  gsize       n_pixels;
+
+  pixels_per_thread = gegl_operation_get_pixels_per_thread (operation);
 
   /* if pixels count of input buffer > MAX_PIXELS, compute a smaller buffer */
 
   downsample_buffer (input, &source);
 
+  n_pixels = (gsize) gegl_buffer_get_width (source) *
+                     gegl_buffer_get_height (source);
+  pixels   = gegl_malloc (3 * sizeof (gfloat) * n_pixels);
+
+  gegl_buffer_get (source, NULL, 1.0, babl_format ("CIE Lab float"), pixels,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
   /* clusters initialization */
 
   clusters = init_clusters (source, o);
@@ -325,15 +453,18 @@ process (GeglOperation       *operation,
 
   while (iterations--)
     {
-      assign_pixels_to_clusters (source, clusters, o->n_clusters);
+      assign_pixels_to_clusters (pixels, n_pixels, clusters, o->n_clusters,
+                                 pixels_per_thread);
 
       if (!update_clusters (clusters, o->n_clusters))
         break;
     }
 
+  gegl_free (pixels);
+
   /* apply cluster colors to output */
 
-  set_output (input, output, clusters, o->n_clusters);
+  set_output (input, output, clusters, o->n_clusters, pixels_per_thread);
 
   g_free (clusters);
 
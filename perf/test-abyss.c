@@ -0,0 +1,104 @@
+#include "test-common.h"
+
+#define SIZE    96
+#define FRINGE  24
+#define ROI     64
+#define BPP     16
+
+void box_blur (GeglBuffer *buffer);
+void median_blur (GeglBuffer *buffer);
+
+/* reads ROIxROI rectangles straddling each corner and edge of a SIZExSIZE
+ * buffer, such that about half of each read falls in the abyss.
+ */
+static void
+bench_get (GeglBuffer      *buffer,
+           GeglAbyssPolicy  repeat_mode,
+           const gchar     *id)
+{
+  static const gint offsets[] = { -ROI / 2, (SIZE - ROI) / 2, SIZE - ROI / 2 };
+  guchar *buf = g_malloc (ROI * ROI * BPP);
+  gint    i;
+
+  test_start ();
+  for (i=0;i<ITERATIONS && converged < BAIL_COUNT;i++)
+    {
+      gint j;
+
+      test_start_iter ();
+      for (j = 0; j < 9; j++)
+        {
+          gegl_buffer_get (buffer,
+                           GEGL_RECTANGLE (offsets[j % 3], offsets[j / 3],
+                                           ROI, ROI),
+                           1.0, NULL, buf, GEGL_AUTO_ROWSTRIDE, repeat_mode);
+        }
+      test_end_iter ();
+    }
+  test_end (id, 9.0 * ROI * ROI * ITERATIONS * BPP);
+
+  g_free (buf);
+}
+
+gint
+main (gint    argc,
+      gchar **argv)
+{
+  GeglBuffer *buffer;
+
+  gegl_init (&argc, &argv);
+
+  buffer = test_buffer (SIZE, SIZE, babl_format ("RGBA float"));
+
+  bench_get (buffer, GEGL_ABYSS_NONE,  "gegl_buffer_get abyss none");
+  bench_get (buffer, GEGL_ABYSS_BLACK, "gegl_buffer_get abyss black");
+  bench_get (buffer, GEGL_ABYSS_CLAMP, "gegl_buffer_get abyss clamp");
+  bench_get (buffer, GEGL_ABYSS_LOOP,  "gegl_buffer_get abyss loop");
+
+  /* area filters on a small input, whose fringe is about as large as the
+   * input itself
+   */
+  bench ("box-blur (small)", buffer, &box_blur);
+  bench ("median-blur (small)", buffer, &median_blur);
+
+  g_object_unref (buffer);
+
+  gegl_exit ();
+  return 0;
+}
+
+void box_blur (GeglBuffer *buffer)
+{
+  GeglBuffer *buffer2;
+  GeglNode   *gegl, *source, *node, *sink;
+
+  gegl = gegl_node_new ();
+  source = gegl_node_new_child (gegl, "operation", "gegl:buffer-source", "buffer", buffer, NULL);
+  node = gegl_node_new_child (gegl, "operation", "gegl:box-blur",
+                                    "radius", FRINGE,
+                                    NULL);
+  sink = gegl_node_new_child (gegl, "operation", "gegl:buffer-sink", "buffer", &buffer2, NULL);
+
+  gegl_node_link_many (source, node, sink, NULL);
+  gegl_node_process (sink);
+  g_object_unref (gegl);
+  g_object_unref (buffer2);
+}
+
+void median_blur (GeglBuffer *buffer)
+{
+  GeglBuffer *buffer2;
+  GeglNode   *gegl, *source, *node, *sink;
+
+  gegl = gegl_node_new ();
+  source = gegl_node_new_child (gegl, "operation", "gegl:buffer-source", "buffer", buffer, NULL);
+  node = gegl_node_new_child (gegl, "operation", "gegl:median-blur",
+                                    "radius", FRINGE / 4,
+                                    NULL);
+  sink = gegl_node_new_child (gegl, "operation", "gegl:buffer-sink", "buffer", &buffer2, NULL);
+
+  gegl_node_link_many (source, node, sink, NULL);
+  gegl_node_process (sink);
+  g_object_unref (gegl);
+  g_object_unref (buffer2);
+}
@@ -0,0 +1,60 @@
+#include "test-common.h"
+
+void bilateral_filter(GeglBuffer *buffer);
+
+/* the values of the "method" enum */
+#define METHOD_EXACT   1
+#define METHOD_LATTICE 2
+
+static gdouble radius;
+static gint    method;
+
+gint
+main (gint    argc,
+      gchar **argv)
+{
+  GeglBuffer *buffer;
+
+  gegl_init(&argc, &argv);
+
+  buffer = test_buffer(512, 512, babl_format("RGBA float"));
+
+  method = METHOD_EXACT;
+  radius = 4.0;
+  bench("bilateral-filter (exact, radius 4)", buffer, &bilateral_filter);
+
+  method = METHOD_LATTICE;
+  radius = 4.0;
+  bench("bilateral-filter (lattice, radius 4)", buffer, &bilateral_filter);
+
+  radius = 16.0;
+  bench("bilateral-filter (lattice, radius 16)", buffer, &bilateral_filter);
+
+  radius = 64.0;
+  bench("bilateral-filter (lattice, radius 64)", buffer, &bilateral_filter);
+
+  g_object_unref (buffer);
+
+  gegl_exit ();
+  return 0;
+}
+
+void bilateral_filter(GeglBuffer *buffer)
+{
+  GeglBuffer *buffer2;
+  GeglNode   *gegl, *source, *node, *sink;
+
+  gegl = gegl_node_new ();
+  source = gegl_node_new_child (gegl, "operation", "gegl:buffer-source", "buffer", buffer, NULL);
+  node = gegl_node_new_child (gegl, "operation", "gegl:bilateral-filter",
+                                       "blur-radius", radius,
+                                       "edge-preservation", 8.0,
+                                       "method", method,
+                                       NULL);
+  sink = gegl_node_new_child (gegl, "operation", "gegl:buffer-sink", "buffer", &buffer2, NULL);
+
+  gegl_node_link_many (source, node, sink, NULL);
+  gegl_node_process (sink);
+  g_object_unref (gegl);
+  g_object_unref (buffer2);
+}
@@ -0,0 +1,38 @@
+#include "test-common.h"
+
+void domain_transform (GeglBuffer *buffer);
+
+gint
+main (gint    argc,
+      gchar **argv)
+{
+  GeglBuffer *buffer;
+
+  gegl_init(&argc, &argv);
+
+  /* a 4K frame */
+  buffer = test_buffer(3840, 2160, babl_format("R'G'B'A float"));
+
+  bench("domain-transform (4K)", buffer, &domain_transform);
+
+  g_object_unref (buffer);
+
+  gegl_exit ();
+  return 0;
+}
+
+void domain_transform (GeglBuffer *buffer)
+{
+  GeglBuffer *buffer2;
+  GeglNode   *gegl, *source, *node, *sink;
+
+  gegl = gegl_node_new ();
+  source = gegl_node_new_child (gegl, "operation", "gegl:buffer-source", "buffer", buffer, NULL);
+  node = gegl_node_new_child (gegl, "operation", "gegl:domain-transform", NULL);
+  sink = gegl_node_new_child (gegl, "operation", "gegl:buffer-sink", "buffer", &buffer2, NULL);
+
+  gegl_node_link_many (source, node, sink, NULL);
+  gegl_node_process (sink);
+  g_object_unref (gegl);
+  g_object_unref (buffer2);
+}
@@ -0,0 +1,131 @@
+#include "test-common.h"
+
+#define SIZE       10000
+#define SEED_STEP  97
+
+void connected_components (GeglBuffer *buffer);
+void watershed_transform (GeglBuffer *buffer);
+
+static GeglBuffer *labels;
+
+/* a 100 megapixel mask of random blocks, each of which is either black,
+ * separating the components, or white.
+ */
+static GeglBuffer *
+mask_buffer (void)
+{
+  GeglBuffer         *buffer;
+  GeglBufferIterator *iter;
+
+  buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0, SIZE, SIZE),
+                            babl_format ("Y u8"));
+
+  iter = gegl_buffer_iterator_new (buffer, NULL, 0, NULL,
+                                   GEGL_ACCESS_WRITE, GEGL_ABYSS_NONE, 1);
+
+  while (gegl_buffer_iterator_next (iter))
+    {
+      const GeglRectangle *roi = &iter->items[0].roi;
+      guint8              *out = iter->items[0].data;
+      gint                 x, y;
+
+      for (y = roi->y; y < roi->y + roi->height; y++)
+        for (x = roi->x; x < roi->x + roi->width; x++)
+          {
+            guint hash = ((x / 37) ^ ((y / 53) << 12)) * 2654435761u;
+
+            *out++ = (hash >> 28) & 1 ? 255 : 0;
+          }
+    }
+
+  return buffer;
+}
+
+/* labels for gegl:watershed-transform, seeded on a sparse grid, with the
+ * unlabelled pixels flagged by a zero alpha.
+ */
+static GeglBuffer *
+labels_buffer (void)
+{
+  GeglBuffer         *buffer;
+  GeglBufferIterator *iter;
+
+  buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0, SIZE, SIZE),
+                            babl_format ("YA u8"));
+
+  iter = gegl_buffer_iterator_new (buffer, NULL, 0, NULL,
+                                   GEGL_ACCESS_WRITE, GEGL_ABYSS_NONE, 1);
+
+  while (gegl_buffer_iterator_next (iter))
+    {
+      const GeglRectangle *roi = &iter->items[0].roi;
+      guint8              *out = iter->items[0].data;
+      gint                 x, y;
+
+      for (y = roi->y; y < roi->y + roi->height; y++)
+        for (x = roi->x; x < roi->x + roi->width; x++)
+          {
+            gboolean seed = x % SEED_STEP == 0 && y % SEED_STEP == 0;
+
+            *out++ = seed ? (x / SEED_STEP + y / SEED_STEP) % 255 + 1 : 0;
+            *out++ = seed ? 255 : 0;
+          }
+    }
+
+  return buffer;
+}
+
+gint
+main (gint    argc,
+      gchar **argv)
+{
+  GeglBuffer *buffer;
+
+  gegl_init(&argc, &argv);
+
+  buffer = mask_buffer ();
+  labels = labels_buffer ();
+
+  bench("connected-components (100 MP)", buffer, &connected_components);
+  bench("watershed-transform (100 MP)", buffer, &watershed_transform);
+
+  g_object_unref (labels);
+  g_object_unref (buffer);
+
+  gegl_exit ();
+  return 0;
+}
+
+void connected_components (GeglBuffer *buffer)
+{
+  GeglBuffer *buffer2;
+  GeglNode   *gegl, *source, *node, *sink;
+
+  gegl = gegl_node_new ();
+  source = gegl_node_new_child (gegl, "operation", "gegl:buffer-source", "buffer", buffer, NULL);
+  node = gegl_node_new_child (gegl, "operation", "gegl:connected-components", NULL);
+  sink = gegl_node_new_child (gegl, "operation", "gegl:buffer-sink", "buffer", &buffer2, NULL);
+
+  gegl_node_link_many (source, node, sink, NULL);
+  gegl_node_process (sink);
+  g_object_unref (gegl);
+  g_object_unref (buffer2);
+}
+
+void watershed_transform (GeglBuffer *buffer)
+{
+  GeglBuffer *buffer2;
+  GeglNode   *gegl, *source, *gradient, *node, *sink;
+
+  gegl = gegl_node_new ();
+  source = gegl_node_new_child (gegl, "operation", "gegl:buffer-source", "buffer", labels, NULL);
+  gradient = gegl_node_new_child (gegl, "operation", "gegl:buffer-source", "buffer", buffer, NULL);
+  node = gegl_node_new_child (gegl, "operation", "gegl:watershed-transform", NULL);
+  sink = gegl_node_new_child (gegl, "operation", "gegl:buffer-sink", "buffer", &buffer2, NULL);
+
+  gegl_node_link_many (source, node, sink, NULL);
+  gegl_node_connect_to (gradient, "output", node, "aux");
+  gegl_node_process (sink);
+  g_object_unref (gegl);
+  g_object_unref (buffer2);
+}
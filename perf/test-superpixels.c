@@ -0,0 +1,83 @@
+#include "test-common.h"
+
+void slic (GeglBuffer *buffer);
+void waterpixels (GeglBuffer *buffer);
+void segment_kmeans (GeglBuffer *buffer);
+
+static gboolean multi_resolution;
+
+gint
+main (gint    argc,
+      gchar **argv)
+{
+  GeglBuffer *buffer;
+
+  gegl_init(&argc, &argv);
+
+  buffer = test_buffer(2048, 2048, babl_format("RGBA float"));
+
+  multi_resolution = FALSE;
+  bench("slic", buffer, &slic);
+
+  multi_resolution = TRUE;
+  bench("slic (multi-resolution)", buffer, &slic);
+
+  bench("waterpixels", buffer, &waterpixels);
+  bench("segment-kmeans", buffer, &segment_kmeans);
+
+  g_object_unref (buffer);
+
+  gegl_exit ();
+  return 0;
+}
+
+void slic (GeglBuffer *buffer)
+{
+  GeglBuffer *buffer2;
+  GeglNode   *gegl, *source, *node, *sink;
+
+  gegl = gegl_node_new ();
+  source = gegl_node_new_child (gegl, "operation", "gegl:buffer-source", "buffer", buffer, NULL);
+  node = gegl_node_new_child (gegl, "operation", "gegl:slic",
+                                       "iterations", 5,
+                                       "multi-resolution", multi_resolution,
+                                       NULL);
+  sink = gegl_node_new_child (gegl, "operation", "gegl:buffer-sink", "buffer", &buffer2, NULL);
+
+  gegl_node_link_many (source, node, sink, NULL);
+  gegl_node_process (sink);
+  g_object_unref (gegl);
+  g_object_unref (buffer2);
+}
+
+void waterpixels (GeglBuffer *buffer)
+{
+  GeglBuffer *buffer2;
+  GeglNode   *gegl, *source, *node, *sink;
+
+  gegl = gegl_node_new ();
+  source = gegl_node_new_child (gegl, "operation", "gegl:buffer-source", "buffer", buffer, NULL);
+  node = gegl_node_new_child (gegl, "operation", "gegl:waterpixels", NULL);
+  sink = gegl_node_new_child (gegl, "operation", "gegl:buffer-sink", "buffer", &buffer2, NULL);
+
+  gegl_node_link_many (source, node, sink, NULL);
+  gegl_node_process (sink);
+  g_object_unref (gegl);
+  g_object_unref (buffer2);
+}
+
+void segment_kmeans (GeglBuffer *buffer)
+{
+  GeglBuffer *buffer2;
+  GeglNode   *gegl, *source, *node, *sink;
+
+  gegl = gegl_node_new ();
+  source = gegl_node_new_child (gegl, "operation", "gegl:buffer-source", "buffer", buffer, NULL);
+  node = gegl_node_new_child (gegl, "operation", "gegl:segment-kmeans", NULL);
+  sink = gegl_node_new_child (gegl, "operation", "gegl:buffer-sink", "buffer", &buffer2, NULL);
+
+  gegl_node_link_many (source, node, sink, NULL);
+  gegl_node_process (sink);
+  g_object_unref (gegl);
+  g_object_unref (buffer2);
+}
@@ -0,0 +1,104 @@
+#include "test-common.h"
+
+#define SIZE 1024
+
+void point_op (GeglBuffer *buffer);
+void area_op (GeglBuffer *buffer);
+
+/* runs a point and an area operation on buffers of @format, with all
+ * buffers using a tile size of @tile_size, or, if it's 0, with the tile
+ * size of the output buffers chosen according to their format and to the
+ * operation.
+ */
+static void
+sweep (const gchar *format_name,
+       gint         tile_size)
+{
+  GeglBuffer *buffer;
+  gchar      *size_name;
+  gchar      *id;
+
+  if (tile_size)
+    {
+      g_object_set (gegl_config (),
+                    "tile-width",     tile_size,
+                    "tile-height",    tile_size,
+                    "tile-size-auto", FALSE,
+                    NULL);
+
+      size_name = g_strdup_printf ("%dx%d", tile_size, tile_size);
+    }
+  else
+    {
+      g_object_set (gegl_config (),
+                    "tile-width",     128,
+                    "tile-height",    128,
+                    "tile-size-auto", TRUE,
+                    NULL);
+
+      size_name = g_strdup ("auto");
+    }
+
+  buffer = test_buffer (SIZE, SIZE, babl_format (format_name));
+
+  id = g_strdup_printf ("point op, %s, %s tiles", format_name, size_name);
+  bench (id, buffer, &point_op);
+  g_free (id);
+
+  id = g_strdup_printf ("area op, %s, %s tiles", format_name, size_name);
+  bench (id, buffer, &area_op);
+  g_free (id);
+
+  g_object_unref (buffer);
+  g_free (size_name);
+}
+
+gint
+main (gint    argc,
+      gchar **argv)
+{
+  static const gchar *formats[]    = { "R'G'B'A u8", "RGBA float" };
+  static const gint   tile_sizes[] = { 32, 64, 128, 256, 512, 0 };
+  gint                i, j;
+
+  gegl_init (&argc, &argv);
+
+  for (i = 0; i < G_N_ELEMENTS (formats); i++)
+    for (j = 0; j < G_N_ELEMENTS (tile_sizes); j++)
+      sweep (formats[i], tile_sizes[j]);
+
+  gegl_exit ();
+  return 0;
+}
+
+void point_op (GeglBuffer *buffer)
+{
+  GeglBuffer *buffer2;
+  GeglNode   *gegl, *source, *node, *sink;
+
+  gegl = gegl_node_new ();
+  source = gegl_node_new_child (gegl, "operation", "gegl:buffer-source", "buffer", buffer, NULL);
+  node = gegl_node_new_child (gegl, "operation", "gegl:brightness-contrast", "contrast", 0.2, NULL);
+  sink = gegl_node_new_child (gegl, "operation", "gegl:buffer-sink", "buffer", &buffer2, NULL);
+
+  gegl_node_link_many (source, node, sink, NULL);
+  gegl_node_process (sink);
+  g_object_unref (gegl);
+  g_object_unref (buffer2);
+}
+
+void area_op (GeglBuffer *buffer)
+{
+  GeglBuffer *buffer2;
+  GeglNode   *gegl, *source, *node, *sink;
+
+  gegl = gegl_node_new ();
+  source = gegl_node_new_child (gegl, "operation", "gegl:buffer-source", "buffer", buffer, NULL);
+  node = gegl_node_new_child (gegl, "operation", "gegl:box-blur", "radius", 8, NULL);
+  sink = gegl_node_new_child (gegl, "operation", "gegl:buffer-sink", "buffer", &buffer2, NULL);
+
+  gegl_node_link_many (source, node, sink, NULL);
+  gegl_node_process (sink);
+  g_object_unref (gegl);
+  g_object_unref (buffer2);
+}
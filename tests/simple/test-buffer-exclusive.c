@@ -0,0 +1,268 @@
+/* This file is a test-case for GEGL
+ *
+ * GEGL is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * GEGL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* make sure that exclusive buffers, which skip locking and index their
+ * tiles directly, hold the same pixels as regular buffers, after the same
+ * writes, including outside of their original extent, and that their tiles
+ * are trimmed from the tile cache like those of regular buffers.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "gegl.h"
+
+
+#define SUCCESS    0
+#define FAILURE    -1
+
+#define EXTENT     GEGL_RECTANGLE (-37, -91, 500, 300)
+#define LARGE      GEGL_RECTANGLE (0, 0, 1024, 1024)
+
+
+/* writes a pattern to @rect of @buffer, through an iterator */
+static void
+fill_buffer (GeglBuffer          *buffer,
+             const GeglRectangle *rect)
+{
+  GeglBufferIterator *iter;
+
+  iter = gegl_buffer_iterator_new (buffer, rect, 0, babl_format ("RGBA u8"),
+                                   GEGL_ACCESS_WRITE, GEGL_ABYSS_NONE, 1);
+
+  while (gegl_buffer_iterator_next (iter))
+    {
+      const GeglRectangle *roi = &iter->items[0].roi;
+      guint8              *out = iter->items[0].data;
+      gint                 x, y;
+
+      for (y = roi->y; y < roi->y + roi->height; y++)
+        for (x = roi->x; x < roi->x + roi->width; x++)
+          {
+            *out++ = x;
+            *out++ = y;
+            *out++ = x ^ y;
+            *out++ = 255;
+          }
+    }
+}
+
+/* compares @rect of @buffer with @expected at @level, iterating over both */
+static gint
+test_iteration (GeglBuffer          *buffer,
+                GeglBuffer          *expected,
+                const GeglRectangle *rect,
+                gint                 level)
+{
+  GeglBufferIterator *iter;
+  gint                result = SUCCESS;
+
+  iter = gegl_buffer_iterator_new (buffer, rect, level,
+                                   babl_format ("RGBA u8"),
+                                   GEGL_ACCESS_READ, GEGL_ABYSS_NONE, 2);
+  gegl_buffer_iterator_add (iter, expected, rect, level,
+                            babl_format ("RGBA u8"),
+                            GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
+
+  while (gegl_buffer_iterator_next (iter))
+    {
+      if (memcmp (iter->items[0].data, iter->items[1].data,
+                  4 * iter->length))
+        {
+          const GeglRectangle *roi = &iter->items[0].roi;
+
+          printf ("level %d: %dx%d at (%d, %d) differs\n",
+                  level, roi->width, roi->height, roi->x, roi->y);
+
+          result = FAILURE;
+        }
+    }
+
+  return result;
+}
+
+/* test that copying tiles from, and to, an exclusive buffer gives the same
+ * pixels as the regular buffer.
+ */
+static gint
+test_copy (GeglBuffer *buffer,
+           GeglBuffer *expected)
+{
+  GeglBufferIterator *iter;
+  GeglBuffer         *copy;
+  gint                result = SUCCESS;
+
+  copy = gegl_buffer_new_exclusive (EXTENT, babl_format ("RGBA u8"));
+
+  gegl_buffer_copy (buffer, NULL, GEGL_ABYSS_NONE, copy, NULL);
+  gegl_buffer_copy (expected, NULL, GEGL_ABYSS_NONE, buffer, NULL);
+
+  iter = gegl_buffer_iterator_new (copy, EXTENT, 0, babl_format ("RGBA u8"),
+                                   GEGL_ACCESS_READ, GEGL_ABYSS_NONE, 3);
+  gegl_buffer_iterator_add (iter, buffer, EXTENT, 0, babl_format ("RGBA u8"),
+                            GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
+  gegl_buffer_iterator_add (iter, expected, EXTENT, 0,
+                            babl_format ("RGBA u8"),
+                            GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
+
+  while (gegl_buffer_iterator_next (iter))
+    {
+      gsize size = 4 * iter->length;
+
+      if (memcmp (iter->items[0].data, iter->items[2].data, size) ||
+          memcmp (iter->items[1].data, iter->items[2].data, size))
+        {
+          const GeglRectangle *roi = &iter->items[0].roi;
+
+          printf ("copy: %dx%d at (%d, %d) differs\n",
+                  roi->width, roi->height, roi->x, roi->y);
+
+          result = FAILURE;
+        }
+    }
+
+  g_object_unref (copy);
+
+  return result;
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  const Babl *format = babl_format ("RGBA u8");
+  GeglBuffer *buffer;
+  GeglBuffer *expected;
+  GeglBuffer *sub;
+  GeglColor  *color;
+  guchar     *data;
+  guint64     cache_size = 1 << 20;
+  guint64     cache_total;
+  gboolean    exclusive;
+  gint        result = SUCCESS;
+
+  gegl_init (&argc, &argv);
+
+  buffer   = gegl_buffer_new_exclusive (EXTENT, format);
+  expected = gegl_buffer_new (EXTENT, format);
+
+  g_object_get (buffer, "exclusive", &exclusive, NULL);
+
+  if (! exclusive)
+    {
+      printf ("buffer isn't exclusive\n");
+
+      result = FAILURE;
+    }
+
+  /* iteration, and mipmaps */
+  fill_buffer (buffer,   EXTENT);
+  fill_buffer (expected, EXTENT);
+
+  if (test_iteration (buffer, expected, EXTENT, 0) != SUCCESS              ||
+      test_iteration (buffer, expected,
+                      GEGL_RECTANGLE (-5, -20, 100, 60), 1) != SUCCESS)
+    {
+      result = FAILURE;
+    }
+
+  /* get and set, across tile boundaries */
+  data = g_malloc (4 * 150 * 100);
+
+  gegl_buffer_get (expected, GEGL_RECTANGLE (100, 50, 150, 100), 1.0, format,
+                   data, GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  gegl_buffer_set (buffer,   GEGL_RECTANGLE (-20, -70, 150, 100), 0, format,
+                   data, GEGL_AUTO_ROWSTRIDE);
+  gegl_buffer_set (expected, GEGL_RECTANGLE (-20, -70, 150, 100), 0, format,
+                   data, GEGL_AUTO_ROWSTRIDE);
+
+  g_free (data);
+
+  color = gegl_color_new ("rgba(0.2, 0.4, 0.6, 0.8)");
+
+  gegl_buffer_set_color (buffer,   GEGL_RECTANGLE (200, 0, 250, 150), color);
+  gegl_buffer_set_color (expected, GEGL_RECTANGLE (200, 0, 250, 150), color);
+
+  if (test_iteration (buffer, expected, EXTENT, 0) != SUCCESS)
+    result = FAILURE;
+
+  /* tiles outside of the original extent */
+  gegl_buffer_set_extent (buffer,   GEGL_RECTANGLE (-300, -300, 1000, 1000));
+  gegl_buffer_set_extent (expected, GEGL_RECTANGLE (-300, -300, 1000, 1000));
+
+  fill_buffer (buffer,   GEGL_RECTANGLE (-300, -300, 400, 1000));
+  fill_buffer (expected, GEGL_RECTANGLE (-300, -300, 400, 1000));
+
+  if (test_iteration (buffer, expected,
+                      GEGL_RECTANGLE (-300, -300, 1000, 1000), 0) != SUCCESS)
+    {
+      result = FAILURE;
+    }
+
+  /* sub-buffers share the storage of their buffer */
+  sub = gegl_buffer_create_sub_buffer (buffer, GEGL_RECTANGLE (10, 20, 300, 200));
+
+  gegl_buffer_set_color (sub,      GEGL_RECTANGLE (10, 20, 100, 100), color);
+  gegl_buffer_set_color (expected, GEGL_RECTANGLE (10, 20, 100, 100), color);
+
+  if (test_iteration (buffer, expected, EXTENT, 0) != SUCCESS)
+    result = FAILURE;
+
+  g_object_unref (sub);
+
+  if (test_copy (buffer, expected) != SUCCESS)
+    result = FAILURE;
+
+  g_object_unref (color);
+  g_object_unref (expected);
+  g_object_unref (buffer);
+
+  /* buffers larger than the tile cache */
+  g_object_set (gegl_config (),
+                "tile-cache-size", cache_size,
+                NULL);
+
+  buffer = gegl_buffer_new_exclusive (LARGE, format);
+
+  fill_buffer (buffer, LARGE);
+
+  g_object_get (gegl_stats (), "tile-cache-total", &cache_total, NULL);
+
+  if (cache_total > cache_size)
+    {
+      printf ("the tile cache holds %" G_GUINT64_FORMAT " bytes, "
+              "more than its size\n", cache_total);
+
+      result = FAILURE;
+    }
+
+  expected = gegl_buffer_new (LARGE, format);
+
+  fill_buffer (expected, LARGE);
+
+  if (test_iteration (buffer, expected, LARGE, 0) != SUCCESS)
+    result = FAILURE;
+
+  g_object_unref (expected);
+  g_object_unref (buffer);
+
+  gegl_exit ();
+
+  return result;
+}
@@ -0,0 +1,206 @@
+/* This file is a test-case for GEGL
+ *
+ * GEGL is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * GEGL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* make sure that large gegl_buffer_get() and gegl_buffer_set() calls,
+ * which are distributed across threads, give the same result as reading
+ * and writing a row at a time.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "gegl.h"
+
+
+#define SUCCESS    0
+#define FAILURE    -1
+
+#define EXTENT     GEGL_RECTANGLE (-37, -91, 1000, 700)
+
+
+/* gets @rect of @buffer in @format a row at a time */
+static guchar *
+get_rows (GeglBuffer          *buffer,
+          const GeglRectangle *rect,
+          const Babl          *format,
+          GeglAbyssPolicy      repeat_mode)
+{
+  gint    bpp    = babl_format_get_bytes_per_pixel (format);
+  gint    stride = bpp * rect->width;
+  guchar *data   = g_malloc ((gsize) stride * rect->height);
+  gint    y;
+
+  for (y = 0; y < rect->height; y++)
+    {
+      gegl_buffer_get (buffer,
+                       GEGL_RECTANGLE (rect->x, rect->y + y, rect->width, 1),
+                       1.0, format, data + (gsize) y * stride,
+                       GEGL_AUTO_ROWSTRIDE, repeat_mode);
+    }
+
+  return data;
+}
+
+/* sets @rect of @buffer from @data, in @format, a row at a time */
+static void
+set_rows (GeglBuffer          *buffer,
+          const GeglRectangle *rect,
+          const Babl          *format,
+          const guchar        *data)
+{
+  gint stride = babl_format_get_bytes_per_pixel (format) * rect->width;
+  gint y;
+
+  for (y = 0; y < rect->height; y++)
+    {
+      gegl_buffer_set (buffer,
+                       GEGL_RECTANGLE (rect->x, rect->y + y, rect->width, 1),
+                       0, format, data + (gsize) y * stride,
+                       GEGL_AUTO_ROWSTRIDE);
+    }
+}
+
+static gboolean
+test_get (GeglBuffer          *buffer,
+          const GeglRectangle *rect,
+          const Babl          *format,
+          GeglAbyssPolicy      repeat_mode)
+{
+  gsize    size = (gsize) babl_format_get_bytes_per_pixel (format) *
+                  rect->width * rect->height;
+  guchar  *expected;
+  guchar  *data;
+  gboolean success;
+
+  expected = get_rows (buffer, rect, format, repeat_mode);
+  data     = g_malloc (size);
+
+  gegl_buffer_get (buffer, rect, 1.0, format, data,
+                   GEGL_AUTO_ROWSTRIDE, repeat_mode);
+
+  success = ! memcmp (data, expected, size);
+
+  if (! success)
+    {
+      printf ("get of %dx%d at (%d, %d) in \"%s\" differs\n",
+              rect->width, rect->height, rect->x, rect->y,
+              babl_get_name (format));
+    }
+
+  g_free (data);
+  g_free (expected);
+
+  return success;
+}
+
+static gboolean
+test_set (GeglBuffer          *buffer,
+          const GeglRectangle *rect,
+          const Babl          *format)
+{
+  const Babl *buffer_format = gegl_buffer_get_format (buffer);
+  GeglBuffer *expected;
+  GeglBuffer *result;
+  guchar     *data;
+  guchar     *expected_data;
+  guchar     *result_data;
+  gsize       size;
+  gboolean    success;
+
+  data = get_rows (buffer, rect, format, GEGL_ABYSS_NONE);
+
+  expected = gegl_buffer_new (EXTENT, buffer_format);
+  result   = gegl_buffer_new (EXTENT, buffer_format);
+
+  set_rows (expected, rect, format, data);
+  gegl_buffer_set (result, rect, 0, format, data, GEGL_AUTO_ROWSTRIDE);
+
+  expected_data = get_rows (expected, EXTENT, buffer_format, GEGL_ABYSS_NONE);
+  result_data   = get_rows (result,   EXTENT, buffer_format, GEGL_ABYSS_NONE);
+
+  size = (gsize) babl_format_get_bytes_per_pixel (buffer_format) *
+         EXTENT->width * EXTENT->height;
+
+  success = ! memcmp (result_data, expected_data, size);
+
+  if (! success)
+    {
+      printf ("set of %dx%d at (%d, %d) from \"%s\" differs\n",
+              rect->width, rect->height, rect->x, rect->y,
+              babl_get_name (format));
+    }
+
+  g_free (result_data);
+  g_free (expected_data);
+  g_object_unref (result);
+  g_object_unref (expected);
+  g_free (data);
+
+  return success;
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  const Babl *format = babl_format ("RGBA float");
+  GeglBuffer *buffer;
+  GRand      *rand;
+  gfloat     *data;
+  gint        n     = 4 * EXTENT->width * EXTENT->height;
+  gint        result = SUCCESS;
+  gint        i;
+
+  gegl_init (&argc, &argv);
+
+  g_object_set (gegl_config (),
+                "threads", 4,
+                NULL);
+
+  rand = g_rand_new_with_seed (0);
+  data = g_new (gfloat, n);
+
+  for (i = 0; i < n; i++)
+    data[i] = g_rand_double_range (rand, -0.25, 1.25);
+
+  buffer = gegl_buffer_new (EXTENT, format);
+
+  set_rows (buffer, EXTENT, format, (const guchar *) data);
+
+  if (! test_get (buffer, EXTENT, format, GEGL_ABYSS_NONE)                ||
+      ! test_get (buffer, EXTENT, babl_format ("R'G'B' u8"),
+                  GEGL_ABYSS_NONE)                                        ||
+      ! test_get (buffer, GEGL_RECTANGLE (-100, -150, 1111, 777),
+                  babl_format ("Y' u16"), GEGL_ABYSS_CLAMP)               ||
+      ! test_get (buffer, GEGL_RECTANGLE (5, 3, 901, 555),
+                  babl_format ("RaGaBaA float"), GEGL_ABYSS_BLACK)        ||
+      ! test_set (buffer, GEGL_RECTANGLE (5, 3, 901, 555), format)        ||
+      ! test_set (buffer, GEGL_RECTANGLE (-37, -60, 777, 600),
+                  babl_format ("R'G'B'A u8")))
+    {
+      result = FAILURE;
+    }
+
+  g_object_unref (buffer);
+  g_free (data);
+  g_rand_free (rand);
+
+  gegl_exit ();
+
+  return result;
+}
@@ -0,0 +1,201 @@
+/* This file is a test-case for GEGL
+ *
+ * GEGL is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * GEGL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* make sure that iterating over swap and file backed buffers, whose tiles
+ * have been evicted from the tile cache, and which the iterator prefetches
+ * ahead of the chunk being processed, reads back what was written.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+
+#include <glib/gstdio.h>
+
+#include "gegl.h"
+#include "gegl-buffer-backend.h"
+#include "gegl-tile-backend-file.h"
+#include "gegl-tile-backend-swap.h"
+
+
+#define SUCCESS    0
+#define FAILURE    -1
+
+#define EXTENT     GEGL_RECTANGLE (-30, -20, 640, 480)
+
+
+/* writes a pattern to @buffer, through an iterator */
+static void
+fill_buffer (GeglBuffer *buffer)
+{
+  GeglBufferIterator *iter;
+
+  iter = gegl_buffer_iterator_new (buffer, EXTENT, 0, babl_format ("RGBA u8"),
+                                   GEGL_ACCESS_WRITE, GEGL_ABYSS_NONE, 1);
+
+  while (gegl_buffer_iterator_next (iter))
+    {
+      const GeglRectangle *roi = &iter->items[0].roi;
+      guint8              *out = iter->items[0].data;
+      gint                 x, y;
+
+      for (y = roi->y; y < roi->y + roi->height; y++)
+        for (x = roi->x; x < roi->x + roi->width; x++)
+          {
+            *out++ = x;
+            *out++ = y;
+            *out++ = x ^ y;
+            *out++ = 255;
+          }
+    }
+}
+
+/* reads @rect of @buffer back, through an iterator, and checks it against
+ * the pattern.
+ */
+static gint
+test_read (GeglBuffer          *buffer,
+           const GeglRectangle *rect,
+           const gchar         *what)
+{
+  GeglBufferIterator *iter;
+  gint                result = SUCCESS;
+
+  iter = gegl_buffer_iterator_new (buffer, rect, 0, babl_format ("RGBA u8"),
+                                   GEGL_ACCESS_READ, GEGL_ABYSS_NONE, 1);
+
+  while (gegl_buffer_iterator_next (iter))
+    {
+      const GeglRectangle *roi = &iter->items[0].roi;
+      const guint8        *in  = iter->items[0].data;
+      gint                 x, y;
+
+      for (y = roi->y; y < roi->y + roi->height; y++)
+        for (x = roi->x; x < roi->x + roi->width; x++, in += 4)
+          {
+            if (result == SUCCESS &&
+                (in[0] != (guint8) x       ||
+                 in[1] != (guint8) y       ||
+                 in[2] != (guint8) (x ^ y) ||
+                 in[3] != 255))
+              {
+                printf ("%s: pixel (%d, %d) differs\n", what, x, y);
+
+                result = FAILURE;
+              }
+          }
+    }
+
+  return result;
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  GeglTileBackend *backend;
+  GeglBuffer      *buffer;
+  gchar           *dir;
+  gchar           *path;
+  gint             result = SUCCESS;
+
+  gegl_init (&argc, &argv);
+
+  dir  = g_dir_make_tmp ("test-buffer-prefetch-XXXXXX", NULL);
+  path = g_build_filename (dir, "buffer.gegl", NULL);
+
+  /* the tests run with a RAM swap; use a swap directory, and a tile cache
+   * much smaller than the buffers, so that their tiles get evicted.
+   */
+  g_object_set (gegl_config (),
+                "swap",            dir,
+                "tile-cache-size", (guint64) 256 * 1024,
+                "tile-width",      64,
+                "tile-height",     64,
+                NULL);
+
+  /* a swap backed buffer */
+  buffer = gegl_buffer_new (EXTENT, babl_format ("RGBA u8"));
+
+  g_object_get (buffer, "backend", &backend, NULL);
+
+  if (! GEGL_IS_TILE_BACKEND_SWAP (backend))
+    {
+      printf ("buffer isn't swap backed\n");
+
+      result = FAILURE;
+    }
+
+  g_object_unref (backend);
+
+  fill_buffer (buffer);
+
+  if (test_read (buffer, EXTENT, "swap") != SUCCESS                        ||
+      test_read (buffer, GEGL_RECTANGLE (13, 7, 300, 200),
+                 "swap, unaligned") != SUCCESS)
+    {
+      result = FAILURE;
+    }
+
+  g_object_unref (buffer);
+
+  /* a file backed buffer, opened again, whose tiles are all on disk */
+  buffer = g_object_new (GEGL_TYPE_BUFFER,
+                         "x",      EXTENT->x,
+                         "y",      EXTENT->y,
+                         "width",  EXTENT->width,
+                         "height", EXTENT->height,
+                         "format", babl_format ("RGBA u8"),
+                         "path",   path,
+                         NULL);
+
+  fill_buffer (buffer);
+
+  gegl_buffer_flush (buffer);
+  g_object_unref (buffer);
+
+  buffer = gegl_buffer_open (path);
+
+  g_object_get (buffer, "backend", &backend, NULL);
+
+  if (! GEGL_IS_TILE_BACKEND_FILE (backend))
+    {
+      printf ("buffer isn't file backed\n");
+
+      result = FAILURE;
+    }
+
+  g_object_unref (backend);
+
+  if (test_read (buffer, EXTENT, "file") != SUCCESS                        ||
+      test_read (buffer, GEGL_RECTANGLE (13, 7, 300, 200),
+                 "file, unaligned") != SUCCESS)
+    {
+      result = FAILURE;
+    }
+
+  g_object_unref (buffer);
+
+  gegl_exit ();
+
+  g_unlink (path);
+  g_rmdir (dir);
+
+  g_free (path);
+  g_free (dir);
+
+  return result;
+}
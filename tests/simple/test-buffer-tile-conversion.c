@@ -0,0 +1,137 @@
+/* This file is a test-case for GEGL
+ *
+ * GEGL is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * GEGL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* make sure that read-only iteration in a format other than the buffer's,
+ * which uses the cached conversions of the tiles it mostly covers, sees the
+ * changes made to the buffer between iterations.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "gegl.h"
+
+
+#define SUCCESS    0
+#define FAILURE    -1
+
+#define EXTENT     GEGL_RECTANGLE (-10, -20, 300, 200)
+
+
+/* compares iterating over @rect of @buffer in @format with
+ * gegl_buffer_get().
+ */
+static gboolean
+check_iteration (GeglBuffer          *buffer,
+                 const GeglRectangle *rect,
+                 const Babl          *format)
+{
+  GeglBufferIterator *iter;
+  gint                bpp    = babl_format_get_bytes_per_pixel (format);
+  gint                stride = bpp * rect->width;
+  guchar             *expected;
+  gboolean            success = TRUE;
+
+  expected = g_malloc ((gsize) stride * rect->height);
+
+  gegl_buffer_get (buffer, rect, 1.0, format, expected,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  iter = gegl_buffer_iterator_new (buffer, rect, 0, format,
+                                   GEGL_ACCESS_READ, GEGL_ABYSS_NONE, 1);
+
+  while (gegl_buffer_iterator_next (iter))
+    {
+      const GeglRectangle *roi  = &iter->items[0].roi;
+      const guchar        *data = iter->items[0].data;
+      gint                 y;
+
+      for (y = 0; y < roi->height && success; y++)
+        {
+          const guchar *e = expected +
+                            (gsize) (roi->y - rect->y + y) * stride +
+                            (roi->x - rect->x) * bpp;
+
+          if (memcmp (data + (gsize) y * roi->width * bpp, e,
+                      roi->width * bpp))
+            {
+              printf ("row %d of %dx%d at (%d, %d) in \"%s\" differs\n",
+                      roi->y + y, roi->width, roi->height, roi->x, roi->y,
+                      babl_get_name (format));
+
+              success = FALSE;
+            }
+        }
+    }
+
+  g_free (expected);
+
+  return success;
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  const Babl *format = babl_format ("RGBA float");
+  GeglBuffer *buffer;
+  GeglColor  *color;
+  gint        result = SUCCESS;
+
+  gegl_init (&argc, &argv);
+
+  buffer = gegl_buffer_new (EXTENT, babl_format ("R'G'B'A u8"));
+
+  color = gegl_color_new ("rgba(0.2, 0.4, 0.6, 0.8)");
+  gegl_buffer_set_color (buffer, NULL, color);
+  g_object_unref (color);
+
+  /* a first iteration converts the tiles, and the second one reuses them */
+  if (! check_iteration (buffer, EXTENT, format) ||
+      ! check_iteration (buffer, EXTENT, format) ||
+      ! check_iteration (buffer, GEGL_RECTANGLE (3, 5, 150, 100), format))
+    {
+      result = FAILURE;
+    }
+
+  /* small areas are converted alone, along with the larger parts of
+   * their tiles.
+   */
+  if (! check_iteration (buffer, GEGL_RECTANGLE (70, 40, 20, 10), format) ||
+      ! check_iteration (buffer, GEGL_RECTANGLE (120, 5, 10, 150), format))
+    {
+      result = FAILURE;
+    }
+
+  /* changes made to the buffer invalidate the conversions */
+  color = gegl_color_new ("rgba(0.9, 0.1, 0.3, 1.0)");
+  gegl_buffer_set_color (buffer, GEGL_RECTANGLE (50, 30, 100, 60), color);
+  g_object_unref (color);
+
+  if (! check_iteration (buffer, EXTENT, format) ||
+      ! check_iteration (buffer, EXTENT, babl_format ("Y float")))
+    {
+      result = FAILURE;
+    }
+
+  g_object_unref (buffer);
+
+  gegl_exit ();
+
+  return result;
+}
@@ -0,0 +1,360 @@
+/* This file is a test-case for GEGL
+ *
+ * GEGL is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * GEGL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* make sure that the tile size of buffers follows their access hint, that
+ * the buffers of a graph are hinted after the operations reading them, and
+ * that copying, iterating and processing across buffers of different tile
+ * sizes gives the same result as for buffers of the same tile size.
+ */
+
+#include "config.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "gegl.h"
+#include "graph/gegl-node-private.h"
+
+
+#define SUCCESS    0
+#define FAILURE    -1
+
+#define EXTENT     GEGL_RECTANGLE (-17, -5, 500, 300)
+
+
+static gboolean
+check_tile_size (GeglBuffer  *buffer,
+                 gint         expected_width,
+                 gint         expected_height,
+                 const gchar *what)
+{
+  gint tile_width;
+  gint tile_height;
+
+  g_object_get (buffer,
+                "tile-width",  &tile_width,
+                "tile-height", &tile_height,
+                NULL);
+
+  if (tile_width != expected_width || tile_height != expected_height)
+    {
+      printf ("%s: tile size is %dx%d, expected %dx%d\n",
+              what, tile_width, tile_height, expected_width, expected_height);
+
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+static GeglBuffer *
+process (GeglBuffer *input)
+{
+  GeglBuffer *output = NULL;
+  GeglNode   *graph;
+  GeglNode   *source;
+  GeglNode   *point;
+  GeglNode   *area;
+  GeglNode   *sink;
+
+  graph  = gegl_node_new ();
+  source = gegl_node_new_child (graph,
+                                "operation",  "gegl:buffer-source",
+                                "buffer",     input,
+                                NULL);
+  point  = gegl_node_new_child (graph,
+                                "operation",  "gegl:brightness-contrast",
+                                "contrast",   1.5,
+                                "brightness", 0.1,
+                                NULL);
+  area   = gegl_node_new_child (graph,
+                                "operation",  "gegl:box-blur",
+                                "radius",     5,
+                                NULL);
+  sink   = gegl_node_new_child (graph,
+                                "operation",  "gegl:buffer-sink",
+                                "buffer",     &output,
+                                NULL);
+
+  gegl_node_link_many (source, point, area, sink, NULL);
+  gegl_node_process (sink);
+
+  g_object_unref (graph);
+
+  return output;
+}
+
+static gboolean
+check_hint (GeglNode             *node,
+            GeglBufferAccessHint  expected,
+            const gchar          *what)
+{
+  GeglBufferAccessHint hint;
+
+  g_object_get (gegl_node_get_cache (node), "access-hint", &hint, NULL);
+
+  if (hint != expected)
+    {
+      printf ("%s: access hint %d, expected %d\n", what, hint, expected);
+
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+/* test that the cache of each node is hinted after the operations consuming
+ * it: the output of the source is read by a point operation, that of the
+ * point operation by an area operation, and that of the area operation is
+ * handed out by a sink, so keeps the default tile size.
+ */
+static gint
+test_hints (GeglBuffer *input)
+{
+  GeglBuffer *output = NULL;
+  GeglNode   *graph;
+  GeglNode   *source;
+  GeglNode   *point;
+  GeglNode   *area;
+  GeglNode   *sink;
+  gint        result = SUCCESS;
+
+  g_object_set (gegl_config (),
+                "tile-size-auto", TRUE,
+                NULL);
+
+  graph  = gegl_node_new ();
+  source = gegl_node_new_child (graph,
+                                "operation",  "gegl:buffer-source",
+                                "buffer",     input,
+                                NULL);
+  point  = gegl_node_new_child (graph,
+                                "operation",  "gegl:brightness-contrast",
+                                NULL);
+  area   = gegl_node_new_child (graph,
+                                "operation",  "gegl:box-blur",
+                                NULL);
+  sink   = gegl_node_new_child (graph,
+                                "operation",  "gegl:buffer-sink",
+                                "buffer",     &output,
+                                NULL);
+
+  gegl_node_link_many (source, point, area, sink, NULL);
+
+  if (! check_hint (source, GEGL_BUFFER_ACCESS_HINT_POINT, "source")     ||
+      ! check_hint (point, GEGL_BUFFER_ACCESS_HINT_AREA, "point")        ||
+      ! check_hint (area, GEGL_BUFFER_ACCESS_HINT_DEFAULT, "area"))
+    {
+      result = FAILURE;
+    }
+
+  g_object_unref (graph);
+
+  g_object_set (gegl_config (),
+                "tile-size-auto", FALSE,
+                NULL);
+
+  return result;
+}
+
+/* test that buffers of different tile sizes, copied from one another, hold
+ * the same data, when iterating over them together.
+ */
+static gint
+test_copy (GeglBuffer *buffer,
+           GeglBuffer *point,
+           GeglBuffer *copy)
+{
+  const Babl         *format = babl_format ("RGBA float");
+  GeglBufferIterator *iter;
+  gint                result = SUCCESS;
+
+  gegl_buffer_copy (buffer, NULL, GEGL_ABYSS_NONE, point, NULL);
+  gegl_buffer_copy (point, NULL, GEGL_ABYSS_NONE, copy, NULL);
+
+  iter = gegl_buffer_iterator_new (buffer, EXTENT, 0, format,
+                                   GEGL_ACCESS_READ, GEGL_ABYSS_NONE, 3);
+  gegl_buffer_iterator_add (iter, point, EXTENT, 0, format,
+                            GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
+  gegl_buffer_iterator_add (iter, copy, EXTENT, 0, format,
+                            GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
+
+  while (gegl_buffer_iterator_next (iter))
+    {
+      gsize size = 4 * sizeof (gfloat) * iter->length;
+
+      if (memcmp (iter->items[0].data, iter->items[1].data, size) ||
+          memcmp (iter->items[0].data, iter->items[2].data, size))
+        {
+          const GeglRectangle *roi = &iter->items[0].roi;
+
+          printf ("copy: %dx%d at (%d, %d) differs\n",
+                  roi->width, roi->height, roi->x, roi->y);
+
+          result = FAILURE;
+        }
+    }
+
+  return result;
+}
+
+/* test that processing with tile sizes chosen per operation gives the same
+ * result as with the default tile size, up to the rounding of operations
+ * whose output is split into different chunks.
+ */
+static gint
+test_processing (GeglBuffer *buffer,
+                 GeglBuffer *point)
+{
+  const Babl         *format = babl_format ("RGBA float");
+  GeglBuffer         *expected;
+  GeglBuffer         *output;
+  GeglBufferIterator *iter;
+  gint                result = SUCCESS;
+
+  expected = process (buffer);
+
+  g_object_set (gegl_config (),
+                "tile-size-auto", TRUE,
+                NULL);
+
+  output = process (point);
+
+  g_object_set (gegl_config (),
+                "tile-size-auto", FALSE,
+                NULL);
+
+  iter = gegl_buffer_iterator_new (output, EXTENT, 0, format,
+                                   GEGL_ACCESS_READ, GEGL_ABYSS_NONE, 2);
+  gegl_buffer_iterator_add (iter, expected, EXTENT, 0, format,
+                            GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
+
+  while (gegl_buffer_iterator_next (iter))
+    {
+      const gfloat *out = iter->items[0].data;
+      const gfloat *ref = iter->items[1].data;
+      gint          i;
+
+      for (i = 0; i < 4 * iter->length; i++)
+        {
+          if (fabsf (out[i] - ref[i]) > 1e-5f)
+            {
+              const GeglRectangle *roi = &iter->items[0].roi;
+
+              printf ("processing: %dx%d at (%d, %d) differs\n",
+                      roi->width, roi->height, roi->x, roi->y);
+
+              result = FAILURE;
+              break;
+            }
+        }
+    }
+
+  g_object_unref (output);
+  g_object_unref (expected);
+
+  return result;
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  const Babl *format = babl_format ("RGBA float");
+  GeglBuffer *buffer;
+  GeglBuffer *point;
+  GeglBuffer *area;
+  GeglBuffer *copy;
+  GRand      *rand;
+  gfloat     *data;
+  gint        n      = 4 * EXTENT->width * EXTENT->height;
+  gint        result = SUCCESS;
+  gint        i;
+
+  gegl_init (&argc, &argv);
+
+  g_object_set (gegl_config (),
+                "tile-width",  128,
+                "tile-height", 128,
+                NULL);
+
+  rand = g_rand_new_with_seed (0);
+  data = g_new (gfloat, n);
+
+  for (i = 0; i < n; i++)
+    data[i] = g_rand_double_range (rand, 0.0, 1.0);
+
+  buffer = gegl_buffer_new (EXTENT, format);
+  point  = gegl_buffer_new_for_access (EXTENT, format,
+                                       GEGL_BUFFER_ACCESS_HINT_POINT);
+  area   = gegl_buffer_new_for_access (EXTENT, format,
+                                       GEGL_BUFFER_ACCESS_HINT_AREA);
+
+  /* tiles of about the same number of bytes as 128x128 4-byte pixels */
+  if (! check_tile_size (buffer, 128, 128, "default")                     ||
+      ! check_tile_size (point, 64, 64, "point")                          ||
+      ! check_tile_size (area, 128, 128, "area"))
+    {
+      result = FAILURE;
+    }
+
+  g_object_unref (area);
+  area = gegl_buffer_new_for_access (EXTENT, babl_format ("Y u8"),
+                                     GEGL_BUFFER_ACCESS_HINT_AREA);
+  copy = g_object_new (GEGL_TYPE_BUFFER,
+                       "x",           EXTENT->x,
+                       "y",           EXTENT->y,
+                       "width",       EXTENT->width,
+                       "height",      EXTENT->height,
+                       "format",      format,
+                       "tile-width",  100,
+                       "tile-height", 50,
+                       "access-hint", GEGL_BUFFER_ACCESS_HINT_POINT,
+                       NULL);
+
+  /* smaller pixels make for larger tiles, up to a limit, and an explicit
+   * size takes precedence over the hint
+   */
+  if (! check_tile_size (area, 512, 512, "area u8")                       ||
+      ! check_tile_size (copy, 100, 50, "explicit"))
+    {
+      result = FAILURE;
+    }
+
+  g_object_unref (area);
+
+  gegl_buffer_set (buffer, NULL, 0, format, data, GEGL_AUTO_ROWSTRIDE);
+
+  if (test_copy (buffer, point, copy) != SUCCESS)
+    result = FAILURE;
+
+  if (test_hints (buffer) != SUCCESS)
+    result = FAILURE;
+
+  if (test_processing (buffer, point) != SUCCESS)
+    result = FAILURE;
+
+  g_object_unref (copy);
+  g_object_unref (point);
+  g_object_unref (buffer);
+  g_free (data);
+  g_rand_free (rand);
+
+  gegl_exit ();
+
+  return result;
+}
@@ -0,0 +1,204 @@
+/* This file is a test-case for GEGL
+ *
+ * GEGL is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * GEGL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* make sure that gegl_buffer_get_transposed() and
+ * gegl_buffer_set_transposed() give the same result as transposing the
+ * data of gegl_buffer_get() and gegl_buffer_set().
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "gegl.h"
+
+
+#define SUCCESS    0
+#define FAILURE    -1
+
+#define EXTENT     GEGL_RECTANGLE (-13, -29, 300, 200)
+
+
+static guchar *
+transpose (const guchar *data,
+           gint          width,
+           gint          height,
+           gint          bpp)
+{
+  guchar *result = g_malloc ((gsize) bpp * width * height);
+  gint    x, y;
+
+  for (y = 0; y < height; y++)
+    for (x = 0; x < width; x++)
+      {
+        memcpy (result + ((gsize) x * height + y) * bpp,
+                data   + ((gsize) y * width  + x) * bpp,
+                bpp);
+      }
+
+  return result;
+}
+
+static gboolean
+test_get (GeglBuffer          *buffer,
+          const GeglRectangle *rect,
+          const Babl          *format,
+          GeglAbyssPolicy      repeat_mode)
+{
+  gint     bpp  = babl_format_get_bytes_per_pixel (format);
+  gsize    size = (gsize) bpp * rect->width * rect->height;
+  guchar  *data;
+  guchar  *expected;
+  guchar  *result;
+  gboolean success;
+
+  data   = g_malloc (size);
+  result = g_malloc (size);
+
+  gegl_buffer_get (buffer, rect, 1.0, format, data,
+                   GEGL_AUTO_ROWSTRIDE, repeat_mode);
+  expected = transpose (data, rect->width, rect->height, bpp);
+
+  gegl_buffer_get_transposed (buffer, rect, 1.0, format, result,
+                              GEGL_AUTO_ROWSTRIDE, repeat_mode);
+
+  success = ! memcmp (result, expected, size);
+
+  if (! success)
+    {
+      printf ("transposed get of %dx%d at (%d, %d) in \"%s\" differs\n",
+              rect->width, rect->height, rect->x, rect->y,
+              babl_get_name (format));
+    }
+
+  g_free (expected);
+  g_free (result);
+  g_free (data);
+
+  return success;
+}
+
+static gboolean
+test_set (GeglBuffer          *buffer,
+          const GeglRectangle *rect,
+          const Babl          *format)
+{
+  const Babl *buffer_format = gegl_buffer_get_format (buffer);
+  gint        bpp           = babl_format_get_bytes_per_pixel (format);
+  GeglBuffer *expected;
+  GeglBuffer *result;
+  guchar     *data;
+  guchar     *transposed;
+  guchar     *expected_data;
+  guchar     *result_data;
+  gsize       size;
+  gboolean    success;
+
+  data = g_malloc ((gsize) bpp * rect->width * rect->height);
+
+  gegl_buffer_get (buffer, rect, 1.0, format, data,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+  transposed = transpose (data, rect->width, rect->height, bpp);
+
+  expected = gegl_buffer_new (EXTENT, buffer_format);
+  result   = gegl_buffer_new (EXTENT, buffer_format);
+
+  gegl_buffer_set (expected, rect, 0, format, data, GEGL_AUTO_ROWSTRIDE);
+  gegl_buffer_set_transposed (result, rect, 0, format, transposed,
+                              GEGL_AUTO_ROWSTRIDE);
+
+  size = (gsize) babl_format_get_bytes_per_pixel (buffer_format) *
+         EXTENT->width * EXTENT->height;
+
+  expected_data = g_malloc (size);
+  result_data   = g_malloc (size);
+
+  gegl_buffer_get (expected, EXTENT, 1.0, buffer_format, expected_data,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+  gegl_buffer_get (result, EXTENT, 1.0, buffer_format, result_data,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  success = ! memcmp (result_data, expected_data, size);
+
+  if (! success)
+    {
+      printf ("transposed set of %dx%d at (%d, %d) from \"%s\" differs\n",
+              rect->width, rect->height, rect->x, rect->y,
+              babl_get_name (format));
+    }
+
+  g_free (result_data);
+  g_free (expected_data);
+  g_object_unref (result);
+  g_object_unref (expected);
+  g_free (transposed);
+  g_free (data);
+
+  return success;
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  const Babl *format = babl_format ("RGBA float");
+  GeglBuffer *buffer;
+  GRand      *rand;
+  gfloat     *data;
+  gint        n      = 4 * EXTENT->width * EXTENT->height;
+  gint        result = SUCCESS;
+  gint        i;
+
+  gegl_init (&argc, &argv);
+
+  rand = g_rand_new_with_seed (0);
+  data = g_new (gfloat, n);
+
+  for (i = 0; i < n; i++)
+    data[i] = g_rand_double_range (rand, 0.0, 1.0);
+
+  buffer = gegl_buffer_new (EXTENT, format);
+  gegl_buffer_set (buffer, NULL, 0, format, data, GEGL_AUTO_ROWSTRIDE);
+
+  /* whole buffer, column blocks, and reads straddling the abyss, in
+   * formats of different pixel sizes
+   */
+  if (! test_get (buffer, EXTENT, format, GEGL_ABYSS_NONE)                 ||
+      ! test_get (buffer, GEGL_RECTANGLE (5, -40, 16, 250),
+                  format, GEGL_ABYSS_CLAMP)                                ||
+      ! test_get (buffer, GEGL_RECTANGLE (-20, 3, 7, 131),
+                  babl_format ("R'G'B' u8"), GEGL_ABYSS_BLACK)             ||
+      ! test_get (buffer, GEGL_RECTANGLE (100, 50, 33, 77),
+                  babl_format ("Y' u16"), GEGL_ABYSS_LOOP)                 ||
+      ! test_get (buffer, GEGL_RECTANGLE (7, 9, 1, 100),
+                  babl_format ("RGB float"), GEGL_ABYSS_NONE)              ||
+      ! test_set (buffer, EXTENT, format)                                  ||
+      ! test_set (buffer, GEGL_RECTANGLE (5, 3, 16, 150), format)          ||
+      ! test_set (buffer, GEGL_RECTANGLE (-13, -20, 77, 99),
+                  babl_format ("R'G'B'A u8")))
+    {
+      result = FAILURE;
+    }
+
+  g_object_unref (buffer);
+  g_free (data);
+  g_rand_free (rand);
+
+  gegl_exit ();
+
+  return result;
+}
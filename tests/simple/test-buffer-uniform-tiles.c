@@ -0,0 +1,428 @@
+/* This file is a test-case for GEGL
+ *
+ * GEGL is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * GEGL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* make sure that buffers filled with a solid color, whose tiles share a
+ * single uniform tile, read back, mipmap, process and change the same as
+ * buffers holding the same pixels as regular tiles, and that they survive
+ * being evicted to, and read back from, the swap.
+ */
+
+#include "config.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <glib/gstdio.h>
+
+#include "gegl.h"
+#include "gegl-buffer-private.h"
+
+
+#define SUCCESS    0
+#define FAILURE    -1
+
+#define EXTENT     GEGL_RECTANGLE (-10, -20, 400, 300)
+
+/* the mipmaps of uniform tiles are exact, while those of regular tiles are
+ * subject to the rounding of the downscaling
+ */
+#define TOLERANCE  (2.0 / 255.0)
+
+
+/* a buffer filled with @color, a pixel at a time, rather than using
+ * gegl_buffer_set_color()
+ */
+static GeglBuffer *
+regular_buffer (const Babl *format,
+                GeglColor  *color)
+{
+  GeglBuffer *buffer = gegl_buffer_new (EXTENT, format);
+  gint        bpp    = babl_format_get_bytes_per_pixel (format);
+  guchar      pixel[64];
+  guchar     *data;
+  gint        i;
+
+  gegl_color_get_pixel (color, format, pixel);
+
+  data = g_malloc ((gsize) bpp * EXTENT->width * EXTENT->height);
+
+  for (i = 0; i < EXTENT->width * EXTENT->height; i++)
+    memcpy (data + (gsize) i * bpp, pixel, bpp);
+
+  gegl_buffer_set (buffer, NULL, 0, format, data, GEGL_AUTO_ROWSTRIDE);
+
+  g_free (data);
+
+  return buffer;
+}
+
+static gboolean
+compare_buffers (GeglBuffer          *buffer,
+                 GeglBuffer          *expected,
+                 const GeglRectangle *rect,
+                 gdouble              scale,
+                 const Babl          *format,
+                 const gchar         *what)
+{
+  gint     bpp  = babl_format_get_bytes_per_pixel (format);
+  gsize    size = (gsize) bpp * rect->width * rect->height;
+  guchar  *data1 = g_malloc (size);
+  guchar  *data2 = g_malloc (size);
+  gboolean success;
+
+  gegl_buffer_get (buffer, rect, scale, format, data1,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+  gegl_buffer_get (expected, rect, scale, format, data2,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  if (scale == 1.0)
+    {
+      success = ! memcmp (data1, data2, size);
+    }
+  else
+    {
+      const gfloat *f1 = (const gfloat *) data1;
+      const gfloat *f2 = (const gfloat *) data2;
+      gsize         i;
+
+      g_assert (format == babl_format ("RGBA float"));
+
+      success = TRUE;
+
+      for (i = 0; i < size / sizeof (gfloat) && success; i++)
+        success = fabs (f1[i] - f2[i]) <= TOLERANCE;
+    }
+
+  if (! success)
+    {
+      printf ("%s: %dx%d at (%d, %d), scale %g, in \"%s\" differs\n",
+              what, rect->width, rect->height, rect->x, rect->y, scale,
+              babl_get_name (format));
+    }
+
+  g_free (data2);
+  g_free (data1);
+
+  return success;
+}
+
+/* compares iterating over @buffer in @format with reading @expected */
+static gboolean
+compare_iteration (GeglBuffer  *buffer,
+                   GeglBuffer  *expected,
+                   const Babl  *format)
+{
+  GeglBufferIterator *iter;
+  gint                bpp     = babl_format_get_bytes_per_pixel (format);
+  gboolean            success = TRUE;
+
+  iter = gegl_buffer_iterator_new (buffer, EXTENT, 0, format,
+                                   GEGL_ACCESS_READ, GEGL_ABYSS_NONE, 2);
+  gegl_buffer_iterator_add (iter, expected, EXTENT, 0, format,
+                            GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
+
+  while (gegl_buffer_iterator_next (iter))
+    {
+      if (memcmp (iter->items[0].data, iter->items[1].data,
+                  (gsize) bpp * iter->length))
+        {
+          const GeglRectangle *roi = &iter->items[0].roi;
+
+          printf ("iteration: %dx%d at (%d, %d) in \"%s\" differs\n",
+                  roi->width, roi->height, roi->x, roi->y,
+                  babl_get_name (format));
+
+          success = FALSE;
+        }
+    }
+
+  return success;
+}
+
+static GeglBuffer *
+brightness_contrast (GeglBuffer *input)
+{
+  GeglBuffer *output = NULL;
+  GeglNode   *graph;
+  GeglNode   *source;
+  GeglNode   *node;
+  GeglNode   *sink;
+
+  graph  = gegl_node_new ();
+  source = gegl_node_new_child (graph,
+                                "operation",  "gegl:buffer-source",
+                                "buffer",     input,
+                                NULL);
+  node   = gegl_node_new_child (graph,
+                                "operation",  "gegl:brightness-contrast",
+                                "contrast",   1.5,
+                                "brightness", 0.1,
+                                NULL);
+  sink   = gegl_node_new_child (graph,
+                                "operation",  "gegl:buffer-sink",
+                                "buffer",     &output,
+                                NULL);
+
+  gegl_node_link_many (source, node, sink, NULL);
+  gegl_node_process (sink);
+
+  g_object_unref (graph);
+
+  return output;
+}
+
+/* checks that the tiles of @buffer covering @rect are uniform */
+static gboolean
+check_uniform_tiles (GeglBuffer          *buffer,
+                     const GeglRectangle *rect,
+                     const gchar         *what)
+{
+  gint     tile_width;
+  gint     tile_height;
+  gint     x, y;
+  gboolean success = TRUE;
+
+  g_object_get (buffer,
+                "tile-width",  &tile_width,
+                "tile-height", &tile_height,
+                NULL);
+
+  for (y = rect->y / tile_height;
+       y < (rect->y + rect->height) / tile_height;
+       y++)
+    {
+      for (x = rect->x / tile_width;
+           x < (rect->x + rect->width) / tile_width;
+           x++)
+        {
+          GeglTile *tile;
+
+          tile = gegl_tile_source_get_tile (GEGL_TILE_SOURCE (buffer),
+                                            x, y, 0);
+
+          if (! tile || ! tile->is_uniform_tile)
+            {
+              printf ("%s: tile (%d, %d) isn't uniform\n", what, x, y);
+
+              success = FALSE;
+            }
+
+          if (tile)
+            gegl_tile_unref (tile);
+        }
+    }
+
+  return success;
+}
+
+/* a point filter processes a tile aligned, uniform, input as a single pixel,
+ * and fills its output with uniform tiles.
+ */
+static gboolean
+test_process_uniform (const Babl *format,
+                      GeglColor  *color)
+{
+  GeglBuffer    *buffer;
+  GeglBuffer    *result;
+  GeglRectangle  rect = {};
+  gboolean       success;
+
+  g_object_get (gegl_config (),
+                "tile-width",  &rect.width,
+                "tile-height", &rect.height,
+                NULL);
+
+  rect.width  *= 2;
+  rect.height *= 2;
+
+  buffer = gegl_buffer_new (&rect, format);
+  gegl_buffer_set_color (buffer, NULL, color);
+
+  result = brightness_contrast (buffer);
+
+  success = check_uniform_tiles (buffer, &rect, "input") &&
+            check_uniform_tiles (result, &rect, "process-uniform");
+
+  g_object_unref (result);
+  g_object_unref (buffer);
+
+  return success;
+}
+
+/* uniform tiles evicted from the tile cache are stored in the swap as a
+ * single pixel, and read back as uniform tiles.
+ */
+static gboolean
+test_swap (const Babl  *format,
+           GeglColor   *color,
+           const gchar *dir)
+{
+  GeglBuffer *buffer;
+  GeglBuffer *expected;
+  gint        misses_before;
+  gint        misses_after;
+  gboolean    success = TRUE;
+
+  /* the tests run with a RAM swap; use a swap directory, and a tile cache
+   * much smaller than the buffers, so that their tiles get evicted.
+   */
+  g_object_set (gegl_config (),
+                "swap",            dir,
+                "tile-cache-size", (guint64) 64 * 1024,
+                "tile-width",      64,
+                "tile-height",     64,
+                NULL);
+
+  buffer = gegl_buffer_new (EXTENT, format);
+  gegl_buffer_set_color (buffer, NULL, color);
+
+  /* filling the regular buffer evicts the tiles of @buffer */
+  expected = regular_buffer (format, color);
+
+  g_object_get (gegl_stats (), "tile-cache-misses", &misses_before, NULL);
+
+  if (! check_uniform_tiles (buffer, GEGL_RECTANGLE (0, 0, 320, 256),
+                             "swap"))
+    {
+      success = FALSE;
+    }
+
+  g_object_get (gegl_stats (), "tile-cache-misses", &misses_after, NULL);
+
+  if (misses_after == misses_before)
+    {
+      printf ("swap: the uniform tiles weren't evicted\n");
+
+      success = FALSE;
+    }
+
+  if (! compare_buffers (buffer, expected, EXTENT, 1.0, format, "swap")   ||
+      ! compare_iteration (buffer, expected, babl_format ("RGBA float")))
+    {
+      success = FALSE;
+    }
+
+  g_object_unref (expected);
+  g_object_unref (buffer);
+
+  return success;
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  const Babl *format = babl_format ("R'G'B'A u8");
+  GeglBuffer *buffer;
+  GeglBuffer *other;
+  GeglBuffer *expected;
+  GeglBuffer *result;
+  GeglBuffer *expected_result;
+  GeglColor  *color;
+  GeglColor  *color2;
+  gchar      *dir;
+  gint        result_code = SUCCESS;
+
+  gegl_init (&argc, &argv);
+
+  color  = gegl_color_new ("rgba(0.2, 0.4, 0.6, 0.8)");
+  color2 = gegl_color_new ("rgba(0.9, 0.1, 0.3, 1.0)");
+
+  buffer = gegl_buffer_new (EXTENT, format);
+  gegl_buffer_set_color (buffer, NULL, color);
+
+  /* a second buffer of the same color, sharing its tiles */
+  other = gegl_buffer_new (EXTENT, format);
+  gegl_buffer_set_color (other, NULL, color);
+
+  expected = regular_buffer (format, color);
+
+  /* reading, converted, iterated and mipmapped */
+  if (! compare_buffers (buffer, expected, EXTENT, 1.0, format, "get")     ||
+      ! compare_buffers (buffer, expected, EXTENT, 1.0,
+                         babl_format ("RGBA float"), "get")                ||
+      ! compare_buffers (buffer, expected, GEGL_RECTANGLE (3, 5, 150, 100),
+                         1.0, babl_format ("Y' u16"), "get")               ||
+      ! compare_buffers (buffer, expected, GEGL_RECTANGLE (0, 0, 100, 75),
+                         0.25, babl_format ("RGBA float"), "mipmap")       ||
+      ! compare_iteration (buffer, expected, babl_format ("RGBA float"))   ||
+      ! compare_iteration (buffer, expected, format))
+    {
+      result_code = FAILURE;
+    }
+
+  /* processing, as a single pixel */
+  result          = brightness_contrast (buffer);
+  expected_result = brightness_contrast (expected);
+
+  if (! compare_buffers (result, expected_result, EXTENT, 1.0,
+                         babl_format ("RGBA float"), "brightness-contrast"))
+    {
+      result_code = FAILURE;
+    }
+
+  g_object_unref (expected_result);
+  g_object_unref (result);
+
+  if (! test_process_uniform (format, color))
+    result_code = FAILURE;
+
+  /* writing to a buffer doesn't change the other buffers sharing its tiles */
+  gegl_buffer_set_color (buffer, GEGL_RECTANGLE (50, 30, 100, 60), color2);
+  gegl_buffer_set_color (expected, GEGL_RECTANGLE (50, 30, 100, 60), color2);
+
+  if (! compare_buffers (buffer, expected, EXTENT, 1.0, format,
+                         "changed buffer")                                 ||
+      ! compare_buffers (buffer, expected, GEGL_RECTANGLE (0, 0, 100, 75),
+                         0.25, babl_format ("RGBA float"),
+                         "changed mipmap")                                 ||
+      ! compare_iteration (buffer, expected, babl_format ("RGBA float")))
+    {
+      result_code = FAILURE;
+    }
+
+  g_object_unref (expected);
+
+  expected = regular_buffer (format, color);
+
+  if (! compare_buffers (other, expected, EXTENT, 1.0, format,
+                         "unchanged buffer"))
+    {
+      result_code = FAILURE;
+    }
+
+  g_object_unref (expected);
+  g_object_unref (other);
+  g_object_unref (buffer);
+  g_object_unref (color2);
+
+  /* last, since it changes the configuration of the buffers */
+  dir = g_dir_make_tmp ("test-buffer-uniform-tiles-XXXXXX", NULL);
+
+  if (! test_swap (format, color, dir))
+    result_code = FAILURE;
+
+  g_object_unref (color);
+
+  /* the swap file is removed on exit */
+  gegl_exit ();
+
+  g_rmdir (dir);
+  g_free (dir);
+
+  return result_code;
+}
@@ -0,0 +1,166 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* make sure that gegl:convolve matches a brute-force convolution, both for
+ * small kernels, convolved directly, and large ones, convolved through the
+ * FFT.
+ */
+
+#include "config.h"
+#include <math.h>
+#include <stdio.h>
+
+#include "gegl.h"
+
+#define SUCCESS  0
+#define FAILURE -1
+
+#define WIDTH  64
+#define HEIGHT 48
+
+static gint
+test_kernel (GRand        *rand,
+             const gfloat *src,
+             gint          kernel_width,
+             gint          kernel_height)
+{
+  const Babl *format = babl_format ("RaGaBaA float");
+  GeglBuffer *input;
+  GeglBuffer *aux;
+  GeglNode   *graph;
+  GeglNode   *source;
+  GeglNode   *kernel_source;
+  GeglNode   *convolve;
+  gfloat     *kernel;
+  gfloat     *dst;
+  gint        result = SUCCESS;
+  gint        x, y, c;
+
+  kernel = g_new (gfloat, kernel_width * kernel_height);
+
+  for (x = 0; x < kernel_width * kernel_height; x++)
+    kernel[x] = g_rand_double (rand);
+
+  input = gegl_buffer_new (GEGL_RECTANGLE (0, 0, WIDTH, HEIGHT), format);
+  gegl_buffer_set (input, NULL, 0, format, src, GEGL_AUTO_ROWSTRIDE);
+
+  aux = gegl_buffer_new (GEGL_RECTANGLE (0, 0, kernel_width, kernel_height),
+                         babl_format ("Y float"));
+  gegl_buffer_set (aux, NULL, 0, babl_format ("Y float"), kernel,
+                   GEGL_AUTO_ROWSTRIDE);
+
+  graph         = gegl_node_new ();
+  source        = gegl_node_new_child (graph,
+                                       "operation", "gegl:buffer-source",
+                                       "buffer",    input,
+                                       NULL);
+  kernel_source = gegl_node_new_child (graph,
+                                       "operation", "gegl:buffer-source",
+                                       "buffer",    aux,
+                                       NULL);
+  convolve      = gegl_node_new_child (graph,
+                                       "operation", "gegl:convolve",
+                                       "normalize", FALSE,
+                                       NULL);
+
+  gegl_node_link (source, convolve);
+  gegl_node_connect_to (kernel_source, "output", convolve, "aux");
+
+  dst = g_new (gfloat, WIDTH * HEIGHT * 4);
+  gegl_node_blit (convolve, 1.0, GEGL_RECTANGLE (0, 0, WIDTH, HEIGHT),
+                  format, dst, GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+
+  for (y = 0; y < HEIGHT && result == SUCCESS; y++)
+    {
+      for (x = 0; x < WIDTH && result == SUCCESS; x++)
+        {
+          for (c = 0; c < 4; c++)
+            {
+              gdouble expected = 0.0;
+              gint    i, j;
+
+              for (j = 0; j < kernel_height; j++)
+                {
+                  gint sy = y + j - kernel_height / 2;
+
+                  if (sy < 0 || sy >= HEIGHT)
+                    continue;
+
+                  for (i = 0; i < kernel_width; i++)
+                    {
+                      gint sx = x + i - kernel_width / 2;
+
+                      if (sx < 0 || sx >= WIDTH)
+                        continue;
+
+                      expected += kernel[j * kernel_width + i] *
+                                  src[(sy * WIDTH + sx) * 4 + c];
+                    }
+                }
+
+              if (fabs (dst[(y * WIDTH + x) * 4 + c] - expected) >
+                  1e-4 * fabs (expected) + 1e-5)
+                {
+                  printf ("%dx%d kernel, pixel (%d, %d), component %d: "
+                          "expected %f, got %f\n",
+                          kernel_width, kernel_height, x, y, c,
+                          expected, dst[(y * WIDTH + x) * 4 + c]);
+                  result = FAILURE;
+                  break;
+                }
+            }
+        }
+    }
+
+  g_free (dst);
+  g_object_unref (graph);
+  g_object_unref (aux);
+  g_object_unref (input);
+  g_free (kernel);
+
+  return result;
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  GRand  *rand;
+  gfloat *src;
+  gint    result = SUCCESS;
+  gint    i;
+
+  gegl_init (&argc, &argv);
+
+  rand = g_rand_new_with_seed (0);
+  src  = g_new (gfloat, WIDTH * HEIGHT * 4);
+
+  for (i = 0; i < WIDTH * HEIGHT * 4; i++)
+    src[i] = g_rand_double (rand);
+
+  /* kernels are deliberately asymmetric, to catch mirroring */
+  if (test_kernel (rand, src,  5,  3) != SUCCESS ||
+      test_kernel (rand, src, 61, 45) != SUCCESS)
+    {
+      result = FAILURE;
+    }
+
+  g_free (src);
+  g_rand_free (rand);
+
+  gegl_exit ();
+
+  return result;
+}
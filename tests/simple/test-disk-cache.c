@@ -0,0 +1,542 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* make sure that the result cache of the gegl tool reuses the result of
+ * an unchanged graph, and renders it again once one of its properties, or
+ * one of the files it reads, through a path or a URI, changes, and that
+ * graphs sharing a prefix reuse its result.
+ */
+
+#include "config.h"
+#include <math.h>
+#include <stdio.h>
+
+#include <glib/gstdio.h>
+
+#include "gegl.h"
+#include "gegl-disk-cache.h"
+
+#define SUCCESS  0
+#define FAILURE -1
+
+typedef struct
+{
+  const gchar *operation;
+  const gchar *property;  /* the path or URI property */
+  gboolean     uri;
+  const gchar *extension;
+} Input;
+
+static const gfloat planted[4] = { 0.25, 0.5, 0.75, 1.0 };
+
+static void
+write_input (const gchar *path,
+             gint         width,
+             gint         height)
+{
+  GeglBuffer *buffer;
+  GeglNode   *graph;
+  GeglNode   *source;
+  GeglNode   *save;
+  gfloat     *pixels;
+  gint        i;
+
+  pixels = g_new (gfloat, 4 * width * height);
+
+  for (i = 0; i < width * height; i++)
+    {
+      pixels[4 * i + 0] = (gfloat) (i % width) / width;
+      pixels[4 * i + 1] = (gfloat) (i / width) / height;
+      pixels[4 * i + 2] = 0.5;
+      pixels[4 * i + 3] = 1.0;
+    }
+
+  buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0, width, height),
+                            babl_format ("RGBA float"));
+  gegl_buffer_set (buffer, NULL, 0, babl_format ("RGBA float"), pixels,
+                   GEGL_AUTO_ROWSTRIDE);
+
+  graph  = gegl_node_new ();
+  source = gegl_node_new_child (graph,
+                                "operation", "gegl:buffer-source",
+                                "buffer",    buffer,
+                                NULL);
+  save   = gegl_node_new_child (graph,
+                                "operation", "gegl:save",
+                                "path",      path,
+                                NULL);
+  gegl_node_link (source, save);
+  gegl_node_process (save);
+
+  g_object_unref (graph);
+  g_object_unref (buffer);
+  g_free (pixels);
+}
+
+/* renders the input through gegl:brightness-contrast, through @cache if
+ * it's not NULL.
+ */
+static gfloat *
+render (GeglDiskCache *cache,
+        const Input   *input,
+        const gchar   *value,
+        gdouble        brightness,
+        GeglRectangle *extent)
+{
+  GeglNode *graph;
+  GeglNode *load;
+  GeglNode *node;
+  gfloat   *pixels;
+
+  graph = gegl_node_new ();
+  load  = gegl_node_new_child (graph,
+                               "operation",     input->operation,
+                               input->property, value,
+                               NULL);
+  node  = gegl_node_new_child (graph,
+                               "operation",     "gegl:brightness-contrast",
+                               "brightness",    brightness,
+                               NULL);
+  gegl_node_link (load, node);
+
+  if (cache)
+    node = gegl_disk_cache_process (cache, node);
+
+  *extent = gegl_node_get_bounding_box (node);
+
+  pixels = g_new (gfloat, 4 * extent->width * extent->height);
+
+  gegl_node_blit (node, 1.0, extent, babl_format ("RGBA float"), pixels,
+                  GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+
+  g_object_unref (graph);
+
+  return pixels;
+}
+
+/* checks that rendering through @cache gives the same result as without */
+static gboolean
+check_render (GeglDiskCache *cache,
+              const Input   *input,
+              const gchar   *value,
+              gdouble        brightness,
+              const gchar   *what)
+{
+  GeglRectangle  extent;
+  GeglRectangle  expected_extent;
+  gfloat        *pixels;
+  gfloat        *expected;
+  gboolean       success = TRUE;
+  gint           i;
+
+  pixels   = render (cache, input, value, brightness, &extent);
+  expected = render (NULL,  input, value, brightness, &expected_extent);
+
+  if (! gegl_rectangle_equal (&extent, &expected_extent))
+    {
+      printf ("%s: %s: expected a %dx%d result, got %dx%d\n",
+              input->operation, what,
+              expected_extent.width, expected_extent.height,
+              extent.width, extent.height);
+      success = FALSE;
+    }
+
+  for (i = 0; success && i < 4 * extent.width * extent.height; i++)
+    {
+      if (fabsf (pixels[i] - expected[i]) > 1e-5)
+        {
+          printf ("%s: %s: component %d: expected %f, got %f\n",
+                  input->operation, what, i, expected[i], pixels[i]);
+          success = FALSE;
+        }
+    }
+
+  g_free (expected);
+  g_free (pixels);
+
+  return success;
+}
+
+static GPtrArray *
+list_entries (const gchar *cache_path)
+{
+  GPtrArray   *entries = g_ptr_array_new_with_free_func (g_free);
+  GDir        *dir     = g_dir_open (cache_path, 0, NULL);
+  const gchar *name;
+
+  while (dir && (name = g_dir_read_name (dir)))
+    {
+      if (g_str_has_suffix (name, ".gegl"))
+        g_ptr_array_add (entries, g_build_filename (cache_path, name, NULL));
+    }
+
+  if (dir)
+    g_dir_close (dir);
+
+  return entries;
+}
+
+static gboolean
+check_n_entries (const gchar *cache_path,
+                 const Input *input,
+                 guint        n_entries,
+                 const gchar *what)
+{
+  GPtrArray *entries = list_entries (cache_path);
+  gboolean   success = entries->len == n_entries;
+
+  if (! success)
+    {
+      printf ("%s: %s: expected %u cache entries, got %u\n",
+              input->operation, what, n_entries, entries->len);
+    }
+
+  g_ptr_array_free (entries, TRUE);
+
+  return success;
+}
+
+/* replaces the cache entry at @entry_path with a flat color, of the same
+ * extent, which a cache hit then returns.
+ */
+static void
+plant_entry (const gchar *entry_path)
+{
+  GeglBuffer    *buffer;
+  GeglRectangle  extent;
+
+  buffer = gegl_buffer_load (entry_path);
+  extent = *gegl_buffer_get_extent (buffer);
+  g_object_unref (buffer);
+
+  buffer = gegl_buffer_new (&extent, babl_format ("RGBA float"));
+  gegl_buffer_set_color_from_pixel (buffer, NULL, planted,
+                                    babl_format ("RGBA float"));
+
+  gegl_buffer_save (buffer, entry_path, NULL);
+  g_object_unref (buffer);
+}
+
+static gboolean
+check_hit (GeglDiskCache *cache,
+           const gchar   *cache_path,
+           const Input   *input,
+           const gchar   *value)
+{
+  GPtrArray     *entries = list_entries (cache_path);
+  GeglRectangle  extent;
+  gfloat        *pixels;
+  gboolean       success = TRUE;
+  gint           i;
+
+  plant_entry (entries->pdata[0]);
+
+  pixels = render (cache, input, value, 0.1, &extent);
+
+  for (i = 0; success && i < 4 * extent.width * extent.height; i++)
+    {
+      if (pixels[i] != planted[i % 4])
+        {
+          printf ("%s: hit: component %d: expected %f, got %f\n",
+                  input->operation, i, planted[i % 4], pixels[i]);
+          success = FALSE;
+        }
+    }
+
+  g_free (pixels);
+  g_ptr_array_free (entries, TRUE);
+
+  return success;
+}
+
+static gboolean
+test_input (const gchar *dir,
+            const Input *input)
+{
+  GeglDiskCache *cache;
+  GPtrArray     *entries;
+  gchar         *name;
+  gchar         *path;
+  gchar         *value;
+  gchar         *cache_path;
+  gboolean       success = TRUE;
+  gint           i;
+
+  name       = g_strconcat ("input", input->extension, NULL);
+  path       = g_build_filename (dir, name, NULL);
+  value      = input->uri ? g_filename_to_uri (path, NULL, NULL) :
+                            g_strdup (path);
+  cache_path = g_build_filename (dir, "cache", NULL);
+
+  cache = gegl_disk_cache_new (cache_path, 0);
+
+  write_input (path, 64, 48);
+
+  /* a miss stores the result */
+  if (! check_render (cache, input, value, 0.1, "miss") ||
+      ! check_n_entries (cache_path, input, 1, "miss"))
+    {
+      success = FALSE;
+    }
+
+  /* the same graph is then read from the cache */
+  if (success && ! check_hit (cache, cache_path, input, value))
+    success = FALSE;
+
+  /* changing a property, or the input file, misses */
+  if (! check_render (cache, input, value, 0.3, "property change") ||
+      ! check_n_entries (cache_path, input, 2, "property change"))
+    {
+      success = FALSE;
+    }
+
+  write_input (path, 300, 200);
+
+  if (! check_render (cache, input, value, 0.1, "input change") ||
+      ! check_n_entries (cache_path, input, 3, "input change"))
+    {
+      success = FALSE;
+    }
+
+  gegl_disk_cache_free (cache);
+
+  entries = list_entries (cache_path);
+
+  for (i = 0; i < entries->len; i++)
+    g_unlink (entries->pdata[i]);
+
+  g_ptr_array_free (entries, TRUE);
+
+  g_rmdir (cache_path);
+  g_unlink (path);
+
+  g_free (cache_path);
+  g_free (value);
+  g_free (path);
+  g_free (name);
+
+  return success;
+}
+
+/* renders a chain ending with gegl:brightness-contrast from a prefix
+ * shared with another chain, ending with another brightness, when @fork,
+ * through @cache.  Returns the result and its extent.
+ */
+static gfloat *
+render_chain (GeglDiskCache *cache,
+              const gchar   *path,
+              gboolean       fork,
+              gdouble        brightness,
+              GeglRectangle *extent)
+{
+  GeglNode *graph;
+  GeglNode *prefix;
+  GeglNode *node;
+  gfloat   *pixels;
+
+  graph  = gegl_node_new ();
+  prefix = gegl_node_new_child (graph,
+                                "operation",  "gegl:gegl-buffer-load",
+                                "path",       path,
+                                NULL);
+  node   = gegl_node_new_child (graph,
+                                "operation",  "gegl:crop",
+                                "x",          4.0,
+                                "y",          4.0,
+                                "width",      40.0,
+                                "height",     30.0,
+                                NULL);
+  gegl_node_link (prefix, node);
+  prefix = node;
+  node   = gegl_node_new_child (graph,
+                                "operation",  "gegl:gaussian-blur",
+                                "std-dev-x",  1.5,
+                                "std-dev-y",  1.5,
+                                NULL);
+  gegl_node_link (prefix, node);
+  prefix = node;
+
+  if (fork)
+    {
+      GeglNode *other;
+
+      other = gegl_node_new_child (graph,
+                                   "operation",  "gegl:brightness-contrast",
+                                   "brightness", -brightness,
+                                   NULL);
+      gegl_node_link (prefix, other);
+    }
+
+  node   = gegl_node_new_child (graph,
+                                "operation",  "gegl:brightness-contrast",
+                                "brightness", brightness,
+                                NULL);
+  gegl_node_link (prefix, node);
+
+  node    = gegl_disk_cache_process (cache, node);
+  *extent = gegl_node_get_bounding_box (node);
+
+  pixels = g_new (gfloat, 4 * extent->width * extent->height);
+
+  gegl_node_blit (node, 1.0, extent, babl_format ("RGBA float"), pixels,
+                  GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+
+  g_object_unref (graph);
+
+  return pixels;
+}
+
+/* make sure that the prefix shared by two chains of a first job is
+ * stored, and that a second job, whose chain starts with the same prefix,
+ * is rendered from it.
+ */
+static gboolean
+test_shared_prefix (const gchar *dir)
+{
+  GeglDiskCache *cache;
+  GPtrArray     *entries;
+  GeglBuffer    *buffer;
+  GeglNode      *graph;
+  GeglNode      *source;
+  GeglNode      *node;
+  GeglRectangle  extent;
+  gchar         *path;
+  gchar         *cache_path;
+  gfloat        *pixels;
+  gfloat         expected[4];
+  gboolean       success = TRUE;
+  gint           i;
+
+  path       = g_build_filename (dir, "prefix.gegl", NULL);
+  cache_path = g_build_filename (dir, "prefix-cache", NULL);
+
+  cache = gegl_disk_cache_new (cache_path, 0);
+
+  write_input (path, 64, 48);
+
+  /* the first job stores its result, and the shared prefix */
+  g_free (render_chain (cache, path, TRUE, 0.1, &extent));
+
+  entries = list_entries (cache_path);
+
+  if (entries->len != 2)
+    {
+      printf ("shared prefix: expected 2 cache entries, got %u\n",
+              entries->len);
+      success = FALSE;
+    }
+
+  /* the second job, which only shares the prefix, starts from it */
+  for (i = 0; i < entries->len; i++)
+    plant_entry (entries->pdata[i]);
+
+  g_ptr_array_free (entries, TRUE);
+
+  pixels = render_chain (cache, path, FALSE, 0.2, &extent);
+
+  buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0, 1, 1),
+                            babl_format ("RGBA float"));
+  gegl_buffer_set_color_from_pixel (buffer, NULL, planted,
+                                    babl_format ("RGBA float"));
+
+  graph  = gegl_node_new ();
+  source = gegl_node_new_child (graph,
+                                "operation",  "gegl:buffer-source",
+                                "buffer",     buffer,
+                                NULL);
+  node   = gegl_node_new_child (graph,
+                                "operation",  "gegl:brightness-contrast",
+                                "brightness", 0.2,
+                                NULL);
+  gegl_node_link (source, node);
+  gegl_node_blit (node, 1.0, GEGL_RECTANGLE (0, 0, 1, 1),
+                  babl_format ("RGBA float"), expected,
+                  GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+
+  g_object_unref (graph);
+  g_object_unref (buffer);
+
+  for (i = 0; success && i < 4 * extent.width * extent.height; i++)
+    {
+      if (fabsf (pixels[i] - expected[i % 4]) > 1e-5)
+        {
+          printf ("shared prefix: component %d: expected %f, got %f\n",
+                  i, expected[i % 4], pixels[i]);
+          success = FALSE;
+        }
+    }
+
+  g_free (pixels);
+
+  gegl_disk_cache_free (cache);
+
+  entries = list_entries (cache_path);
+
+  if (entries->len != 3)
+    {
+      printf ("shared prefix: expected 3 cache entries, got %u\n",
+              entries->len);
+      success = FALSE;
+    }
+
+  for (i = 0; i < entries->len; i++)
+    g_unlink (entries->pdata[i]);
+
+  g_ptr_array_free (entries, TRUE);
+
+  g_rmdir (cache_path);
+  g_unlink (path);
+
+  g_free (cache_path);
+  g_free (path);
+
+  return success;
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  const Input inputs[] = {
+    { "gegl:gegl-buffer-load", "path", FALSE, ".gegl" },
+    { "gegl:png-load",         "uri",  TRUE,  ".png"  }
+  };
+  gchar *dir;
+  gint   result = SUCCESS;
+  gint   i;
+
+  gegl_init (&argc, &argv);
+
+  dir = g_dir_make_tmp ("gegl-disk-cache-XXXXXX", NULL);
+
+  for (i = 0; i < G_N_ELEMENTS (inputs); i++)
+    {
+      if (! gegl_has_operation (inputs[i].operation))
+        continue;
+
+      if (! test_input (dir, &inputs[i]))
+        result = FAILURE;
+    }
+
+  if (! test_shared_prefix (dir))
+    result = FAILURE;
+
+  g_rmdir (dir);
+  g_free (dir);
+
+  gegl_exit ();
+
+  return result;
+}
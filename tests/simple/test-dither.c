@@ -0,0 +1,117 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* make sure that error diffusion dithering gives the same result no matter
+ * how many threads it is distributed over.
+ */
+
+#include "config.h"
+#include <stdio.h>
+#include <string.h>
+
+#include "gegl.h"
+
+#define SUCCESS  0
+#define FAILURE -1
+
+#define WIDTH  600
+#define HEIGHT 150
+
+static guint16 *
+dither (GeglBuffer       *input,
+        GeglDitherMethod  method,
+        gint              n_threads)
+{
+  GeglNode *graph;
+  GeglNode *source;
+  GeglNode *node;
+  guint16  *dst;
+
+  g_object_set (gegl_config (), "threads", n_threads, NULL);
+
+  graph  = gegl_node_new ();
+  source = gegl_node_new_child (graph,
+                                "operation",     "gegl:buffer-source",
+                                "buffer",        input,
+                                NULL);
+  node   = gegl_node_new_child (graph,
+                                "operation",     "gegl:dither",
+                                "dither-method", method,
+                                "red-levels",    4,
+                                "green-levels",  5,
+                                "blue-levels",   3,
+                                "alpha-levels",  2,
+                                NULL);
+  gegl_node_link (source, node);
+
+  dst = g_new (guint16, WIDTH * HEIGHT * 4);
+  gegl_node_blit (node, 1.0, GEGL_RECTANGLE (0, 0, WIDTH, HEIGHT),
+                  babl_format ("R'G'B'A u16"), dst,
+                  GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+
+  g_object_unref (graph);
+
+  return dst;
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  const GeglDitherMethod methods[] = { GEGL_DITHER_FLOYD_STEINBERG,
+                                       GEGL_DITHER_JARVIS_JUDICE_NINKE,
+                                       GEGL_DITHER_STUCKI };
+  GeglBuffer *input;
+  GRand      *rand;
+  guint16    *src;
+  gint        result = SUCCESS;
+  gint        i;
+
+  gegl_init (&argc, &argv);
+
+  rand = g_rand_new_with_seed (0);
+  src  = g_new (guint16, WIDTH * HEIGHT * 4);
+
+  for (i = 0; i < WIDTH * HEIGHT * 4; i++)
+    src[i] = g_rand_int_range (rand, 0, 65536);
+
+  input = gegl_buffer_new (GEGL_RECTANGLE (0, 0, WIDTH, HEIGHT),
+                           babl_format ("R'G'B'A u16"));
+  gegl_buffer_set (input, NULL, 0, babl_format ("R'G'B'A u16"), src,
+                   GEGL_AUTO_ROWSTRIDE);
+
+  for (i = 0; i < G_N_ELEMENTS (methods); i++)
+    {
+      guint16 *serial   = dither (input, methods[i], 1);
+      guint16 *parallel = dither (input, methods[i], 4);
+
+      if (memcmp (serial, parallel, WIDTH * HEIGHT * 4 * sizeof (guint16)))
+        {
+          printf ("dither method %d: parallel result differs\n", methods[i]);
+          result = FAILURE;
+        }
+
+      g_free (parallel);
+      g_free (serial);
+    }
+
+  g_object_unref (input);
+  g_free (src);
+  g_rand_free (rand);
+
+  gegl_exit ();
+
+  return result;
+}
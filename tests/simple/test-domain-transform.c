@@ -0,0 +1,297 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* make sure that gegl:domain-transform, which filters its rows and column
+ * blocks in parallel, gives the same result as the serial filter it
+ * replaces, one row, or one column, at a time.
+ */
+
+#include "config.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "gegl.h"
+
+#define SUCCESS  0
+#define FAILURE -1
+
+#define RF_TABLE_SIZE 768
+#define SQRT3 1.7320508075f
+#define SQRT2 1.4142135623f
+
+static GeglBuffer *
+create_input (gint width,
+              gint height)
+{
+  GeglBuffer *input;
+  gfloat     *src;
+  gint        x, y;
+
+  src = g_new (gfloat, 4 * width * height);
+
+  /* smooth gradients, split by hard edges */
+  for (y = 0; y < height; y++)
+    {
+      for (x = 0; x < width; x++)
+        {
+          gfloat *p = src + 4 * (y * width + x);
+
+          p[0] = (gfloat) x / width;
+          p[1] = (gfloat) y / height;
+          p[2] = ((x / 23 + y / 17) % 2) ? 0.9f : 0.1f;
+          p[3] = (x + y) % 3 ? 1.0f : 0.5f;
+        }
+    }
+
+  input = gegl_buffer_new (GEGL_RECTANGLE (0, 0, width, height),
+                           babl_format ("R'G'B'A float"));
+  gegl_buffer_set (input, NULL, 0, babl_format ("R'G'B'A float"), src,
+                   GEGL_AUTO_ROWSTRIDE);
+
+  g_free (src);
+
+  return input;
+}
+
+/* one pass of the recursive filter, along @n pixels @stride floats apart,
+ * with the transforms of the pixels @t_stride apart.
+ */
+static void
+filter_line (gfloat        *pixels,
+             gint           stride,
+             const guint16 *transforms,
+             gint           t_stride,
+             gint           n,
+             const gfloat  *rf_table)
+{
+  gfloat last[4];
+  gint   i, c;
+
+  for (c = 0; c < 4; c++)
+    last[c] = pixels[c];
+
+  for (i = 0; i < n; i++)
+    {
+      gfloat w = rf_table[transforms[i * t_stride]];
+
+      for (c = 0; c < 4; c++)
+        {
+          last[c] = ((1 - w) * pixels[i * stride + c] + w * last[c]);
+          pixels[i * stride + c] = last[c];
+        }
+    }
+
+  for (c = 0; c < 4; c++)
+    last[c] = pixels[(n - 1) * stride + c];
+
+  for (i = n - 1; i >= 0; i--)
+    {
+      gfloat w = rf_table[transforms[MIN (i + 1, n - 1) * t_stride]];
+
+      for (c = 0; c < 4; c++)
+        {
+          last[c] = ((1 - w) * pixels[i * stride + c] + w * last[c]);
+          pixels[i * stride + c] = last[c];
+        }
+    }
+}
+
+static guint16
+transform (const guint8 *current,
+           const guint8 *last)
+{
+  return abs (current[0] - last[0]) +
+         abs (current[1] - last[1]) +
+         abs (current[2] - last[2]);
+}
+
+/* the serial filter, as gegl:domain-transform computed it before */
+static gfloat *
+render_reference (GeglBuffer *input,
+                  gint        n_iterations,
+                  gfloat      spatial_factor,
+                  gfloat      edge_preservation)
+{
+  const GeglRectangle *extent = gegl_buffer_get_extent (input);
+  gint                 width  = extent->width;
+  gint                 height = extent->height;
+  guint8              *src_u8;
+  guint16             *h_transforms;
+  guint16             *v_transforms;
+  gfloat              *pixels;
+  gfloat               range_factor;
+  gint                 x, y, i, n;
+
+  src_u8       = g_new (guint8, 3 * width * height);
+  h_transforms = g_new (guint16, width * height);
+  v_transforms = g_new (guint16, width * height);
+  pixels       = g_new (gfloat, 4 * width * height);
+
+  gegl_buffer_get (input, NULL, 1.0, babl_format ("R'G'B' u8"), src_u8,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_CLAMP);
+  gegl_buffer_get (input, NULL, 1.0, babl_format ("R'G'B'A float"), pixels,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_CLAMP);
+
+  for (y = 0; y < height; y++)
+    {
+      for (x = 0; x < width; x++)
+        {
+          const guint8 *p = src_u8 + 3 * (y * width + x);
+
+          h_transforms[y * width + x] = transform (p, x ? p - 3 : p);
+          v_transforms[y * width + x] = transform (p, y ? p - 3 * width : p);
+        }
+    }
+
+  if (edge_preservation != 0.0)
+    range_factor = (1.0 / edge_preservation) - 1.0f;
+  else
+    range_factor = G_MAXFLOAT;
+
+  for (n = 0; n < n_iterations; n++)
+    {
+      gfloat rf_table[RF_TABLE_SIZE];
+      gfloat sdt_dev;
+      gfloat a;
+
+      sdt_dev = spatial_factor * SQRT3 *
+                          (powf (2.0f, (gfloat)(n_iterations - (n + 1))) /
+                             sqrtf (powf (4.0f, (gfloat) n_iterations) - 1));
+
+      a = expf (-SQRT2 / sdt_dev);
+
+      for (i = 0; i < RF_TABLE_SIZE; i++)
+        {
+          rf_table[i] = powf (a, 1.0f + (spatial_factor / range_factor) *
+                              ((gfloat) i / 255.0f));
+        }
+
+      for (y = 0; y < height; y++)
+        {
+          filter_line (pixels + 4 * y * width, 4,
+                       h_transforms + y * width, 1, width, rf_table);
+        }
+
+      for (x = 0; x < width; x++)
+        {
+          filter_line (pixels + 4 * x, 4 * width,
+                       v_transforms + x, width, height, rf_table);
+        }
+    }
+
+  g_free (v_transforms);
+  g_free (h_transforms);
+  g_free (src_u8);
+
+  return pixels;
+}
+
+static gfloat *
+render (GeglBuffer *input,
+        gint        n_iterations,
+        gdouble     spatial_factor,
+        gdouble     edge_preservation)
+{
+  const GeglRectangle *extent = gegl_buffer_get_extent (input);
+  GeglNode            *graph;
+  GeglNode            *source;
+  GeglNode            *node;
+  gfloat              *dst;
+
+  graph  = gegl_node_new ();
+  source = gegl_node_new_child (graph,
+                                "operation",         "gegl:buffer-source",
+                                "buffer",            input,
+                                NULL);
+  node   = gegl_node_new_child (graph,
+                                "operation",         "gegl:domain-transform",
+                                "n-iterations",      n_iterations,
+                                "spatial-factor",    spatial_factor,
+                                "edge-preservation", edge_preservation,
+                                NULL);
+  gegl_node_link (source, node);
+
+  dst = g_new (gfloat, 4 * extent->width * extent->height);
+
+  gegl_node_blit (node, 1.0, extent, babl_format ("R'G'B'A float"), dst,
+                  GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+
+  g_object_unref (graph);
+
+  return dst;
+}
+
+static gboolean
+test_domain_transform (gint    width,
+                       gint    height,
+                       gint    n_iterations,
+                       gdouble spatial_factor,
+                       gdouble edge_preservation)
+{
+  GeglBuffer *input    = create_input (width, height);
+  gfloat     *result   = render (input, n_iterations,
+                                 spatial_factor, edge_preservation);
+  gfloat     *expected = render_reference (input, n_iterations,
+                                           spatial_factor, edge_preservation);
+  gboolean    success  = TRUE;
+  gint        i;
+
+  /* the filter is computed in the same order either way; the tolerance
+   * only leaves room for the compiler contracting the operations
+   * differently.
+   */
+  for (i = 0; i < 4 * width * height && success; i++)
+    {
+      if (fabsf (result[i] - expected[i]) > 1e-5)
+        {
+          printf ("%dx%d, %d iterations, radius %g, edges %g: "
+                  "component %d: expected %f, got %f\n",
+                  width, height, n_iterations,
+                  spatial_factor, edge_preservation,
+                  i, expected[i], result[i]);
+          success = FALSE;
+        }
+    }
+
+  g_free (expected);
+  g_free (result);
+  g_object_unref (input);
+
+  return success;
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  gint result = SUCCESS;
+
+  gegl_init (&argc, &argv);
+
+  /* sizes which aren't multiples of the column blocks, nor of the rows
+   * the threads are given.
+   */
+  if (! test_domain_transform (203, 117, 3, 30.0, 0.8) ||
+      ! test_domain_transform (512, 300, 2, 5.0,  0.5) ||
+      ! test_domain_transform (1,   64,  1, 10.0, 0.0))
+    {
+      result = FAILURE;
+    }
+
+  gegl_exit ();
+
+  return result;
+}
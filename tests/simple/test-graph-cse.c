@@ -0,0 +1,130 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* make sure that graphs with identical branches, of the form
+ *
+ *          blur -> add(a) --
+ *         /                 v
+ *   color                    add
+ *         \                 ^
+ *          blur -> add(b) --
+ *
+ * render correctly, both while the branches are merged and after
+ * changing one of them.
+ */
+
+#include "config.h"
+#include <math.h>
+#include <stdio.h>
+
+#include "gegl.h"
+
+#define SUCCESS  0
+#define FAILURE -1
+
+static gboolean
+check_output (GeglNode *node,
+              gfloat    expected)
+{
+  gfloat pixel[4];
+
+  gegl_node_blit (node, 1.0, GEGL_RECTANGLE (16, 16, 1, 1),
+                  babl_format ("RGBA float"), pixel,
+                  GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+
+  if (fabsf (pixel[0] - expected) > 1e-4 ||
+      fabsf (pixel[1] - expected) > 1e-4 ||
+      fabsf (pixel[2] - expected) > 1e-4)
+    {
+      printf ("expected %f, got %f, %f, %f\n",
+              expected, pixel[0], pixel[1], pixel[2]);
+
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  GeglNode  *graph;
+  GeglNode  *color;
+  GeglNode  *branches[2];
+  GeglNode  *sum;
+  GeglColor *value;
+  gint       result = SUCCESS;
+  gint       i;
+
+  gegl_init (&argc, &argv);
+
+  graph = gegl_node_new ();
+
+  value = gegl_color_new (NULL);
+  gegl_color_set_rgba (value, 0.25, 0.25, 0.25, 1.0);
+
+  color = gegl_node_new_child (graph,
+                               "operation", "gegl:color",
+                               "value",     value,
+                               NULL);
+
+  for (i = 0; i < 2; i++)
+    {
+      GeglNode *blur;
+
+      blur = gegl_node_new_child (graph,
+                                  "operation", "gegl:gaussian-blur",
+                                  "std-dev-x", 2.0,
+                                  "std-dev-y", 2.0,
+                                  NULL);
+
+      branches[i] = gegl_node_new_child (graph,
+                                         "operation", "gegl:add",
+                                         "value",     0.125,
+                                         NULL);
+
+      gegl_node_link_many (color, blur, branches[i], NULL);
+    }
+
+  sum = gegl_node_new_child (graph,
+                             "operation", "gegl:add",
+                             NULL);
+
+  gegl_node_connect_to (branches[0], "output", sum, "input");
+  gegl_node_connect_to (branches[1], "output", sum, "aux");
+
+  if (! check_output (sum, 0.75))
+    result = FAILURE;
+
+  /* the branches are no longer identical */
+  gegl_node_set (branches[1], "value", 0.25, NULL);
+
+  if (! check_output (sum, 0.875))
+    result = FAILURE;
+
+  /* ... and identical again */
+  gegl_node_set (branches[0], "value", 0.25, NULL);
+
+  if (! check_output (sum, 1.0))
+    result = FAILURE;
+
+  g_object_unref (value);
+  g_object_unref (graph);
+
+  gegl_exit ();
+
+  return result;
+}
@@ -0,0 +1,159 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* make sure that a linear result read by two perceptual consumers gets
+ * written in the perceptual format directly, and renders like it would
+ * when each consumer converts it.
+ */
+
+#include "config.h"
+#include <math.h>
+#include <stdio.h>
+
+#include "gegl.h"
+#include "gegl-plugin.h"
+#include "operation/gegl-operation-context-private.h"
+#include "process/gegl-graph-traversal.h"
+#include "process/gegl-graph-traversal-private.h"
+
+#define SUCCESS  0
+#define FAILURE -1
+
+/* checks that the output buffer of @node, read by @consumer1 and
+ * @consumer2 in the same format, is written in that format.
+ */
+static gboolean
+check_output_format (GeglNode *sink,
+                     GeglNode *node,
+                     GeglNode *consumer1,
+                     GeglNode *consumer2)
+{
+  GeglGraphTraversal   *path = gegl_graph_build (sink);
+  GeglOperationContext *context;
+  GeglOperation        *operation1;
+  GeglOperation        *operation2;
+  const Babl           *format;
+  const Babl           *output_format;
+  gboolean              success = TRUE;
+
+  gegl_graph_prepare (path);
+
+  operation1    = gegl_node_get_gegl_operation (consumer1);
+  operation2    = gegl_node_get_gegl_operation (consumer2);
+  format        = gegl_operation_get_format (operation1, "input");
+  context       = g_hash_table_lookup (path->contexts, node);
+  output_format = context ? context->output_format : NULL;
+
+  if (gegl_operation_get_format (operation2, "input") != format)
+    {
+      printf ("the consumers read the output in different formats\n");
+      success = FALSE;
+    }
+  else if (output_format != format)
+    {
+      printf ("output written in %s, expected %s\n",
+              output_format ? babl_get_name (output_format) : "its own format",
+              babl_get_name (format));
+      success = FALSE;
+    }
+
+  gegl_graph_free (path);
+
+  return success;
+}
+
+static void
+get_pixel (GeglNode *node,
+           gfloat   *pixel)
+{
+  gegl_node_blit (node, 1.0, GEGL_RECTANGLE (8, 8, 1, 1),
+                  babl_format ("RGBA float"), pixel,
+                  GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  GeglNode  *graph;
+  GeglNode  *color;
+  GeglNode  *exposure;
+  GeglNode  *invert;
+  GeglNode  *value_invert;
+  GeglNode  *add;
+  GeglColor *value;
+  gfloat     inverted[4];
+  gfloat     value_inverted[4];
+  gfloat     sum[4];
+  gint       result = SUCCESS;
+  gint       i;
+
+  gegl_init (&argc, &argv);
+
+  graph = gegl_node_new ();
+
+  value = gegl_color_new (NULL);
+  gegl_color_set_rgba (value, 0.125, 0.25, 0.375, 1.0);
+
+  color        = gegl_node_new_child (graph,
+                                      "operation", "gegl:color",
+                                      "value",     value,
+                                      NULL);
+  exposure     = gegl_node_new_child (graph,
+                                      "operation", "gegl:exposure",
+                                      "exposure",  1.0,
+                                      NULL);
+  invert       = gegl_node_new_child (graph,
+                                      "operation", "gegl:invert-gamma",
+                                      NULL);
+  value_invert = gegl_node_new_child (graph,
+                                      "operation", "gegl:value-invert",
+                                      NULL);
+  add          = gegl_node_new_child (graph,
+                                      "operation", "gegl:add",
+                                      NULL);
+
+  gegl_node_link_many (color, exposure, invert, NULL);
+  gegl_node_link (exposure, value_invert);
+  gegl_node_connect_to (invert,       "output", add, "input");
+  gegl_node_connect_to (value_invert, "output", add, "aux");
+
+  /* the exposure is written in the format of its consumers */
+  if (! check_output_format (add, exposure, invert, value_invert))
+    result = FAILURE;
+
+  /* each branch on its own, where the exposure has a single consumer */
+  get_pixel (invert, inverted);
+  get_pixel (value_invert, value_inverted);
+
+  get_pixel (add, sum);
+
+  for (i = 0; i < 3; i++)
+    {
+      if (fabsf (sum[i] - (inverted[i] + value_inverted[i])) > 1e-5)
+        {
+          printf ("component %d: expected %f, got %f\n",
+                  i, inverted[i] + value_inverted[i], sum[i]);
+          result = FAILURE;
+        }
+    }
+
+  g_object_unref (value);
+  g_object_unref (graph);
+
+  gegl_exit ();
+
+  return result;
+}
@@ -0,0 +1,319 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* make sure that chains of color operations, blurs and identities, which
+ * get folded when preparing the graph, render like they would unfolded.
+ */
+
+#include "config.h"
+#include <math.h>
+#include <stdio.h>
+
+#include "gegl.h"
+
+#define SUCCESS  0
+#define FAILURE -1
+
+#define SIZE 32
+
+static gboolean
+check_pixel (GeglNode *node,
+             gfloat    color,
+             gfloat    alpha)
+{
+  gfloat pixel[4];
+
+  gegl_node_blit (node, 1.0, GEGL_RECTANGLE (8, 8, 1, 1),
+                  babl_format ("RGBA float"), pixel,
+                  GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+
+  if (fabsf (pixel[0] - color) > 1e-5 ||
+      fabsf (pixel[1] - color) > 1e-5 ||
+      fabsf (pixel[2] - color) > 1e-5 ||
+      fabsf (pixel[3] - alpha) > 1e-5)
+    {
+      printf ("expected %f, %f, got %f, %f, %f, %f\n",
+              color, alpha, pixel[0], pixel[1], pixel[2], pixel[3]);
+
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+static gboolean
+test_color_chain (void)
+{
+  GeglNode  *graph;
+  GeglNode  *color;
+  GeglNode  *contrast;
+  GeglNode  *nop;
+  GeglNode  *exposure;
+  GeglNode  *opacity;
+  GeglColor *value;
+  gboolean   result = TRUE;
+
+  graph = gegl_node_new ();
+
+  value = gegl_color_new (NULL);
+  gegl_color_set_rgba (value, 0.25, 0.25, 0.25, 1.0);
+
+  color    = gegl_node_new_child (graph,
+                                  "operation", "gegl:color",
+                                  "value",     value,
+                                  NULL);
+  contrast = gegl_node_new_child (graph,
+                                  "operation",  "gegl:brightness-contrast",
+                                  "contrast",   2.0,
+                                  "brightness", 0.1,
+                                  NULL);
+  nop      = gegl_node_new_child (graph,
+                                  "operation", "gegl:nop",
+                                  NULL);
+  exposure = gegl_node_new_child (graph,
+                                  "operation", "gegl:exposure",
+                                  "exposure",  1.0,
+                                  NULL);
+  opacity  = gegl_node_new_child (graph,
+                                  "operation", "gegl:opacity",
+                                  "value",     0.5,
+                                  NULL);
+
+  gegl_node_link_many (color, contrast, nop, exposure, opacity, NULL);
+
+  /* (0.25 - 0.5) * 2 + 0.1 + 0.5 = 0.1, doubled by the exposure */
+  if (! check_pixel (opacity, 0.2, 0.5))
+    result = FALSE;
+
+  /* an identity chain */
+  gegl_node_set (contrast, "contrast", 1.0, "brightness", 0.0, NULL);
+  gegl_node_set (exposure, "exposure", 0.0, NULL);
+
+  if (! check_pixel (opacity, 0.25, 0.5))
+    result = FALSE;
+
+  g_object_unref (value);
+  g_object_unref (graph);
+
+  return result;
+}
+
+static gboolean
+test_blur_chain (void)
+{
+  GeglNode   *graph;
+  GeglNode   *source;
+  GeglNode   *crop;
+  GeglNode   *blurs[3];
+  GeglNode   *single;
+  gfloat     *folded;
+  gfloat     *expected;
+  gboolean    result = TRUE;
+  gint        i;
+
+  graph = gegl_node_new ();
+
+  source = gegl_node_new_child (graph,
+                                "operation", "gegl:checkerboard",
+                                "x",         4,
+                                "y",         4,
+                                NULL);
+  crop   = gegl_node_new_child (graph,
+                                "operation", "gegl:crop",
+                                "width",     (gdouble) SIZE,
+                                "height",    (gdouble) SIZE,
+                                NULL);
+
+  blurs[0] = gegl_node_new_child (graph,
+                                  "operation",    "gegl:gaussian-blur",
+                                  "std-dev-x",    3.0,
+                                  "std-dev-y",    0.0,
+                                  "filter",       1, /* fir */
+                                  "abyss-policy", 0, /* none */
+                                  "clip-extent",  FALSE,
+                                  NULL);
+  blurs[1] = gegl_node_new_child (graph,
+                                  "operation",    "gegl:gaussian-blur",
+                                  "std-dev-x",    4.0,
+                                  "std-dev-y",    3.0,
+                                  "filter",       1,
+                                  "abyss-policy", 0,
+                                  "clip-extent",  FALSE,
+                                  NULL);
+  blurs[2] = gegl_node_new_child (graph,
+                                  "operation",    "gegl:gaussian-blur",
+                                  "std-dev-x",    0.0,
+                                  "std-dev-y",    4.0,
+                                  "filter",       1,
+                                  "abyss-policy", 0,
+                                  "clip-extent",  FALSE,
+                                  NULL);
+  single   = gegl_node_new_child (graph,
+                                  "operation",    "gegl:gaussian-blur",
+                                  "std-dev-x",    5.0,
+                                  "std-dev-y",    5.0,
+                                  "filter",       1,
+                                  "abyss-policy", 0,
+                                  "clip-extent",  FALSE,
+                                  NULL);
+
+  gegl_node_link_many (source, crop, blurs[0], blurs[1], blurs[2], NULL);
+  gegl_node_link (crop, single);
+
+  folded   = g_new (gfloat, SIZE * SIZE * 4);
+  expected = g_new (gfloat, SIZE * SIZE * 4);
+
+  gegl_node_blit (blurs[2], 1.0, GEGL_RECTANGLE (0, 0, SIZE, SIZE),
+                  babl_format ("RGBA float"), folded,
+                  GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+  gegl_node_blit (single, 1.0, GEGL_RECTANGLE (0, 0, SIZE, SIZE),
+                  babl_format ("RGBA float"), expected,
+                  GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+
+  /* blurring in several steps only differs from a single blur in how the
+   * kernels are truncated
+   */
+  for (i = 0; i < SIZE * SIZE * 4; i++)
+    {
+      if (fabsf (folded[i] - expected[i]) > 1e-2)
+        {
+          printf ("blur chain differs at %d: %f, expected %f\n",
+                  i / 4, folded[i], expected[i]);
+          result = FALSE;
+          break;
+        }
+    }
+
+  g_free (folded);
+  g_free (expected);
+  g_object_unref (graph);
+
+  return result;
+}
+
+/* blurs which clip their result, or fill the abyss, aren't folded, and
+ * render exactly like blurring each step into a buffer of its own.
+ */
+static gboolean
+test_clipped_blur_chain (void)
+{
+  GeglNode   *graph;
+  GeglNode   *source;
+  GeglNode   *crop;
+  GeglNode   *blur1;
+  GeglNode   *blur2;
+  GeglNode   *buffer_source;
+  GeglNode   *blur3;
+  GeglBuffer *buffer;
+  gfloat     *chained;
+  gfloat     *expected;
+  gboolean    result = TRUE;
+  gint        i;
+
+  graph = gegl_node_new ();
+
+  source = gegl_node_new_child (graph,
+                                "operation", "gegl:checkerboard",
+                                "x",         4,
+                                "y",         4,
+                                NULL);
+  crop   = gegl_node_new_child (graph,
+                                "operation", "gegl:crop",
+                                "width",     (gdouble) SIZE,
+                                "height",    (gdouble) SIZE,
+                                NULL);
+  blur1  = gegl_node_new_child (graph,
+                                "operation", "gegl:gaussian-blur",
+                                "std-dev-x", 3.0,
+                                "std-dev-y", 3.0,
+                                "filter",    1,
+                                NULL);
+  blur2  = gegl_node_new_child (graph,
+                                "operation", "gegl:gaussian-blur",
+                                "std-dev-x", 4.0,
+                                "std-dev-y", 4.0,
+                                "filter",    1,
+                                NULL);
+
+  gegl_node_link_many (source, crop, blur1, blur2, NULL);
+
+  buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0, SIZE, SIZE),
+                            babl_format ("RGBA float"));
+
+  gegl_node_blit_buffer (blur1, buffer, NULL, 0, GEGL_ABYSS_NONE);
+
+  buffer_source = gegl_node_new_child (graph,
+                                       "operation", "gegl:buffer-source",
+                                       "buffer",    buffer,
+                                       NULL);
+  blur3         = gegl_node_new_child (graph,
+                                       "operation", "gegl:gaussian-blur",
+                                       "std-dev-x", 4.0,
+                                       "std-dev-y", 4.0,
+                                       "filter",    1,
+                                       NULL);
+
+  gegl_node_link (buffer_source, blur3);
+
+  chained  = g_new (gfloat, SIZE * SIZE * 4);
+  expected = g_new (gfloat, SIZE * SIZE * 4);
+
+  gegl_node_blit (blur2, 1.0, GEGL_RECTANGLE (0, 0, SIZE, SIZE),
+                  babl_format ("RGBA float"), chained,
+                  GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+  gegl_node_blit (blur3, 1.0, GEGL_RECTANGLE (0, 0, SIZE, SIZE),
+                  babl_format ("RGBA float"), expected,
+                  GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+
+  for (i = 0; i < SIZE * SIZE * 4; i++)
+    {
+      if (fabsf (chained[i] - expected[i]) > 1e-5)
+        {
+          printf ("clipped blur chain differs at %d: %f, expected %f\n",
+                  i / 4, chained[i], expected[i]);
+          result = FALSE;
+          break;
+        }
+    }
+
+  g_free (chained);
+  g_free (expected);
+  g_object_unref (buffer);
+  g_object_unref (graph);
+
+  return result;
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  gint result = SUCCESS;
+
+  gegl_init (&argc, &argv);
+
+  if (! test_color_chain ())
+    result = FAILURE;
+
+  if (! test_blur_chain ())
+    result = FAILURE;
+
+  if (! test_clipped_blur_chain ())
+    result = FAILURE;
+
+  gegl_exit ();
+
+  return result;
+}
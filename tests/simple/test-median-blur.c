@@ -0,0 +1,156 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* make sure that the constant-time median of square neighborhoods matches
+ * the median computed by sorting each neighborhood.
+ */
+
+#include "config.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "gegl.h"
+
+#define SUCCESS  0
+#define FAILURE -1
+
+#define WIDTH  97
+#define HEIGHT 61
+#define RADIUS 11
+
+static int
+compare_values (const void *a,
+                const void *b)
+{
+  return *(const guchar *) a - *(const guchar *) b;
+}
+
+static gint
+test_percentile (const guchar *src,
+                 gdouble       percentile)
+{
+  GeglBuffer *input;
+  GeglNode   *graph;
+  GeglNode   *source;
+  GeglNode   *median;
+  guchar     *dst;
+  guchar     *values;
+  gint        n_values = (2 * RADIUS + 1) * (2 * RADIUS + 1);
+  gint        index;
+  gint        result   = SUCCESS;
+  gint        x, y, c;
+
+  input = gegl_buffer_new (GEGL_RECTANGLE (0, 0, WIDTH, HEIGHT),
+                           babl_format ("R'G'B' u8"));
+  gegl_buffer_set (input, NULL, 0, babl_format ("R'G'B' u8"), src,
+                   GEGL_AUTO_ROWSTRIDE);
+
+  graph  = gegl_node_new ();
+  source = gegl_node_new_child (graph,
+                                "operation",    "gegl:buffer-source",
+                                "buffer",       input,
+                                NULL);
+  median = gegl_node_new_child (graph,
+                                "operation",    "gegl:median-blur",
+                                "neighborhood", 0, /* square */
+                                "radius",       RADIUS,
+                                "percentile",   percentile,
+                                "abyss-policy", 1, /* clamp */
+                                NULL);
+  gegl_node_link (source, median);
+
+  dst = g_new (guchar, WIDTH * HEIGHT * 3);
+  gegl_node_blit (median, 1.0, GEGL_RECTANGLE (0, 0, WIDTH, HEIGHT),
+                  babl_format ("R'G'B' u8"), dst,
+                  GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+
+  values = g_new (guchar, n_values);
+  index  = MAX ((gint) ceil (n_values * percentile / 100.0), 1) - 1;
+
+  for (y = 0; y < HEIGHT && result == SUCCESS; y++)
+    {
+      for (x = 0; x < WIDTH && result == SUCCESS; x++)
+        {
+          for (c = 0; c < 3; c++)
+            {
+              gint n = 0;
+              gint i, j;
+
+              for (j = -RADIUS; j <= RADIUS; j++)
+                {
+                  for (i = -RADIUS; i <= RADIUS; i++)
+                    {
+                      gint sx = CLAMP (x + i, 0, WIDTH  - 1);
+                      gint sy = CLAMP (y + j, 0, HEIGHT - 1);
+
+                      values[n++] = src[(sy * WIDTH + sx) * 3 + c];
+                    }
+                }
+
+              qsort (values, n_values, 1, compare_values);
+
+              if (dst[(y * WIDTH + x) * 3 + c] != values[index])
+                {
+                  printf ("percentile %g, pixel (%d, %d), component %d: "
+                          "expected %d, got %d\n",
+                          percentile, x, y, c,
+                          values[index], dst[(y * WIDTH + x) * 3 + c]);
+                  result = FAILURE;
+                  break;
+                }
+            }
+        }
+    }
+
+  g_free (values);
+  g_free (dst);
+  g_object_unref (graph);
+  g_object_unref (input);
+
+  return result;
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  GRand  *rand;
+  guchar *src;
+  gint    result = SUCCESS;
+  gint    i;
+
+  gegl_init (&argc, &argv);
+
+  rand = g_rand_new_with_seed (0);
+  src  = g_new (guchar, WIDTH * HEIGHT * 3);
+
+  for (i = 0; i < WIDTH * HEIGHT * 3; i++)
+    src[i] = g_rand_int_range (rand, 0, 256);
+
+  if (test_percentile (src, 50.0) != SUCCESS ||
+      test_percentile (src, 10.0) != SUCCESS ||
+      test_percentile (src, 90.0) != SUCCESS)
+    {
+      result = FAILURE;
+    }
+
+  g_free (src);
+  g_rand_free (rand);
+
+  gegl_exit ();
+
+  return result;
+}
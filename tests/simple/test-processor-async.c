@@ -0,0 +1,186 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* make sure that asynchronous processors deliver every chunk of their
+ * rectangle, that cancelling one stops it early and reports the
+ * cancellation, and that it then resumes where it stopped.
+ */
+
+#include "config.h"
+
+#include "gegl.h"
+
+#define SUCCESS  0
+#define FAILURE -1
+
+#define SIZE     1024
+#define TIMEOUT  (60 * G_TIME_SPAN_SECOND)
+
+typedef struct
+{
+  gboolean cancel_on_first_chunk;
+  gboolean resume;
+  gint     n_chunks;
+  gint     area;
+  gboolean done;
+  gboolean cancelled;
+} Job;
+
+static GMutex mutex;
+static GCond  cond;
+
+static void
+chunk_func (GeglProcessor       *processor,
+            const GeglRectangle *rectangle,
+            gpointer             user_data)
+{
+  Job *job = user_data;
+
+  job->n_chunks++;
+  job->area += rectangle->width * rectangle->height;
+
+  if (job->cancel_on_first_chunk)
+    gegl_processor_cancel (processor);
+}
+
+static void
+done_func (GeglProcessor *processor,
+           gboolean       cancelled,
+           gpointer       user_data)
+{
+  Job *job = user_data;
+
+  g_mutex_lock (&mutex);
+
+  job->cancelled = cancelled;
+  job->done      = TRUE;
+  g_cond_signal (&cond);
+
+  g_mutex_unlock (&mutex);
+}
+
+static gboolean
+wait_job (Job *job)
+{
+  gint64 end_time = g_get_monotonic_time () + TIMEOUT;
+
+  g_mutex_lock (&mutex);
+
+  while (! job->done)
+    {
+      if (! g_cond_wait_until (&cond, &mutex, end_time))
+        break;
+    }
+
+  g_mutex_unlock (&mutex);
+
+  if (! job->done)
+    g_print ("timeout expired.\n");
+
+  return job->done;
+}
+
+static gboolean
+run_job (Job *job)
+{
+  GeglRectangle  rect = {0, 0, SIZE, SIZE};
+  GeglColor     *color;
+  GeglNode      *graph;
+  GeglNode      *source;
+  GeglNode      *node;
+  GeglProcessor *processor;
+  gboolean       success;
+
+  color = gegl_color_new ("rgb(0.2, 0.4, 0.6)");
+
+  graph  = gegl_node_new ();
+  source = gegl_node_new_child (graph,
+                                "operation", "gegl:color",
+                                "value",     color,
+                                NULL);
+  node   = gegl_node_new_child (graph,
+                                "operation", "gegl:crop",
+                                "width",     (gdouble) SIZE,
+                                "height",    (gdouble) SIZE,
+                                NULL);
+  gegl_node_link (source, node);
+
+  processor = g_object_new (GEGL_TYPE_PROCESSOR,
+                            "node",      node,
+                            "chunksize", 128 * 128,
+                            "rectangle", &rect,
+                            NULL);
+
+  gegl_processor_set_priority (processor, G_PRIORITY_HIGH);
+  gegl_processor_work_async (processor, chunk_func, done_func, job);
+
+  success = wait_job (job);
+
+  /* render the rest of the rectangle */
+  if (success && job->resume)
+    {
+      job->cancel_on_first_chunk = FALSE;
+      job->done                  = FALSE;
+
+      gegl_processor_work_async (processor, chunk_func, done_func, job);
+
+      success = wait_job (job);
+    }
+
+  g_object_unref (processor);
+  g_object_unref (graph);
+  g_object_unref (color);
+
+  return success;
+}
+
+int main (int argc, char **argv)
+{
+  Job full    = {FALSE, };
+  Job partial = {TRUE, };
+  Job resumed = {TRUE, TRUE, };
+  int result  = SUCCESS;
+
+  gegl_init (&argc, &argv);
+
+  if (! run_job (&full) || full.cancelled || full.area != SIZE * SIZE)
+    {
+      g_print ("async render incomplete: %d of %d pixels in %d chunks%s\n",
+               full.area, SIZE * SIZE, full.n_chunks,
+               full.cancelled ? " (cancelled)" : "");
+      result = FAILURE;
+    }
+
+  if (! run_job (&partial) || ! partial.cancelled || partial.n_chunks != 1)
+    {
+      g_print ("cancelled render delivered %d chunks%s\n",
+               partial.n_chunks,
+               partial.cancelled ? "" : " (not cancelled)");
+      result = FAILURE;
+    }
+
+  if (! run_job (&resumed) || resumed.cancelled ||
+      resumed.area != SIZE * SIZE)
+    {
+      g_print ("resumed render incomplete: %d of %d pixels in %d chunks%s\n",
+               resumed.area, SIZE * SIZE, resumed.n_chunks,
+               resumed.cancelled ? " (cancelled)" : "");
+      result = FAILURE;
+    }
+
+  gegl_exit ();
+
+  return result;
+}
@@ -0,0 +1,185 @@
+/* This file is a test-case for GEGL
+ *
+ * GEGL is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * GEGL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* make sure that scratch memory of all size classes is usable and aligned,
+ * that scopes free the memory allocated within them, and that memory
+ * allocated outside of a scope can be freed by another thread.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "gegl.h"
+
+
+#define SUCCESS    0
+#define FAILURE    -1
+
+#define N_BLOCKS   64
+#define ALIGNMENT  16
+
+#define SMALL_SIZE 1000
+#define LARGE_SIZE (4 << 20)
+
+
+static gboolean
+check_block (guint8 *block,
+             gsize   size,
+             guint8  value)
+{
+  gsize i;
+
+  for (i = 0; i < size; i++)
+    {
+      if (block[i] != value)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+static gpointer
+free_blocks (gpointer data)
+{
+  gpointer *blocks = data;
+  gint      i;
+
+  for (i = 0; i < N_BLOCKS; i++)
+    gegl_scratch_free (blocks[i]);
+
+  return NULL;
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  gpointer blocks[N_BLOCKS];
+  gsize    sizes[N_BLOCKS];
+  gpointer small;
+  guint64  total_before;
+  guint64  total_after;
+  GThread *thread;
+  gint     result = SUCCESS;
+  gint     i;
+
+  gegl_init (&argc, &argv);
+
+  /* sizes spanning all the size classes, and beyond */
+  for (i = 0; i < N_BLOCKS; i++)
+    {
+      sizes[i]  = ((gsize) 1 << (i % 22)) + i;
+      blocks[i] = gegl_scratch_alloc (sizes[i]);
+
+      if ((guintptr) blocks[i] % ALIGNMENT)
+        {
+          printf ("block of %" G_GSIZE_FORMAT " bytes is misaligned\n",
+                  sizes[i]);
+
+          result = FAILURE;
+        }
+
+      memset (blocks[i], i, sizes[i]);
+    }
+
+  for (i = 0; i < N_BLOCKS; i++)
+    {
+      if (! check_block (blocks[i], sizes[i], i))
+        {
+          printf ("block of %" G_GSIZE_FORMAT " bytes was overwritten\n",
+                  sizes[i]);
+
+          result = FAILURE;
+        }
+    }
+
+  /* memory allocated outside of a scope may be freed by another thread */
+  thread = g_thread_new ("free-blocks", free_blocks, blocks);
+  g_thread_join (thread);
+
+  /* nested scopes, with some of the memory freed explicitly */
+  gegl_scratch_begin ();
+
+  for (i = 0; i < N_BLOCKS; i++)
+    {
+      if (i == N_BLOCKS / 2)
+        gegl_scratch_begin ();
+
+      blocks[i] = gegl_scratch_alloc0 (sizes[i]);
+
+      if (! check_block (blocks[i], sizes[i], 0))
+        {
+          printf ("block of %" G_GSIZE_FORMAT " bytes isn't cleared\n",
+                  sizes[i]);
+
+          result = FAILURE;
+        }
+
+      if (i % 3 == 0)
+        gegl_scratch_free (blocks[i]);
+    }
+
+  gegl_scratch_end ();
+
+  /* the outer scope's memory is still usable */
+  for (i = 0; i < N_BLOCKS / 2; i++)
+    {
+      if (i % 3)
+        memset (blocks[i], i, sizes[i]);
+    }
+
+  gegl_scratch_end ();
+
+  /* ending a scope frees the memory allocated within it: blocks too large
+   * for the free lists are released, and the others are reused
+   */
+  g_object_get (gegl_stats (), "scratch-total", &total_before, NULL);
+
+  gegl_scratch_begin ();
+
+  gegl_scratch_alloc (LARGE_SIZE);
+  small = gegl_scratch_alloc (SMALL_SIZE);
+
+  gegl_scratch_end ();
+
+  g_object_get (gegl_stats (), "scratch-total", &total_after, NULL);
+
+  if (total_after >= total_before + LARGE_SIZE)
+    {
+      printf ("block of %d bytes wasn't freed by the end of its scope\n",
+              LARGE_SIZE);
+
+      result = FAILURE;
+    }
+
+  blocks[0] = gegl_scratch_alloc (SMALL_SIZE);
+
+  if (blocks[0] != small)
+    {
+      printf ("block of %d bytes wasn't reused after the end of its scope\n",
+              SMALL_SIZE);
+
+      result = FAILURE;
+    }
+
+  gegl_scratch_free (blocks[0]);
+
+  gegl_exit ();
+
+  return result;
+}
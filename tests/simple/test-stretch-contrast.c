@@ -0,0 +1,162 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* make sure that gegl:stretch-contrast stretches each part of the output
+ * according to the whole input, and follows changes to the input.
+ */
+
+#include "config.h"
+#include <math.h>
+#include <stdio.h>
+
+#include "gegl.h"
+
+#define SUCCESS  0
+#define FAILURE -1
+
+#define WIDTH  300
+#define HEIGHT 200
+
+static gboolean
+check_rect (GeglNode            *node,
+            const gfloat        *src,
+            const GeglRectangle *rect)
+{
+  gfloat   min[3] = {  G_MAXFLOAT,  G_MAXFLOAT,  G_MAXFLOAT };
+  gfloat   max[3] = { -G_MAXFLOAT, -G_MAXFLOAT, -G_MAXFLOAT };
+  gfloat  *dst;
+  gboolean success = TRUE;
+  gint     x, y, c;
+
+  for (x = 0; x < WIDTH * HEIGHT; x++)
+    {
+      for (c = 0; c < 3; c++)
+        {
+          min[c] = MIN (min[c], src[4 * x + c]);
+          max[c] = MAX (max[c], src[4 * x + c]);
+        }
+    }
+
+  dst = g_new (gfloat, 4 * rect->width * rect->height);
+
+  gegl_node_blit (node, 1.0, rect, babl_format ("RGBA float"), dst,
+                  GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+
+  for (y = 0; y < rect->height && success; y++)
+    {
+      for (x = 0; x < rect->width && success; x++)
+        {
+          const gfloat *s = src + 4 * ((rect->y + y) * WIDTH + rect->x + x);
+          const gfloat *d = dst + 4 * (y * rect->width + x);
+
+          for (c = 0; c < 3; c++)
+            {
+              gfloat expected = (s[c] - min[c]) / (max[c] - min[c]);
+
+              if (fabsf (d[c] - expected) > 1e-5)
+                {
+                  printf ("pixel (%d, %d), component %d: "
+                          "expected %f, got %f\n",
+                          rect->x + x, rect->y + y, c, expected, d[c]);
+                  success = FALSE;
+                }
+            }
+        }
+    }
+
+  g_free (dst);
+
+  return success;
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  GeglNode   *graph;
+  GeglNode   *source;
+  GeglNode   *node;
+  GeglBuffer *input;
+  GRand      *rand;
+  gfloat     *src;
+  guint       revision;
+  gint        result = SUCCESS;
+  gint        i;
+
+  gegl_init (&argc, &argv);
+
+  rand = g_rand_new_with_seed (0);
+  src  = g_new (gfloat, 4 * WIDTH * HEIGHT);
+
+  for (i = 0; i < 4 * WIDTH * HEIGHT; i++)
+    src[i] = g_rand_double_range (rand, 0.25, 0.75);
+
+  input = gegl_buffer_new (GEGL_RECTANGLE (0, 0, WIDTH, HEIGHT),
+                           babl_format ("RGBA float"));
+  gegl_buffer_set (input, NULL, 0, babl_format ("RGBA float"), src,
+                   GEGL_AUTO_ROWSTRIDE);
+
+  graph  = gegl_node_new ();
+  source = gegl_node_new_child (graph,
+                                "operation",   "gegl:buffer-source",
+                                "buffer",      input,
+                                NULL);
+  node   = gegl_node_new_child (graph,
+                                "operation",   "gegl:stretch-contrast",
+                                "keep-colors", FALSE,
+                                NULL);
+  gegl_node_link (source, node);
+
+  /* parts of the output, each of which has a narrower range */
+  if (! check_rect (node, src, GEGL_RECTANGLE (0, 0, WIDTH, HEIGHT / 2)) ||
+      ! check_rect (node, src, GEGL_RECTANGLE (WIDTH / 3, HEIGHT / 2,
+                                               WIDTH / 3, HEIGHT / 4)))
+    {
+      result = FAILURE;
+    }
+
+  /* widen the range of the input, outside of the next rendered part */
+  revision = gegl_buffer_get_revision (input);
+
+  src[0] = 0.0f;
+  src[4 * (WIDTH * HEIGHT - 1) + 1] = 1.0f;
+
+  gegl_buffer_set (input, GEGL_RECTANGLE (0, 0, 1, 1), 0,
+                   babl_format ("RGBA float"), src, GEGL_AUTO_ROWSTRIDE);
+  gegl_buffer_set (input, GEGL_RECTANGLE (WIDTH - 1, HEIGHT - 1, 1, 1), 0,
+                   babl_format ("RGBA float"),
+                   src + 4 * (WIDTH * HEIGHT - 1), GEGL_AUTO_ROWSTRIDE);
+
+  if (gegl_buffer_get_revision (input) == revision)
+    {
+      printf ("the revision of the input didn't change\n");
+      result = FAILURE;
+    }
+
+  if (! check_rect (node, src, GEGL_RECTANGLE (WIDTH / 3, HEIGHT / 2,
+                                               WIDTH / 3, HEIGHT / 4)))
+    {
+      result = FAILURE;
+    }
+
+  g_object_unref (graph);
+  g_object_unref (input);
+  g_free (src);
+  g_rand_free (rand);
+
+  gegl_exit ();
+
+  return result;
+}
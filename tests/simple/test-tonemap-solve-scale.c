@@ -0,0 +1,188 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* make sure that the "solve-scale" of the tone mapping operations leaves
+ * small images, whose solve size can't be reduced, untouched, and that
+ * solving larger images at a lower scale gives a close approximation of
+ * solving them at full size.
+ */
+
+#include "config.h"
+#include <math.h>
+#include <stdio.h>
+
+#include "gegl.h"
+
+#define SUCCESS  0
+#define FAILURE -1
+
+static GeglBuffer *
+create_input (gint width,
+              gint height)
+{
+  GeglBuffer *input;
+  gfloat     *src;
+  gint        x, y;
+
+  src = g_new (gfloat, 3 * width * height);
+
+  /* a smooth, high dynamic range, input */
+  for (y = 0; y < height; y++)
+    {
+      for (x = 0; x < width; x++)
+        {
+          gfloat *p   = src + 3 * (y * width + x);
+          gfloat  lum = 0.01f * exp2f (8.0f * x / width) *
+                        (1.0f + 0.5f * sinf (4.0f * G_PI * y / height));
+
+          p[0] = lum;
+          p[1] = 0.8f * lum;
+          p[2] = 0.6f * lum;
+        }
+    }
+
+  input = gegl_buffer_new (GEGL_RECTANGLE (0, 0, width, height),
+                           babl_format ("RGB float"));
+  gegl_buffer_set (input, NULL, 0, babl_format ("RGB float"), src,
+                   GEGL_AUTO_ROWSTRIDE);
+
+  g_free (src);
+
+  return input;
+}
+
+static gfloat *
+render (GeglBuffer  *input,
+        const gchar *operation,
+        gdouble      solve_scale)
+{
+  const GeglRectangle *extent = gegl_buffer_get_extent (input);
+  GeglNode            *graph;
+  GeglNode            *source;
+  GeglNode            *node;
+  gfloat              *dst;
+
+  graph  = gegl_node_new ();
+  source = gegl_node_new_child (graph,
+                                "operation",   "gegl:buffer-source",
+                                "buffer",      input,
+                                NULL);
+  node   = gegl_node_new_child (graph,
+                                "operation",   operation,
+                                "solve-scale", solve_scale,
+                                NULL);
+  gegl_node_link (source, node);
+
+  dst = g_new (gfloat, 3 * extent->width * extent->height);
+
+  gegl_node_blit (node, 1.0, extent, babl_format ("RGB float"), dst,
+                  GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+
+  g_object_unref (graph);
+
+  return dst;
+}
+
+static gboolean
+test_small_image (const gchar *operation)
+{
+  GeglBuffer *input    = create_input (100, 80);
+  gfloat     *full     = render (input, operation, 1.0);
+  gfloat     *reduced  = render (input, operation, 0.25);
+  gboolean    success  = TRUE;
+  gint        i;
+
+  /* the solve size is already below its minimum, so that the image is
+   * solved at full size either way.
+   */
+  for (i = 0; i < 3 * 100 * 80 && success; i++)
+    {
+      if (full[i] != reduced[i])
+        {
+          printf ("%s: small image, component %d: expected %f, got %f\n",
+                  operation, i, full[i], reduced[i]);
+          success = FALSE;
+        }
+    }
+
+  g_free (reduced);
+  g_free (full);
+  g_object_unref (input);
+
+  return success;
+}
+
+static gboolean
+test_large_image (const gchar *operation)
+{
+  GeglBuffer *input    = create_input (512, 256);
+  gfloat     *full     = render (input, operation, 1.0);
+  gfloat     *reduced  = render (input, operation, 0.5);
+  gboolean    success  = TRUE;
+  gdouble     diff     = 0.0;
+  gint        n        = 3 * 512 * 256;
+  gint        i;
+
+  for (i = 0; i < n && success; i++)
+    {
+      if (! isfinite (reduced[i]))
+        {
+          printf ("%s: large image, component %d isn't finite\n",
+                  operation, i);
+          success = FALSE;
+        }
+
+      diff += fabsf (full[i] - reduced[i]);
+    }
+
+  diff /= n;
+
+  if (success && diff > 0.1)
+    {
+      printf ("%s: large image, average difference %f is too large\n",
+              operation, diff);
+      success = FALSE;
+    }
+
+  g_free (reduced);
+  g_free (full);
+  g_object_unref (input);
+
+  return success;
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  const gchar *operations[] = {"gegl:fattal02", "gegl:mantiuk06"};
+  gint         result       = SUCCESS;
+  gint         i;
+
+  gegl_init (&argc, &argv);
+
+  for (i = 0; i < G_N_ELEMENTS (operations); i++)
+    {
+      if (! test_small_image (operations[i]) ||
+          ! test_large_image (operations[i]))
+        {
+          result = FAILURE;
+        }
+    }
+
+  gegl_exit ();
+
+  return result;
+}